@@ -1,7 +1,9 @@
 #pragma once
 
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h> // For HRESULT
+#endif
 #include <stdexcept>
 
 // From DXSampleHelper.h 
@@ -1,10 +1,32 @@
 #include "dxpch.h"
 #include "Application.h"
+#include "Profiler.h"
 
 Application* Application::s_instance = nullptr;
 
+namespace
+{
+	void printDebugMessage(const char* message)
+	{
+#if defined(_WIN32)
+		::OutputDebugStringA(message);
+#endif
+		fputs(message, stdout);
+	}
+
+	void printBarrierStats(const char* label, const ResourceStateTracker::BarrierStats& stats, uint64_t numFrames)
+	{
+		double n = static_cast<double>(std::max<uint64_t>(numFrames, 1));
+		char buffer[500];
+		snprintf(buffer, 500, "Barriers (%s): requested %.1f, submitted %.1f, elided %.1f, merged %.1f, split %.1f\n",
+			label, stats.numRequested / n, stats.numSubmitted / n, stats.numElided / n, stats.numMerged / n, stats.numSplit / n);
+		printDebugMessage(buffer);
+	}
+}
+
 Application::Application(const WindowSettings& windowSettings, Game* game)
-	:	m_game(game)
+	:	m_game(game),
+		m_frameCount(0)
 {
 	if (s_instance == nullptr)
 	{
@@ -12,32 +34,45 @@ Application::Application(const WindowSettings& windowSettings, Game* game)
 	}
 	else
 	{
-		OutputDebugString(L"Should not create 2 applications!");
+		printDebugMessage("Should not create 2 applications!\n");
 	}
 
-	// Windows 10 Creators update adds Per Monitor V2 DPI awareness context.
-	// Using this awareness context allows the client area of the window 
-	// to achieve 100% scaling while still allowing non-client window content to 
-	// be rendered in a DPI sensitive fashion.
-	SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+#if defined(_WIN32)
+	if (!windowSettings.headless)
+	{
+		// Windows 10 Creators update adds Per Monitor V2 DPI awareness context.
+		// Using this awareness context allows the client area of the window 
+		// to achieve 100% scaling while still allowing non-client window content to 
+		// be rendered in a DPI sensitive fashion.
+		SetThreadDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
 
-	ComPtr<IDXGIAdapter4> adapter = getAdapter(USE_WARP_ADAPTER);
-	m_device = createDevice(adapter);
+		m_device = Device::CreateD3D12Device(USE_WARP_ADAPTER);
+	}
+	else
+#endif
+	{
+		m_device = Device::CreateNullDevice();
+	}
 
 	m_window = m_game->Initialize(windowSettings);
 }
 
 Application::~Application()
 {
-
+	if (s_instance == this)
+	{
+		s_instance = nullptr;
+	}
 }
 
 void Application::run()
 {
 	m_frameCount = 0;
+	m_totalBarrierStats = {};
 
 	m_isRunning = true;
 
+#if defined(_WIN32)
 	m_window->show();
 
 	MSG msg = {};
@@ -49,12 +84,60 @@ void Application::run()
 			::DispatchMessage(&msg);
 		}
 	}
+#endif
 
 	m_isRunning = false;
 
 	m_game->Destory();
 }
 
+void Application::runHeadless(uint64_t numFrames)
+{
+	m_frameCount = 0;
+	m_totalBarrierStats = {};
+
+	m_isRunning = true;
+
+	std::chrono::high_resolution_clock clock;
+	double totalMilliseconds = 0.0;
+	double minMilliseconds = std::numeric_limits<double>::max();
+	double maxMilliseconds = 0.0;
+
+	for (uint64_t i = 0; i < numFrames; ++i)
+	{
+		auto t0 = clock.now();
+
+		Event e(EventType::WindowUpdate);
+		onEvent(e);
+
+		std::chrono::duration<double, std::milli> frameTime = clock.now() - t0;
+		totalMilliseconds += frameTime.count();
+		minMilliseconds = std::min(minMilliseconds, frameTime.count());
+		maxMilliseconds = std::max(maxMilliseconds, frameTime.count());
+	}
+
+	m_isRunning = false;
+
+	m_game->Destory();
+
+	if (numFrames > 0)
+	{
+		char buffer[500];
+		snprintf(buffer, 500, "%s: %llu frames, CPU frame time avg %.4f ms, min %.4f ms, max %.4f ms\n",
+			m_device->isNullDevice() ? "Null device" : "D3D12 device", static_cast<unsigned long long>(numFrames),
+			totalMilliseconds / numFrames, minMilliseconds, maxMilliseconds);
+		printDebugMessage(buffer);
+		std::string frameSummary = m_game->getFrameSummary();
+		if (!frameSummary.empty())
+		{
+			printDebugMessage((frameSummary + "\n").c_str());
+		}
+		printDebugMessage(Profiler::GetReport().c_str());
+		printBarrierStats("avg per frame", m_totalBarrierStats, numFrames);
+		printDebugMessage(m_game->getReport().c_str());
+	}
+}
+
 void Application::update()
 {
 	static uint64_t frameCounter = 0;
@@ -71,23 +154,34 @@ void Application::update()
 	{
 		char buffer[500];
 		auto fps = frameCounter / elapsedSeconds;
-		sprintf_s(buffer, 500, "FPS: %f\n", fps);
-		wchar_t wbuffer[500];
-		size_t converted;
-		::mbstowcs_s(&converted, wbuffer, buffer, strlen(buffer) + 1);
-		LPWSTR str = wbuffer;
-		OutputDebugString(str);
+		std::string frameSummary = m_game->getFrameSummary();
+		snprintf(buffer, 500, "FPS: %f%s%s\n", fps, frameSummary.empty() ? "" : ", ", frameSummary.c_str());
+		printDebugMessage(buffer);
 
 		frameCounter = 0;
 		elapsedSeconds = 0.0;
 	}
 
+	PROFILE_SCOPE("Update");
 	m_game->onUpdate(deltaTime.count() * 1e-9);
 }
 
 void Application::render()
 {
-	m_game->onRender();
+	{
+		PROFILE_SCOPE("Render");
+		m_game->onRender();
+	}
+
+	Profiler::EndFrame();
+
+	m_lastBarrierStats = ResourceStateTracker::GetAndResetBarrierStats();
+	m_totalBarrierStats.numRequested += m_lastBarrierStats.numRequested;
+	m_totalBarrierStats.numSubmitted += m_lastBarrierStats.numSubmitted;
+	m_totalBarrierStats.numElided += m_lastBarrierStats.numElided;
+	m_totalBarrierStats.numMerged += m_lastBarrierStats.numMerged;
+	m_totalBarrierStats.numSplit += m_lastBarrierStats.numSplit;
+
 	m_frameCount++;
 }
 
@@ -115,7 +209,9 @@ void Application::onEvent(Event& event)
 	}
 	case EventType::WindowDestroy:
 	{
+#if defined(_WIN32)
 		::PostQuitMessage(0);
+#endif
 		break;
 	}
 	case EventType::SysKeyDown:
@@ -131,100 +227,37 @@ void Application::onEvent(Event& event)
 			m_window->getSwapChain()->setVSync(!m_window->getSwapChain()->isVSync());
 			break;
 		}
-		case VK_F11:
+		// Print the percentiles of the zones of the last frames
+		case 'R':
 		{
-			m_window->setFullscreen(!m_window->isFullscreen());
+			printDebugMessage(Profiler::GetReport().c_str());
+			printBarrierStats("last frame", m_lastBarrierStats, 1);
+			printDebugMessage(m_game->getReport().c_str());
 			break;
 		}
-		}
-	}
-	}
-}
-
-Microsoft::WRL::ComPtr<IDXGIAdapter4> Application::getAdapter(bool useWarp)
-{
-	ComPtr<IDXGIFactory4> dxgiFactory;
-	UINT createFactoryFlags = 0;
-#if defined(_DEBUG)
-	createFactoryFlags = DXGI_CREATE_FACTORY_DEBUG;
-#endif
-
-	ThrowIfFailed(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory)));
-
-	ComPtr<IDXGIAdapter1> dxgiAdapter1;
-	ComPtr<IDXGIAdapter4> dxgiAdapter4;
-
-	if (useWarp)
-	{
-		ThrowIfFailed(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&dxgiAdapter1)));
-		ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
-	}
-	else
-	{
-		SIZE_T maxDedicatedVideoMemory = 0;
-		for (UINT i = 0; dxgiFactory->EnumAdapters1(i, &dxgiAdapter1) != DXGI_ERROR_NOT_FOUND; ++i)
+		// Capture the frames between two presses as a Chrome trace
+		case 'P':
 		{
-			DXGI_ADAPTER_DESC1 dxgiAdapterDesc1;
-			dxgiAdapter1->GetDesc1(&dxgiAdapterDesc1);
-
-			// Check to see if the adapter can create a D3D12 device without actually 
-			// creating it. The adapter with the largest dedicated video memory
-			// is favored.
-			if ((dxgiAdapterDesc1.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) == 0 &&
-				SUCCEEDED(D3D12CreateDevice(dxgiAdapter1.Get(),
-					D3D_FEATURE_LEVEL_11_0, __uuidof(ID3D12Device), nullptr)) &&
-				dxgiAdapterDesc1.DedicatedVideoMemory > maxDedicatedVideoMemory)
+			static bool capturing = false;
+			if (!capturing)
 			{
-				maxDedicatedVideoMemory = dxgiAdapterDesc1.DedicatedVideoMemory;
-				ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
+				Profiler::BeginTraceCapture();
 			}
+			else if (Profiler::EndTraceCapture("trace.json"))
+			{
+				printDebugMessage("Written trace.json\n");
+			}
+			capturing = !capturing;
+			break;
 		}
-	}
-
-	return dxgiAdapter4;
-}
-
-Microsoft::WRL::ComPtr<ID3D12Device2> Application::createDevice(Microsoft::WRL::ComPtr<IDXGIAdapter4> adapter)
-{
-	ComPtr<ID3D12Device2> d3d12Device2;
-	ThrowIfFailed(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&d3d12Device2)));
-
-	// Enable debug messages in debug mode.
-#if defined(_DEBUG)
-	ComPtr<ID3D12InfoQueue> pInfoQueue;
-	if (SUCCEEDED(d3d12Device2.As(&pInfoQueue)))
-	{
-		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_CORRUPTION, TRUE);
-		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_ERROR, TRUE);
-		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, TRUE);
-
-		// Suppress whole categories of messages
-		//D3D12_MESSAGE_CATEGORY Categories[] = {};
-
-		// Suppress messages based on their severity level
-		D3D12_MESSAGE_SEVERITY Severities[] =
+#if defined(_WIN32)
+		case VK_F11:
 		{
-			D3D12_MESSAGE_SEVERITY_INFO
-		};
-
-		// Suppress individual messages by their ID
-		D3D12_MESSAGE_ID DenyIds[] = {
-			D3D12_MESSAGE_ID_CLEARRENDERTARGETVIEW_MISMATCHINGCLEARVALUE,   // I'm really not sure how to avoid this message.
-			D3D12_MESSAGE_ID_MAP_INVALID_NULLRANGE,                         // This warning occurs when using capture frame while graphics debugging.
-			D3D12_MESSAGE_ID_UNMAP_INVALID_NULLRANGE,                       // This warning occurs when using capture frame while graphics debugging.
-		};
-
-		D3D12_INFO_QUEUE_FILTER NewFilter = {};
-		//NewFilter.DenyList.NumCategories = _countof(Categories);
-		//NewFilter.DenyList.pCategoryList = Categories;
-		NewFilter.DenyList.NumSeverities = _countof(Severities);
-		NewFilter.DenyList.pSeverityList = Severities;
-		NewFilter.DenyList.NumIDs = _countof(DenyIds);
-		NewFilter.DenyList.pIDList = DenyIds;
-
-		ThrowIfFailed(pInfoQueue->PushStorageFilter(&NewFilter));
-	}
+			m_window->setFullscreen(!m_window->isFullscreen());
+			break;
+		}
 #endif
-
-	return d3d12Device2;
+		}
+	}
+	}
 }
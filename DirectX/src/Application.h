@@ -7,9 +7,11 @@
 #include <d3d12.h>
 
 // Own Headers
+#include "Device.h"
 #include "Event.h"
 #include "Window.h"
 #include "Game.h"
+#include "ResourceStateTracker.h"
 
 #define USE_WARP_ADAPTER 0
 
@@ -20,12 +22,15 @@ public:
 	virtual ~Application();
 
 	void run();
+	// Run a fixed amount of frames without a window (and without waiting for the GPU on the null device)
+	// and report the CPU time spent per frame.
+	void runHeadless(uint64_t numFrames);
 
 	virtual void onEvent(Event& event) override;
 
 	std::shared_ptr<Window> getWindow() const { return m_window; }
 
-	Microsoft::WRL::ComPtr<ID3D12Device2> getDevice() const { return m_device; }
+	std::shared_ptr<Device> getDevice() const { return m_device; }
 
 	uint64_t getFrameCount() const { return m_frameCount; }
 
@@ -35,20 +40,21 @@ private:
 	void update();
 	void render();
 
-	Microsoft::WRL::ComPtr<IDXGIAdapter4> getAdapter(bool useWarp);
-	Microsoft::WRL::ComPtr<ID3D12Device2> createDevice(Microsoft::WRL::ComPtr<IDXGIAdapter4> adapter);
-
 protected:
 	bool									m_isRunning = false;
 
 	Game*									m_game;
 
-	Microsoft::WRL::ComPtr<ID3D12Device2>	m_device;
+	std::shared_ptr<Device>					m_device;
 
 	std::shared_ptr<Window>					m_window;
 
 	uint64_t								m_frameCount;
 
+	// The barriers of the last frame and of all frames since run
+	ResourceStateTracker::BarrierStats		m_lastBarrierStats = {};
+	ResourceStateTracker::BarrierStats		m_totalBarrierStats = {};
+
 private:
 	static Application*						s_instance;
 };
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "dxpch.h"
+#include "BindlessDescriptorHeap.h"
+#include "Application.h"
+#include "CommandList.h"
+
+BindlessDescriptorHeap::BindlessDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors)
+	:	m_heapType(type),
+		m_numDescriptors(numDescriptors),
+		m_freeList(numDescriptors)
+{
+	assert((type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER) &&
+		"Only CBV_SRV_UAV and sampler heaps can be shader visible");
+
+	auto device = Application::Get()->getDevice();
+
+	D3D12_DESCRIPTOR_HEAP_DESC heapDesc{};
+	heapDesc.Type = m_heapType;
+	heapDesc.NumDescriptors = m_numDescriptors;
+	heapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+	m_descriptorHeap = device->createDescriptorHeap(heapDesc);
+	m_baseCPUDescriptor = m_descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+	m_baseGPUDescriptor = m_descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+	m_descriptorHandleIncrementSize = device->getDescriptorHandleIncrementSize(m_heapType);
+}
+
+uint32_t BindlessDescriptorHeap::allocate(uint32_t numDescriptors)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_freeList.allocate(numDescriptors);
+}
+
+void BindlessDescriptorHeap::free(uint32_t index, uint32_t numDescriptors)
+{
+	if (index == InvalidIndex)
+	{
+		return;
+	}
+
+	assert(index + numDescriptors <= m_numDescriptors);
+
+	uint64_t frameNumber = Application::Get()->getFrameCount();
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	// Don't add the block directly to the free list until the frame has completed.
+	m_staleDescriptors.push({ index, numDescriptors, frameNumber });
+}
+
+void BindlessDescriptorHeap::releaseStaleDescriptors(uint64_t frameNumber)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	while (!m_staleDescriptors.empty() && m_staleDescriptors.front().frameNumber <= frameNumber)
+	{
+		const StaleDescriptorInfo& staleDescriptor = m_staleDescriptors.front();
+		m_freeList.free(staleDescriptor.index, staleDescriptor.numDescriptors);
+
+		m_staleDescriptors.pop();
+	}
+}
+
+void BindlessDescriptorHeap::copyDescriptors(uint32_t index, D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor, uint32_t numDescriptors)
+{
+	assert(index + numDescriptors <= m_numDescriptors);
+
+	Application::Get()->getDevice()->copyDescriptorsSimple(numDescriptors, getCPUDescriptorHandle(index), srcDescriptor, m_heapType);
+}
+
+void BindlessDescriptorHeap::createConstantBufferView(uint32_t index, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc)
+{
+	assert(m_heapType == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV && index < m_numDescriptors);
+
+	Application::Get()->getDevice()->createConstantBufferView(desc, getCPUDescriptorHandle(index));
+}
+
+void BindlessDescriptorHeap::bind(CommandList& commandList) const
+{
+	commandList.setDescriptorHeap(m_heapType, m_descriptorHeap.Get());
+}
+
+uint32_t BindlessDescriptorHeap::getNumFreeDescriptors() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_freeList.getNumFreeDescriptors();
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "d3dx12.h"
+
+#include <wrl.h>
+
+#include <cstdint>
+#include <mutex>
+#include <queue>
+
+#include "DescriptorFreeList.h"
+
+class CommandList;
+
+/*
+*	A single, large shader visible descriptor heap in which descriptors keep a permanent index.
+*
+*	Views are written to their index once (when the resource is created) instead of being staged and
+*	copied for every draw like with the DynamicDescriptorHeap. Shaders receive the indices through
+*	root constants and index the heap directly (ResourceDescriptorHeap / SamplerDescriptorHeap in
+*	shader model 6.6), which requires the D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED
+*	(or SAMPLER_HEAP_DIRECTLY_INDEXED) root signature flag. The heap is bound once per command list.
+*
+*	Only one heap of every type can be bound at a time, so a command list that uses the bindless heap
+*	cannot use a DynamicDescriptorHeap of the same type.
+*/
+class BindlessDescriptorHeap
+{
+public:
+	// Returned by allocate when the heap is full
+	static const uint32_t InvalidIndex = DescriptorFreeList::InvalidOffset;
+
+	/*
+	* @param numDescriptors The number of descriptors in the heap. The resource binding tier limits this
+	* to 1,000,000 (tier 1 and 2) for CBV_SRV_UAV heaps and 2048 for sampler heaps.
+	*/
+	BindlessDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, uint32_t numDescriptors = 65536);
+	virtual ~BindlessDescriptorHeap() = default;
+
+	D3D12_DESCRIPTOR_HEAP_TYPE getHeapType() const { return m_heapType; }
+	ID3D12DescriptorHeap* getDescriptorHeap() const { return m_descriptorHeap.Get(); }
+
+	/*
+	* Allocate a range of descriptors which keep their index until they are freed.
+	* @return The index of the first descriptor or InvalidIndex if the heap is full.
+	*/
+	uint32_t allocate(uint32_t numDescriptors = 1);
+
+	/*
+	* Return a range of descriptors. The indices are only reused after the
+	* frame in which they were freed has completed (see releaseStaleDescriptors).
+	*/
+	void free(uint32_t index, uint32_t numDescriptors = 1);
+
+	/*
+	* Release the descriptors that were freed in this frame (or before), once the frame has completed.
+	*/
+	void releaseStaleDescriptors(uint64_t frameNumber);
+
+	D3D12_CPU_DESCRIPTOR_HANDLE getCPUDescriptorHandle(uint32_t index) const
+	{
+		return { m_baseCPUDescriptor.ptr + static_cast<SIZE_T>(index) * m_descriptorHandleIncrementSize };
+	}
+	D3D12_GPU_DESCRIPTOR_HANDLE getGPUDescriptorHandle(uint32_t index) const
+	{
+		return { m_baseGPUDescriptor.ptr + static_cast<UINT64>(index) * m_descriptorHandleIncrementSize };
+	}
+
+	// Copy CPU visible (non shader visible) descriptors to their permanent index
+	void copyDescriptors(uint32_t index, D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor, uint32_t numDescriptors = 1);
+
+	// Create a constant buffer view directly at its permanent index
+	void createConstantBufferView(uint32_t index, const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc);
+
+	// Bind the heap on the command list, should be done once after the command list is reset
+	void bind(CommandList& commandList) const;
+
+	uint32_t getNumDescriptors() const { return m_numDescriptors; }
+	uint32_t getNumFreeDescriptors() const;
+
+private:
+	// Descriptors that were freed, but may still be used by a frame in flight
+	struct StaleDescriptorInfo
+	{
+		uint32_t index;
+		uint32_t numDescriptors;
+		uint64_t frameNumber;
+	};
+
+	D3D12_DESCRIPTOR_HEAP_TYPE m_heapType;
+	uint32_t m_numDescriptors;
+	uint32_t m_descriptorHandleIncrementSize;
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE m_baseCPUDescriptor;
+	CD3DX12_GPU_DESCRIPTOR_HANDLE m_baseGPUDescriptor;
+
+	DescriptorFreeList m_freeList;
+	std::queue<StaleDescriptorInfo> m_staleDescriptors;
+
+	mutable std::mutex m_mutex;
+};
@@ -6,14 +6,36 @@
 
 #include <cstdint>
 
+/*
+*	Command list abstraction. The recording functions map one to one on the
+*	ID3D12GraphicsCommandList2 functions the renderer uses and are implemented by
+*	a backend (D3D12CommandList or NullCommandList).
+*/
 class CommandList
 {
 public:
-	CommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>& commandList)
-		:	m_commandList(commandList)
+	explicit CommandList(D3D12_COMMAND_LIST_TYPE type)
+		:	m_type(type),
+			m_descriptorHeaps{}
 	{}
+	virtual ~CommandList() = default;
 
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> getCommandList() const { return m_commandList; }
+	D3D12_COMMAND_LIST_TYPE getType() const { return m_type; }
+
+	/*
+	* Reset the command list so it can be recorded again. This should only be done
+	* when the command list is finished executing on the command queue.
+	*/
+	virtual void reset()
+	{
+		for (uint32_t i = 0; i < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES; ++i)
+		{
+			m_descriptorHeaps[i] = nullptr;
+		}
+	}
+
+	// Close the command list before it is executed on the command queue.
+	virtual void close() = 0;
 
 	void setDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, ID3D12DescriptorHeap* descriptorHeap)
 	{
@@ -24,6 +46,52 @@ public:
 		}
 	}
 
+	/*
+	* Recording
+	*/
+	virtual void resourceBarrier(uint32_t numBarriers, const D3D12_RESOURCE_BARRIER* barriers) = 0;
+
+	virtual void copyBufferRegion(ID3D12Resource* dstBuffer, uint64_t dstOffset, ID3D12Resource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) = 0;
+	virtual void copyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION& dst, uint32_t dstX, uint32_t dstY, uint32_t dstZ,
+		const D3D12_TEXTURE_COPY_LOCATION& src, const D3D12_BOX* srcBox = nullptr) = 0;
+
+	virtual void clearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const float clearColor[4]) = 0;
+	virtual void clearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags, float depth, uint8_t stencil) = 0;
+
+	virtual void setPipelineState(ID3D12PipelineState* pipelineState) = 0;
+	virtual void setGraphicsRootSignature(ID3D12RootSignature* rootSignature) = 0;
+	virtual void setComputeRootSignature(ID3D12RootSignature* rootSignature) = 0;
+
+	virtual void setGraphicsRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) = 0;
+	virtual void setComputeRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) = 0;
+
+	virtual void setGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues = 0) = 0;
+	virtual void setComputeRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues = 0) = 0;
+
+	virtual void setGraphicsRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+	virtual void setComputeRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) = 0;
+
+	virtual void setPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology) = 0;
+	virtual void setVertexBuffers(uint32_t startSlot, uint32_t numViews, const D3D12_VERTEX_BUFFER_VIEW* views) = 0;
+	virtual void setIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) = 0;
+
+	virtual void setViewports(uint32_t numViewports, const D3D12_VIEWPORT* viewports) = 0;
+	virtual void setScissorRects(uint32_t numRects, const D3D12_RECT* rects) = 0;
+	virtual void setRenderTargets(uint32_t numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) = 0;
+
+	virtual void drawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation,
+		int32_t baseVertexLocation, uint32_t startInstanceLocation) = 0;
+	virtual void dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) = 0;
+
+	// Write a query (e.g. a timestamp) into a query heap, see TimestampQueryPool
+	virtual void endQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t index) = 0;
+	// Copy the results of queries into a buffer, which must be in the COPY_DEST state
+	virtual void resolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t startIndex, uint32_t numQueries,
+		ID3D12Resource* destinationBuffer, uint64_t alignedDestinationBufferOffset) = 0;
+
+protected:
+	virtual void setDescriptorHeaps(uint32_t numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps) = 0;
+
 private:
 	void bindDescriptorHeaps()
 	{
@@ -39,10 +107,10 @@ private:
 			}
 		}
 
-		m_commandList->SetDescriptorHeaps(numDescriptorHeaps, descriptorHeaps);
+		setDescriptorHeaps(numDescriptorHeaps, descriptorHeaps);
 	}
 
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> m_commandList;
+	D3D12_COMMAND_LIST_TYPE m_type;
 
 	ID3D12DescriptorHeap* m_descriptorHeaps[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
 };
\ No newline at end of file
@@ -1,130 +1,161 @@
 #include "dxpch.h"
 #include "CommandQueue.h"
+#include "CommandList.h"
+#include "ResourceStateTracker.h"
 
-CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
-    :   m_fenceValue(0),
-        m_commandListType(type),
-        m_device(device)
+namespace
 {
-    D3D12_COMMAND_QUEUE_DESC desc = {};
-    desc.Type = type;
-    desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
-    desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
-    desc.NodeMask = 0;
-
-    ThrowIfFailed(m_device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_commandQueue)));
-    ThrowIfFailed(m_device->CreateFence(m_fenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+    // Orders a heap with the lowest fence value on top, entries with the same fence value first in first out
+    struct LaterEntry
+    {
+        template<typename Entry>
+        bool operator()(const Entry& a, const Entry& b) const
+        {
+            return a.fenceValue != b.fenceValue ? a.fenceValue > b.fenceValue : a.sequenceNumber > b.sequenceNumber;
+        }
+    };
+}
 
-    m_fenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+CommandQueue::CommandQueue(D3D12_COMMAND_LIST_TYPE type)
+    :   m_commandListType(type),
+        m_fenceValue(0),
+        m_nextSequenceNumber(0),
+        m_retiring(false),
+        m_stopRetiring(false)
+{
 }
 
 CommandQueue::~CommandQueue()
 {
-    ::CloseHandle(m_fenceEvent);
+    assert(!m_retireThread.joinable() && "The backend must stop the retire thread.");
 }
 
-
-Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CommandQueue::createCommandAllocator()
+std::shared_ptr<CommandList> CommandQueue::getCommandList()
 {
-    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-    ThrowIfFailed(m_device->CreateCommandAllocator(m_commandListType, IID_PPV_ARGS(&commandAllocator)));
+    {
+        std::lock_guard<std::mutex> lock(m_retireMutex);
+
+        if (!m_availableCommandLists.empty())
+        {
+            std::shared_ptr<CommandList> commandList = std::move(m_availableCommandLists.back());
+            m_availableCommandLists.pop_back();
 
-    return commandAllocator;
+            return commandList;
+        }
+    }
+
+    return createCommandList();
 }
 
+uint64_t CommandQueue::executeCommandList(std::shared_ptr<CommandList> commandList)
+{
+    return executeCommandLists(1, &commandList);
+}
 
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::createCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator)
+uint64_t CommandQueue::executeCommandLists(uint32_t numCommandLists, const std::shared_ptr<CommandList>* commandLists)
 {
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList;
-    ThrowIfFailed(m_device->CreateCommandList(0, m_commandListType, allocator.Get(), nullptr, IID_PPV_ARGS(&commandList)));
+    uint64_t fenceValue;
+    {
+        // Threads may submit to the same queue, the fence value must follow the order of the submissions
+        std::lock_guard<std::mutex> lock(m_submitMutex);
+
+        m_submittedCommandLists.clear();
+        for (uint32_t i = 0; i < numCommandLists; ++i)
+        {
+            commandLists[i]->close();
+            m_submittedCommandLists.push_back(commandLists[i].get());
+        }
+
+        submitCommandLists(numCommandLists, m_submittedCommandLists.data());
+        fenceValue = signalNextFenceValue();
+    }
 
-    return commandList;
-}
+    retireCommandLists(fenceValue, numCommandLists, commandLists);
 
+    return fenceValue;
+}
 
-Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> CommandQueue::getCommandList()
+uint64_t CommandQueue::executeCommandLists(uint32_t numCommandLists, const std::shared_ptr<CommandList>* commandLists,
+    ResourceStateTracker& resourceStateTracker, std::shared_ptr<CommandList>& barrierCommandList)
 {
-    Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList;
-
-    if (!m_commandAllocatorQueue.empty() && isFenceComplete(m_commandAllocatorQueue.front().fenceValue))
+    uint64_t fenceValue;
+    bool executeBarriers;
     {
-        commandAllocator = m_commandAllocatorQueue.front().commandAllocator;
-        m_commandAllocatorQueue.pop();
+        // Another submission to this queue can't resolve the same resources in between, submissions
+        // to other queues which use the same resources wait for this one on the GPU.
+        std::lock_guard<std::mutex> lock(m_submitMutex);
 
-        ThrowIfFailed(commandAllocator->Reset());
-    }
-    else
-    {
-        commandAllocator = createCommandAllocator();
-    }
+        executeBarriers = resourceStateTracker.flushPendingResourceBarriers(*barrierCommandList) > 0;
 
+        m_submittedCommandLists.clear();
+        if (executeBarriers)
+        {
+            barrierCommandList->close();
+            m_submittedCommandLists.push_back(barrierCommandList.get());
+        }
 
-    if (!m_commandListQueue.empty())
-    {
-        commandList = m_commandListQueue.front();
-        m_commandListQueue.pop();
+        for (uint32_t i = 0; i < numCommandLists; ++i)
+        {
+            commandLists[i]->close();
+            m_submittedCommandLists.push_back(commandLists[i].get());
+        }
+
+        submitCommandLists(static_cast<uint32_t>(m_submittedCommandLists.size()), m_submittedCommandLists.data());
+        fenceValue = signalNextFenceValue();
 
-        ThrowIfFailed(commandList->Reset(commandAllocator.Get(), nullptr));
+        resourceStateTracker.commitFinalResourceStates();
     }
-    else
+
+    // The barrier command list stays with the caller when it was not used
+    if (executeBarriers)
     {
-        commandList = createCommandList(commandAllocator);
+        std::shared_ptr<CommandList> executedBarrierCommandList = std::move(barrierCommandList);
+        retireCommandLists(fenceValue, 1, &executedBarrierCommandList);
     }
 
-    // Associate the command allocator with the command list so that it can be
-    // retrieved when the command list is executed.
-    ThrowIfFailed(commandList->SetPrivateDataInterface(__uuidof(ID3D12CommandAllocator), commandAllocator.Get()));
+    retireCommandLists(fenceValue, numCommandLists, commandLists);
 
-    return commandList;
+    return fenceValue;
 }
 
-
-uint64_t CommandQueue::executeCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList)
+void CommandQueue::retireCommandLists(uint64_t fenceValue, uint32_t numCommandLists, const std::shared_ptr<CommandList>* commandLists)
 {
-    commandList->Close();
-
-    ID3D12CommandAllocator* commandAllocator;
-    UINT dataSize = sizeof(commandAllocator);
-    ThrowIfFailed(commandList->GetPrivateData(__uuidof(ID3D12CommandAllocator), &dataSize, &commandAllocator));
-
-    ID3D12CommandList* const ppCommandLists[] = {
-        commandList.Get()
-    };
-
-    m_commandQueue->ExecuteCommandLists(1, ppCommandLists);
-    uint64_t fenceValue = signal();
-
-    m_commandAllocatorQueue.emplace(CommandAllocatorEntry{ fenceValue, commandAllocator });
-    m_commandListQueue.push(commandList);
+    // The command lists (and their allocators) are reset by the retire thread once the fence value has been reached.
+    std::lock_guard<std::mutex> lock(m_retireMutex);
+    for (uint32_t i = 0; i < numCommandLists; ++i)
+    {
+        RetireEntry entry{};
+        entry.fenceValue = fenceValue;
+        entry.commandList = commandLists[i];
+        pushRetireEntry(std::move(entry));
+    }
+}
 
-    // The ownership of the command allocator has been transferred to the ComPtr
-    // in the command allocator queue. It is safe to release the reference 
-    // in this temporary COM pointer here.
-    commandAllocator->Release();
+uint64_t CommandQueue::signal()
+{
+    std::lock_guard<std::mutex> lock(m_submitMutex);
 
-    return fenceValue;
+    return signalNextFenceValue();
 }
 
-uint64_t CommandQueue::signal()
+uint64_t CommandQueue::signalNextFenceValue()
 {
     uint64_t fenceValueForSignal = ++m_fenceValue;
-    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fenceValueForSignal));
+    signalFence(fenceValueForSignal);
 
     return fenceValueForSignal;
 }
 
 bool CommandQueue::isFenceComplete(uint64_t fenceValue)
 {
-    return m_fence->GetCompletedValue() >= fenceValue;
+    return getCompletedFenceValue() >= fenceValue;
 }
 
 void CommandQueue::waitForFenceValue(uint64_t fenceValue, std::chrono::milliseconds duration)
 {
-    if (m_fence->GetCompletedValue() < fenceValue)
+    if (!isFenceComplete(fenceValue))
     {
-        ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
-        ::WaitForSingleObject(m_fenceEvent, static_cast<DWORD>(duration.count()));
+        waitForFence(fenceValue, duration);
     }
 }
 
@@ -132,6 +163,147 @@ void CommandQueue::flush()
 {
     uint64_t fenceValueForSignal = signal();
     waitForFenceValue(fenceValueForSignal);
+
+    // Everything up to the fence value has completed, so it only has to leave the retire thread
+    std::unique_lock<std::mutex> lock(m_retireMutex);
+    m_retiredCondition.wait(lock, [this, fenceValueForSignal]()
+    {
+        return !m_retiring && (m_retireEntries.empty() || m_retireEntries.front().fenceValue > fenceValueForSignal);
+    });
 }
 
+void CommandQueue::waitForQueue(CommandQueue& commandQueue, uint64_t fenceValue)
+{
+    // A queue executes its own work in order, and completed work does not need a wait
+    if (&commandQueue == this || fenceValue == 0 || commandQueue.isFenceComplete(fenceValue))
+    {
+        return;
+    }
+
+    waitForQueueFence(commandQueue, fenceValue);
+}
+
+void CommandQueue::waitForTicket(const FenceTicket& ticket)
+{
+    if (ticket.commandQueue != nullptr)
+    {
+        waitForQueue(*ticket.commandQueue, ticket.fenceValue);
+    }
+}
+
+void CommandQueue::addCompletionCallback(uint64_t fenceValue, CompletionCallback callback)
+{
+    assert(fenceValue <= m_fenceValue && "The fence value has not been signaled.");
+
+    RetireEntry entry{};
+    entry.fenceValue = fenceValue;
+    entry.callback = std::move(callback);
+
+    std::lock_guard<std::mutex> lock(m_retireMutex);
+    pushRetireEntry(std::move(entry));
+}
+
+void CommandQueue::releaseOnCompletion(uint64_t fenceValue, std::shared_ptr<void> payload)
+{
+    assert(fenceValue <= m_fenceValue && "The fence value has not been signaled.");
+
+    RetireEntry entry{};
+    entry.fenceValue = fenceValue;
+    entry.payload = std::move(payload);
+
+    std::lock_guard<std::mutex> lock(m_retireMutex);
+    pushRetireEntry(std::move(entry));
+}
+
+void CommandQueue::stopRetireThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_retireMutex);
+        m_stopRetiring = true;
+    }
+    m_retireCondition.notify_all();
+
+    if (m_retireThread.joinable())
+    {
+        m_retireThread.join();
+    }
+}
+
+void CommandQueue::pushRetireEntry(RetireEntry&& entry)
+{
+    assert(!m_stopRetiring && "The retire thread has been stopped.");
+
+    // Started here instead of in the constructor, the retire thread uses the backend
+    if (!m_retireThread.joinable())
+    {
+        m_retireThread = std::thread(&CommandQueue::retireMain, this);
+    }
+
+    entry.sequenceNumber = m_nextSequenceNumber++;
+    m_retireEntries.push_back(std::move(entry));
+    std::push_heap(m_retireEntries.begin(), m_retireEntries.end(), LaterEntry());
+
+    m_retireCondition.notify_one();
+}
 
+void CommandQueue::retireMain()
+{
+    std::vector<RetireEntry> completedEntries;
+    std::vector<std::shared_ptr<CommandList>> commandLists;
+
+    std::unique_lock<std::mutex> lock(m_retireMutex);
+    for (;;)
+    {
+        m_retireCondition.wait(lock, [this]() { return m_stopRetiring || !m_retireEntries.empty(); });
+
+        // Stopping retires the remaining entries first
+        if (m_retireEntries.empty())
+        {
+            return;
+        }
+
+        // Block on the fence without the lock, so the queue keeps submitting in the meantime
+        uint64_t fenceValue = m_retireEntries.front().fenceValue;
+        lock.unlock();
+
+        waitForFenceValue(fenceValue);
+        uint64_t completedFenceValue = getCompletedFenceValue();
+
+        lock.lock();
+        while (!m_retireEntries.empty() && m_retireEntries.front().fenceValue <= completedFenceValue)
+        {
+            std::pop_heap(m_retireEntries.begin(), m_retireEntries.end(), LaterEntry());
+            completedEntries.push_back(std::move(m_retireEntries.back()));
+            m_retireEntries.pop_back();
+        }
+        m_retiring = true;
+        lock.unlock();
+
+        for (RetireEntry& entry : completedEntries)
+        {
+            if (entry.commandList != nullptr)
+            {
+                entry.commandList->reset();
+                commandLists.push_back(std::move(entry.commandList));
+            }
+
+            if (entry.callback)
+            {
+                entry.callback();
+            }
+        }
+
+        // Release the payloads (and callbacks) before the lock is taken again
+        completedEntries.clear();
+
+        lock.lock();
+        for (std::shared_ptr<CommandList>& commandList : commandLists)
+        {
+            m_availableCommandLists.push_back(std::move(commandList));
+        }
+        commandLists.clear();
+
+        m_retiring = false;
+        m_retiredCondition.notify_all();
+    }
+}
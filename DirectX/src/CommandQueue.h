@@ -8,48 +8,157 @@
 
 // STL Headers
 #include <algorithm>
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+class CommandList;
+class CommandQueue;
+class ResourceStateTracker;
+
+/*
+*	Refers to a point in the work of a command queue, e.g. the upload of an asset on the copy queue.
+*	Another queue waits for it on the GPU (CommandQueue::waitForTicket), so the CPU does not have to.
+*/
+struct FenceTicket
+{
+	CommandQueue* commandQueue = nullptr;
+	uint64_t fenceValue = 0;
+};
+
+/*
+*	Command queue with a fence to track the command lists that are in-flight.
+*	The submission itself is implemented by a backend (D3D12CommandQueue or NullCommandQueue),
+*	created through Device::createCommandQueue.
+*
+*	A retire thread waits for the fence values of the in-flight work and retires it as soon as it
+*	completes: command lists (and their allocators) are reset and become available to getCommandList,
+*	payloads are released and completion callbacks are run. Neither happens on the thread which
+*	submits, so releasing resources or reading back results never stalls the submission of a frame.
+*	The thread is started by the first submission (or callback) and stopped by the backend.
+*/
 class CommandQueue
 {
 public:
-	CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
-	~CommandQueue();
+	explicit CommandQueue(D3D12_COMMAND_LIST_TYPE type);
+	virtual ~CommandQueue();
+
+	using CompletionCallback = std::function<void()>;
 
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> getCommandList();
+	D3D12_COMMAND_LIST_TYPE getType() const { return m_commandListType; }
+
+	// Get a command list which is ready for recording
+	std::shared_ptr<CommandList> getCommandList();
 
 	// Returns the fence value to wait for this command list
-	uint64_t executeCommandList(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList);
+	uint64_t executeCommandList(std::shared_ptr<CommandList> commandList);
+	// Execute command lists (in order) with a single submission and a single signal,
+	// returns the fence value to wait for all of them
+	uint64_t executeCommandLists(uint32_t numCommandLists, const std::shared_ptr<CommandList>* commandLists);
+	/*
+	* Execute command lists which were recorded with a resource state tracker. Its pending barriers are resolved
+	* onto the barrier command list, which is executed first in the same submission (and taken) when there were any.
+	* The barriers are resolved and the final states committed under the submit lock, so the command lists of this
+	* queue execute in the order their barriers were resolved. Work on other queues must be ordered by fence waits.
+	*/
+	uint64_t executeCommandLists(uint32_t numCommandLists, const std::shared_ptr<CommandList>* commandLists,
+		ResourceStateTracker& resourceStateTracker, std::shared_ptr<CommandList>& barrierCommandList);
 
 	uint64_t signal();
 	bool isFenceComplete(uint64_t fenceValue);
 	void waitForFenceValue(uint64_t fenceValue, std::chrono::milliseconds duration = std::chrono::milliseconds::max());
+	// Wait for all submitted work, including the retirement of it (and its callbacks)
 	void flush();
 
-    Microsoft::WRL::ComPtr<ID3D12CommandQueue> getCommandQueue() const { return m_commandQueue; }
+	/*
+	* Make the GPU wait until another queue has reached a fence value before it executes the work
+	* which is submitted to this queue afterwards. The CPU does not wait.
+	*/
+	void waitForQueue(CommandQueue& commandQueue, uint64_t fenceValue);
+	void waitForTicket(const FenceTicket& ticket);
+	// A ticket for the work that has been submitted so far
+	FenceTicket getTicket(uint64_t fenceValue) { return { this, fenceValue }; }
 
-private:
-	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> createCommandAllocator();
-	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> createCommandList(Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
+	/*
+	* Run a callback on the retire thread once the fence has reached the given value, callbacks with
+	* the same fence value are run in the order they were added. The fence value must have been signaled
+	* already. A callback must not wait for this queue, it would wait for itself.
+	*/
+	void addCompletionCallback(uint64_t fenceValue, CompletionCallback callback);
+	// Keep a payload (e.g. a resource the GPU still uses) alive until the fence has reached the given value
+	void releaseOnCompletion(uint64_t fenceValue, std::shared_ptr<void> payload);
+
+	// The frequency of the timestamp queries on this queue in ticks per second, 0 if the queue has no timestamps
+	virtual uint64_t getTimestampFrequency() const = 0;
+	// Sample the timestamp counter of the queue and the CPU time (Profiler::GetTime) at the same moment,
+	// so timestamps can be converted to CPU time
+	virtual void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuTime) = 0;
+
+protected:
+	// Create a new command list (and its command allocator) for this queue
+	virtual std::shared_ptr<CommandList> createCommandList() = 0;
+	// Submit closed command lists to the queue, called with m_submitMutex locked
+	virtual void submitCommandLists(uint32_t numCommandLists, CommandList* const* commandLists) = 0;
+	// Signal the fence from the queue with the given value, called with m_submitMutex locked
+	virtual void signalFence(uint64_t fenceValue) = 0;
+	virtual uint64_t getCompletedFenceValue() = 0;
+	// Make this queue wait on the GPU for the fence of another queue (of the same backend)
+	virtual void waitForQueueFence(CommandQueue& commandQueue, uint64_t fenceValue) = 0;
+	// Block the calling thread until the fence has reached the given value.
+	// Must be safe to call from the retire thread and another thread at the same time.
+	virtual void waitForFence(uint64_t fenceValue, std::chrono::milliseconds duration) = 0;
+
+	/*
+	* Retire the remaining work and join the retire thread. The backend must call this in its destructor,
+	* the retire thread uses the fence of the backend.
+	*/
+	void stopRetireThread();
 
 private:
-    // Keep track of command allocators that are "in-flight"
-    struct CommandAllocatorEntry
-    {
-        uint64_t fenceValue;
-        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-    };
-
-    using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
-    using CommandListQueue = std::queue<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>>;
-
-    D3D12_COMMAND_LIST_TYPE                     m_commandListType;
-    Microsoft::WRL::ComPtr<ID3D12Device2>       m_device;
-    Microsoft::WRL::ComPtr<ID3D12CommandQueue>  m_commandQueue;
-    Microsoft::WRL::ComPtr<ID3D12Fence>         m_fence;
-    HANDLE                                      m_fenceEvent;
-    uint64_t                                    m_fenceValue;
-
-    CommandAllocatorQueue                       m_commandAllocatorQueue;
-    CommandListQueue                            m_commandListQueue;
+	// A command list, payload or callback that is "in-flight"
+	struct RetireEntry
+	{
+		uint64_t fenceValue;
+		// Orders the entries with the same fence value
+		uint64_t sequenceNumber;
+
+		std::shared_ptr<CommandList> commandList;
+		std::shared_ptr<void> payload;
+		CompletionCallback callback;
+	};
+
+	// Signal the fence with the next fence value, m_submitMutex must be locked
+	uint64_t signalNextFenceValue();
+	// Reset the command lists (and their allocators) once the fence value has been reached
+	void retireCommandLists(uint64_t fenceValue, uint32_t numCommandLists, const std::shared_ptr<CommandList>* commandLists);
+	// Add an entry to m_retireEntries, m_retireMutex must be locked
+	void pushRetireEntry(RetireEntry&& entry);
+	void retireMain();
+
+	D3D12_COMMAND_LIST_TYPE	m_commandListType;
+	std::atomic<uint64_t>	m_fenceValue;
+
+	// Guards the submissions and signals, and the command lists of a submission (kept to avoid an allocation per submission)
+	std::mutex				m_submitMutex;
+	std::vector<CommandList*> m_submittedCommandLists;
+
+	std::thread				m_retireThread;
+	std::mutex				m_retireMutex;
+	std::condition_variable	m_retireCondition;
+	std::condition_variable	m_retiredCondition;
+
+	// A heap with the lowest fence value (and sequence number) first
+	std::vector<RetireEntry> m_retireEntries;
+	uint64_t				m_nextSequenceNumber;
+	// Whether the retire thread is retiring entries which it has taken from m_retireEntries
+	bool					m_retiring;
+	bool					m_stopRetiring;
+
+	// The command lists which have been reset and are ready for recording
+	std::vector<std::shared_ptr<CommandList>> m_availableCommandLists;
 };
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "dxpch.h"
+#include "ConstantBufferBinder.h"
+#include "Application.h"
+#include "CommandList.h"
+#include "DescriptorAllocator.h"
+#include "DynamicDescriptorHeap.h"
+#include "RootSignature.h"
+#include "UploadBuffer.h"
+
+struct ConstantBufferBinder::GraphicsRootSetters
+{
+	static void setRoot32BitConstants(CommandList& commandList, uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data)
+	{
+		commandList.setGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, data);
+	}
+
+	static void setRootConstantBufferView(CommandList& commandList, uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+	{
+		commandList.setGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+	}
+};
+
+struct ConstantBufferBinder::ComputeRootSetters
+{
+	static void setRoot32BitConstants(CommandList& commandList, uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data)
+	{
+		commandList.setComputeRoot32BitConstants(rootParameterIndex, num32BitValues, data);
+	}
+
+	static void setRootConstantBufferView(CommandList& commandList, uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+	{
+		commandList.setComputeRootConstantBufferView(rootParameterIndex, bufferLocation);
+	}
+};
+
+ConstantBufferBinder::ConstantBufferBinder(UploadBuffer& uploadBuffer, DescriptorAllocator& descriptorAllocator)
+	:	m_uploadBuffer(uploadBuffer),
+		m_descriptorAllocator(descriptorAllocator),
+		m_rootSignature(nullptr),
+		m_numRootConstantBindings(0),
+		m_numRootDescriptorBindings(0),
+		m_numDescriptorTableBindings(0)
+{
+}
+
+void ConstantBufferBinder::setGraphicsConstantBuffer(CommandList& commandList, DynamicDescriptorHeap& descriptorHeap, uint32_t rootParameterIndex, const void* data, size_t sizeInBytes)
+{
+	setConstantBuffer<GraphicsRootSetters>(commandList, descriptorHeap, rootParameterIndex, data, sizeInBytes);
+}
+
+void ConstantBufferBinder::setComputeConstantBuffer(CommandList& commandList, DynamicDescriptorHeap& descriptorHeap, uint32_t rootParameterIndex, const void* data, size_t sizeInBytes)
+{
+	setConstantBuffer<ComputeRootSetters>(commandList, descriptorHeap, rootParameterIndex, data, sizeInBytes);
+}
+
+template<typename RootSetters>
+void ConstantBufferBinder::setConstantBuffer(CommandList& commandList, DynamicDescriptorHeap& descriptorHeap, uint32_t rootParameterIndex, const void* data, size_t sizeInBytes)
+{
+	assert(m_rootSignature != nullptr && "Set the root signature before binding constant buffers.");
+
+	switch (m_rootSignature->getRootParameterType(rootParameterIndex))
+	{
+	case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+	{
+		assert(sizeInBytes <= m_rootSignature->getNum32BitValues(rootParameterIndex) * 4 && "The data does not fit in the root constants.");
+
+		RootSetters::setRoot32BitConstants(commandList, rootParameterIndex, static_cast<uint32_t>((sizeInBytes + 3) / 4), data);
+		m_numRootConstantBindings++;
+		break;
+	}
+	case D3D12_ROOT_PARAMETER_TYPE_CBV:
+	{
+		// The shader reads whole 256-byte blocks, so the next allocation must not start inside this one
+		size_t alignedSize = Math::AlignUp(sizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+		UploadBuffer::Allocation allocation = m_uploadBuffer.allocate(alignedSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		memcpy(allocation.cpu, data, sizeInBytes);
+
+		RootSetters::setRootConstantBufferView(commandList, rootParameterIndex, allocation.gpu);
+		m_numRootDescriptorBindings++;
+		break;
+	}
+	case D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE:
+	{
+		// CBVs must be 256-byte aligned
+		size_t alignedSize = Math::AlignUp(sizeInBytes, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+		UploadBuffer::Allocation allocation = m_uploadBuffer.allocate(alignedSize, D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+		memcpy(allocation.cpu, data, sizeInBytes);
+
+		D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc{};
+		cbvDesc.BufferLocation = allocation.gpu;
+		cbvDesc.SizeInBytes = static_cast<UINT>(alignedSize);
+
+		// Freed right away, the descriptor is only reused once this frame has completed
+		DescriptorAllocation cbv = m_descriptorAllocator.allocate(1);
+		Application::Get()->getDevice()->createConstantBufferView(cbvDesc, cbv.getDescriptorHandle());
+		descriptorHeap.stageDescriptors(rootParameterIndex, 0, 1, cbv.getDescriptorHandle());
+		m_descriptorAllocator.free(cbv);
+
+		m_numDescriptorTableBindings++;
+		break;
+	}
+	default:
+		assert(false && "The root parameter is not a constant buffer.");
+		break;
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "d3dx12.h"
+
+#include <cstdint>
+
+class CommandList;
+class DescriptorAllocator;
+class DynamicDescriptorHeap;
+class RootSignature;
+class UploadBuffer;
+
+/*
+*	Binds per-draw (or per-dispatch) constant data to a root parameter, using whatever the root signature
+*	chose for it (see RootSignature::InitAsConstantBuffer):
+*	  * root constants: the data is written into the command list, no upload and no descriptor.
+*	  * root CBV: the data is copied to the upload buffer and its GPU address is set, no descriptor.
+*	  * descriptor table: the data is copied to the upload buffer, a CBV is created and staged on the
+*	    dynamic descriptor heap, which must be committed before the draw like any other table.
+*
+*	Like the UploadBuffer, a binder must only be used with a single command list at a time.
+*/
+class ConstantBufferBinder
+{
+public:
+	/*
+	* @param descriptorAllocator Provides the CPU visible CBVs of constant buffers bound through descriptor tables.
+	*/
+	ConstantBufferBinder(UploadBuffer& uploadBuffer, DescriptorAllocator& descriptorAllocator);
+	virtual ~ConstantBufferBinder() = default;
+
+	// Use the root signature that is set on the command list
+	void setRootSignature(const RootSignature& rootSignature) { m_rootSignature = &rootSignature; }
+
+	void setGraphicsConstantBuffer(CommandList& commandList, DynamicDescriptorHeap& descriptorHeap, uint32_t rootParameterIndex, const void* data, size_t sizeInBytes);
+	void setComputeConstantBuffer(CommandList& commandList, DynamicDescriptorHeap& descriptorHeap, uint32_t rootParameterIndex, const void* data, size_t sizeInBytes);
+
+	// Usage per binding, since the binder was created
+	uint64_t getNumRootConstantBindings() const { return m_numRootConstantBindings; }
+	uint64_t getNumRootDescriptorBindings() const { return m_numRootDescriptorBindings; }
+	uint64_t getNumDescriptorTableBindings() const { return m_numDescriptorTableBindings; }
+
+private:
+	// The setters of the graphics or compute root parameters on the command list
+	struct GraphicsRootSetters;
+	struct ComputeRootSetters;
+
+	template<typename RootSetters>
+	void setConstantBuffer(CommandList& commandList, DynamicDescriptorHeap& descriptorHeap, uint32_t rootParameterIndex, const void* data, size_t sizeInBytes);
+
+	UploadBuffer& m_uploadBuffer;
+	DescriptorAllocator& m_descriptorAllocator;
+
+	const RootSignature* m_rootSignature;
+
+	uint64_t m_numRootConstantBindings;
+	uint64_t m_numRootDescriptorBindings;
+	uint64_t m_numDescriptorTableBindings;
+};
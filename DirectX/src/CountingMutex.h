@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+/*
+*	std::mutex which counts how often it is locked and how often a thread had to wait
+*	for it because another thread was holding it. Can be used with std::lock_guard
+*	and std::unique_lock like a regular mutex.
+*/
+class CountingMutex
+{
+public:
+	CountingMutex()
+		:	m_numLocks(0),
+			m_numContendedLocks(0)
+	{}
+
+	CountingMutex(const CountingMutex&) = delete;
+	CountingMutex& operator=(const CountingMutex&) = delete;
+
+	void lock()
+	{
+		if (!m_mutex.try_lock())
+		{
+			m_numContendedLocks.fetch_add(1, std::memory_order_relaxed);
+			m_mutex.lock();
+		}
+
+		m_numLocks.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	bool try_lock()
+	{
+		if (!m_mutex.try_lock())
+		{
+			return false;
+		}
+
+		m_numLocks.fetch_add(1, std::memory_order_relaxed);
+		return true;
+	}
+
+	void unlock()
+	{
+		m_mutex.unlock();
+	}
+
+	uint64_t getNumLocks() const { return m_numLocks.load(std::memory_order_relaxed); }
+	uint64_t getNumContendedLocks() const { return m_numContendedLocks.load(std::memory_order_relaxed); }
+
+private:
+	std::mutex				m_mutex;
+
+	std::atomic<uint64_t>	m_numLocks;
+	std::atomic<uint64_t>	m_numContendedLocks;
+};
@@ -3,54 +3,60 @@
 #include "d3dx12.h"
 
 #include <cstdint>
-#include <memory>
+#include <type_traits>
 
-class DescriptorAllocatorPage;
+class DescriptorAllocator;
 
 /*
-* Descriptor table wrapper class
+* Descriptor table handle.
+* A plain 16 byte value (allocator, page index, offset and count) which is resolved through the
+* DescriptorAllocator that handed it out. It does not own the descriptors, they must be returned with
+* DescriptorAllocator::free (or DescriptorAllocation::free) once they are not used anymore.
 */
 class DescriptorAllocation
 {
 public:
-	// Creates  a NULL descriptor
-	DescriptorAllocation();
+	// Creates a NULL descriptor
+	DescriptorAllocation() = default;
 	// Create a valid descriptor allocation
-	DescriptorAllocation(D3D12_CPU_DESCRIPTOR_HANDLE descriptor, uint32_t numHandles, uint32_t descriptorSize, std::shared_ptr<DescriptorAllocatorPage> page);
-	// The desctructor will automatically free the allocation
-	~DescriptorAllocation();
-
-	// Copies are not allowed
-	DescriptorAllocation(const DescriptorAllocation&) = delete;
-	DescriptorAllocation& operator=(const DescriptorAllocation&) = delete;
-
-	// Move is allowed
-	DescriptorAllocation(DescriptorAllocation&& allocation);
-	DescriptorAllocation& operator= (DescriptorAllocation && other);
+	DescriptorAllocation(DescriptorAllocator* allocator, uint32_t pageIndex, uint32_t offset, uint32_t numHandles);
 
 	// Check if this is a valid descriptor
-	bool isNull() const;
+	bool isNull() const { return m_allocator == nullptr; }
 
 	// Get a descriptor at a particular offset in the allocation
 	D3D12_CPU_DESCRIPTOR_HANDLE getDescriptorHandle(uint32_t offset = 0) const;
 
 	// Get the number of (consecutive) handles for this allocation
-	uint32_t getNumHandles() const;
-
-	// Get the heap that this allocation came from
-	std::shared_ptr<DescriptorAllocatorPage> getDescriptorAllocatorPage() const;
-
-private:
-	// Free the descriptor back to the heap it came from
+	uint32_t getNumHandles() const { return m_numHandles; }
+
+	// Get the allocator that this allocation came from
+	DescriptorAllocator* getDescriptorAllocator() const { return m_allocator; }
+	// Get the index of the page (in the allocator) that this allocation came from
+	uint32_t getPageIndex() const { return m_pageIndex; }
+	// Get the offset (in descriptors) of the allocation within its page
+	uint32_t getOffset() const { return m_offset; }
+
+	// Check if both handles refer to the same descriptors
+	bool operator==(const DescriptorAllocation& other) const
+	{
+		return m_allocator == other.m_allocator && m_pageIndex == other.m_pageIndex && m_offset == other.m_offset;
+	}
+	bool operator!=(const DescriptorAllocation& other) const { return !(*this == other); }
+
+	// Free the descriptors back to the allocator they came from and make this a NULL descriptor
 	void free();
 
-	// The base descriptor
-	D3D12_CPU_DESCRIPTOR_HANDLE m_descriptor;
+private:
+	// The allocator which owns the page
+	DescriptorAllocator* m_allocator = nullptr;
+	// The offset (in descriptors) within the page
+	uint32_t m_offset = 0;
+	// The index of the page in the allocator
+	uint16_t m_pageIndex = 0;
 	// The number of descriptors in this allocation
-	uint32_t m_numHandles;
-	// The offset to the next descriptor
-	uint32_t m_descriptorSize;
+	uint16_t m_numHandles = 0;
+};
 
-	// A pointer back to the original page where this allocation came from
-	std::shared_ptr<DescriptorAllocatorPage> m_page;
-};
\ No newline at end of file
+static_assert(sizeof(DescriptorAllocation) == 16, "DescriptorAllocation should stay a compact handle");
+static_assert(std::is_trivially_copyable<DescriptorAllocation>::value, "DescriptorAllocation should be a plain value");
\ No newline at end of file
@@ -1,80 +1,672 @@
 #include "dxpch.h"
 #include "DescriptorAllocator.h"
 
+#include "Application.h"
 #include "DescriptorAllocatorPage.h"
 
-DescriptorAllocator::DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptorsPerHeap)
+#include <algorithm>
+#include <unordered_map>
+
+namespace
+{
+	std::atomic<uint64_t> s_nextAllocatorId(1);
+
+	// The allocators that are alive by id, so an exiting thread only returns its caches to those
+	std::mutex s_allocatorsMutex;
+	std::unordered_map<uint64_t, DescriptorAllocator*> s_allocators;
+
+	// Marks a page that was not empty the last time it was trimmed
+	const uint64_t PageNotIdle = UINT64_MAX;
+}
+
+// The caches of the calling thread, by allocator id
+struct ThreadCacheLookup
+{
+	uint64_t lastAllocatorId = 0;
+	void* lastCache = nullptr;
+
+	std::unordered_map<uint64_t, void*> caches;
+
+	// The thread exits, return the cached descriptors to the allocators that are still alive
+	~ThreadCacheLookup()
+	{
+		std::lock_guard<std::mutex> lock(s_allocatorsMutex);
+		for (const auto& entry : caches)
+		{
+			auto itr = s_allocators.find(entry.first);
+			if (itr != s_allocators.end())
+			{
+				itr->second->releaseThreadCache(static_cast<DescriptorAllocator::ThreadCache*>(entry.second));
+			}
+		}
+	}
+};
+
+namespace
+{
+	thread_local ThreadCacheLookup t_threadCacheLookup;
+}
+
+DescriptorAllocator::DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptorsPerHeap, bool useThreadCaches)
 	:	m_heapType(type),
-		m_numDescriptorsPerHeap(numDescriptorsPerHeap)
+		m_numDescriptorsPerHeap(numDescriptorsPerHeap),
+		m_pageTable(std::make_unique<std::atomic<DescriptorAllocatorPage*>[]>(MaxPages)),
+		m_staleBuckets(8),
+		m_firstStaleBucket(0),
+		m_numStaleBuckets(0),
+		m_numStaleDescriptors(0),
+		m_id(s_nextAllocatorId.fetch_add(1)),
+		m_useThreadCaches(useThreadCaches),
+		m_numReleasedCacheAllocations(0),
+		m_numReleasedCacheHits(0),
+		m_numReleasedCacheRefills(0),
+		m_numUncachedAllocations(0)
 {
+	std::lock_guard<std::mutex> lock(s_allocatorsMutex);
+	s_allocators[m_id] = this;
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_allocatorsMutex);
+		s_allocators.erase(m_id);
+	}
+
+	// Cached descriptors belong to the pages, which are released together with the allocator.
+	// Only forget the cache of the calling thread, the entries of other threads are never looked up again.
+	if (t_threadCacheLookup.lastAllocatorId == m_id)
+	{
+		t_threadCacheLookup.lastAllocatorId = 0;
+		t_threadCacheLookup.lastCache = nullptr;
+	}
+	t_threadCacheLookup.caches.erase(m_id);
 }
 
 DescriptorAllocation DescriptorAllocator::allocate(uint32_t numDescriptors)
 {
-	std::lock_guard<std::mutex> lock(m_allocationMutex);
+	if (numDescriptors == 0)
+	{
+		return DescriptorAllocation();
+	}
 
-	DescriptorAllocation allocation;
+	if (numDescriptors > MaxAllocationSize)
+	{
+		throw std::length_error("Number of descriptors exceeds the maximum size of a descriptor allocation.");
+	}
 
-	for (auto itr = m_availableHeaps.begin(); itr != m_availableHeaps.end(); ++itr)
+	if (!m_useThreadCaches || numDescriptors > MaxCachedDescriptors)
 	{
-		auto allocatorPage = m_heapPool[*itr];
+		m_numUncachedAllocations.fetch_add(1, std::memory_order_relaxed);
 
-		// Try allocating the descriptors
-		allocation = allocatorPage->allocate(numDescriptors);
+		std::lock_guard<CountingMutex> lock(m_allocationMutex);
+		return allocateFromPages(numDescriptors);
+	}
+
+	ThreadCache& cache = getThreadCache();
+	cache.numAllocations.store(cache.numAllocations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+	Magazine& magazine = cache.magazines[numDescriptors - 1];
+	if (magazine.numOffsets == 0)
+	{
+		refillMagazine(magazine, numDescriptors);
+		cache.numCacheRefills.store(cache.numCacheRefills.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	else
+	{
+		cache.numCacheHits.store(cache.numCacheHits.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	if (magazine.numOffsets == 0)
+	{
+		// Refilling did not succeed, there is not a single page left that can hold this many descriptors
+		std::lock_guard<CountingMutex> lock(m_allocationMutex);
+		return allocateFromPages(numDescriptors);
+	}
+
+	uint32_t offset = magazine.offsets[--magazine.numOffsets];
+	return DescriptorAllocation(this, magazine.page->getPageIndex(), offset, numDescriptors);
+}
+
+void DescriptorAllocator::free(DescriptorAllocation& allocation)
+{
+	if (allocation.isNull())
+	{
+		return;
+	}
+
+	assert(allocation.getDescriptorAllocator() == this && "The allocation belongs to another allocator");
+
+	uint64_t frameNumber = Application::Get()->getFrameCount();
+
+	{
+		std::lock_guard<CountingMutex> lock(m_staleMutex);
+
+		// Don't add the block directly to the free list until the frame has completed.
+		getStaleDescriptorBucket(frameNumber).ranges.push_back({ allocation.getPageIndex(), allocation.getOffset(), allocation.getNumHandles() });
+		m_numStaleDescriptors += allocation.getNumHandles();
+	}
+
+	allocation = DescriptorAllocation();
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::getDescriptorHandle(uint32_t pageIndex, uint32_t offset) const
+{
+	assert(pageIndex < MaxPages);
+	return m_pageTable[pageIndex].load(std::memory_order_acquire)->getDescriptorHandle(offset);
+}
+
+void DescriptorAllocator::releaseStaleDescriptors(uint64_t frameNumber)
+{
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+
+	{
+		std::lock_guard<CountingMutex> staleLock(m_staleMutex);
+
+		// Take the ranges of all completed frames, the buckets keep their memory for later frames
+		while (m_numStaleBuckets > 0 && m_staleBuckets[m_firstStaleBucket].frameNumber <= frameNumber)
+		{
+			StaleDescriptorBucket& bucket = m_staleBuckets[m_firstStaleBucket];
+			m_retiredRanges.insert(m_retiredRanges.end(), bucket.ranges.begin(), bucket.ranges.end());
+			bucket.ranges.clear();
+
+			m_firstStaleBucket = (m_firstStaleBucket + 1) & (m_staleBuckets.size() - 1);
+			m_numStaleBuckets--;
+		}
+
+		for (const DescriptorRange& range : m_retiredRanges)
+		{
+			m_numStaleDescriptors -= range.numDescriptors;
+		}
+	}
+
+	if (m_retiredRanges.empty())
+	{
+		return;
+	}
+
+	// Group the ranges by page (and by offset within the page, so neighbouring blocks are merged in order)
+	std::sort(m_retiredRanges.begin(), m_retiredRanges.end(), [](const DescriptorRange& a, const DescriptorRange& b)
+	{
+		return a.pageIndex < b.pageIndex || (a.pageIndex == b.pageIndex && a.offset < b.offset);
+	});
+
+	size_t first = 0;
+	while (first < m_retiredRanges.size())
+	{
+		uint32_t pageIndex = m_retiredRanges[first].pageIndex;
+
+		size_t last = first + 1;
+		while (last < m_retiredRanges.size() && m_retiredRanges[last].pageIndex == pageIndex)
+		{
+			last++;
+		}
+
+		// Return all the ranges of the page at once
+		m_heapPool[pageIndex]->free(static_cast<uint32_t>(last - first), &m_retiredRanges[first]);
+
+		// There is space for new descriptors again, set is unique so can't contain same heap twice
+		m_availableHeaps.insert(pageIndex);
+
+		first = last;
+	}
+
+	m_retiredRanges.clear();
+}
+
+void DescriptorAllocator::flushThreadCache()
+{
+	if (!m_useThreadCaches)
+	{
+		return;
+	}
+
+	ThreadCache& cache = getThreadCache();
+
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+
+	for (uint32_t i = 0; i < MaxCachedDescriptors; ++i)
+	{
+		flushMagazine(cache.magazines[i], i + 1);
+	}
+}
+
+DescriptorAllocator::Stats DescriptorAllocator::getStats() const
+{
+	Stats stats{};
+	stats.numAllocations = m_numUncachedAllocations.load(std::memory_order_relaxed);
+
+	{
+		std::lock_guard<std::mutex> lock(m_threadCacheMutex);
+		stats.numAllocations += m_numReleasedCacheAllocations;
+		stats.numCacheHits = m_numReleasedCacheHits;
+		stats.numCacheRefills = m_numReleasedCacheRefills;
+		for (const auto& cache : m_threadCaches)
+		{
+			stats.numAllocations += cache->numAllocations.load(std::memory_order_relaxed);
+			stats.numCacheHits += cache->numCacheHits.load(std::memory_order_relaxed);
+			stats.numCacheRefills += cache->numCacheRefills.load(std::memory_order_relaxed);
+		}
+	}
+
+	stats.numLocks = m_allocationMutex.getNumLocks() + m_staleMutex.getNumLocks();
+	stats.numContendedLocks = m_allocationMutex.getNumContendedLocks() + m_staleMutex.getNumContendedLocks();
+
+	{
+		std::lock_guard<CountingMutex> lock(m_staleMutex);
+		stats.numStaleDescriptors = m_numStaleDescriptors;
+	}
+
+	// The pages are only added under the allocation lock, reading the counters is safe from any thread
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+	for (const auto& page : m_heapPool)
+	{
+		if (!page)
+		{
+			continue;
+		}
+
+		stats.numLocks += page->getNumLocks();
+		stats.numContendedLocks += page->getNumContendedLocks();
+	}
+
+	return stats;
+}
+
+uint32_t DescriptorAllocator::trim(uint64_t frameNumber)
+{
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+
+	m_pageIdleSince.resize(m_heapPool.size(), PageNotIdle);
+
+	uint32_t numEmptyPages = 0;
+	uint32_t numDestroyedPages = 0;
+
+	for (size_t i = 0; i < m_heapPool.size(); ++i)
+	{
+		auto& allocatorPage = m_heapPool[i];
+		if (!allocatorPage)
+		{
+			continue;
+		}
+
+		// Stale and cached descriptors are allocated in the page, so an empty page is not referenced anymore
+		if (!allocatorPage->isEmpty())
+		{
+			m_pageIdleSince[i] = PageNotIdle;
+			continue;
+		}
+
+		if (m_pageIdleSince[i] == PageNotIdle)
+		{
+			m_pageIdleSince[i] = frameNumber;
+		}
+
+		if (numEmptyPages < m_trimPolicy.numEmptyPagesToKeep || frameNumber - m_pageIdleSince[i] < m_trimPolicy.numIdleFrames)
+		{
+			numEmptyPages++;
+			continue;
+		}
+
+		// Destroy the page, its index is reused by the next page that is created
+		m_pageTable[i].store(nullptr, std::memory_order_release);
+		m_availableHeaps.erase(i);
+		allocatorPage.reset();
+
+		m_pageIdleSince[i] = PageNotIdle;
+		m_freePageIndices.push_back(static_cast<uint32_t>(i));
+		numDestroyedPages++;
+	}
+
+	return numDestroyedPages;
+}
+
+uint32_t DescriptorAllocator::compact(const CompactionPolicy& policy, const ForwardFunction& forward)
+{
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+
+	// Return the cached descriptors of all threads, otherwise they keep the sparse pages alive
+	{
+		std::lock_guard<std::mutex> cacheLock(m_threadCacheMutex);
+		for (const auto& cache : m_threadCaches)
+		{
+			for (uint32_t i = 0; i < MaxCachedDescriptors; ++i)
+			{
+				flushMagazine(cache->magazines[i], i + 1);
+			}
+		}
+	}
+
+	// Pages with stale descriptors become sparse on their own once the descriptors are released
+	std::vector<bool> hasStaleDescriptors(m_heapPool.size(), false);
+	{
+		std::lock_guard<CountingMutex> staleLock(m_staleMutex);
+		for (uint32_t i = 0; i < m_numStaleBuckets; ++i)
+		{
+			const StaleDescriptorBucket& bucket = m_staleBuckets[(m_firstStaleBucket + i) & (m_staleBuckets.size() - 1)];
+			for (const DescriptorRange& range : bucket.ranges)
+			{
+				hasStaleDescriptors[range.pageIndex] = true;
+			}
+		}
+	}
+
+	// The pages which can take part, densest first
+	std::vector<DescriptorAllocatorPage*> pages;
+	for (size_t i = 0; i < m_heapPool.size(); ++i)
+	{
+		DescriptorAllocatorPage* allocatorPage = m_heapPool[i].get();
+		if (allocatorPage && !allocatorPage->isEmpty() && !hasStaleDescriptors[i])
+		{
+			pages.push_back(allocatorPage);
+		}
+	}
+
+	std::sort(pages.begin(), pages.end(), [](const DescriptorAllocatorPage* a, const DescriptorAllocatorPage* b)
+	{
+		return a->numFreeHandles() < b->numFreeHandles();
+	});
+
+	std::shared_ptr<Device> device = Application::Get()->getDevice();
+
+	uint32_t numMovedDescriptors = 0;
+	std::vector<DescriptorRange> ranges;
+
+	// Empty the sparsest pages first, into the pages that are denser than them (never into a new page,
+	// that would only move the sparseness). The pages after the source have been emptied already.
+	for (size_t source = pages.size(); source-- > 1;)
+	{
+		DescriptorAllocatorPage* sourcePage = pages[source];
+
+		uint32_t numAllocated = sourcePage->getNumDescriptors() - sourcePage->numFreeHandles();
+		if (static_cast<float>(numAllocated) / sourcePage->getNumDescriptors() >= policy.maxSourceOccupancy)
+		{
+			break;
+		}
+
+		ranges.clear();
+		sourcePage->getAllocatedRanges(ranges);
+
+		for (const DescriptorRange& range : ranges)
+		{
+			if (numMovedDescriptors + range.numDescriptors > policy.maxDescriptorsToMove)
+			{
+				return numMovedDescriptors;
+			}
+
+			DescriptorAllocatorPage* destinationPage = nullptr;
+			uint32_t offset = DescriptorFreeList::InvalidOffset;
+			for (size_t destination = 0; destination < source; ++destination)
+			{
+				offset = pages[destination]->allocate(range.numDescriptors);
+				if (offset != DescriptorFreeList::InvalidOffset)
+				{
+					destinationPage = pages[destination];
+					break;
+				}
+			}
+
+			if (!destinationPage)
+			{
+				// The remaining allocations of this page do not fit in the denser pages
+				break;
+			}
+
+			if (destinationPage->numFreeHandles() == 0)
+			{
+				m_availableHeaps.erase(destinationPage->getPageIndex());
+			}
+
+			DescriptorAllocation oldAllocation(this, range.pageIndex, range.offset, range.numDescriptors);
+			DescriptorAllocation newAllocation(this, destinationPage->getPageIndex(), offset, range.numDescriptors);
+
+			device->copyDescriptorsSimple(range.numDescriptors, newAllocation.getDescriptorHandle(), oldAllocation.getDescriptorHandle(), m_heapType);
+			forward(oldAllocation, newAllocation);
+
+			// Views created from the old descriptors may still be in flight, retire them like any other allocation
+			free(oldAllocation);
+
+			numMovedDescriptors += range.numDescriptors;
+		}
+	}
+
+	return numMovedDescriptors;
+}
+
+DescriptorAllocator::OccupancyStats DescriptorAllocator::getOccupancyStats() const
+{
+	OccupancyStats stats{};
+
+	uint64_t largestFreeBlocks = 0;
+
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+	for (const auto& page : m_heapPool)
+	{
+		if (!page)
+		{
+			continue;
+		}
+
+		uint32_t numFreeBlocks = 0;
+		uint32_t largestFreeBlock = 0;
+		page->getFreeBlockStats(numFreeBlocks, largestFreeBlock);
+
+		stats.numPages++;
+		stats.numDescriptors += page->getNumDescriptors();
+		stats.numFreeDescriptors += page->numFreeHandles();
+		stats.numFreeBlocks += numFreeBlocks;
+		largestFreeBlocks += largestFreeBlock;
+	}
+
+	stats.numAllocatedDescriptors = stats.numDescriptors - stats.numFreeDescriptors;
+	stats.occupancy = stats.numDescriptors > 0 ? static_cast<float>(stats.numAllocatedDescriptors) / stats.numDescriptors : 0.0f;
+	stats.fragmentation = stats.numFreeDescriptors > 0 ? 1.0f - static_cast<float>(largestFreeBlocks) / stats.numFreeDescriptors : 0.0f;
+
+	return stats;
+}
+
+DescriptorAllocator::ThreadCache& DescriptorAllocator::getThreadCache()
+{
+	ThreadCacheLookup& lookup = t_threadCacheLookup;
+	if (lookup.lastAllocatorId == m_id)
+	{
+		return *static_cast<ThreadCache*>(lookup.lastCache);
+	}
+
+	ThreadCache* cache = nullptr;
+
+	auto itr = lookup.caches.find(m_id);
+	if (itr != lookup.caches.end())
+	{
+		cache = static_cast<ThreadCache*>(itr->second);
+	}
+	else
+	{
+		// First allocation of this thread, the allocator owns the cache until the thread exits
+		std::lock_guard<std::mutex> lock(m_threadCacheMutex);
+		m_threadCaches.emplace_back(std::make_unique<ThreadCache>());
+		cache = m_threadCaches.back().get();
+
+		lookup.caches[m_id] = cache;
+	}
+
+	lookup.lastAllocatorId = m_id;
+	lookup.lastCache = cache;
+
+	return *cache;
+}
+
+void DescriptorAllocator::releaseThreadCache(ThreadCache* cache)
+{
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+
+	for (uint32_t i = 0; i < MaxCachedDescriptors; ++i)
+	{
+		flushMagazine(cache->magazines[i], i + 1);
+	}
+
+	// Keep the counters of the cache in the stats
+	std::lock_guard<std::mutex> cacheLock(m_threadCacheMutex);
+	m_numReleasedCacheAllocations += cache->numAllocations.load(std::memory_order_relaxed);
+	m_numReleasedCacheHits += cache->numCacheHits.load(std::memory_order_relaxed);
+	m_numReleasedCacheRefills += cache->numCacheRefills.load(std::memory_order_relaxed);
+
+	m_threadCaches.erase(std::remove_if(m_threadCaches.begin(), m_threadCaches.end(),
+		[cache](const std::unique_ptr<ThreadCache>& threadCache) { return threadCache.get() == cache; }), m_threadCaches.end());
+}
+
+void DescriptorAllocator::refillMagazine(Magazine& magazine, uint32_t numDescriptors)
+{
+	assert(magazine.numOffsets == 0);
+
+	std::lock_guard<CountingMutex> lock(m_allocationMutex);
+
+	for (auto itr = m_availableHeaps.begin(); itr != m_availableHeaps.end();)
+	{
+		auto& allocatorPage = m_heapPool[*itr];
+
+		// Take as many ranges as possible from a single page, so the magazine only refers to one page
+		magazine.numOffsets = allocatorPage->allocateBatch(numDescriptors, MagazineSize, magazine.offsets);
+		magazine.page = allocatorPage.get();
 
 		// Remove full pages (heaps) from available pages
 		if (allocatorPage->numFreeHandles() == 0)
 		{
 			itr = m_availableHeaps.erase(itr);
 		}
+		else
+		{
+			++itr;
+		}
 
-		// The allocation was valid
-		if (!allocation.isNull())
+		if (magazine.numOffsets > 0)
 		{
-			break;
+			return;
 		}
 	}
 
-	// No available page could satisfy the requested number of descriptors
-	if (allocation.isNull())
+	// No available page could satisfy the requested number of descriptors, create a new page which can
+	m_numDescriptorsPerHeap = std::max(m_numDescriptorsPerHeap, numDescriptors);
+	DescriptorAllocatorPage* newPage = createAllocatorPage();
+
+	magazine.numOffsets = newPage->allocateBatch(numDescriptors, MagazineSize, magazine.offsets);
+	magazine.page = newPage;
+
+	if (newPage->numFreeHandles() == 0)
 	{
-		// Create a new page which can
-		m_numDescriptorsPerHeap = std::max(m_numDescriptorsPerHeap, numDescriptors);
-		auto newPage = createAllocatorPage();
-		allocation = newPage->allocate(numDescriptors);
+		m_availableHeaps.erase(newPage->getPageIndex());
 	}
-
-	return allocation;
 }
 
-void DescriptorAllocator::releaseStaleDescriptors(uint32_t frameNumber)
+void DescriptorAllocator::flushMagazine(Magazine& magazine, uint32_t numDescriptors)
 {
-	std::lock_guard<std::mutex> lock(m_allocationMutex);
+	if (magazine.numOffsets == 0)
+	{
+		return;
+	}
 
-	for (size_t i = 0; i < m_heapPool.size(); ++i)
+	magazine.page->freeBatch(numDescriptors, magazine.numOffsets, magazine.offsets);
+	magazine.numOffsets = 0;
+
+	// The page has free descriptors again
+	m_availableHeaps.insert(magazine.page->getPageIndex());
+}
+
+DescriptorAllocation DescriptorAllocator::allocateFromPages(uint32_t numDescriptors)
+{
+	for (auto itr = m_availableHeaps.begin(); itr != m_availableHeaps.end();)
 	{
-		auto page = m_heapPool[i];
+		auto& allocatorPage = m_heapPool[*itr];
+
+		// Try allocating the descriptors
+		uint32_t offset = allocatorPage->allocate(numDescriptors);
 
-		// Release any descriptors that are not in use anymore
-		page->releaseStaleDescriptors(frameNumber);
+		// Remove full pages (heaps) from available pages
+		if (allocatorPage->numFreeHandles() == 0)
+		{
+			itr = m_availableHeaps.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
 
-		// Is there any space for new descriptors?
-		if (page->numFreeHandles() > 0)
+		// The allocation was valid
+		if (offset != DescriptorFreeList::InvalidOffset)
 		{
-			// Set is unique, so can't contain same heap twice
-			m_availableHeaps.insert(i);
+			return DescriptorAllocation(this, allocatorPage->getPageIndex(), offset, numDescriptors);
 		}
 	}
+
+	// No available page could satisfy the requested number of descriptors
+	// Create a new page which can
+	m_numDescriptorsPerHeap = std::max(m_numDescriptorsPerHeap, numDescriptors);
+	DescriptorAllocatorPage* newPage = createAllocatorPage();
+
+	return DescriptorAllocation(this, newPage->getPageIndex(), newPage->allocate(numDescriptors), numDescriptors);
 }
 
-std::shared_ptr<DescriptorAllocatorPage> DescriptorAllocator::createAllocatorPage()
+DescriptorAllocator::StaleDescriptorBucket& DescriptorAllocator::getStaleDescriptorBucket(uint64_t frameNumber)
 {
-	auto newPage = std::make_shared<DescriptorAllocatorPage>(m_heapType, m_numDescriptorsPerHeap);
+	uint32_t capacity = static_cast<uint32_t>(m_staleBuckets.size());
 
-	m_heapPool.emplace_back(newPage);
-	m_availableHeaps.insert(m_heapPool.size() - 1);
+	if (m_numStaleBuckets > 0)
+	{
+		// Frame numbers only increase, so the bucket of the current frame is always the last one.
+		// A (late) free for an older frame goes in the last bucket as well, which only retires it later.
+		StaleDescriptorBucket& lastBucket = m_staleBuckets[(m_firstStaleBucket + m_numStaleBuckets - 1) & (capacity - 1)];
+		if (lastBucket.frameNumber >= frameNumber)
+		{
+			return lastBucket;
+		}
+	}
 
-	return newPage;
+	if (m_numStaleBuckets == capacity)
+	{
+		// All buckets are in use, double the ring and move the buckets to the start in order
+		std::vector<StaleDescriptorBucket> staleBuckets(capacity * 2);
+		for (uint32_t i = 0; i < m_numStaleBuckets; ++i)
+		{
+			staleBuckets[i] = std::move(m_staleBuckets[(m_firstStaleBucket + i) & (capacity - 1)]);
+		}
+
+		m_staleBuckets = std::move(staleBuckets);
+		m_firstStaleBucket = 0;
+		capacity *= 2;
+	}
+
+	StaleDescriptorBucket& bucket = m_staleBuckets[(m_firstStaleBucket + m_numStaleBuckets) & (capacity - 1)];
+	bucket.frameNumber = frameNumber;
+	m_numStaleBuckets++;
+
+	return bucket;
 }
 
+DescriptorAllocatorPage* DescriptorAllocator::createAllocatorPage()
+{
+	uint32_t pageIndex;
+	if (!m_freePageIndices.empty())
+	{
+		// Reuse the index of a trimmed page
+		pageIndex = m_freePageIndices.back();
+		m_freePageIndices.pop_back();
+	}
+	else
+	{
+		pageIndex = static_cast<uint32_t>(m_heapPool.size());
+		if (pageIndex >= MaxPages)
+		{
+			throw std::bad_alloc();
+		}
+
+		m_heapPool.emplace_back();
+	}
 
+	m_heapPool[pageIndex] = std::make_unique<DescriptorAllocatorPage>(m_heapType, m_numDescriptorsPerHeap, pageIndex);
+	m_availableHeaps.insert(pageIndex);
+
+	DescriptorAllocatorPage* newPage = m_heapPool[pageIndex].get();
+	m_pageTable[pageIndex].store(newPage, std::memory_order_release);
+
+	return newPage;
+}
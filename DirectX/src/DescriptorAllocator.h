@@ -2,46 +2,210 @@
 
 #include "d3dx12.h"
 
+#include <atomic>
 #include <cstdint>
+#include <functional>
 #include <mutex>
 #include <memory>
 #include <set>
 #include <vector>
 
+#include "CountingMutex.h"
 #include "DescriptorAllocation.h"
-
-class DescriptorAllocatorPage;
+#include "DescriptorAllocatorPage.h"
 
 // https://learn.microsoft.com/en-us/windows/win32/direct3d12/resource-binding-flow-of-control
 
 /*
 *	Class which allocates CPU visible decriptor heaps and the descriptors themselfs.
 *	Uses free list memory allocation scheme.
+*
+*	Small allocations (up to MaxCachedDescriptors) are served from a cache per thread,
+*	which is refilled in bulk from the pages. Threads that create views at the same
+*	time therefore only meet each other on the locks once every MagazineSize allocations.
+*
+*	The allocator owns its pages. A DescriptorAllocation only stores the index of its page,
+*	which is resolved through a fixed size page table that can be read without locking.
+*
+*	Freed descriptors are kept in a ring of buckets, one per frame they were freed in.
+*	Releasing stale descriptors only visits the buckets of the completed frames and
+*	returns their ranges to the pages grouped by page.
+*
+*	For long running sessions, trim destroys pages which have been empty for a number of
+*	frames and compact moves the allocations out of sparsely used pages, so they become
+*	empty and can be trimmed.
 */
 class DescriptorAllocator
 {
 public:
-	DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptorsPerHeap = 256);
-	virtual ~DescriptorAllocator() = default;
+	// The largest allocation (in descriptors) that is served from the per-thread caches
+	static const uint32_t MaxCachedDescriptors = 8;
+	// The number of allocations a per-thread cache holds for every allocation size
+	static const uint32_t MagazineSize = 32;
+	// The maximum number of pages (descriptor heaps) of a single allocator
+	static const uint32_t MaxPages = 1024;
+	// The largest allocation (in descriptors), a DescriptorAllocation stores the count in 16 bits
+	static const uint32_t MaxAllocationSize = UINT16_MAX;
+
+	struct Stats
+	{
+		// The number of allocations
+		uint64_t numAllocations;
+		// The number of allocations that were served from a per-thread cache
+		uint64_t numCacheHits;
+		// The number of times a per-thread cache was refilled from the pages
+		uint64_t numCacheRefills;
+		// The number of times the allocator (or one of its pages) was locked
+		uint64_t numLocks;
+		// The number of times a thread had to wait for the allocator or one of its pages
+		uint64_t numContendedLocks;
+		// The number of descriptors that are freed, but whose frame has not completed yet
+		uint64_t numStaleDescriptors;
+	};
+
+	// When pages that are not used anymore are destroyed
+	struct TrimPolicy
+	{
+		// The number of frames a page must have been empty before it is destroyed
+		uint32_t numIdleFrames = 300;
+		// The number of empty pages which are kept anyway, so allocating after a quiet period does not create new heaps
+		uint32_t numEmptyPagesToKeep = 1;
+	};
+
+	// Which allocations are moved by compact
+	struct CompactionPolicy
+	{
+		// Pages with less than this fraction of their descriptors allocated are emptied
+		float maxSourceOccupancy = 0.25f;
+		// The maximum number of descriptors that are moved in a single call
+		uint32_t maxDescriptorsToMove = 1024;
+	};
+
+	struct OccupancyStats
+	{
+		uint32_t numPages;
+		uint64_t numDescriptors;
+		// Allocated descriptors, this includes stale descriptors and descriptors in the per-thread caches
+		uint64_t numAllocatedDescriptors;
+		uint64_t numFreeDescriptors;
+		uint64_t numFreeBlocks;
+		// The fraction of the descriptors which is allocated
+		float occupancy;
+		// 1 - (largest free blocks / free descriptors), 0 when the free descriptors of every page are a single block
+		float fragmentation;
+	};
+
+	// Called by compact for every allocation that was moved, the old allocation must be replaced by the new one
+	using ForwardFunction = std::function<void(const DescriptorAllocation& oldAllocation, const DescriptorAllocation& newAllocation)>;
+
+	DescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptorsPerHeap = 256, bool useThreadCaches = true);
+	virtual ~DescriptorAllocator();
 
 	/*
 	* Allocate a number of contiguous descriptors from a CPU visible descriptor heap.
-	* 
+	*
 	* @param numDescriptors The number of contiguous descriptors to allocate.
-	* Cannot be more than the number of descriptors per descriptor heap.
+	* Cannot be more than MaxAllocationSize, larger requests throw std::length_error.
+	* @return A null allocation when numDescriptors is 0.
 	*/
 	DescriptorAllocation allocate(uint32_t numDescriptors = 1);
 
+	/*
+	* Return the descriptors of an allocation. They are reused once the frame
+	* they were freed in has completed (see releaseStaleDescriptors).
+	* The allocation is reset to a NULL descriptor.
+	*/
+	void free(DescriptorAllocation& allocation);
+
+	// Resolve the CPU descriptor handle at an offset in a page
+	D3D12_CPU_DESCRIPTOR_HANDLE getDescriptorHandle(uint32_t pageIndex, uint32_t offset) const;
+
 	/*
 	* When the frame has completed, the stale descriptors can be released.
+	* Releases all descriptors that were freed in this frame (or before).
+	*/
+	void releaseStaleDescriptors(uint64_t frameNumber);
+
+	/*
+	* Return the descriptors cached by the calling thread to the pages.
+	* The cache of a thread is also returned when the thread exits.
+	*/
+	void flushThreadCache();
+
+	Stats getStats() const;
+
+	void setTrimPolicy(const TrimPolicy& policy) { m_trimPolicy = policy; }
+
+	/*
+	* Destroy the pages that have been empty for the number of frames of the trim policy.
+	* Should be called once per frame (after releaseStaleDescriptors).
+	* @return The number of pages that were destroyed.
+	*/
+	uint32_t trim(uint64_t frameNumber);
+
+	/*
+	* Move the allocations of sparsely used pages into the other pages, so the sparse pages become
+	* empty and get trimmed. The descriptors are copied to their new location and the forward function
+	* is called for every moved allocation. The old descriptors are freed like any other allocation.
+	* No other thread may use the allocator (or the allocations in it) during the compaction.
+	* @return The number of descriptors that were moved.
 	*/
-	void releaseStaleDescriptors(uint32_t frameNumber);
+	uint32_t compact(const CompactionPolicy& policy, const ForwardFunction& forward);
+
+	OccupancyStats getOccupancyStats() const;
 
 private:
-	using DescriptorHeapPool = std::vector<std::shared_ptr<DescriptorAllocatorPage>>;
+	using DescriptorHeapPool = std::vector<std::unique_ptr<DescriptorAllocatorPage>>;
+
+	// Ranges of the same size from a single page, handed out by a single thread
+	struct Magazine
+	{
+		DescriptorAllocatorPage* page = nullptr;
+		uint32_t numOffsets = 0;
+		uint32_t offsets[MagazineSize];
+	};
+
+	// The magazines of a single thread. Only the owning thread touches the magazines,
+	// the counters are atomics so getStats can read them from another thread.
+	struct ThreadCache
+	{
+		Magazine magazines[MaxCachedDescriptors];
+
+		std::atomic<uint64_t> numAllocations{ 0 };
+		std::atomic<uint64_t> numCacheHits{ 0 };
+		std::atomic<uint64_t> numCacheRefills{ 0 };
+	};
+
+	// The thread local lookup returns the caches of an exiting thread
+	friend struct ThreadCacheLookup;
+
+	// Get (or create) the cache of the calling thread
+	ThreadCache& getThreadCache();
+
+	// Return the descriptors of the cache of an exiting thread and destroy the cache
+	void releaseThreadCache(ThreadCache* cache);
+
+	// Fill an empty magazine with ranges of numDescriptors descriptors
+	void refillMagazine(Magazine& magazine, uint32_t numDescriptors);
+
+	// Return the unused ranges in the magazine to its page
+	void flushMagazine(Magazine& magazine, uint32_t numDescriptors);
+
+	// Allocate directly from the pages, m_allocationMutex must be locked
+	DescriptorAllocation allocateFromPages(uint32_t numDescriptors);
 
 	// Create a new heap with a specific number of descriptors
-	std::shared_ptr<DescriptorAllocatorPage> createAllocatorPage();
+	DescriptorAllocatorPage* createAllocatorPage();
+
+	// The descriptors that were freed in a single frame
+	struct StaleDescriptorBucket
+	{
+		uint64_t frameNumber = 0;
+		std::vector<DescriptorRange> ranges;
+	};
+
+	// Get the bucket for descriptors freed in the given frame, m_staleMutex must be locked
+	StaleDescriptorBucket& getStaleDescriptorBucket(uint64_t frameNumber);
 
 	D3D12_DESCRIPTOR_HEAP_TYPE m_heapType;
 	uint32_t m_numDescriptorsPerHeap;
@@ -50,5 +214,41 @@ private:
 	// Indices of available heaps in the heap pool
 	std::set<size_t> m_availableHeaps;
 
-	std::mutex m_allocationMutex;
+	// The pages by index. Entries are only written under m_allocationMutex, but read without it.
+	std::unique_ptr<std::atomic<DescriptorAllocatorPage*>[]> m_pageTable;
+
+	mutable CountingMutex m_allocationMutex;
+
+	// Ring of stale descriptor buckets ordered by frame number. The capacity is a power of 2
+	// and grows when more frames are in flight than there are buckets.
+	std::vector<StaleDescriptorBucket> m_staleBuckets;
+	uint32_t m_firstStaleBucket;
+	uint32_t m_numStaleBuckets;
+	uint64_t m_numStaleDescriptors;
+	// Protects the stale buckets, so freeing does not wait for allocations
+	mutable CountingMutex m_staleMutex;
+
+	// The ranges that are being retired, kept to reuse the memory. Protected by m_allocationMutex.
+	std::vector<DescriptorRange> m_retiredRanges;
+
+	TrimPolicy m_trimPolicy;
+	// The frame a page was first seen empty by trim (or UINT64_MAX while it is used), by page index
+	std::vector<uint64_t> m_pageIdleSince;
+	// Indices of destroyed pages which can be reused
+	std::vector<uint32_t> m_freePageIndices;
+
+	// Identifies this allocator in the thread local cache lookup (never reused, unlike the address)
+	uint64_t m_id;
+	bool m_useThreadCaches;
+
+	std::vector<std::unique_ptr<ThreadCache>> m_threadCaches;
+	mutable std::mutex m_threadCacheMutex;
+
+	// Counters of the caches of threads that have exited, protected by m_threadCacheMutex
+	uint64_t m_numReleasedCacheAllocations;
+	uint64_t m_numReleasedCacheHits;
+	uint64_t m_numReleasedCacheRefills;
+
+	// Counters of the allocations that bypass the thread caches
+	std::atomic<uint64_t> m_numUncachedAllocations;
 };
\ No newline at end of file
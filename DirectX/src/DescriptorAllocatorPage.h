@@ -3,23 +3,35 @@
 #include "d3dx12.h"
 #include <wrl.h>
 
-#include <map>
 #include <memory>
 #include <mutex>
-#include <queue>
+#include <vector>
 
-#include "DescriptorAllocation.h"
+#include "CountingMutex.h"
+#include "DescriptorFreeList.h"
+
+// A range of descriptors in a page of a DescriptorAllocator
+struct DescriptorRange
+{
+	uint32_t pageIndex;
+	uint32_t offset;
+	uint32_t numDescriptors;
+};
 
 /*
-* Descriptor Heap wrapper class
+* Descriptor Heap wrapper class.
+* Pages are owned by a DescriptorAllocator and are identified by their index in it.
 */
-class DescriptorAllocatorPage : public std::enable_shared_from_this<DescriptorAllocatorPage>
+class DescriptorAllocatorPage
 {
 public:
-	DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors);
+	DescriptorAllocatorPage(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors, uint32_t pageIndex);
 
 	D3D12_DESCRIPTOR_HEAP_TYPE getHeapType() const;
 
+	// The index of this page in the allocator that owns it
+	uint32_t getPageIndex() const { return m_pageIndex; }
+
 	/*
 	* Check to see if this descriptor page has a contiguous block of descriptors
 	* large enough to satisfy the request.
@@ -31,88 +43,76 @@ public:
 	*/
 	uint32_t numFreeHandles() const;
 
+	// Get the total number of handles in the heap
+	uint32_t getNumDescriptors() const { return m_numDescriptorsInHeap; }
+
+	// Check if none of the descriptors in the heap are allocated (or stale)
+	bool isEmpty() const { return numFreeHandles() == m_numDescriptorsInHeap; }
+
 	/*
-	* Allocate a number of descriptors from this descriptor heap.
-	* If the allocation cannot be satisfied, then a NULL desciptor is returned.
+	* Get the number of free blocks and the size of the largest free block,
+	* which tell how fragmented the free descriptors in the heap are.
 	*/
-	DescriptorAllocation allocate(uint32_t numDescriptors);
+	void getFreeBlockStats(uint32_t& numFreeBlocks, uint32_t& largestFreeBlock);
 
 	/*
-	* Return a descriptor back to the heap.
-	* @param frameNumber State descriptors are not freed directly, but put
-	* on a stale allocations queue. State allocations are returned to the heap
-	* using the DescriptorAllocatorPage::ReleaseStateAllocations method.
+	* Get the allocated ranges (in offset order). Ranges which are
+	* allocated next to each other are returned as separate ranges.
 	*/
-	void free(DescriptorAllocation&& descriptorAllocation, uint64_t frameNumber);
+	void getAllocatedRanges(std::vector<DescriptorRange>& ranges);
 
 	/*
-	* Returned the state descriptors back to the descriptor heap.
+	* Allocate a number of descriptors from this descriptor heap.
+	* @return The offset of the descriptors within the heap or DescriptorFreeList::InvalidOffset
+	* if the allocation cannot be satisfied.
 	*/
-	void releaseStaleDescriptors(uint32_t frameNumber);
-
-protected:
-	// Compute the offset of the descriptor handle from the start of the heap
-	uint32_t computeOffset(D3D12_CPU_DESCRIPTOR_HANDLE handle);
-
-	// Adds a new block to the free list
-	void addNewBlock(uint32_t offset, uint32_t numDescriptors);
+	uint32_t allocate(uint32_t numDescriptors);
 
-	// Free a block of descriptors. This will also merge free blocks in the free
-	// list to form larger blocks that can be reused.
-	void freeBlock(uint32_t offset, uint32_t numDescriptors);
-
-private:
-	// The offset (in descriptors) within the descriptor heap
-	using OffsetType = uint32_t;
-	// The number of descriptors that are available
-	using SizeType = uint32_t;
+	/*
+	* Allocate up to numAllocations ranges of numDescriptors descriptors while
+	* taking the lock only once. Used to refill the per-thread descriptor caches.
+	* @param offsets Receives the offset of every allocated range.
+	* @return The number of ranges that were allocated.
+	*/
+	uint32_t allocateBatch(uint32_t numDescriptors, uint32_t numAllocations, uint32_t* offsets);
 
-	struct FreeBlockInfo;
-	// A map that lists the free block by the offset within the descriptor heap
-	using FreeListByOffset = std::map<OffsetType, FreeBlockInfo>;
+	/*
+	* Return ranges from allocateBatch that were never handed out. They are
+	* put back in the free list directly instead of being kept as stale descriptors.
+	*/
+	void freeBatch(uint32_t numDescriptors, uint32_t numAllocations, const uint32_t* offsets);
 
-	// A map that lists the free blocks by size. Needs to be multimap since
-	// multiple blocks can have the same size.
-	using FreeListBySize = std::multimap<SizeType, FreeListByOffset::iterator>;
+	/*
+	* Return ranges of descriptors (which must all belong to this page) to the heap.
+	* The ranges are merged with the adjacent free blocks while taking the lock only once.
+	* Stale descriptors are kept by the DescriptorAllocator until their frame has completed,
+	* this is only called when they can be reused.
+	*/
+	void free(uint32_t numRanges, const DescriptorRange* ranges);
 
-	struct FreeBlockInfo
+	// Get the CPU descriptor handle at an offset in the heap
+	D3D12_CPU_DESCRIPTOR_HANDLE getDescriptorHandle(uint32_t offset) const
 	{
-		FreeBlockInfo(SizeType size): size(size) {}
+		return { m_baseDescriptor.ptr + static_cast<SIZE_T>(offset) * m_numDescriptorHandleIncrementSize };
+	}
 
-		SizeType size;
-		FreeListBySize::iterator freeListBySizeItr;
-	};
+	/*
+	* The number of times the page was locked and the number of times
+	* a thread had to wait for the lock.
+	*/
+	uint64_t getNumLocks() const { return m_allocationMutex.getNumLocks(); }
+	uint64_t getNumContendedLocks() const { return m_allocationMutex.getNumContendedLocks(); }
 
-	struct StaleDescriptorInfo
-	{
-		StaleDescriptorInfo(OffsetType offset, SizeType size, uint64_t frameNumber)
-			:	offset(offset),
-				size(size),
-				frameNumber(frameNumber)
-		{}
-
-		// The offset within the descriptor heap
-		OffsetType offset;
-		// The number of descriptors
-		SizeType size;
-		// The frame number that the descriptor was freed
-		uint64_t frameNumber;
-	};
-
-	// Stale descriptors are queued for release until the frame that they
-	// were freed in has completed
-	using StaleDescriptorQueue = std::queue<StaleDescriptorInfo>;
-
-	FreeListByOffset m_freeListByOffset;
-	FreeListBySize m_freeListBySize;
-	StaleDescriptorQueue m_staleDescriptors;
+private:
+	// Constant time free list of the descriptors in the heap, merges adjacent free blocks
+	DescriptorFreeList m_freeList;
 
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_descriptorHeap;
 	D3D12_DESCRIPTOR_HEAP_TYPE m_heapType;
 	CD3DX12_CPU_DESCRIPTOR_HANDLE m_baseDescriptor;
 	uint32_t m_numDescriptorHandleIncrementSize;
 	uint32_t m_numDescriptorsInHeap;
-	uint32_t m_numFreeHandles;
+	uint32_t m_pageIndex;
 
-	std::mutex m_allocationMutex;
+	CountingMutex m_allocationMutex;
 };
\ No newline at end of file
@@ -0,0 +1,254 @@
+#include "dxpch.h"
+#include "DescriptorFreeList.h"
+
+DescriptorFreeList::DescriptorFreeList(uint32_t numDescriptors)
+	:	m_blocks(numDescriptors),
+		m_firstLevelBitmap(0),
+		m_secondLevelBitmaps{},
+		m_numDescriptors(numDescriptors),
+		m_numFreeDescriptors(0)
+{
+	for (uint32_t i = 0; i < FirstLevelCount; ++i)
+	{
+		for (uint32_t j = 0; j < SecondLevelCount; ++j)
+		{
+			m_freeLists[i][j] = InvalidOffset;
+		}
+	}
+
+	if (m_numDescriptors > 0)
+	{
+		insertFreeBlock(0, m_numDescriptors, InvalidOffset);
+		m_numFreeDescriptors = m_numDescriptors;
+	}
+}
+
+bool DescriptorFreeList::hasSpace(uint32_t numDescriptors) const
+{
+	return numDescriptors <= m_numFreeDescriptors && findFreeBlock(numDescriptors) != InvalidOffset;
+}
+
+uint32_t DescriptorFreeList::allocate(uint32_t numDescriptors)
+{
+	// There are less than the requested number of descriptors left.
+	if (numDescriptors == 0 || numDescriptors > m_numFreeDescriptors)
+	{
+		return InvalidOffset;
+	}
+
+	uint32_t offset = findFreeBlock(numDescriptors);
+	if (offset == InvalidOffset)
+	{
+		return InvalidOffset;
+	}
+
+	removeFreeBlock(offset);
+
+	Block& block = m_blocks[offset];
+	uint32_t remainingSize = block.size - numDescriptors;
+
+	if (remainingSize > 0)
+	{
+		// If the allocation did not exactly match the requested size,
+		// return the left-over to the free list.
+		block.size = numDescriptors;
+
+		uint32_t remainingOffset = offset + numDescriptors;
+		insertFreeBlock(remainingOffset, remainingSize, offset);
+
+		uint32_t nextOffset = remainingOffset + remainingSize;
+		if (nextOffset < m_numDescriptors)
+		{
+			m_blocks[nextOffset].prevPhysical = remainingOffset;
+		}
+	}
+
+	m_numFreeDescriptors -= numDescriptors;
+
+	return offset;
+}
+
+void DescriptorFreeList::free(uint32_t offset, uint32_t numDescriptors)
+{
+	assert(offset < m_numDescriptors && !m_blocks[offset].isFree && m_blocks[offset].size == numDescriptors && "Invalid descriptor range");
+
+	// Add the number of free descriptors back before merging any blocks,
+	// since merging modifies numDescriptors.
+	m_numFreeDescriptors += numDescriptors;
+
+	uint32_t prevPhysical = m_blocks[offset].prevPhysical;
+
+	// The previous block is exactly behind the block that is to be freed.
+	if (prevPhysical != InvalidOffset && m_blocks[prevPhysical].isFree)
+	{
+		removeFreeBlock(prevPhysical);
+
+		offset = prevPhysical;
+		numDescriptors += m_blocks[prevPhysical].size;
+		prevPhysical = m_blocks[prevPhysical].prevPhysical;
+	}
+
+	// The next block is exactly in front of the block that is to be freed.
+	uint32_t nextOffset = offset + numDescriptors;
+	if (nextOffset < m_numDescriptors && m_blocks[nextOffset].isFree)
+	{
+		removeFreeBlock(nextOffset);
+
+		numDescriptors += m_blocks[nextOffset].size;
+	}
+
+	insertFreeBlock(offset, numDescriptors, prevPhysical);
+
+	nextOffset = offset + numDescriptors;
+	if (nextOffset < m_numDescriptors)
+	{
+		m_blocks[nextOffset].prevPhysical = offset;
+	}
+}
+
+void DescriptorFreeList::mapping(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	if (size < SecondLevelCount)
+	{
+		// Small blocks are all stored in the first list, one size per second level
+		firstLevel = 0;
+		secondLevel = size;
+	}
+	else
+	{
+		DWORD log2;
+		_BitScanReverse(&log2, size);
+
+		firstLevel = log2 - SecondLevelLog2 + 1;
+		secondLevel = (size >> (log2 - SecondLevelLog2)) ^ SecondLevelCount;
+	}
+}
+
+bool DescriptorFreeList::mappingSearch(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel)
+{
+	if (size >= SecondLevelCount)
+	{
+		// Round up to the next size class, so every block in the class is large enough
+		DWORD log2;
+		_BitScanReverse(&log2, size);
+
+		uint64_t roundedSize = static_cast<uint64_t>(size) + (1ull << (log2 - SecondLevelLog2)) - 1;
+		if (roundedSize > UINT32_MAX)
+		{
+			return false;
+		}
+
+		size = static_cast<uint32_t>(roundedSize);
+	}
+
+	mapping(size, firstLevel, secondLevel);
+	return true;
+}
+
+uint32_t DescriptorFreeList::findSuitableBlock(uint32_t firstLevel, uint32_t secondLevel) const
+{
+	DWORD index;
+
+	// Look for a non-empty list in the same first level (of at least the same size)
+	uint32_t secondLevelMap = m_secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+	if (secondLevelMap == 0)
+	{
+		// Take the smallest non-empty first level that is larger
+		uint32_t firstLevelMap = firstLevel + 1 < FirstLevelCount ? m_firstLevelBitmap & (~0u << (firstLevel + 1)) : 0;
+		if (!_BitScanForward(&index, firstLevelMap))
+		{
+			return InvalidOffset;
+		}
+
+		firstLevel = index;
+		secondLevelMap = m_secondLevelBitmaps[firstLevel];
+	}
+
+	_BitScanForward(&index, secondLevelMap);
+
+	return m_freeLists[firstLevel][index];
+}
+
+uint32_t DescriptorFreeList::findFreeBlock(uint32_t numDescriptors) const
+{
+	uint32_t firstLevel, secondLevel;
+
+	if (mappingSearch(numDescriptors, firstLevel, secondLevel))
+	{
+		uint32_t offset = findSuitableBlock(firstLevel, secondLevel);
+		if (offset != InvalidOffset)
+		{
+			return offset;
+		}
+	}
+
+	// The rounded up size class is empty, but the first block in the size
+	// class of the request itself might still be large enough.
+	mapping(numDescriptors, firstLevel, secondLevel);
+
+	uint32_t offset = m_freeLists[firstLevel][secondLevel];
+	if (offset != InvalidOffset && m_blocks[offset].size >= numDescriptors)
+	{
+		return offset;
+	}
+
+	return InvalidOffset;
+}
+
+void DescriptorFreeList::insertFreeBlock(uint32_t offset, uint32_t size, uint32_t prevPhysical)
+{
+	uint32_t firstLevel, secondLevel;
+	mapping(size, firstLevel, secondLevel);
+
+	uint32_t head = m_freeLists[firstLevel][secondLevel];
+
+	Block& block = m_blocks[offset];
+	block.size = size;
+	block.prevPhysical = prevPhysical;
+	block.prevFree = InvalidOffset;
+	block.nextFree = head;
+	block.isFree = true;
+
+	if (head != InvalidOffset)
+	{
+		m_blocks[head].prevFree = offset;
+	}
+
+	m_freeLists[firstLevel][secondLevel] = offset;
+	m_firstLevelBitmap |= (1 << firstLevel);
+	m_secondLevelBitmaps[firstLevel] |= (1 << secondLevel);
+}
+
+void DescriptorFreeList::removeFreeBlock(uint32_t offset)
+{
+	Block& block = m_blocks[offset];
+
+	uint32_t firstLevel, secondLevel;
+	mapping(block.size, firstLevel, secondLevel);
+
+	if (block.prevFree != InvalidOffset)
+	{
+		m_blocks[block.prevFree].nextFree = block.nextFree;
+	}
+	if (block.nextFree != InvalidOffset)
+	{
+		m_blocks[block.nextFree].prevFree = block.prevFree;
+	}
+
+	if (m_freeLists[firstLevel][secondLevel] == offset)
+	{
+		m_freeLists[firstLevel][secondLevel] = block.nextFree;
+
+		// The list became empty, clear the bits so the list is not found anymore
+		if (block.nextFree == InvalidOffset)
+		{
+			m_secondLevelBitmaps[firstLevel] &= ~(1 << secondLevel);
+			if (m_secondLevelBitmaps[firstLevel] == 0)
+			{
+				m_firstLevelBitmap &= ~(1 << firstLevel);
+			}
+		}
+	}
+
+	block.isFree = false;
+}
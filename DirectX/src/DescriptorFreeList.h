@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*
+*	Two-level segregated fit (TLSF) free list for ranges of descriptors in a descriptor heap.
+*
+*	Free blocks are kept in doubly linked lists which are bucketed by size. The first level
+*	splits the sizes by power of 2, the second level divides every power of 2 in SecondLevelCount
+*	linear ranges. A bitmap per level tracks the non-empty lists, so a fitting block is found with
+*	two bit scans. Allocating, freeing and merging adjacent free blocks are all constant time and
+*	the block bookkeeping is allocated once (one entry per descriptor) when the free list is created.
+*/
+class DescriptorFreeList
+{
+public:
+	// Returned by allocate when there is no block that can satisfy the request
+	static const uint32_t InvalidOffset = UINT32_MAX;
+
+	explicit DescriptorFreeList(uint32_t numDescriptors);
+
+	/*
+	* Check to see if there is a free block of at least the requested size.
+	*/
+	bool hasSpace(uint32_t numDescriptors) const;
+
+	/*
+	* Allocate a contiguous range of descriptors.
+	* @return The offset (in descriptors) of the range or InvalidOffset.
+	*/
+	uint32_t allocate(uint32_t numDescriptors);
+
+	/*
+	* Return a range of descriptors to the free list. It is merged with
+	* the free blocks directly before and after it.
+	*/
+	void free(uint32_t offset, uint32_t numDescriptors);
+
+	uint32_t getNumDescriptors() const { return m_numDescriptors; }
+	uint32_t getNumFreeDescriptors() const { return m_numFreeDescriptors; }
+
+	/*
+	* Visit all (free and allocated) blocks in offset order.
+	* The function is called as function(offset, numDescriptors, isFree).
+	*/
+	template<typename Function>
+	void forEachBlock(Function&& function) const
+	{
+		for (uint32_t offset = 0; offset < m_numDescriptors; offset += m_blocks[offset].size)
+		{
+			function(offset, m_blocks[offset].size, m_blocks[offset].isFree);
+		}
+	}
+
+private:
+	static const uint32_t SecondLevelLog2 = 4;
+	static const uint32_t SecondLevelCount = 1 << SecondLevelLog2;
+	static const uint32_t FirstLevelCount = 32 - SecondLevelLog2 + 1;
+
+	// Bookkeeping of a block, only valid for the entry at the offset where a block starts
+	struct Block
+	{
+		uint32_t size;
+		uint32_t prevPhysical;	// Offset of the block directly before this one (or InvalidOffset)
+		uint32_t prevFree;		// Links in the free list of the size class (when free)
+		uint32_t nextFree;
+		bool isFree;
+	};
+
+	// Get the size class of a block
+	static void mapping(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+	// Get the first size class of which all blocks are large enough for the requested size
+	static bool mappingSearch(uint32_t size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+	// Find a free block that is large enough in the given size class (or a larger one)
+	uint32_t findSuitableBlock(uint32_t firstLevel, uint32_t secondLevel) const;
+	// Find a free block for the requested size
+	uint32_t findFreeBlock(uint32_t numDescriptors) const;
+
+	void insertFreeBlock(uint32_t offset, uint32_t size, uint32_t prevPhysical);
+	void removeFreeBlock(uint32_t offset);
+
+private:
+	std::vector<Block>	m_blocks;
+
+	uint32_t			m_firstLevelBitmap;
+	uint32_t			m_secondLevelBitmaps[FirstLevelCount];
+	uint32_t			m_freeLists[FirstLevelCount][SecondLevelCount];
+
+	uint32_t			m_numDescriptors;
+	uint32_t			m_numFreeDescriptors;
+};
\ No newline at end of file
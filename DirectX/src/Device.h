@@ -0,0 +1,86 @@
+#pragma once
+
+#include "d3dx12.h"
+
+#include <wrl.h>
+
+#include <cstdint>
+#include <memory>
+
+class CommandQueue;
+class SwapChain;
+class Window;
+
+/*
+*	Thin abstraction of the D3D12 device.
+*	Only the functionality the renderer uses is exposed, so it can either be backed
+*	by a real ID3D12Device2 (D3D12Device) or by a CPU only implementation (NullDevice)
+*	which allows running and profiling the CPU side of the renderer without a GPU.
+*/
+class Device : public std::enable_shared_from_this<Device>
+{
+public:
+	virtual ~Device() = default;
+
+#if defined(_WIN32)
+	// Create a device using the D3D12 runtime (the adapter with the most dedicated memory, or WARP).
+	static std::shared_ptr<Device> CreateD3D12Device(bool useWarp);
+#endif
+	// Create a device which does not need a GPU. Fences are signaled immediately
+	// and command lists are recorded into an in-memory stream.
+	static std::shared_ptr<Device> CreateNullDevice();
+
+	virtual bool isNullDevice() const = 0;
+
+	/*
+	* Command submission
+	*/
+	virtual std::shared_ptr<CommandQueue> createCommandQueue(D3D12_COMMAND_LIST_TYPE type) = 0;
+	virtual std::shared_ptr<SwapChain> createSwapChain(std::shared_ptr<CommandQueue> commandQueue, const Window& window,
+		uint32_t width, uint32_t height, uint32_t bufferCount, bool tearingSupported) = 0;
+
+	/*
+	* Descriptors
+	*/
+	virtual Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC& desc) = 0;
+	virtual uint32_t getDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const = 0;
+
+	virtual void copyDescriptors(uint32_t numDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* destDescriptorRangeStarts, const UINT* destDescriptorRangeSizes,
+		uint32_t numSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptorRangeStarts, const UINT* srcDescriptorRangeSizes,
+		D3D12_DESCRIPTOR_HEAP_TYPE type) = 0;
+	virtual void copyDescriptorsSimple(uint32_t numDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptorRangeStart,
+		D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptorRangeStart, D3D12_DESCRIPTOR_HEAP_TYPE type) = 0;
+
+	virtual void createConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) = 0;
+	virtual void createRenderTargetView(ID3D12Resource* resource, const D3D12_RENDER_TARGET_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) = 0;
+	virtual void createDepthStencilView(ID3D12Resource* resource, const D3D12_DEPTH_STENCIL_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) = 0;
+	virtual void createSampler(const D3D12_SAMPLER_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) = 0;
+
+	/*
+	* Resources
+	*/
+	virtual Microsoft::WRL::ComPtr<ID3D12Resource> createCommittedResource(const D3D12_HEAP_PROPERTIES& heapProperties, D3D12_HEAP_FLAGS heapFlags,
+		const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue = nullptr) = 0;
+
+	// Placed resources share the memory of a heap, see TransientResourceAllocator
+	virtual Microsoft::WRL::ComPtr<ID3D12Heap> createHeap(const D3D12_HEAP_DESC& desc) = 0;
+	virtual Microsoft::WRL::ComPtr<ID3D12Resource> createPlacedResource(ID3D12Heap* heap, uint64_t heapOffset, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue = nullptr) = 0;
+	// The size and alignment of the resource in a heap
+	virtual D3D12_RESOURCE_ALLOCATION_INFO getResourceAllocationInfo(const D3D12_RESOURCE_DESC& desc) = 0;
+
+	virtual void getCopyableFootprints(const D3D12_RESOURCE_DESC& desc, uint32_t firstSubresource, uint32_t numSubresources, uint64_t baseOffset,
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizesInBytes, UINT64* totalBytes) = 0;
+
+	/*
+	* Queries
+	*/
+	virtual Microsoft::WRL::ComPtr<ID3D12QueryHeap> createQueryHeap(const D3D12_QUERY_HEAP_DESC& desc) = 0;
+
+	/*
+	* Pipeline
+	*/
+	virtual D3D_ROOT_SIGNATURE_VERSION getHighestRootSignatureVersion() = 0;
+	virtual Microsoft::WRL::ComPtr<ID3D12RootSignature> createRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, D3D_ROOT_SIGNATURE_VERSION version) = 0;
+	virtual Microsoft::WRL::ComPtr<ID3D12PipelineState> createPipelineState(const D3D12_PIPELINE_STATE_STREAM_DESC& desc) = 0;
+};
\ No newline at end of file
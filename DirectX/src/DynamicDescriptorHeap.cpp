@@ -11,12 +11,18 @@ DynamicDescriptorHeap::DynamicDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, ui
 		m_staleDescriptorTableBitMask(0),
 		m_currentCPUDescriptorHandle(D3D12_DEFAULT),
 		m_currentGPUDescriptorHandle(D3D12_DEFAULT),
-		m_numFreeHandles(0)
+		m_numFreeHandles(0),
+		m_numReusedTables(0),
+		m_retainCommittedTables(false)
 {
-	m_descriptorHandleIncrementSize = Application::Get()->getDevice()->GetDescriptorHandleIncrementSize(m_descriptorHeapType);
+	assert((m_descriptorHeapType != D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER || m_numDescriptorsPerHeap <= D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE) &&
+		"Shader visible sampler heaps cannot have more than 2048 descriptors.");
+
+	m_descriptorHandleIncrementSize = Application::Get()->getDevice()->getDescriptorHandleIncrementSize(m_descriptorHeapType);
 
 	// Allocate space for staging CPU visible descriptors
 	m_descriptorHandleCache = std::make_unique<D3D12_CPU_DESCRIPTOR_HANDLE[]>(m_numDescriptorsPerHeap);
+	m_copySrcDescriptors = std::make_unique<D3D12_CPU_DESCRIPTOR_HANDLE[]>(m_numDescriptorsPerHeap);
 }
 
 void DynamicDescriptorHeap::stageDescriptors(uint32_t rootParameterIndex, uint32_t offset, uint32_t numDescriptors, const D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor)
@@ -48,7 +54,8 @@ void DynamicDescriptorHeap::stageDescriptors(uint32_t rootParameterIndex, uint32
 	m_staleDescriptorTableBitMask |= (1 << rootParameterIndex);
 }
 
-void DynamicDescriptorHeap::commitStagedDescriptors(CommandList& commandlist, std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE)> setFunc)
+template<DynamicDescriptorHeap::SetRootDescriptorTableFunction setRootDescriptorTable>
+void DynamicDescriptorHeap::commitStagedDescriptors(CommandList& commandlist)
 {
 	// Compute the number of descriptors that need to be copied
 	uint32_t numDescriptorsToCommit = computeStaleDescriptorCount();
@@ -58,24 +65,15 @@ void DynamicDescriptorHeap::commitStagedDescriptors(CommandList& commandlist, st
 		return;
 	}
 
-	auto device = Application::Get()->getDevice();
-	auto d3dCommandList = commandlist.getCommandList();
-	assert(d3dCommandList != nullptr);
+	prepareDescriptorHeap(commandlist, numDescriptorsToCommit);
 
-	if (m_currentDescriptorHeap == nullptr || m_numFreeHandles < numDescriptorsToCommit)
-	{
-		m_currentDescriptorHeap = requestDescriptorHeap();
-		m_currentCPUDescriptorHandle = m_currentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-		m_currentGPUDescriptorHandle = m_currentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-		m_numFreeHandles = m_numDescriptorsPerHeap;
+	// The tables are laid out one after the other in the heap, so they form a single destination range
+	D3D12_CPU_DESCRIPTOR_HANDLE destDescriptorRangeStart = m_currentCPUDescriptorHandle;
+	UINT numDescriptorsToCopy = 0;
 
-		commandlist.setDescriptorHeap(m_descriptorHeapType, m_currentDescriptorHeap.Get());
-
-		// When updating the descriptor heap on the command list, all descriptor
-		// tables must be (re)copied to the new descriptor heap (not just
-		// the stale descriptor tables).
-		m_staleDescriptorTableBitMask = m_descriptorTableBitMask;
-	}
+	uint32_t numTables = 0;
+	uint32_t rootIndices[MaxDescriptorTables];
+	D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptors[MaxDescriptorTables];
 
 	DWORD rootIndex;
 	// Scan from LSB to MSB for a set bit in staleDescriptorsBitMask
@@ -84,63 +82,69 @@ void DynamicDescriptorHeap::commitStagedDescriptors(CommandList& commandlist, st
 		UINT numSrcDescriptors = m_descriptorTableCache[rootIndex].numDescriptors;
 		D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorHandles = m_descriptorTableCache[rootIndex].baseDescriptor;
 
-		D3D12_CPU_DESCRIPTOR_HANDLE pDestDescriptorRangeStarts[] =
-		{
-			m_currentCPUDescriptorHandle
-		};
-		UINT pDestDescriptorRangeSizes[] =
+		// Flip the stale bit so the descriptor table is not recopied again unless it is updated with a new descriptor
+		m_staleDescriptorTableBitMask ^= (1 << rootIndex);
+
+		rootIndices[numTables] = rootIndex;
+
+		uint64_t hash = hashDescriptorTable(pSrcDescriptorHandles, numSrcDescriptors);
+
+		// An identical table is already in the heap, bind that one instead of copying the descriptors again
+		if (findCommittedTable(hash, pSrcDescriptorHandles, numSrcDescriptors, gpuDescriptors[numTables]))
 		{
-			numSrcDescriptors
-		};
+			m_numReusedTables++;
+			numTables++;
+			continue;
+		}
 
-		// Copy the staged CPU visible descriptors to the GPU visible descriptor heap
-		device->CopyDescriptors(1, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
-			numSrcDescriptors, pSrcDescriptorHandles, nullptr, m_descriptorHeapType);
+		gpuDescriptors[numTables++] = m_currentGPUDescriptorHandle;
 
-		// Set the descriptors on the command list using the passed-in setter function
-		setFunc(d3dCommandList.Get(), rootIndex, m_currentGPUDescriptorHandle);
+		// Gather the staged CPU visible descriptors, they are copied together after the loop
+		memcpy(m_copySrcDescriptors.get() + numDescriptorsToCopy, pSrcDescriptorHandles, numSrcDescriptors * sizeof(D3D12_CPU_DESCRIPTOR_HANDLE));
+		numDescriptorsToCopy += numSrcDescriptors;
+
+		// Remember the table, a table with the same hash is replaced
+		m_committedTables[hash] = { m_currentGPUDescriptorHandle, static_cast<uint32_t>(m_committedDescriptors.size()), numSrcDescriptors };
+		m_committedDescriptors.insert(m_committedDescriptors.end(), pSrcDescriptorHandles, pSrcDescriptorHandles + numSrcDescriptors);
 
 		// Offset current CPU and GPU descriptor handles
 		m_currentCPUDescriptorHandle.Offset(numSrcDescriptors, m_descriptorHandleIncrementSize);
 		m_currentGPUDescriptorHandle.Offset(numSrcDescriptors, m_descriptorHandleIncrementSize);
 		m_numFreeHandles -= numSrcDescriptors;
+	}
 
-		// Flip the stale bit so the descriptor table is not recopied again unless it is updated with a new descriptor
-		m_staleDescriptorTableBitMask ^= (1 << rootIndex);
+	// Copy the staged CPU visible descriptors of all tables to the GPU visible descriptor heap
+	if (numDescriptorsToCopy > 0)
+	{
+		Application::Get()->getDevice()->copyDescriptors(1, &destDescriptorRangeStart, &numDescriptorsToCopy,
+			numDescriptorsToCopy, m_copySrcDescriptors.get(), nullptr, m_descriptorHeapType);
+	}
+
+	// Set the descriptor tables on the command list
+	for (uint32_t i = 0; i < numTables; ++i)
+	{
+		(commandlist.*setRootDescriptorTable)(rootIndices[i], gpuDescriptors[i]);
 	}
 }
 
 void DynamicDescriptorHeap::commitStagedDescriptorsForDraw(CommandList& commandlist)
 {
-	commitStagedDescriptors(commandlist, &ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable);
+	commitStagedDescriptors<&CommandList::setGraphicsRootDescriptorTable>(commandlist);
 }
 
 void DynamicDescriptorHeap::commitStagedDescriptorsForDispatch(CommandList& commandlist)
 {
-	commitStagedDescriptors(commandlist, &ID3D12GraphicsCommandList::SetComputeRootDescriptorTable);
+	commitStagedDescriptors<&CommandList::setComputeRootDescriptorTable>(commandlist);
 }
 
 D3D12_GPU_DESCRIPTOR_HANDLE DynamicDescriptorHeap::copyDescriptor(CommandList& commandlist, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptor)
 {
-	if (m_currentDescriptorHeap == nullptr || m_numFreeHandles < 1)
-	{
-		m_currentDescriptorHeap = requestDescriptorHeap();
-		m_currentCPUDescriptorHandle = m_currentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
-		m_currentGPUDescriptorHandle = m_currentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
-		m_numFreeHandles = m_numDescriptorsPerHeap;
-
-		commandlist.setDescriptorHeap(m_descriptorHeapType, m_currentDescriptorHeap.Get());
-
-		// When updating the descriptor heap on the command list, all descriptor
-		// tables must be (re)copied to the new descriptor heap (not just
-		// the stale descriptor tables).
-		m_staleDescriptorTableBitMask = m_descriptorTableBitMask;
-	}
+	prepareDescriptorHeap(commandlist, 1);
 
 	auto device = Application::Get()->getDevice();
 
 	D3D12_GPU_DESCRIPTOR_HANDLE hGPU = m_currentGPUDescriptorHandle;
-	device->CopyDescriptorsSimple(1, m_currentCPUDescriptorHandle, cpuDescriptor, m_descriptorHeapType);
+	device->copyDescriptorsSimple(1, m_currentCPUDescriptorHandle, cpuDescriptor, m_descriptorHeapType);
 
 	m_currentCPUDescriptorHandle.Offset(1, m_descriptorHandleIncrementSize);
 	m_currentGPUDescriptorHandle.Offset(1, m_descriptorHandleIncrementSize);
@@ -183,11 +187,6 @@ void DynamicDescriptorHeap::parseRootSignature(const RootSignature& rootSignatur
 
 void DynamicDescriptorHeap::reset()
 {
-	m_availableDescriptorHeaps = m_descriptorHeapPool;
-	m_currentDescriptorHeap.Reset();
-	m_currentCPUDescriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
-	m_currentGPUDescriptorHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
-	m_numFreeHandles = 0;
 	m_descriptorTableBitMask = 0;
 	m_staleDescriptorTableBitMask = 0;
 
@@ -196,6 +195,62 @@ void DynamicDescriptorHeap::reset()
 	{
 		m_descriptorTableCache[i].reset();
 	}
+
+	m_numReusedTables = 0;
+
+	if (m_retainCommittedTables && m_currentDescriptorHeap != nullptr)
+	{
+		// Keep appending to the current heap, the other heaps are free again
+		m_availableDescriptorHeaps = DescriptorHeapPool();
+
+		DescriptorHeapPool descriptorHeaps = m_descriptorHeapPool;
+		while (!descriptorHeaps.empty())
+		{
+			if (descriptorHeaps.front().Get() != m_currentDescriptorHeap.Get())
+			{
+				m_availableDescriptorHeaps.push(descriptorHeaps.front());
+			}
+			descriptorHeaps.pop();
+		}
+
+		return;
+	}
+
+	m_availableDescriptorHeaps = m_descriptorHeapPool;
+	m_currentDescriptorHeap.Reset();
+	m_currentCPUDescriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
+	m_currentGPUDescriptorHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
+	m_numFreeHandles = 0;
+
+	invalidateCommittedTables();
+}
+
+void DynamicDescriptorHeap::invalidateCommittedTables()
+{
+	m_committedTables.clear();
+	m_committedDescriptors.clear();
+}
+
+void DynamicDescriptorHeap::prepareDescriptorHeap(CommandList& commandlist, uint32_t numDescriptors)
+{
+	if (m_currentDescriptorHeap == nullptr || m_numFreeHandles < numDescriptors)
+	{
+		m_currentDescriptorHeap = requestDescriptorHeap();
+		m_currentCPUDescriptorHandle = m_currentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+		m_currentGPUDescriptorHandle = m_currentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+		m_numFreeHandles = m_numDescriptorsPerHeap;
+
+		// When updating the descriptor heap on the command list, all descriptor
+		// tables must be (re)copied to the new descriptor heap (not just
+		// the stale descriptor tables).
+		m_staleDescriptorTableBitMask = m_descriptorTableBitMask;
+
+		// The committed tables are in the previous heap, which is not bound anymore
+		invalidateCommittedTables();
+	}
+
+	// Does nothing when the heap is already bound, but a retained heap must be bound again after the command list is reset
+	commandlist.setDescriptorHeap(m_descriptorHeapType, m_currentDescriptorHeap.Get());
 }
 
 Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::requestDescriptorHeap()
@@ -224,10 +279,7 @@ Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> DynamicDescriptorHeap::createDescri
 	descriptorHeapDesc.NumDescriptors = m_numDescriptorsPerHeap;
 	descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 
-	ComPtr<ID3D12DescriptorHeap> descriptorHeap;
-	ThrowIfFailed(device->CreateDescriptorHeap(&descriptorHeapDesc, IID_PPV_ARGS(&descriptorHeap)));
-
-	return descriptorHeap;
+	return device->createDescriptorHeap(descriptorHeapDesc);
 }
 
 uint32_t DynamicDescriptorHeap::computeStaleDescriptorCount() const
@@ -244,3 +296,38 @@ uint32_t DynamicDescriptorHeap::computeStaleDescriptorCount() const
 
 	return numStaleDescriptors;
 }
+
+uint64_t DynamicDescriptorHeap::hashDescriptorTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors)
+{
+	// FNV-1a over the descriptor addresses
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t i = 0; i < numDescriptors; ++i)
+	{
+		hash ^= static_cast<uint64_t>(descriptors[i].ptr);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool DynamicDescriptorHeap::findCommittedTable(uint64_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors, D3D12_GPU_DESCRIPTOR_HANDLE& gpuDescriptor) const
+{
+	auto itr = m_committedTables.find(hash);
+	if (itr == m_committedTables.end() || itr->second.numDescriptors != numDescriptors)
+	{
+		return false;
+	}
+
+	// Different tables can have the same hash
+	const D3D12_CPU_DESCRIPTOR_HANDLE* committedDescriptors = m_committedDescriptors.data() + itr->second.firstDescriptor;
+	for (uint32_t i = 0; i < numDescriptors; ++i)
+	{
+		if (committedDescriptors[i].ptr != descriptors[i].ptr)
+		{
+			return false;
+		}
+	}
+
+	gpuDescriptor = itr->second.gpuDescriptor;
+	return true;
+}
@@ -7,13 +7,26 @@
 #include <cstdint>
 #include <memory>
 #include <queue>
-#include <functional>
+#include <unordered_map>
+#include <vector>
 
 class CommandList;
 class RootSignature;
 
 /*
 * Class which handles copying CPU visible descriptors to GPU visible descriptor heaps and actually binding them to the command list.
+*
+* Committed descriptor tables are remembered by the CPU handles they were copied from. When an identical
+* table is committed again (before the GPU visible heap changes or the heap is reset), the GPU range of the
+* first copy is bound instead of copying the descriptors again. The staged CPU descriptors must therefore
+* not be overwritten until the heap is reset (or invalidateCommittedTables is called).
+*
+* Sampler heaps are limited to 2048 descriptors (D3D12_MAX_SHADER_VISIBLE_SAMPLER_HEAP_SIZE). Samplers from
+* the SamplerCache are never overwritten, so a sampler heap can retain its committed tables when it is reset
+* (see setRetainCommittedTables) and a frame that uses the same samplers as the previous one copies nothing.
+*
+* A heap must only be used by a single thread at a time. Threads which record command lists in parallel each use
+* the heap of their own FrameContext.
 */
 class DynamicDescriptorHeap
 {
@@ -31,15 +44,10 @@ public:
 	/*
 	* Copy all of the staged descriptors to the GPU visible descriptor heap and
     * bind the descriptor heap and the descriptor tables to the command list.
-	* The passed-in function object is used to set the GPU visible descriptors
-    * on the command list. Two possible functions are:
-    *   * Before a draw    : ID3D12GraphicsCommandList::SetGraphicsRootDescriptorTable
-    *   * Before a dispatch: ID3D12GraphicsCommandList::SetComputeRootDescriptorTable
-    * 
-    * Since the DynamicDescriptorHeap can't know which function will be used, it must
-    * be passed as an argument to the function.
+    * All stale tables are copied with a single CopyDescriptors call.
+    * Use the draw version before a draw (SetGraphicsRootDescriptorTable) and
+    * the dispatch version before a dispatch (SetComputeRootDescriptorTable).
 	*/
-	void commitStagedDescriptors(CommandList& commandlist, std::function<void(ID3D12GraphicsCommandList*, UINT, D3D12_GPU_DESCRIPTOR_HANDLE)> setFunc);
 	void commitStagedDescriptorsForDraw(CommandList& commandlist);
 	void commitStagedDescriptorsForDispatch(CommandList& commandlist);
 
@@ -72,7 +80,31 @@ public:
     */
     void reset();
 
+    /*
+    * Forget the committed descriptor tables, so the next commit copies the descriptors again.
+    * Must be called when CPU descriptors that were committed are overwritten before reset.
+    */
+    void invalidateCommittedTables();
+
+    /*
+    * Keep the current GPU visible descriptor heap and its committed tables when the heap is reset.
+    * Only valid when the staged CPU descriptors are never overwritten, like the descriptors of the SamplerCache.
+    */
+    void setRetainCommittedTables(bool retainCommittedTables) { m_retainCommittedTables = retainCommittedTables; }
+
+    // The number of descriptor tables that were bound without copying the descriptors since the last reset
+    uint32_t getNumReusedTables() const { return m_numReusedTables; }
+
 private:
+    // The setter of the descriptor tables on the command list, chosen at compile time
+    using SetRootDescriptorTableFunction = void (CommandList::*)(uint32_t, D3D12_GPU_DESCRIPTOR_HANDLE);
+
+    template<SetRootDescriptorTableFunction setRootDescriptorTable>
+    void commitStagedDescriptors(CommandList& commandlist);
+
+    // Make sure the current descriptor heap has room for a number of descriptors and is bound to the command list
+    void prepareDescriptorHeap(CommandList& commandlist, uint32_t numDescriptors);
+
     // Request a descriptor heap if one is available
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> requestDescriptorHeap();
     // Create a new descriptor heap if no descriptor heap is available
@@ -82,6 +114,12 @@ private:
     // to GPU visible descriptor heap
     uint32_t computeStaleDescriptorCount() const;
 
+    // Hash the CPU handles of a descriptor table
+    static uint64_t hashDescriptorTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors);
+
+    // Find an identical table that was committed to the current heap
+    bool findCommittedTable(uint64_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors, D3D12_GPU_DESCRIPTOR_HANDLE& gpuDescriptor) const;
+
     /*
     * The maximum number of descriptor tables per root signature.
     * A 32-bit mask is used to keep track of the root parameter indices
@@ -131,6 +169,9 @@ private:
     // The descriptor handle cache
     std::unique_ptr<D3D12_CPU_DESCRIPTOR_HANDLE[]> m_descriptorHandleCache;
 
+    // The source descriptors of a commit, gathered so all tables are copied at once
+    std::unique_ptr<D3D12_CPU_DESCRIPTOR_HANDLE[]> m_copySrcDescriptors;
+
     // Descriptor handle cache per descriptor table
     DescriptorTableCache m_descriptorTableCache[MaxDescriptorTables];
 
@@ -151,4 +192,25 @@ private:
     CD3DX12_CPU_DESCRIPTOR_HANDLE m_currentCPUDescriptorHandle;
 
     uint32_t m_numFreeHandles;
+
+    /*
+    * A descriptor table that was copied to the current GPU visible descriptor heap
+    */
+    struct CommittedTable
+    {
+        // The GPU descriptor of the copied table
+        D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptor;
+        // The index of the first CPU handle of the table in m_committedDescriptors
+        uint32_t firstDescriptor;
+        uint32_t numDescriptors;
+    };
+
+    // Committed tables by the hash of their CPU handles. Only valid for the current descriptor heap.
+    std::unordered_map<uint64_t, CommittedTable> m_committedTables;
+    // The CPU handles of the committed tables, to compare tables with the same hash
+    std::vector<D3D12_CPU_DESCRIPTOR_HANDLE> m_committedDescriptors;
+
+    uint32_t m_numReusedTables;
+
+    bool m_retainCommittedTables;
 };
\ No newline at end of file
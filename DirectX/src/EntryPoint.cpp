@@ -1,10 +1,14 @@
 #include "dxpch.h"
 
+#if defined(_WIN32)
 #include <dxgidebug.h>
+#endif
 
 //#include "app/Tutorial1.h"
 #include "app/Tutorial2.h"
+#include "bench/Benchmark.h"
 
+#if defined(_WIN32)
 void EnableDebugLayer()
 {
 #if defined(_DEBUG)
@@ -53,24 +57,103 @@ bool CheckTearingSupport()
     return allowTearing == TRUE;
 }
 
-int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
-{
-    EnableDebugLayer();
+#endif
 
-    WindowSettings settings{};
+// The amount of frames to render when running headless and no amount is given.
+#define HEADLESS_DEFAULT_FRAME_COUNT 1000
+
+int RunGame(WindowSettings& settings, uint64_t numHeadlessFrames)
+{
     settings.title = L"Learning DirectX 12";
     settings.width = 1280;
     settings.height = 720;
-    settings.tearingSupported = CheckTearingSupport();
-    settings.hInstance = hInstance;
 
     Game* game = new Tutorial2();
     Application* app = new Application(settings, game);
-    app->run();
+    if (settings.headless)
+    {
+        app->runHeadless(numHeadlessFrames);
+    }
+    else
+    {
+        app->run();
+    }
     delete app;
     delete game;
 
-    atexit(&ReportLiveObjects);
-
     return 0;
-}
\ No newline at end of file
+}
+
+#if defined(_WIN32)
+int CALLBACK wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR lpCmdLine, int nCmdShow)
+{
+    WindowSettings settings{};
+    settings.hInstance = hInstance;
+
+    uint64_t numHeadlessFrames = HEADLESS_DEFAULT_FRAME_COUNT;
+    std::string benchmark;
+
+    int argc;
+    wchar_t** argv = ::CommandLineToArgvW(::GetCommandLineW(), &argc);
+    for (int i = 0; i < argc; ++i)
+    {
+        if (::wcscmp(argv[i], L"-headless") == 0)
+        {
+            settings.headless = true;
+        }
+        else if (::wcscmp(argv[i], L"-frames") == 0 && i + 1 < argc)
+        {
+            numHeadlessFrames = ::wcstoull(argv[++i], nullptr, 10);
+        }
+        else if (::wcscmp(argv[i], L"-benchmark") == 0 && i + 1 < argc)
+        {
+            std::wstring name = argv[++i];
+            benchmark.assign(name.begin(), name.end());
+        }
+    }
+    ::LocalFree(argv);
+
+    if (!benchmark.empty())
+    {
+        return RunBenchmark(benchmark) ? 0 : 1;
+    }
+
+    if (!settings.headless)
+    {
+        EnableDebugLayer();
+        settings.tearingSupported = CheckTearingSupport();
+    }
+
+    int result = RunGame(settings, numHeadlessFrames);
+
+    if (!settings.headless)
+    {
+        atexit(&ReportLiveObjects);
+    }
+
+    return result;
+}
+#else
+int main(int argc, char** argv)
+{
+    // Without Win32 there is no window (and no D3D12 runtime), so always render with the null device.
+    WindowSettings settings{};
+    settings.headless = true;
+
+    uint64_t numHeadlessFrames = HEADLESS_DEFAULT_FRAME_COUNT;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "-frames") == 0 && i + 1 < argc)
+        {
+            numHeadlessFrames = strtoull(argv[++i], nullptr, 10);
+        }
+        else if (strcmp(argv[i], "-benchmark") == 0 && i + 1 < argc)
+        {
+            return RunBenchmark(argv[++i]) ? 0 : 1;
+        }
+    }
+
+    return RunGame(settings, numHeadlessFrames);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "dxpch.h"
+#include "FrameContext.h"
+#include "CommandList.h"
+#include "CommandQueue.h"
+
+FrameContext::FrameContext(std::shared_ptr<CommandQueue> commandQueue, uint32_t numDescriptorsPerHeap, size_t uploadRingSize)
+	:	m_uploadBuffer(commandQueue, uploadRingSize),
+		m_descriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, numDescriptorsPerHeap)
+{
+}
+
+FrameContextPool::FrameContextPool(std::shared_ptr<CommandQueue> commandQueue, uint32_t numDescriptorsPerHeap, size_t uploadRingSize)
+	:	m_commandQueue(commandQueue),
+		m_numDescriptorsPerHeap(numDescriptorsPerHeap),
+		m_uploadRingSize(uploadRingSize),
+		m_inFrame(false),
+		m_numContexts(0)
+{
+	assert(m_commandQueue != nullptr);
+}
+
+FrameContext* const* FrameContextPool::beginFrame(uint32_t numContexts)
+{
+	assert(!m_inFrame && "The previous frame has not ended.");
+
+	// Reuse the contexts of the frames the GPU has finished, the fence values only increase
+	while (!m_inFlightContexts.empty() && m_commandQueue->isFenceComplete(m_inFlightContexts.front().fenceValue))
+	{
+		std::unique_ptr<FrameContext> context = std::move(m_inFlightContexts.front().context);
+		m_inFlightContexts.pop_front();
+
+		// Releases the ring allocations whose fence value has been reached
+		context->m_uploadBuffer.reset();
+		context->m_descriptorHeap.reset();
+		m_availableContexts.push_back(std::move(context));
+	}
+
+	m_currentContexts.clear();
+	for (uint32_t i = 0; i < numContexts; ++i)
+	{
+		if (!m_availableContexts.empty())
+		{
+			m_contexts.push_back(std::move(m_availableContexts.back()));
+			m_availableContexts.pop_back();
+		}
+		else
+		{
+			m_contexts.push_back(std::make_unique<FrameContext>(m_commandQueue, m_numDescriptorsPerHeap, m_uploadRingSize));
+			m_numContexts++;
+		}
+
+		FrameContext& context = *m_contexts.back();
+		context.m_commandList = m_commandQueue->getCommandList();
+		m_currentContexts.push_back(&context);
+	}
+
+	m_inFrame = true;
+
+	return m_currentContexts.data();
+}
+
+void FrameContextPool::endFrame(uint64_t fenceValue)
+{
+	assert(m_inFrame && "The frame has not begun.");
+
+	for (std::unique_ptr<FrameContext>& context : m_contexts)
+	{
+		// The command queue keeps the executed command lists until they can be reused
+		context->m_commandList = nullptr;
+		context->m_uploadBuffer.submit(fenceValue);
+
+		m_inFlightContexts.push_back({ fenceValue, std::move(context) });
+	}
+	m_contexts.clear();
+
+	m_inFrame = false;
+}
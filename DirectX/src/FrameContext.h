@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Defines.h"
+#include "DynamicDescriptorHeap.h"
+#include "UploadBuffer.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class CommandList;
+class CommandQueue;
+
+/*
+*	Everything a single thread needs to record a command list in a frame: the command list, an upload
+*	ring buffer and a dynamic (CBV_SRV_UAV) descriptor heap of its own. A context is only used by one
+*	thread at a time, so the threads of a frame record their command lists without sharing any locks.
+*
+*	The contexts are handed out and recycled by a FrameContextPool.
+*/
+class FrameContext
+{
+public:
+	FrameContext(std::shared_ptr<CommandQueue> commandQueue, uint32_t numDescriptorsPerHeap, size_t uploadRingSize);
+	virtual ~FrameContext() = default;
+
+	CommandList& getCommandList() { return *m_commandList; }
+	UploadBuffer& getUploadBuffer() { return m_uploadBuffer; }
+	DynamicDescriptorHeap& getDescriptorHeap() { return m_descriptorHeap; }
+
+private:
+	friend class FrameContextPool;
+
+	std::shared_ptr<CommandList> m_commandList;
+	// The allocations are tagged with the fence value of the frame which used them (in ring mode)
+	UploadBuffer m_uploadBuffer;
+	DynamicDescriptorHeap m_descriptorHeap;
+};
+
+/*
+*	Hands out FrameContexts per frame, one per recording thread, and recycles every context when the
+*	command queue has reached the fence value of the frame which used it last. The upload rings reclaim
+*	their memory by the same fence values, so the upload and descriptor memory is reused as soon as the
+*	GPU is done with it, without a set of contexts per swap chain buffer.
+*
+*	beginFrame and endFrame must be called from the thread which uses the command queue,
+*	the contexts themselves may be used from any thread.
+*/
+class FrameContextPool
+{
+public:
+	/*
+	* @param commandQueue The queue the command lists of the contexts are executed on.
+	* @param numDescriptorsPerHeap, uploadRingSize The sizes of the descriptor heap and upload ring of a context.
+	*/
+	FrameContextPool(std::shared_ptr<CommandQueue> commandQueue, uint32_t numDescriptorsPerHeap = 1024, size_t uploadRingSize = _2MB);
+	virtual ~FrameContextPool() = default;
+
+	/*
+	* Get the contexts of a new frame, each with a command list which is ready for recording.
+	* The contexts are valid until endFrame.
+	*/
+	FrameContext* const* beginFrame(uint32_t numContexts);
+
+	// The command list of a context of the current frame, to execute it on the command queue
+	std::shared_ptr<CommandList> getCommandList(uint32_t context) const { return m_currentContexts[context]->m_commandList; }
+
+	/*
+	* End the frame, after the command lists of its contexts have been executed.
+	*
+	* @param fenceValue The fence value of the last command list of the frame, the contexts and their
+	* upload allocations are recycled once it is reached.
+	*/
+	void endFrame(uint64_t fenceValue);
+
+	// The number of contexts that exist, in use by the GPU or not
+	uint32_t getNumContexts() const { return m_numContexts; }
+
+private:
+	struct InFlightContext
+	{
+		uint64_t fenceValue;
+		std::unique_ptr<FrameContext> context;
+	};
+
+	std::shared_ptr<CommandQueue> m_commandQueue;
+
+	uint32_t m_numDescriptorsPerHeap;
+	size_t m_uploadRingSize;
+
+	// The contexts of the frames that may still be executing, oldest first
+	std::deque<InFlightContext> m_inFlightContexts;
+	// The contexts the GPU is done with
+	std::vector<std::unique_ptr<FrameContext>> m_availableContexts;
+	// The contexts of the current frame, in the order of the frame
+	std::vector<std::unique_ptr<FrameContext>> m_contexts;
+	std::vector<FrameContext*> m_currentContexts;
+	bool m_inFrame;
+
+	uint32_t m_numContexts;
+};
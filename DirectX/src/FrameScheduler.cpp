@@ -0,0 +1,159 @@
+#include "dxpch.h"
+#include "FrameScheduler.h"
+#include "CommandQueue.h"
+#include "SwapChain.h"
+#include "Profiler.h"
+
+FrameScheduler::FrameScheduler(std::shared_ptr<CommandQueue> commandQueue, std::shared_ptr<SwapChain> swapChain, uint32_t numFrameSlots)
+	:	m_commandQueue(commandQueue),
+		m_swapChain(swapChain),
+		m_frames(std::max(1u, numFrameSlots)),
+		m_maxLatency(0),
+		m_frameNumber(0),
+		m_numCompletedFrames(0),
+		m_inFrame(false),
+		m_cpuWaitTime(0.0),
+		m_statistics(std::make_shared<Statistics>())
+{
+	assert(m_commandQueue != nullptr && m_swapChain != nullptr);
+
+	setMaxLatency(getNumFrameSlots());
+}
+
+void FrameScheduler::setMaxLatency(uint32_t maxLatency)
+{
+	maxLatency = std::max(1u, std::min(maxLatency, getNumFrameSlots()));
+	if (maxLatency != m_maxLatency)
+	{
+		m_maxLatency = maxLatency;
+		m_swapChain->setMaximumFrameLatency(maxLatency);
+	}
+}
+
+uint32_t FrameScheduler::beginFrame()
+{
+	assert(!m_inFrame && "The previous frame has not ended.");
+
+	PROFILE_SCOPE("WaitForFrame");
+
+	Clock::time_point startTime = Clock::now();
+
+	m_swapChain->waitForNextFrame();
+
+	// The frame which was started maxLatency frames before has to be finished, this includes
+	// the frame which used the slot of this frame before (the fence values are in order)
+	if (m_frameNumber >= m_maxLatency)
+	{
+		const Frame& frame = m_frames[(m_frameNumber - m_maxLatency) % m_frames.size()];
+		assert(frame.frameNumber == m_frameNumber - m_maxLatency);
+
+		m_commandQueue->waitForFenceValue(frame.fenceValue);
+
+		// The slots of the frames before it may be reused from here on, so they are not checked again
+		m_numCompletedFrames = std::max(m_numCompletedFrames, frame.frameNumber + 1);
+	}
+
+	std::chrono::duration<double, std::milli> waitTime = Clock::now() - startTime;
+	m_cpuWaitTime = waitTime.count();
+
+	m_inFrame = true;
+
+	return getFrameIndex();
+}
+
+uint32_t FrameScheduler::endFrame(uint64_t fenceValue)
+{
+	assert(m_inFrame && "The frame has not begun.");
+
+	Frame& frame = m_frames[getFrameIndex()];
+	frame.frameNumber = m_frameNumber;
+	frame.fenceValue = fenceValue;
+
+	// Record the times once the GPU has finished the frame, on the retire thread of the command queue
+	if (fenceValue > 0)
+	{
+		FrameTimes frameTimes;
+		frameTimes.frameNumber = m_frameNumber;
+		frameTimes.cpuWaitTime = m_cpuWaitTime;
+
+		Clock::time_point submitTime = Clock::now();
+		std::shared_ptr<Statistics> statistics = m_statistics;
+
+		m_commandQueue->addCompletionCallback(fenceValue, [statistics, frameTimes, submitTime]() mutable
+		{
+			Clock::time_point completionTime = Clock::now();
+
+			std::lock_guard<std::mutex> lock(statistics->mutex);
+
+			// The GPU was idle when the previous frame was finished before this one was submitted
+			if (statistics->hasCompletedFrame && submitTime > statistics->lastCompletionTime)
+			{
+				std::chrono::duration<double, std::milli> idleTime = submitTime - statistics->lastCompletionTime;
+				frameTimes.gpuIdleTime = idleTime.count();
+			}
+
+			statistics->hasCompletedFrame = true;
+			statistics->lastCompletionTime = completionTime;
+
+			statistics->lastFrameTimes = frameTimes;
+			statistics->totalFrameTimes.frameNumber = frameTimes.frameNumber;
+			statistics->totalFrameTimes.cpuWaitTime += frameTimes.cpuWaitTime;
+			statistics->totalFrameTimes.gpuIdleTime += frameTimes.gpuIdleTime;
+			statistics->numFrames++;
+		});
+	}
+
+	uint32_t backBufferIndex;
+	{
+		PROFILE_SCOPE("Present");
+		backBufferIndex = m_swapChain->present();
+	}
+
+	m_frameNumber++;
+	m_inFrame = false;
+
+	return backBufferIndex;
+}
+
+uint64_t FrameScheduler::getCompletedFrameNumber()
+{
+	// The frames complete in order, so the first frame which has not completed ends the search
+	while (m_numCompletedFrames < m_frameNumber &&
+		m_commandQueue->isFenceComplete(m_frames[m_numCompletedFrames % m_frames.size()].fenceValue))
+	{
+		m_numCompletedFrames++;
+	}
+
+	return m_numCompletedFrames > 0 ? m_numCompletedFrames - 1 : InvalidFrameNumber;
+}
+
+FrameScheduler::FrameTimes FrameScheduler::getLastFrameTimes() const
+{
+	std::lock_guard<std::mutex> lock(m_statistics->mutex);
+	return m_statistics->lastFrameTimes;
+}
+
+FrameScheduler::FrameTimes FrameScheduler::collectAverageFrameTimes()
+{
+	std::lock_guard<std::mutex> lock(m_statistics->mutex);
+
+	FrameTimes averageFrameTimes = m_statistics->totalFrameTimes;
+	if (m_statistics->numFrames > 0)
+	{
+		averageFrameTimes.cpuWaitTime /= m_statistics->numFrames;
+		averageFrameTimes.gpuIdleTime /= m_statistics->numFrames;
+	}
+
+	m_statistics->totalFrameTimes = FrameTimes();
+	m_statistics->numFrames = 0;
+
+	return averageFrameTimes;
+}
+
+void FrameScheduler::waitForIdle()
+{
+	if (m_frameNumber > 0)
+	{
+		m_commandQueue->waitForFenceValue(m_frames[(m_frameNumber - 1) % m_frames.size()].fenceValue);
+	}
+}
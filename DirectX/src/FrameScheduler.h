@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class CommandQueue;
+class SwapChain;
+
+/*
+*	Paces the frames of a swap chain with multiple frames in flight. beginFrame blocks until the swap chain
+*	can take another frame and the GPU has finished the frame that many frames (the maximum latency) before,
+*	so the CPU never runs further ahead of the GPU. A low latency reduces the input latency, a high latency
+*	keeps the GPU busy when the CPU time of the frames varies.
+*
+*	Every frame in flight has a slot (getFrameIndex) for the resources which are used by one frame at a time,
+*	e.g. constant buffers that are written every frame. A slot is reused once the GPU has finished the frame
+*	which used it before.
+*
+*	The scheduler measures the time the CPU waited before each frame and the time the GPU was idle before each
+*	frame. The GPU idle time is measured on the CPU: from the time the retire thread of the command queue saw
+*	the previous frame complete, to the time the frame was submitted.
+*/
+class FrameScheduler
+{
+public:
+	static const uint64_t InvalidFrameNumber = UINT64_MAX;
+
+	struct FrameTimes
+	{
+		uint64_t frameNumber = 0;
+		// In milliseconds
+		double cpuWaitTime = 0.0;
+		double gpuIdleTime = 0.0;
+	};
+
+	/*
+	* @param commandQueue The queue which executes the last command list of every frame.
+	* @param numFrameSlots The maximum number of frames in flight, the maximum latency is set to this as well.
+	*/
+	FrameScheduler(std::shared_ptr<CommandQueue> commandQueue, std::shared_ptr<SwapChain> swapChain, uint32_t numFrameSlots);
+	virtual ~FrameScheduler() = default;
+
+	// Set the number of frames the CPU may run ahead of the GPU, between 1 and the number of frame slots
+	void setMaxLatency(uint32_t maxLatency);
+	uint32_t getMaxLatency() const { return m_maxLatency; }
+	uint32_t getNumFrameSlots() const { return static_cast<uint32_t>(m_frames.size()); }
+
+	// Wait until the next frame can be started, returns the slot of the frame
+	uint32_t beginFrame();
+	/*
+	* Present the frame, returns the index of the new current back buffer.
+	*
+	* @param fenceValue The fence value of the last command list of the frame.
+	*/
+	uint32_t endFrame(uint64_t fenceValue);
+
+	uint32_t getFrameIndex() const { return static_cast<uint32_t>(m_frameNumber % m_frames.size()); }
+	uint64_t getFrameNumber() const { return m_frameNumber; }
+	/*
+	* The number of the last frame the GPU has finished, InvalidFrameNumber before the first one.
+	* What a frame freed may be released once the frame has completed.
+	*/
+	uint64_t getCompletedFrameNumber();
+
+	// The times of the last frame the GPU has finished
+	FrameTimes getLastFrameTimes() const;
+	// The average times of the frames the GPU has finished since the previous call
+	FrameTimes collectAverageFrameTimes();
+
+	// Wait until the GPU has finished all frames, e.g. before the swap chain is resized
+	void waitForIdle();
+
+private:
+	using Clock = std::chrono::high_resolution_clock;
+
+	struct Frame
+	{
+		uint64_t frameNumber = 0;
+		uint64_t fenceValue = 0;
+	};
+
+	// Written by the retire thread of the command queue, shared with the completion callbacks
+	// so they do not depend on the lifetime of the scheduler
+	struct Statistics
+	{
+		std::mutex mutex;
+
+		bool hasCompletedFrame = false;
+		Clock::time_point lastCompletionTime;
+
+		FrameTimes lastFrameTimes;
+		FrameTimes totalFrameTimes;
+		uint32_t numFrames = 0;
+	};
+
+	std::shared_ptr<CommandQueue> m_commandQueue;
+	std::shared_ptr<SwapChain> m_swapChain;
+
+	std::vector<Frame> m_frames;
+	uint32_t m_maxLatency;
+
+	uint64_t m_frameNumber;
+	// The frames before this number have been finished by the GPU
+	uint64_t m_numCompletedFrames;
+	bool m_inFrame;
+	// The time the CPU waited in beginFrame for the current frame, in milliseconds
+	double m_cpuWaitTime;
+
+	std::shared_ptr<Statistics> m_statistics;
+};
@@ -3,6 +3,8 @@
 #include "Window.h"
 #include "Event.h"
 
+#include <string>
+
 class Game
 {
 public:
@@ -17,4 +19,9 @@ public:
 
 	virtual void onKeyPressed(KeyEvent& event) = 0;
 	virtual void onResize(ResizeEvent& event) = 0;
+
+	// Statistics of the game (e.g. of its allocators), printed after the profiler report
+	virtual std::string getReport() const { return std::string(); }
+	// A short summary of the last frames, appended to the FPS line and to the headless summary
+	virtual std::string getFrameSummary() const { return std::string(); }
 };
\ No newline at end of file
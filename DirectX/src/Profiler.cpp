@@ -0,0 +1,429 @@
+#include "dxpch.h"
+#include "Profiler.h"
+
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <mutex>
+
+thread_local uint32_t ProfileScope::s_depth = 0;
+
+namespace
+{
+	struct Zone
+	{
+		const char* name;
+		uint64_t beginTime;
+		uint64_t endTime;
+		uint32_t depth;
+		// The GPU queue of the zone, nullptr for the zones of the thread itself
+		const char* gpuTimeline;
+	};
+
+	// Single producer (the thread) single consumer (EndFrame) ring of zones
+	struct ThreadBuffer
+	{
+		uint32_t threadIndex = 0;
+		std::unique_ptr<Zone[]> zones;
+		std::atomic<uint64_t> writeIndex{ 0 };
+		std::atomic<uint64_t> readIndex{ 0 };
+		std::atomic<uint64_t> numDroppedZones{ 0 };
+	};
+
+	// The zones with the same path (the same names from the outermost zone)
+	struct Path
+	{
+		std::string path;
+		uint32_t depth;
+
+		// The time and calls in the current frame
+		double frameTime = 0.0;
+		uint32_t frameCalls = 0;
+
+		// The frames which had the zone, a ring of HistorySize
+		double times[Profiler::HistorySize];
+		uint32_t calls[Profiler::HistorySize];
+		uint32_t numFrames = 0;
+		uint32_t nextFrame = 0;
+	};
+
+	struct CapturedZone
+	{
+		Zone zone;
+		uint32_t threadIndex;
+	};
+
+	struct ProfilerState
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> threadBuffers;
+
+		std::vector<Path> paths;
+		// The path of a zone from its parent path (+1, 0 is no parent) and its name, and from the path itself
+		// for names which are the same string at different addresses
+		std::map<std::pair<uint32_t, const char*>, uint32_t> pathIds;
+		std::map<std::string, uint32_t> pathIdsByPath;
+		// The paths which have zones in the current frame
+		std::vector<uint32_t> framePaths;
+
+		bool capturing = false;
+		uint64_t captureBeginTime = 0;
+		std::vector<CapturedZone> capturedZones;
+
+		// Scratch memory of EndFrame
+		std::vector<Zone> zones;
+		std::vector<std::pair<uint32_t, uint64_t>> openZones;
+	};
+
+	// The captured zones are limited to keep a forgotten capture from using all memory
+	const size_t MaxCapturedZones = 1 << 22;
+
+	ProfilerState& GetState()
+	{
+		static ProfilerState state;
+		return state;
+	}
+
+	ThreadBuffer* RegisterThread()
+	{
+		ProfilerState& state = GetState();
+		std::lock_guard<std::mutex> lock(state.mutex);
+
+		std::unique_ptr<ThreadBuffer> threadBuffer = std::make_unique<ThreadBuffer>();
+		threadBuffer->threadIndex = static_cast<uint32_t>(state.threadBuffers.size());
+		threadBuffer->zones = std::make_unique<Zone[]>(Profiler::ThreadBufferSize);
+
+		state.threadBuffers.push_back(std::move(threadBuffer));
+		return state.threadBuffers.back().get();
+	}
+
+	ThreadBuffer* GetThreadBuffer()
+	{
+		static thread_local ThreadBuffer* threadBuffer = nullptr;
+		if (threadBuffer == nullptr)
+		{
+			threadBuffer = RegisterThread();
+		}
+
+		return threadBuffer;
+	}
+
+	uint32_t GetPathId(ProfilerState& state, uint32_t parentPathId, const char* name, uint32_t depth)
+	{
+		auto key = std::make_pair(parentPathId, name);
+		auto it = state.pathIds.find(key);
+		if (it != state.pathIds.end())
+		{
+			return it->second;
+		}
+
+		std::string pathName = parentPathId > 0 ? state.paths[parentPathId - 1].path + "/" + name : name;
+
+		auto pathIt = state.pathIdsByPath.find(pathName);
+		if (pathIt != state.pathIdsByPath.end())
+		{
+			state.pathIds.emplace(key, pathIt->second);
+			return pathIt->second;
+		}
+
+		Path path;
+		path.path = pathName;
+		path.depth = depth;
+
+		uint32_t pathId = static_cast<uint32_t>(state.paths.size()) + 1;
+		state.paths.push_back(std::move(path));
+		state.pathIds.emplace(key, pathId);
+		state.pathIdsByPath.emplace(pathName, pathId);
+
+		return pathId;
+	}
+
+	// The value below which the given fraction of the sorted values is
+	double GetPercentile(const std::vector<double>& sortedValues, double fraction)
+	{
+		size_t rank = static_cast<size_t>(std::ceil(fraction * sortedValues.size()));
+		return sortedValues[std::min(std::max<size_t>(rank, 1), sortedValues.size()) - 1];
+	}
+
+	void PushZone(const Zone& zone)
+	{
+		ThreadBuffer* threadBuffer = GetThreadBuffer();
+
+		uint64_t writeIndex = threadBuffer->writeIndex.load(std::memory_order_relaxed);
+		if (writeIndex - threadBuffer->readIndex.load(std::memory_order_acquire) >= Profiler::ThreadBufferSize)
+		{
+			threadBuffer->numDroppedZones.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		threadBuffer->zones[writeIndex % Profiler::ThreadBufferSize] = zone;
+		threadBuffer->writeIndex.store(writeIndex + 1, std::memory_order_release);
+	}
+
+	void WriteEscaped(std::ofstream& file, const char* text)
+	{
+		for (const char* c = text; *c != '\0'; ++c)
+		{
+			if (*c == '"' || *c == '\\')
+			{
+				file << '\\';
+			}
+			file << *c;
+		}
+	}
+}
+
+void Profiler::RecordZone(const char* name, uint64_t beginTime, uint64_t endTime, uint32_t depth)
+{
+	PushZone({ name, beginTime, endTime, depth, nullptr });
+}
+
+void Profiler::RecordGpuZone(const char* queueName, const char* name, uint64_t beginTime, uint64_t endTime, uint32_t depth)
+{
+	PushZone({ name, beginTime, endTime, depth, queueName });
+}
+
+void Profiler::EndFrame()
+{
+	ProfilerState& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	for (std::unique_ptr<ThreadBuffer>& threadBuffer : state.threadBuffers)
+	{
+		uint64_t readIndex = threadBuffer->readIndex.load(std::memory_order_relaxed);
+		uint64_t writeIndex = threadBuffer->writeIndex.load(std::memory_order_acquire);
+		if (readIndex == writeIndex)
+		{
+			continue;
+		}
+
+		state.zones.clear();
+		for (uint64_t i = readIndex; i < writeIndex; ++i)
+		{
+			state.zones.push_back(threadBuffer->zones[i % ThreadBufferSize]);
+		}
+		threadBuffer->readIndex.store(writeIndex, std::memory_order_release);
+
+		// The zones are recorded when they end, so the zones they are nested in come after them.
+		// In the order they began, a zone is nested in the last zone before it which contains it.
+		// The zones of a GPU queue are only nested in each other, so they are kept apart.
+		std::sort(state.zones.begin(), state.zones.end(), [](const Zone& a, const Zone& b)
+		{
+			if (a.gpuTimeline != b.gpuTimeline)
+			{
+				return std::less<const char*>()(a.gpuTimeline, b.gpuTimeline);
+			}
+			return a.beginTime != b.beginTime ? a.beginTime < b.beginTime : a.depth < b.depth;
+		});
+
+		// The path ids and end times of the zones the current zone may be nested in
+		state.openZones.clear();
+		const char* gpuTimeline = nullptr;
+		for (const Zone& zone : state.zones)
+		{
+			if (zone.gpuTimeline != gpuTimeline)
+			{
+				state.openZones.clear();
+				gpuTimeline = zone.gpuTimeline;
+			}
+
+			// The zones a zone is nested in which have not ended yet are not part of its path
+			while (!state.openZones.empty() && (state.openZones.size() > zone.depth || state.openZones.back().second < zone.endTime))
+			{
+				state.openZones.pop_back();
+			}
+
+			uint32_t parentPathId = state.openZones.empty() ? 0 : state.openZones.back().first;
+			uint32_t pathId = GetPathId(state, parentPathId, zone.name, static_cast<uint32_t>(state.openZones.size()));
+			state.openZones.push_back({ pathId, zone.endTime });
+
+			Path& path = state.paths[pathId - 1];
+			if (path.frameCalls == 0)
+			{
+				state.framePaths.push_back(pathId);
+			}
+			path.frameTime += (zone.endTime - zone.beginTime) * 1e-6;
+			path.frameCalls++;
+
+			if (state.capturing && state.capturedZones.size() < MaxCapturedZones)
+			{
+				state.capturedZones.push_back({ zone, threadBuffer->threadIndex });
+			}
+		}
+	}
+
+	// Add the frame to the history of the zones it has
+	for (uint32_t pathId : state.framePaths)
+	{
+		Path& path = state.paths[pathId - 1];
+		path.times[path.nextFrame] = path.frameTime;
+		path.calls[path.nextFrame] = path.frameCalls;
+		path.nextFrame = (path.nextFrame + 1) % HistorySize;
+		path.numFrames = std::min(path.numFrames + 1, HistorySize);
+
+		path.frameTime = 0.0;
+		path.frameCalls = 0;
+	}
+	state.framePaths.clear();
+}
+
+std::vector<Profiler::ZoneStatistics> Profiler::GetZoneStatistics()
+{
+	ProfilerState& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	std::vector<ZoneStatistics> zoneStatistics;
+	std::vector<double> times;
+	for (const Path& path : state.paths)
+	{
+		if (path.numFrames == 0)
+		{
+			continue;
+		}
+
+		ZoneStatistics statistics{};
+		statistics.path = path.path;
+		statistics.depth = path.depth;
+		statistics.numFrames = path.numFrames;
+
+		times.assign(path.times, path.times + path.numFrames);
+		for (uint32_t i = 0; i < path.numFrames; ++i)
+		{
+			statistics.average += times[i];
+			statistics.numCalls += path.calls[i];
+		}
+		statistics.average /= path.numFrames;
+
+		std::sort(times.begin(), times.end());
+		statistics.p50 = GetPercentile(times, 0.50);
+		statistics.p95 = GetPercentile(times, 0.95);
+		statistics.p99 = GetPercentile(times, 0.99);
+
+		zoneStatistics.push_back(statistics);
+	}
+
+	std::sort(zoneStatistics.begin(), zoneStatistics.end(), [](const ZoneStatistics& a, const ZoneStatistics& b)
+	{
+		return a.path < b.path;
+	});
+
+	return zoneStatistics;
+}
+
+std::string Profiler::GetReport()
+{
+	std::string report;
+	char buffer[500];
+
+	snprintf(buffer, 500, "%-40s %10s %10s %10s %10s %10s\n", "Zone (ms per frame)", "avg", "p50", "p95", "p99", "calls");
+	report += buffer;
+
+	for (const ZoneStatistics& statistics : GetZoneStatistics())
+	{
+		// Only the last name of the path, indented by the depth
+		size_t nameBegin = statistics.path.find_last_of('/');
+		std::string name = std::string(statistics.depth * 2, ' ') +
+			(nameBegin == std::string::npos ? statistics.path : statistics.path.substr(nameBegin + 1));
+
+		snprintf(buffer, 500, "%-40s %10.4f %10.4f %10.4f %10.4f %10.1f\n", name.c_str(),
+			statistics.average, statistics.p50, statistics.p95, statistics.p99, static_cast<double>(statistics.numCalls) / statistics.numFrames);
+		report += buffer;
+	}
+
+	return report;
+}
+
+uint64_t Profiler::GetNumDroppedZones()
+{
+	ProfilerState& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	uint64_t numDroppedZones = 0;
+	for (std::unique_ptr<ThreadBuffer>& threadBuffer : state.threadBuffers)
+	{
+		numDroppedZones += threadBuffer->numDroppedZones.load(std::memory_order_relaxed);
+	}
+
+	return numDroppedZones;
+}
+
+void Profiler::ClearHistory()
+{
+	ProfilerState& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	for (Path& path : state.paths)
+	{
+		path.numFrames = 0;
+		path.nextFrame = 0;
+	}
+}
+
+void Profiler::BeginTraceCapture()
+{
+	ProfilerState& state = GetState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+
+	state.capturing = true;
+	state.captureBeginTime = GetTime();
+	state.capturedZones.clear();
+}
+
+bool Profiler::EndTraceCapture(const std::string& fileName)
+{
+	ProfilerState& state = GetState();
+	std::vector<CapturedZone> capturedZones;
+	uint64_t captureBeginTime;
+	uint32_t numThreads;
+	{
+		std::lock_guard<std::mutex> lock(state.mutex);
+
+		state.capturing = false;
+		capturedZones.swap(state.capturedZones);
+		captureBeginTime = state.captureBeginTime;
+		numThreads = static_cast<uint32_t>(state.threadBuffers.size());
+	}
+
+	std::ofstream file(fileName);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	// The threads are the timelines 0 to numThreads - 1, every GPU queue gets a timeline after them
+	std::map<std::string, uint32_t> gpuTimelines;
+
+	// Complete events ("X") with the times in microseconds, the viewer nests them by their times
+	char buffer[200];
+	file << "{\"traceEvents\":[";
+	for (size_t i = 0; i < capturedZones.size(); ++i)
+	{
+		const CapturedZone& capturedZone = capturedZones[i];
+		int64_t beginTime = static_cast<int64_t>(capturedZone.zone.beginTime - captureBeginTime);
+
+		uint32_t timeline = capturedZone.threadIndex;
+		if (capturedZone.zone.gpuTimeline != nullptr)
+		{
+			timeline = gpuTimelines.emplace(capturedZone.zone.gpuTimeline, numThreads + static_cast<uint32_t>(gpuTimelines.size())).first->second;
+		}
+
+		file << (i > 0 ? ",\n" : "\n") << "{\"name\":\"";
+		WriteEscaped(file, capturedZone.zone.name);
+		snprintf(buffer, 200, "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":0,\"tid\":%u}",
+			capturedZone.zone.gpuTimeline != nullptr ? "gpu" : "cpu", beginTime * 1e-3,
+			(capturedZone.zone.endTime - capturedZone.zone.beginTime) * 1e-3, timeline);
+		file << buffer;
+	}
+
+	// Name the timelines of the GPU queues after the queues
+	for (const auto& gpuTimeline : gpuTimelines)
+	{
+		file << (capturedZones.empty() ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << gpuTimeline.second << ",\"args\":{\"name\":\"";
+		WriteEscaped(file, gpuTimeline.first.c_str());
+		file << "\"}}";
+	}
+	file << "\n]}\n";
+
+	return file.good();
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Set to 0 to compile the profile scopes out
+#ifndef ENABLE_PROFILER
+#define ENABLE_PROFILER 1
+#endif
+
+/*
+*	Hierarchical CPU profiler. A PROFILE_SCOPE measures the time until the end of its scope (a zone),
+*	zones in zones are nested. Every thread writes its zones to its own ring buffer without locks, so
+*	the scopes are cheap enough for release builds. EndFrame collects the zones of all threads and adds
+*	the time spent in every zone (per nesting path) in the frame to the history of the zone, which the
+*	percentiles are taken from.
+*
+*	The zones of a number of frames can be captured and written as a Chrome trace (chrome://tracing).
+*	GPU zones (see TimestampQueryPool) are recorded by the retire threads of the command queues, and are
+*	written to the trace in the "gpu" category with a timeline per queue.
+*
+*	Zone names must be string literals (or outlive the profiler).
+*/
+class Profiler
+{
+public:
+	struct ZoneStatistics
+	{
+		// The names of the zones from the outermost zone, separated by '/'
+		std::string path;
+		uint32_t depth;
+		// The number of frames in the history which have the zone, and the calls in these frames
+		uint32_t numFrames;
+		uint64_t numCalls;
+		// The time spent in the zone per frame, in milliseconds
+		double average;
+		double p50;
+		double p95;
+		double p99;
+	};
+
+	// The number of frames the percentiles are taken from
+	static const uint32_t HistorySize = 256;
+	// The number of zones a thread can have that are not collected yet, more are dropped
+	static const uint32_t ThreadBufferSize = 1 << 16;
+
+	static uint64_t GetTime()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// Record a zone of the calling thread (called by ProfileScope)
+	static void RecordZone(const char* name, uint64_t beginTime, uint64_t endTime, uint32_t depth);
+	// Record a zone of the work of a GPU queue, which has its own timeline in the trace (called by TimestampQueryPool)
+	static void RecordGpuZone(const char* queueName, const char* name, uint64_t beginTime, uint64_t endTime, uint32_t depth);
+
+	// Collect the zones of all threads, should be called once per frame by the thread which renders
+	static void EndFrame();
+
+	// Statistics of all zones in the history, sorted by path so zones follow the zone they are nested in
+	static std::vector<ZoneStatistics> GetZoneStatistics();
+	// A line with the percentiles per zone, indented by depth
+	static std::string GetReport();
+	// The number of zones that were dropped because a thread buffer was full
+	static uint64_t GetNumDroppedZones();
+	static void ClearHistory();
+
+	// Keep the zones of the frames from now on, until EndTraceCapture
+	static void BeginTraceCapture();
+	// Write the captured zones as Chrome trace events (JSON), returns false when the file could not be written
+	static bool EndTraceCapture(const std::string& fileName);
+};
+
+/*
+*	Measures a zone from its construction to its destruction.
+*/
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		:	m_name(name),
+			m_depth(s_depth++),
+			m_beginTime(Profiler::GetTime())
+	{}
+
+	~ProfileScope()
+	{
+		Profiler::RecordZone(m_name, m_beginTime, Profiler::GetTime(), m_depth);
+		s_depth--;
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_name;
+	uint32_t m_depth;
+	uint64_t m_beginTime;
+
+	// The number of zones the thread is in
+	static thread_local uint32_t s_depth;
+};
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+#if ENABLE_PROFILER
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name)
+#endif
@@ -0,0 +1,952 @@
+#include "dxpch.h"
+#include "RenderGraph.h"
+#include "CommandList.h"
+#include "CommandQueue.h"
+#include "Application.h"
+#include "WorkerPool.h"
+#include "Profiler.h"
+
+struct RenderGraph::Submission
+{
+	QueueIndex queue;
+	// The command lists in the order they are executed in, and the one which is recorded on
+	// (none after a parallel pass, until the next command is recorded)
+	std::vector<std::shared_ptr<CommandList>> commandLists;
+	std::shared_ptr<CommandList> commandList;
+	ResourceStateTracker resourceStateTracker;
+
+	// The fence values of the other queues the queue waits for (on the GPU) before the command lists are executed
+	uint64_t waitFenceValues[NumQueues];
+	uint64_t fenceValue;
+	bool submitted;
+};
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& renderGraph, uint32_t pass)
+	:	m_renderGraph(renderGraph),
+		m_pass(pass)
+{
+}
+
+void RenderGraph::PassBuilder::read(ResourceHandle resource, D3D12_RESOURCE_STATES state, UINT subresource)
+{
+	m_renderGraph.addAccess(m_pass, resource, subresource, state, false);
+}
+
+void RenderGraph::PassBuilder::write(ResourceHandle resource, D3D12_RESOURCE_STATES state, UINT subresource)
+{
+	m_renderGraph.addAccess(m_pass, resource, subresource, state, true);
+}
+
+void RenderGraph::PassBuilder::setSideEffect()
+{
+	m_renderGraph.m_passes[m_pass].sideEffect = true;
+}
+
+RenderGraph::RenderGraph(std::shared_ptr<CommandQueue> directQueue, std::shared_ptr<CommandQueue> computeQueue, std::shared_ptr<CommandQueue> copyQueue)
+	:	m_compiled(false),
+		m_fenceValues{},
+		m_previousFenceValues{},
+		m_numCulledPasses(0),
+		m_numLevels(0),
+		m_numSubmissions(0),
+		m_numCommandLists(0),
+		m_numQueueWaits(0)
+{
+	assert(directQueue != nullptr && directQueue->getType() == D3D12_COMMAND_LIST_TYPE_DIRECT);
+	assert(computeQueue == nullptr || computeQueue->getType() == D3D12_COMMAND_LIST_TYPE_COMPUTE);
+	assert(copyQueue == nullptr || copyQueue->getType() == D3D12_COMMAND_LIST_TYPE_COPY);
+
+	m_queues[DirectQueueIndex] = directQueue;
+	m_queues[ComputeQueueIndex] = computeQueue;
+	m_queues[CopyQueueIndex] = copyQueue;
+
+	m_waitForPreviousFrame = false;
+	m_gpuTimings = false;
+
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		m_openSubmissions[i] = -1;
+		m_frameContexts[i] = nullptr;
+		m_nextFrameContext[i] = 0;
+		m_activeTimestampQueryPools[i] = nullptr;
+	}
+}
+
+RenderGraph::~RenderGraph()
+{
+}
+
+RenderGraph::ResourceHandle RenderGraph::importResource(const std::string& name, ID3D12Resource* resource, ResourceStateTracker::ResourceId resourceId,
+	D3D12_RESOURCE_STATES finalState)
+{
+	Resource importedResource;
+	importedResource.name = name;
+	importedResource.resource = resource;
+	importedResource.resourceId = resourceId;
+	importedResource.finalState = finalState;
+	importedResource.imported = true;
+	importedResource.desc = resource->GetDesc();
+	importedResource.hasClearValue = false;
+	importedResource.aliased = false;
+	importedResource.firstPass = UINT32_MAX;
+	importedResource.lastPass = UINT32_MAX;
+
+	m_resources.push_back(importedResource);
+	m_compiled = false;
+
+	return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::createResource(const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue)
+{
+	Resource transientResource;
+	transientResource.name = name;
+	transientResource.resource = nullptr;
+	transientResource.resourceId = ResourceStateTracker::InvalidResourceId;
+	transientResource.finalState = D3D12_RESOURCE_STATE_COMMON;
+	transientResource.imported = false;
+	transientResource.desc = desc;
+	transientResource.clearValue = clearValue != nullptr ? *clearValue : D3D12_CLEAR_VALUE{};
+	transientResource.hasClearValue = clearValue != nullptr;
+	transientResource.aliased = false;
+	transientResource.firstPass = UINT32_MAX;
+	transientResource.lastPass = UINT32_MAX;
+
+	m_resources.push_back(transientResource);
+	m_compiled = false;
+
+	return static_cast<ResourceHandle>(m_resources.size() - 1);
+}
+
+void RenderGraph::addPass(const std::string& name, D3D12_COMMAND_LIST_TYPE queueType, const SetupFunction& setup, ExecuteFunction execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.queue = getQueueIndex(queueType);
+	pass.execute = std::move(execute);
+	pass.numItems = 0;
+	pass.minItemsPerCommandList = 1;
+	pass.sideEffect = false;
+	pass.culled = false;
+	pass.level = 0;
+	pass.submission = UINT32_MAX;
+
+	m_passes.push_back(std::move(pass));
+	m_compiled = false;
+
+	PassBuilder builder(*this, static_cast<uint32_t>(m_passes.size() - 1));
+	setup(builder);
+}
+
+void RenderGraph::addParallelPass(const std::string& name, D3D12_COMMAND_LIST_TYPE queueType, const SetupFunction& setup,
+	uint32_t numItems, ParallelExecuteFunction execute, uint32_t minItemsPerCommandList)
+{
+	addPass(name, queueType, setup, nullptr);
+
+	Pass& pass = m_passes.back();
+	pass.parallelExecute = std::move(execute);
+	pass.numItems = numItems;
+	pass.minItemsPerCommandList = std::max(1u, minItemsPerCommandList);
+}
+
+void RenderGraph::addAccess(uint32_t pass, ResourceHandle resource, UINT subresource, D3D12_RESOURCE_STATES state, bool write)
+{
+	assert(resource < m_resources.size() && "Invalid resource handle.");
+
+	std::vector<ResourceAccess>& accesses = m_passes[pass].accesses;
+	for (ResourceAccess& access : accesses)
+	{
+		if (access.resource == resource && access.subresource == subresource)
+		{
+			// Reading and writing a subresource in a pass is only possible in a single state (e.g. UNORDERED_ACCESS)
+			assert((!access.write && !write) || access.state == state);
+
+			access.state = access.state | state;
+			access.read = access.read || !write;
+			access.write = access.write || write;
+			return;
+		}
+	}
+
+	accesses.push_back({ resource, subresource, state, !write, write });
+}
+
+void RenderGraph::compile()
+{
+	PROFILE_SCOPE("CompileRenderGraph");
+
+	cullPasses();
+	buildDependencies();
+	schedulePasses();
+	allocateTransientResources();
+
+	m_compiled = true;
+}
+
+void RenderGraph::cullPasses()
+{
+	// Walk back from the outputs of the graph (the imported resources). A pass is needed when it has a side effect or
+	// writes a resource which is read by a later pass that is needed, before the resource is overwritten completely.
+	std::vector<bool> readLater(m_resources.size());
+	for (size_t i = 0; i < m_resources.size(); ++i)
+	{
+		readLater[i] = m_resources[i].imported;
+	}
+
+	m_numCulledPasses = 0;
+
+	for (size_t i = m_passes.size(); i > 0; --i)
+	{
+		Pass& pass = m_passes[i - 1];
+
+		bool needed = pass.sideEffect;
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			needed = needed || (access.write && readLater[access.resource]);
+		}
+
+		pass.culled = !needed;
+		if (pass.culled)
+		{
+			m_numCulledPasses++;
+			continue;
+		}
+
+		// The contents before a complete write are not needed, unless the pass reads them as well
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (access.write && access.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+			{
+				readLater[access.resource] = false;
+			}
+		}
+
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (access.read)
+			{
+				readLater[access.resource] = true;
+			}
+		}
+	}
+}
+
+void RenderGraph::buildDependencies()
+{
+	// The last pass which wrote a resource, and the passes which read it since
+	struct ResourceUsage
+	{
+		uint32_t lastWriter = UINT32_MAX;
+		std::vector<uint32_t> readers;
+	};
+
+	std::vector<ResourceUsage> usages(m_resources.size());
+
+	for (Resource& resource : m_resources)
+	{
+		resource.firstPass = UINT32_MAX;
+		resource.lastPass = UINT32_MAX;
+	}
+
+	for (uint32_t i = 0; i < m_passes.size(); ++i)
+	{
+		Pass& pass = m_passes[i];
+		pass.dependencies.clear();
+
+		if (pass.culled)
+		{
+			continue;
+		}
+
+		auto addDependency = [&pass, i](uint32_t dependency)
+		{
+			if (dependency != i && std::find(pass.dependencies.begin(), pass.dependencies.end(), dependency) == pass.dependencies.end())
+			{
+				pass.dependencies.push_back(dependency);
+			}
+		};
+
+		// Dependencies are tracked per resource (not per subresource), which is conservative
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			const ResourceUsage& usage = usages[access.resource];
+
+			// Read after write and write after write
+			if (usage.lastWriter != UINT32_MAX)
+			{
+				addDependency(usage.lastWriter);
+			}
+
+			// Write after read
+			if (access.write)
+			{
+				for (uint32_t reader : usage.readers)
+				{
+					addDependency(reader);
+				}
+			}
+
+			Resource& resource = m_resources[access.resource];
+			resource.firstPass = std::min(resource.firstPass, i);
+			resource.lastPass = i;
+		}
+
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			if (access.write)
+			{
+				usages[access.resource].lastWriter = i;
+				usages[access.resource].readers.clear();
+			}
+		}
+
+		for (const ResourceAccess& access : pass.accesses)
+		{
+			ResourceUsage& usage = usages[access.resource];
+			if (access.read && usage.lastWriter != i && std::find(usage.readers.begin(), usage.readers.end(), i) == usage.readers.end())
+			{
+				usage.readers.push_back(i);
+			}
+		}
+	}
+}
+
+void RenderGraph::schedulePasses()
+{
+	// The dependencies of a pass are always added before the pass, so the levels can be assigned in order
+	m_numLevels = 0;
+	m_schedule.clear();
+
+	for (uint32_t i = 0; i < m_passes.size(); ++i)
+	{
+		Pass& pass = m_passes[i];
+		if (pass.culled)
+		{
+			continue;
+		}
+
+		pass.level = 0;
+		for (uint32_t dependency : pass.dependencies)
+		{
+			pass.level = std::max(pass.level, m_passes[dependency].level + 1);
+		}
+
+		m_numLevels = std::max(m_numLevels, pass.level + 1);
+		m_schedule.push_back(i);
+	}
+
+	// The passes of a level do not depend on each other, so the passes of a level on the same queue
+	// are recorded after each other and share a single batch of barriers
+	std::stable_sort(m_schedule.begin(), m_schedule.end(), [this](uint32_t a, uint32_t b)
+	{
+		const Pass& passA = m_passes[a];
+		const Pass& passB = m_passes[b];
+		return passA.level != passB.level ? passA.level < passB.level : passA.queue < passB.queue;
+	});
+}
+
+void RenderGraph::allocateTransientResources()
+{
+	// The lifetimes are measured in barrier batches (a level on a queue), as all transitions of a batch
+	// are recorded before its first pass
+	std::vector<uint32_t> batches(m_passes.size(), UINT32_MAX);
+	uint32_t batch = 0;
+	for (size_t i = 0; i < m_schedule.size(); ++i)
+	{
+		const Pass& pass = m_passes[m_schedule[i]];
+		if (i > 0 && (pass.level != m_passes[m_schedule[i - 1]].level || pass.queue != m_passes[m_schedule[i - 1]].queue))
+		{
+			++batch;
+		}
+		batches[m_schedule[i]] = batch;
+	}
+
+	std::vector<TransientResourceAllocator::ResourceRequest> requests;
+	std::vector<ResourceHandle> requestResources;
+	for (ResourceHandle i = 0; i < m_resources.size(); ++i)
+	{
+		Resource& resource = m_resources[i];
+		if (resource.imported)
+		{
+			continue;
+		}
+
+		resource.resource = nullptr;
+		resource.resourceId = ResourceStateTracker::InvalidResourceId;
+		resource.aliased = false;
+
+		// Only used by culled passes
+		if (resource.lastPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		TransientResourceAllocator::ResourceRequest request;
+		request.desc = resource.desc;
+		request.clearValue = resource.clearValue;
+		request.hasClearValue = resource.hasClearValue;
+		request.queue = m_passes[resource.firstPass].queue;
+		request.firstUse = UINT32_MAX;
+		request.lastUse = 0;
+
+		for (uint32_t pass : m_schedule)
+		{
+			for (const ResourceAccess& access : m_passes[pass].accesses)
+			{
+				if (access.resource != i)
+				{
+					continue;
+				}
+
+				if (m_passes[pass].queue != request.queue)
+				{
+					request.queue = TransientResourceAllocator::MultipleQueues;
+				}
+
+				// The first pass in the schedule, which activates the resource
+				if (batches[pass] < request.firstUse)
+				{
+					request.firstUse = batches[pass];
+					resource.firstPass = pass;
+				}
+				request.lastUse = std::max(request.lastUse, batches[pass]);
+			}
+		}
+
+		requests.push_back(request);
+		requestResources.push_back(i);
+	}
+
+	std::vector<TransientResourceAllocator::PlacedResource> placedResources(requests.size());
+	m_waitForPreviousFrame = m_transientResourceAllocator.allocate(requests.data(), static_cast<uint32_t>(requests.size()), placedResources.data());
+
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		Resource& resource = m_resources[requestResources[i]];
+		resource.resource = placedResources[i].resource;
+		resource.resourceId = placedResources[i].resourceId;
+		resource.aliased = placedResources[i].aliased;
+	}
+}
+
+void RenderGraph::execute()
+{
+	assert(m_compiled && "Compile the render graph before it is executed.");
+
+	PROFILE_SCOPE("ExecuteRenderGraph");
+
+	m_submissions.clear();
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		if (m_fenceValues[i] > 0)
+		{
+			m_previousFenceValues[i] = m_fenceValues[i];
+		}
+
+		m_openSubmissions[i] = -1;
+		m_fenceValues[i] = 0;
+	}
+	m_numSubmissions = 0;
+	m_numCommandLists = 0;
+	m_numQueueWaits = 0;
+
+	// Get the contexts (and command lists) of all parallel passes of a queue at once, on this thread
+	uint32_t numParallelCommandLists[NumQueues] = {};
+	bool hasPasses[NumQueues] = {};
+	for (uint32_t pass : m_schedule)
+	{
+		numParallelCommandLists[m_passes[pass].queue] += getNumParallelCommandLists(m_passes[pass]);
+		hasPasses[m_passes[pass].queue] = true;
+	}
+
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		m_activeTimestampQueryPools[i] = nullptr;
+		if (!m_gpuTimings || !hasPasses[i] || m_queues[i]->getTimestampFrequency() == 0)
+		{
+			continue;
+		}
+
+		if (m_timestampQueryPools[i] == nullptr)
+		{
+			m_timestampQueryPools[i] = std::make_unique<TimestampQueryPool>(m_queues[i]);
+		}
+
+		m_activeTimestampQueryPools[i] = m_timestampQueryPools[i].get();
+		m_activeTimestampQueryPools[i]->beginFrame();
+	}
+
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		if (numParallelCommandLists[i] == 0)
+		{
+			continue;
+		}
+
+		if (m_frameContextPools[i] == nullptr)
+		{
+			m_frameContextPools[i] = std::make_unique<FrameContextPool>(m_queues[i]);
+		}
+
+		m_frameContexts[i] = m_frameContextPools[i]->beginFrame(numParallelCommandLists[i]);
+		m_nextFrameContext[i] = 0;
+	}
+
+	for (size_t first = 0; first < m_schedule.size();)
+	{
+		const Pass& firstPass = m_passes[m_schedule[first]];
+
+		size_t last = first + 1;
+		while (last < m_schedule.size() && m_passes[m_schedule[last]].level == firstPass.level && m_passes[m_schedule[last]].queue == firstPass.queue)
+		{
+			++last;
+		}
+
+		recordPasses(&m_schedule[first], static_cast<uint32_t>(last - first));
+		first = last;
+	}
+
+	// Transition the imported resources to their final state on the direct queue, which supports all states
+	for (const Resource& resource : m_resources)
+	{
+		if (!resource.imported || resource.lastPass == UINT32_MAX)
+		{
+			continue;
+		}
+
+		if (m_passes[resource.lastPass].queue != DirectQueueIndex)
+		{
+			waitForPass(DirectQueueIndex, resource.lastPass);
+		}
+
+		getOpenSubmission(DirectQueueIndex).resourceStateTracker.transitionResource(resource.resourceId, resource.finalState);
+	}
+
+	// The timestamps of a queue are resolved by its last submission
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		if (m_activeTimestampQueryPools[i] != nullptr && m_activeTimestampQueryPools[i]->hasZones())
+		{
+			m_activeTimestampQueryPools[i]->resolve(getCommandList(getOpenSubmission(static_cast<QueueIndex>(i))));
+		}
+	}
+
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		if (m_openSubmissions[i] >= 0)
+		{
+			submit(*m_submissions[m_openSubmissions[i]]);
+		}
+	}
+
+	// The timestamps are read back when the last submission of their queue has completed
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		if (m_activeTimestampQueryPools[i] != nullptr)
+		{
+			m_activeTimestampQueryPools[i]->endFrame(m_fenceValues[i]);
+			m_activeTimestampQueryPools[i] = nullptr;
+		}
+	}
+
+	// The contexts are recycled when the last submission of their queue has completed
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		if (m_frameContexts[i] != nullptr)
+		{
+			m_frameContextPools[i]->endFrame(m_fenceValues[i]);
+			m_frameContexts[i] = nullptr;
+		}
+	}
+}
+
+void RenderGraph::recordPasses(const uint32_t* passes, uint32_t numPasses)
+{
+	QueueIndex queue = m_passes[passes[0]].queue;
+
+	// The results of passes on other queues must be available before this level is executed
+	for (uint32_t i = 0; i < numPasses; ++i)
+	{
+		for (uint32_t dependency : m_passes[passes[i]].dependencies)
+		{
+			if (m_passes[dependency].queue != queue)
+			{
+				waitForPass(queue, dependency);
+			}
+		}
+	}
+
+	Submission& submission = getOpenSubmission(queue);
+	uint32_t submissionIndex = static_cast<uint32_t>(m_openSubmissions[queue]);
+
+	// Combine the accesses of the passes, the passes of a level only share resources they read
+	std::vector<ResourceAccess> transitions;
+	for (uint32_t i = 0; i < numPasses; ++i)
+	{
+		for (const ResourceAccess& access : m_passes[passes[i]].accesses)
+		{
+			auto overlaps = [&access](const ResourceAccess& transition)
+			{
+				return transition.resource == access.resource && (transition.subresource == access.subresource ||
+					transition.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || access.subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+			};
+
+			auto itr = std::find_if(transitions.begin(), transitions.end(), overlaps);
+			if (itr == transitions.end())
+			{
+				transitions.push_back(access);
+				continue;
+			}
+
+			assert((!itr->write && !access.write) || itr->state == access.state);
+			itr->state = itr->state | access.state;
+
+			// Reading the whole resource and a subresource, read the whole resource in all of the states
+			if (itr->subresource != access.subresource)
+			{
+				itr->subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+				for (auto other = itr + 1; other != transitions.end();)
+				{
+					if (other->resource == access.resource)
+					{
+						itr->state = itr->state | other->state;
+						other = transitions.erase(other);
+					}
+					else
+					{
+						++other;
+					}
+				}
+			}
+		}
+	}
+
+	// Activate the transient resources which share memory with others, their state is known from here on
+	for (const ResourceAccess& transition : transitions)
+	{
+		const Resource& resource = m_resources[transition.resource];
+		if (resource.aliased && std::find(passes, passes + numPasses, resource.firstPass) != passes + numPasses)
+		{
+			submission.resourceStateTracker.aliasBarrier(nullptr, resource.resource);
+			submission.resourceStateTracker.acquireResourceState(resource.resourceId);
+		}
+	}
+
+	for (const ResourceAccess& transition : transitions)
+	{
+		submission.resourceStateTracker.transitionResource(m_resources[transition.resource].resourceId, transition.state, transition.subresource);
+	}
+
+	// A split transition must end on the command list it began on, parallel passes are recorded on other command lists
+	for (uint32_t i = 0; i < numPasses; ++i)
+	{
+		if (m_passes[passes[i]].parallelExecute)
+		{
+			submission.resourceStateTracker.endSplitTransitions();
+			break;
+		}
+	}
+
+	if (submission.resourceStateTracker.hasResourceBarriers())
+	{
+		submission.resourceStateTracker.flushResourceBarriers(getCommandList(submission));
+	}
+
+	for (uint32_t i = 0; i < numPasses; ++i)
+	{
+		Pass& pass = m_passes[passes[i]];
+		pass.submission = submissionIndex;
+
+		if (pass.parallelExecute)
+		{
+			recordParallelPass(submission, pass);
+		}
+		else
+		{
+			TimestampQueryPool* timestampQueryPool = m_activeTimestampQueryPools[queue];
+			TimestampQueryPool::ZoneId zone = timestampQueryPool != nullptr ?
+				timestampQueryPool->beginZone(getCommandList(submission), pass.name) : TimestampQueryPool::InvalidZoneId;
+
+			pass.execute(getCommandList(submission));
+
+			if (timestampQueryPool != nullptr)
+			{
+				timestampQueryPool->endZone(getCommandList(submission), zone);
+			}
+		}
+	}
+
+	beginSplitTransitions(submission, passes, numPasses, transitions);
+}
+
+void RenderGraph::beginSplitTransitions(Submission& submission, const uint32_t* passes, uint32_t numPasses, const std::vector<ResourceAccess>& transitions)
+{
+	QueueIndex queue = m_passes[passes[0]].queue;
+	size_t nextPosition = static_cast<size_t>(passes - m_schedule.data()) + numPasses;
+
+	// The level of the next batch on this queue, a transition to that batch has no work to overlap with
+	uint32_t nextLevel = UINT32_MAX;
+	for (size_t i = nextPosition; i < m_schedule.size(); ++i)
+	{
+		if (m_passes[m_schedule[i]].queue == queue)
+		{
+			nextLevel = m_passes[m_schedule[i]].level;
+			break;
+		}
+	}
+
+	if (nextLevel == UINT32_MAX)
+	{
+		return;
+	}
+
+	bool hasSplitTransitions = false;
+	for (const ResourceAccess& transition : transitions)
+	{
+		if (!transition.write)
+		{
+			continue;
+		}
+
+		// Only the next pass which uses the resource matters, the passes after it see the state it leaves
+		for (size_t i = nextPosition; i < m_schedule.size(); ++i)
+		{
+			const Pass& consumer = m_passes[m_schedule[i]];
+			auto access = std::find_if(consumer.accesses.begin(), consumer.accesses.end(), [&transition](const ResourceAccess& consumerAccess)
+			{
+				return consumerAccess.resource == transition.resource;
+			});
+
+			if (access == consumer.accesses.end())
+			{
+				continue;
+			}
+
+			// The transition in the batch of the consumer ends the split transition
+			if (consumer.queue == queue && consumer.level != nextLevel && access->subresource == transition.subresource && access->state != transition.state)
+			{
+				submission.resourceStateTracker.beginTransitionResource(m_resources[transition.resource].resourceId, access->state, access->subresource);
+				hasSplitTransitions = true;
+			}
+			break;
+		}
+	}
+
+	if (hasSplitTransitions)
+	{
+		submission.resourceStateTracker.flushResourceBarriers(getCommandList(submission));
+	}
+}
+
+void RenderGraph::recordParallelPass(Submission& submission, const Pass& pass)
+{
+	uint32_t numCommandLists = getNumParallelCommandLists(pass);
+	if (numCommandLists == 0)
+	{
+		return;
+	}
+
+	uint32_t firstContext = m_nextFrameContext[pass.queue];
+	m_nextFrameContext[pass.queue] += numCommandLists;
+
+	FrameContext* const* contexts = m_frameContexts[pass.queue] + firstContext;
+
+	// The pass begins on its first command list and ends on its last one, which are executed in order
+	TimestampQueryPool* timestampQueryPool = m_activeTimestampQueryPools[pass.queue];
+	TimestampQueryPool::ZoneId zone = timestampQueryPool != nullptr ?
+		timestampQueryPool->beginZone(contexts[0]->getCommandList(), pass.name) : TimestampQueryPool::InvalidZoneId;
+
+	auto recordRange = [&pass, contexts, numCommandLists](uint32_t i)
+	{
+		PROFILE_SCOPE("RecordParallelPass");
+
+		uint32_t firstItem = static_cast<uint32_t>(static_cast<uint64_t>(pass.numItems) * i / numCommandLists);
+		uint32_t lastItem = static_cast<uint32_t>(static_cast<uint64_t>(pass.numItems) * (i + 1) / numCommandLists);
+		pass.parallelExecute(*contexts[i], firstItem, lastItem - firstItem);
+	};
+
+	if (m_workerPool != nullptr)
+	{
+		m_workerPool->parallelFor(numCommandLists, recordRange);
+	}
+	else
+	{
+		for (uint32_t i = 0; i < numCommandLists; ++i)
+		{
+			recordRange(i);
+		}
+	}
+
+	if (timestampQueryPool != nullptr)
+	{
+		timestampQueryPool->endZone(contexts[numCommandLists - 1]->getCommandList(), zone);
+	}
+
+	// The commands after the pass are recorded on a new command list
+	for (uint32_t i = 0; i < numCommandLists; ++i)
+	{
+		submission.commandLists.push_back(m_frameContextPools[pass.queue]->getCommandList(firstContext + i));
+	}
+	submission.commandList = nullptr;
+}
+
+uint32_t RenderGraph::getNumParallelCommandLists(const Pass& pass) const
+{
+	if (!pass.parallelExecute || pass.numItems == 0)
+	{
+		return 0;
+	}
+
+	uint32_t numThreads = m_workerPool != nullptr ? m_workerPool->getNumThreads() : 1;
+	return std::max(1u, std::min(numThreads, pass.numItems / pass.minItemsPerCommandList));
+}
+
+RenderGraph::Submission& RenderGraph::getOpenSubmission(QueueIndex queue)
+{
+	if (m_openSubmissions[queue] < 0)
+	{
+		std::unique_ptr<Submission> submission = std::make_unique<Submission>();
+		submission->queue = queue;
+		submission->fenceValue = 0;
+		submission->submitted = false;
+		for (uint32_t i = 0; i < NumQueues; ++i)
+		{
+			submission->waitFenceValues[i] = 0;
+		}
+
+		// The transient resources were placed in memory the previous frame may still use on the other queues.
+		// Later submissions of the queue are executed after the first one, so they do not have to wait.
+		if (m_waitForPreviousFrame && m_fenceValues[queue] == 0)
+		{
+			for (uint32_t i = 0; i < NumQueues; ++i)
+			{
+				if (i != queue && m_previousFenceValues[i] > 0)
+				{
+					submission->waitFenceValues[i] = m_previousFenceValues[i];
+					m_numQueueWaits++;
+				}
+			}
+		}
+
+		// Copy command lists only support the copy states. The split transitions end at the batch of the pass
+		// which needs the resource (see beginSplitTransitions), not after a fixed number of batches
+		ResourceStateTracker::OptimizerSettings settings;
+		settings.combineReadStates = queue != CopyQueueIndex;
+		settings.splitBarrierWindow = UINT32_MAX;
+		submission->resourceStateTracker.setOptimizerSettings(settings);
+
+		m_openSubmissions[queue] = static_cast<int32_t>(m_submissions.size());
+		m_submissions.push_back(std::move(submission));
+	}
+
+	return *m_submissions[m_openSubmissions[queue]];
+}
+
+CommandList& RenderGraph::getCommandList(Submission& submission)
+{
+	if (submission.commandList == nullptr)
+	{
+		if (m_spareCommandLists[submission.queue] != nullptr)
+		{
+			submission.commandList = std::move(m_spareCommandLists[submission.queue]);
+		}
+		else
+		{
+			submission.commandList = m_queues[submission.queue]->getCommandList();
+		}
+
+		submission.commandLists.push_back(submission.commandList);
+	}
+
+	return *submission.commandList;
+}
+
+void RenderGraph::waitForPass(QueueIndex queue, uint32_t pass)
+{
+	const Pass& dependency = m_passes[pass];
+	assert(dependency.submission != UINT32_MAX && "The pass has not been recorded yet.");
+
+	Submission& dependencySubmission = *m_submissions[dependency.submission];
+	if (!dependencySubmission.submitted)
+	{
+		submit(dependencySubmission);
+	}
+
+	Submission& submission = getOpenSubmission(queue);
+	if (submission.waitFenceValues[dependency.queue] < dependencySubmission.fenceValue)
+	{
+		submission.waitFenceValues[dependency.queue] = dependencySubmission.fenceValue;
+		m_numQueueWaits++;
+	}
+}
+
+void RenderGraph::submit(Submission& submission)
+{
+	assert(!submission.submitted);
+
+	ResourceStateTracker& resourceStateTracker = submission.resourceStateTracker;
+
+	// The split transitions whose consumer is in a later submission end on this command list
+	resourceStateTracker.endSplitTransitions();
+	if (resourceStateTracker.hasResourceBarriers())
+	{
+		resourceStateTracker.flushResourceBarriers(getCommandList(submission));
+	}
+
+	CommandQueue& queue = *m_queues[submission.queue];
+
+	// The queue waits (on the GPU) until the other queues have finished the work this submission depends on
+	for (uint32_t i = 0; i < NumQueues; ++i)
+	{
+		if (submission.waitFenceValues[i] > 0)
+		{
+			queue.waitForQueue(*m_queues[i], submission.waitFenceValues[i]);
+		}
+	}
+
+	// The queue resolves the pending barriers against the global resource states when it executes the command lists.
+	// They are executed first, in the same submission. They are recorded on the spare command list, which the queue
+	// takes when there are any
+	std::shared_ptr<CommandList>& spareCommandList = m_spareCommandLists[submission.queue];
+	if (spareCommandList == nullptr)
+	{
+		spareCommandList = queue.getCommandList();
+	}
+
+	submission.fenceValue = queue.executeCommandLists(static_cast<uint32_t>(submission.commandLists.size()), submission.commandLists.data(),
+		resourceStateTracker, spareCommandList);
+
+	submission.submitted = true;
+	m_openSubmissions[submission.queue] = -1;
+	m_fenceValues[submission.queue] = submission.fenceValue;
+	m_numSubmissions++;
+	m_numCommandLists += static_cast<uint32_t>(submission.commandLists.size()) + (spareCommandList == nullptr ? 1 : 0);
+}
+
+void RenderGraph::reset()
+{
+	m_passes.clear();
+	m_resources.clear();
+	m_schedule.clear();
+	m_submissions.clear();
+	m_compiled = false;
+}
+
+uint64_t RenderGraph::getFenceValue(D3D12_COMMAND_LIST_TYPE queueType) const
+{
+	return m_fenceValues[getQueueIndex(queueType)];
+}
+
+RenderGraph::QueueIndex RenderGraph::getQueueIndex(D3D12_COMMAND_LIST_TYPE queueType) const
+{
+	switch (queueType)
+	{
+	case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+		return m_queues[ComputeQueueIndex] != nullptr ? ComputeQueueIndex : DirectQueueIndex;
+	case D3D12_COMMAND_LIST_TYPE_COPY:
+		return m_queues[CopyQueueIndex] != nullptr ? CopyQueueIndex : DirectQueueIndex;
+	default:
+		return DirectQueueIndex;
+	}
+}
@@ -0,0 +1,286 @@
+#pragma once
+
+#include "FrameContext.h"
+#include "ResourceStateTracker.h"
+#include "TimestampQueryPool.h"
+#include "TransientResourceAllocator.h"
+
+#include "d3dx12.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CommandList;
+class CommandQueue;
+class WorkerPool;
+
+/*
+*	Frame graph on top of the ResourceStateTracker and the command queues.
+*	Passes declare the resources they read and write, and the state they need them in. The graph then:
+*	  * culls the passes whose results are never used,
+*	  * orders the passes in dependency levels. The transitions of all passes on a queue in the same
+*	    level are submitted as a single batch of barriers, before the first pass of the level is recorded.
+*	    When a resource is next used on the same queue a few levels later, its transition is split: it begins
+*	    after the level which wrote it and ends in the batch of the pass which uses it,
+*	  * records the passes on the direct, compute or copy queue, and makes a queue wait for another
+*	    queue on the GPU when a pass uses the results of a pass on the other queue.
+*	The before states are resolved by the resource state trackers, so passes never transition resources.
+*	Resources created by the graph (transient resources) only live during the passes which use them,
+*	and share memory with the transient resources which are not alive at the same time.
+*	The work of a parallel pass (e.g. thousands of draws) is split over multiple command lists, which are
+*	recorded in parallel by the worker pool. All command lists of a submission are executed at once.
+*	With GPU timings, every pass is measured with timestamp queries and appears as a GPU zone in the Profiler.
+*
+*	The graph is built every frame: reset, import the resources, add the passes, compile and execute.
+*/
+class RenderGraph
+{
+public:
+	using ResourceHandle = uint32_t;
+
+	static const ResourceHandle InvalidResourceHandle = UINT32_MAX;
+
+	// Declares the resource accesses of a pass, only valid within the setup function of the pass
+	class PassBuilder
+	{
+	public:
+		// Read a (sub)resource in the given state, e.g. PIXEL_SHADER_RESOURCE or COPY_SOURCE
+		void read(ResourceHandle resource, D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+		// Write a (sub)resource in the given state, e.g. RENDER_TARGET or UNORDERED_ACCESS
+		void write(ResourceHandle resource, D3D12_RESOURCE_STATES state, UINT subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+		// Never cull the pass, even if nothing reads what it writes (e.g. it writes a readback buffer)
+		void setSideEffect();
+
+	private:
+		friend class RenderGraph;
+
+		PassBuilder(RenderGraph& renderGraph, uint32_t pass);
+
+		RenderGraph& m_renderGraph;
+		uint32_t m_pass;
+	};
+
+	using SetupFunction = std::function<void(PassBuilder&)>;
+	using ExecuteFunction = std::function<void(CommandList&)>;
+	// Records the items [firstItem, firstItem + numItems) of a parallel pass, on the command list of the context
+	using ParallelExecuteFunction = std::function<void(FrameContext& context, uint32_t firstItem, uint32_t numItems)>;
+
+	/*
+	* @param computeQueue, copyQueue Optional, passes for a missing queue are recorded on the direct queue.
+	*/
+	RenderGraph(std::shared_ptr<CommandQueue> directQueue, std::shared_ptr<CommandQueue> computeQueue = nullptr,
+		std::shared_ptr<CommandQueue> copyQueue = nullptr);
+	virtual ~RenderGraph();
+
+	/*
+	* Use a resource which lives outside of the graph (e.g. the back buffer).
+	* Imported resources are the outputs of the graph, passes which write them are never culled.
+	*
+	* @param resourceId The id of the resource in the resource state trackers.
+	* @param finalState The state the resource is transitioned to after its last pass.
+	*/
+	ResourceHandle importResource(const std::string& name, ID3D12Resource* resource, ResourceStateTracker::ResourceId resourceId,
+		D3D12_RESOURCE_STATES finalState);
+
+	/*
+	* Create a resource which only lives within the graph. The resource is allocated by compile.
+	* Its contents are undefined at its first pass, so render target and depth stencil textures must be cleared first.
+	*
+	* @param clearValue The optimized clear value of a render target or depth stencil texture.
+	*/
+	ResourceHandle createResource(const std::string& name, const D3D12_RESOURCE_DESC& desc, const D3D12_CLEAR_VALUE* clearValue = nullptr);
+
+	/*
+	* Add a pass to the graph.
+	*
+	* @param queueType The queue to record the pass on (DIRECT, COMPUTE or COPY).
+	* @param setup Declares the resource accesses of the pass, called immediately.
+	* @param execute Records the pass, called from execute when the pass is not culled.
+	*/
+	void addPass(const std::string& name, D3D12_COMMAND_LIST_TYPE queueType, const SetupFunction& setup, ExecuteFunction execute);
+
+	/*
+	* Add a pass whose items are split in ranges, which are recorded on their own command lists in parallel.
+	* Every range must set all state it needs (render targets, pipeline state, root signature, ...),
+	* and the ranges must not depend on each other. The first range is executed first.
+	*
+	* @param numItems The number of items (e.g. draws) of the pass.
+	* @param minItemsPerCommandList The ranges are never smaller than this, so small passes are not split.
+	*/
+	void addParallelPass(const std::string& name, D3D12_COMMAND_LIST_TYPE queueType, const SetupFunction& setup,
+		uint32_t numItems, ParallelExecuteFunction execute, uint32_t minItemsPerCommandList = 256);
+
+	// Record the parallel passes with the worker pool, without one they are recorded on the calling thread
+	void setWorkerPool(std::shared_ptr<WorkerPool> workerPool) { m_workerPool = workerPool; }
+
+	// Measure the GPU time of the passes on the queues which have timestamps, see TimestampQueryPool
+	void setGpuTimings(bool enabled) { m_gpuTimings = enabled; }
+
+	/*
+	* Cull the unused passes, schedule the others and allocate the transient resources.
+	*/
+	void compile();
+
+	/*
+	* Record and execute the passes, in the order of the schedule.
+	*/
+	void execute();
+
+	/*
+	* Remove all passes and resources, so the graph can be built again.
+	*/
+	void reset();
+
+	// The resource of a handle, transient resources are only available after compile
+	ID3D12Resource* getResource(ResourceHandle resource) const { return m_resources[resource].resource; }
+
+	// Release the stale transient resources with releaseStaleResources, once their frame has completed
+	TransientResourceAllocator& getTransientResourceAllocator() { return m_transientResourceAllocator; }
+	// The memory the transient resources of the last compile saved by sharing memory
+	uint64_t getTransientMemorySaved() const { return m_transientResourceAllocator.getMemorySaved(); }
+
+	// The fence value of the last command list executed on the queue by execute, 0 if none was executed
+	uint64_t getFenceValue(D3D12_COMMAND_LIST_TYPE queueType) const;
+
+	// The statistics of the last compile and execute
+	uint32_t getNumPasses() const { return static_cast<uint32_t>(m_passes.size()); }
+	uint32_t getNumCulledPasses() const { return m_numCulledPasses; }
+	// The number of dependency levels, which is the number of barrier batches per queue
+	uint32_t getNumLevels() const { return m_numLevels; }
+	uint32_t getNumSubmissions() const { return m_numSubmissions; }
+	uint32_t getNumCommandLists() const { return m_numCommandLists; }
+	uint32_t getNumQueueWaits() const { return m_numQueueWaits; }
+
+private:
+	enum QueueIndex
+	{
+		DirectQueueIndex,
+		ComputeQueueIndex,
+		CopyQueueIndex,
+		NumQueues
+	};
+
+	struct ResourceAccess
+	{
+		ResourceHandle resource;
+		UINT subresource;
+		D3D12_RESOURCE_STATES state;
+		bool read;
+		bool write;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		QueueIndex queue;
+		ExecuteFunction execute;
+
+		// A parallel pass
+		ParallelExecuteFunction parallelExecute;
+		uint32_t numItems;
+		uint32_t minItemsPerCommandList;
+
+		std::vector<ResourceAccess> accesses;
+		// The passes which must be executed before this pass
+		std::vector<uint32_t> dependencies;
+
+		bool sideEffect;
+		bool culled;
+		uint32_t level;
+		// The submission the pass is recorded in
+		uint32_t submission;
+	};
+
+	struct Resource
+	{
+		std::string name;
+		ID3D12Resource* resource;
+		ResourceStateTracker::ResourceId resourceId;
+		D3D12_RESOURCE_STATES finalState;
+		bool imported;
+
+		// The description of a transient resource
+		D3D12_RESOURCE_DESC desc;
+		D3D12_CLEAR_VALUE clearValue;
+		bool hasClearValue;
+		// Shares memory with other transient resources
+		bool aliased;
+
+		// The first and last pass which use the resource
+		uint32_t firstPass;
+		uint32_t lastPass;
+	};
+
+	// A command list of one of the queues, with the state of the resources in it
+	struct Submission;
+
+	void addAccess(uint32_t pass, ResourceHandle resource, UINT subresource, D3D12_RESOURCE_STATES state, bool write);
+
+	void cullPasses();
+	void buildDependencies();
+	void schedulePasses();
+	void allocateTransientResources();
+
+	// Record the passes of a single level on a single queue
+	void recordPasses(const uint32_t* passes, uint32_t numPasses);
+	// Begin the transitions of the resources written by a level which are next used on the same queue, in a later batch
+	void beginSplitTransitions(Submission& submission, const uint32_t* passes, uint32_t numPasses, const std::vector<ResourceAccess>& transitions);
+	void recordParallelPass(Submission& submission, const Pass& pass);
+	uint32_t getNumParallelCommandLists(const Pass& pass) const;
+
+	Submission& getOpenSubmission(QueueIndex queue);
+	// The command list the next commands of a submission are recorded on
+	CommandList& getCommandList(Submission& submission);
+	// Make the open submission of the queue wait for the submission of a pass
+	void waitForPass(QueueIndex queue, uint32_t pass);
+	void submit(Submission& submission);
+
+	QueueIndex getQueueIndex(D3D12_COMMAND_LIST_TYPE queueType) const;
+
+	std::shared_ptr<CommandQueue> m_queues[NumQueues];
+
+	std::vector<Pass> m_passes;
+	std::vector<Resource> m_resources;
+
+	// The passes which are not culled, in the order in which they are recorded
+	std::vector<uint32_t> m_schedule;
+	bool m_compiled;
+
+	std::vector<std::unique_ptr<Submission>> m_submissions;
+	// The submission of every queue which is still being recorded (-1 if none)
+	int32_t m_openSubmissions[NumQueues];
+	// A command list per queue which was not used by the previous submission of the queue
+	std::shared_ptr<CommandList> m_spareCommandLists[NumQueues];
+
+	std::shared_ptr<WorkerPool> m_workerPool;
+	// The contexts of the parallel passes per queue, created when a queue has a parallel pass
+	std::unique_ptr<FrameContextPool> m_frameContextPools[NumQueues];
+	// The contexts of the current execute, and the first one which is not used yet
+	FrameContext* const* m_frameContexts[NumQueues];
+	uint32_t m_nextFrameContext[NumQueues];
+
+	bool m_gpuTimings;
+	// The timestamp queries per queue, created when a queue has a pass which is measured
+	std::unique_ptr<TimestampQueryPool> m_timestampQueryPools[NumQueues];
+	// The pools of the queues which are measured in the current execute (null for the others)
+	TimestampQueryPool* m_activeTimestampQueryPools[NumQueues];
+
+	uint64_t m_fenceValues[NumQueues];
+	// The fence values of the last submissions of the previous frames
+	uint64_t m_previousFenceValues[NumQueues];
+
+	TransientResourceAllocator m_transientResourceAllocator;
+	// The memory of the transient resources was used by other resources in the previous frame, so the
+	// first submission of every queue waits for the previous frames of the other queues
+	bool m_waitForPreviousFrame;
+
+	uint32_t m_numCulledPasses;
+	uint32_t m_numLevels;
+	uint32_t m_numSubmissions;
+	uint32_t m_numCommandLists;
+	uint32_t m_numQueueWaits;
+};
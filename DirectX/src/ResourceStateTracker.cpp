@@ -1,49 +1,163 @@
 #include "dxpch.h"
 #include "ResourceStateTracker.h"
 #include "CommandList.h"
+#include "Profiler.h"
 
 // Static definitions
-std::mutex ResourceStateTracker::s_globalMutex;
-bool ResourceStateTracker::s_isLocked = false;
-ResourceStateTracker::ResourceStateMap ResourceStateTracker::s_globalResourceStates;
+std::atomic<ResourceStateTracker::ResourceSlot*> ResourceStateTracker::s_resourceSlotChunks[MaxChunks];
+std::unique_ptr<ResourceStateTracker::ResourceSlot[]> ResourceStateTracker::s_resourceSlotChunkStorage[MaxChunks];
+std::mutex ResourceStateTracker::s_resourceIdMutex;
+std::vector<ResourceStateTracker::ResourceId> ResourceStateTracker::s_freeResourceIds;
+uint32_t ResourceStateTracker::s_numResourceIds = 0;
+std::atomic<uint64_t> ResourceStateTracker::s_numRequestedBarriers(0);
+std::atomic<uint64_t> ResourceStateTracker::s_numSubmittedBarriers(0);
+std::atomic<uint64_t> ResourceStateTracker::s_numElidedBarriers(0);
+std::atomic<uint64_t> ResourceStateTracker::s_numMergedBarriers(0);
+std::atomic<uint64_t> ResourceStateTracker::s_numSplitBarriers(0);
+
+namespace
+{
+	// The states in which a resource can only be read, these can be combined
+	const D3D12_RESOURCE_STATES ReadStates = D3D12_RESOURCE_STATE_GENERIC_READ | D3D12_RESOURCE_STATE_DEPTH_READ | D3D12_RESOURCE_STATE_RESOLVE_SOURCE;
+
+	bool IsReadState(D3D12_RESOURCE_STATES state)
+	{
+		return state != D3D12_RESOURCE_STATE_COMMON && (state & ~ReadStates) == 0;
+	}
+
+	// Check if two transitions apply to (some of) the same subresources
+	bool OverlapSubresources(const D3D12_RESOURCE_TRANSITION_BARRIER& a, const D3D12_RESOURCE_TRANSITION_BARRIER& b)
+	{
+		return a.pResource == b.pResource &&
+			(a.Subresource == b.Subresource || a.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || b.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+	}
+
+	uint32_t GetNumSubresources(ID3D12Resource* resource)
+	{
+		D3D12_RESOURCE_DESC desc = resource->GetDesc();
+		if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+		{
+			return 1;
+		}
+
+		// Depth stencil formats have a depth and a stencil plane
+		uint32_t numPlanes = 1;
+		switch (desc.Format)
+		{
+		case DXGI_FORMAT_R24G8_TYPELESS:
+		case DXGI_FORMAT_D24_UNORM_S8_UINT:
+		case DXGI_FORMAT_R32G8X24_TYPELESS:
+		case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+			numPlanes = 2;
+			break;
+		default:
+			break;
+		}
+
+		uint32_t arraySize = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize;
+		return desc.MipLevels * arraySize * numPlanes;
+	}
+}
+
+ResourceStateTracker::ResourceStateTracker()
+	:	m_stats{}
+{
+}
+
+ResourceStateTracker::~ResourceStateTracker()
+{
+}
 
 void ResourceStateTracker::resourceBarrier(const D3D12_RESOURCE_BARRIER& barrier)
 {
-	if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+	assert(barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && "Use transitionResource to push transitions.");
+
+	m_stats.numRequested++;
+
+	// A resource cannot be used while it is in transition
+	if (!m_splitTransitions.empty())
+	{
+		if (barrier.Type == D3D12_RESOURCE_BARRIER_TYPE_UAV)
+		{
+			endSplitTransitions(barrier.UAV.pResource);
+		}
+		else if (barrier.Aliasing.pResourceBefore == nullptr || barrier.Aliasing.pResourceAfter == nullptr)
+		{
+			endSplitTransitions(nullptr);
+		}
+		else
+		{
+			endSplitTransitions(barrier.Aliasing.pResourceBefore);
+			endSplitTransitions(barrier.Aliasing.pResourceAfter);
+		}
+	}
+
+	// Just push non-transition barriers to the resource barriers array.
+	m_resourceBarriers.push_back(barrier);
+}
+
+void ResourceStateTracker::transitionResource(ResourceId resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource)
+{
+	if (resource == InvalidResourceId)
 	{
-		// Just push non-transition barriers to the resource barriers array.
-		m_resourceBarriers.push_back(barrier);
 		return;
 	}
 
+	m_stats.numRequested++;
+
+	// The resource is used, so a transition that was started for it must end here
+	if (!m_splitTransitions.empty())
+	{
+		endSplitTransitions(resource, subResource);
+	}
+
+	// The resource of a slot is only changed when it is added or removed, so it can be read without locking the slot
+	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(GetResourceSlot(resource).resource, D3D12_RESOURCE_STATE_COMMON, stateAfter, subResource);
 	const D3D12_RESOURCE_TRANSITION_BARRIER& transitionBarrier = barrier.Transition;
 
 	// First check if there is already a known "final" state for the given resource.
 	// If there is, the resource has been used on the command list before and
 	// already has a known state within the command list execution.
-	const auto itr = m_finalResourceStates.find(transitionBarrier.pResource);
+	const auto itr = m_finalResourceStates.find(resource);
 	if (itr != m_finalResourceStates.end())
 	{
-		auto& resourceState = itr->second;
+		auto& resourceState = itr->second.state;
 		// If the known final state of the resource is different...
 		if (transitionBarrier.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
 			!resourceState.subresourceStates.empty())
 		{
 			// First transition all of the subresources if they are different than the StateAfter.
-			for (auto subresourceState : resourceState.subresourceStates)
+			for (const SubresourceStates::Range& range : resourceState.subresourceStates)
 			{
-				if (transitionBarrier.StateAfter != subresourceState.second)
+				if (transitionBarrier.StateAfter != range.state)
 				{
 					D3D12_RESOURCE_BARRIER newBarrier = barrier;
-					newBarrier.Transition.Subresource = subresourceState.first;
-					newBarrier.Transition.StateBefore = subresourceState.second;
-					m_resourceBarriers.push_back(newBarrier);
+					newBarrier.Transition.StateBefore = range.state;
+					for (UINT subresource = range.first; subresource < range.first + range.count; ++subresource)
+					{
+						newBarrier.Transition.Subresource = subresource;
+						m_resourceBarriers.push_back(newBarrier);
+					}
 				}
 			}
 		}
 		else
 		{
 			auto finalState = resourceState.getSubresourceState(transitionBarrier.Subresource);
+
+			if (m_settings.combineReadStates && IsReadState(finalState) && IsReadState(stateAfter))
+			{
+				// The resource can already be read in the requested way
+				if ((finalState & stateAfter) == stateAfter)
+				{
+					m_stats.numElided++;
+					return;
+				}
+
+				// Keep the resource readable in the current way as well, so switching back costs nothing
+				barrier.Transition.StateAfter = finalState | stateAfter;
+			}
+
 			if (transitionBarrier.StateAfter != finalState)
 			{
 				// Push a new transition barrier with the correct before state.
@@ -51,24 +165,133 @@ void ResourceStateTracker::resourceBarrier(const D3D12_RESOURCE_BARRIER& barrier
 				newBarrier.Transition.StateBefore = finalState;
 				m_resourceBarriers.push_back(newBarrier);
 			}
+			else
+			{
+				m_stats.numElided++;
+			}
 		}
 	}
 	else // In this case, the resource is being used on the command list for the first time.
 	{
 		// Add a pending barrier. The pending barriers will be resolved
 		// before the command list is executed on the command queue.
-		m_pendingResourceBarriers.push_back(barrier);
+		m_pendingResourceBarriers.push_back({ resource, barrier });
 	}
 
 	// Push the final known state (possibly replacing the previously known state for the subresource).
-	m_finalResourceStates[transitionBarrier.pResource].setSubresourceState(transitionBarrier.Subresource, transitionBarrier.StateAfter);
+	m_finalResourceStates[resource].state.setSubresourceState(transitionBarrier.Subresource, transitionBarrier.StateAfter);
+}
+
+void ResourceStateTracker::beginTransitionResource(ResourceId resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource)
+{
+	if (resource == InvalidResourceId)
+	{
+		return;
+	}
+
+	// The state before is only known when the resource was used on the command list before
+	auto itr = m_finalResourceStates.find(resource);
+	if (m_settings.splitBarrierWindow == 0 || itr == m_finalResourceStates.end() ||
+		(subResource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES && !itr->second.state.subresourceStates.empty()))
+	{
+		transitionResource(resource, stateAfter, subResource);
+		return;
+	}
+
+	m_stats.numRequested++;
+
+	// A previous split transition of the subresource must end first
+	if (!m_splitTransitions.empty())
+	{
+		endSplitTransitions(resource, subResource);
+	}
+
+	ResourceState& resourceState = itr->second.state;
+	D3D12_RESOURCE_STATES stateBefore = resourceState.getSubresourceState(subResource);
+	if (stateBefore == stateAfter)
+	{
+		m_stats.numElided++;
+		return;
+	}
+
+	D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(GetResourceSlot(resource).resource, stateBefore, stateAfter, subResource,
+		D3D12_RESOURCE_BARRIER_FLAG_BEGIN_ONLY);
+	m_resourceBarriers.push_back(barrier);
+	m_splitTransitions.push_back({ resource, barrier, 0 });
+	m_stats.numSplit++;
+
+	resourceState.setSubresourceState(subResource, stateAfter);
+}
+
+void ResourceStateTracker::acquireResourceState(ResourceId resource)
+{
+	if (resource == InvalidResourceId || m_finalResourceStates.find(resource) != m_finalResourceStates.end())
+	{
+		return;
+	}
+
+	ResourceSlot& slot = GetResourceSlot(resource);
+
+	slot.lock();
+	m_finalResourceStates[resource].state = slot.state;
+	slot.unlock();
 }
 
-void ResourceStateTracker::transitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource)
+void ResourceStateTracker::endSplitTransitions()
 {
-	if (resource != nullptr)
+	for (const SplitTransition& splitTransition : m_splitTransitions)
 	{
-		resourceBarrier(CD3DX12_RESOURCE_BARRIER::Transition(resource, D3D12_RESOURCE_STATE_COMMON, stateAfter, subResource));
+		D3D12_RESOURCE_BARRIER barrier = splitTransition.barrier;
+		barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+		m_resourceBarriers.push_back(barrier);
+	}
+
+	m_splitTransitions.clear();
+}
+
+void ResourceStateTracker::endSplitTransitions(ResourceId resource, UINT subresource)
+{
+	for (size_t i = 0; i < m_splitTransitions.size();)
+	{
+		const SplitTransition& splitTransition = m_splitTransitions[i];
+		UINT splitSubresource = splitTransition.barrier.Transition.Subresource;
+
+		if (splitTransition.resource == resource && (splitSubresource == subresource ||
+			splitSubresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES || subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES))
+		{
+			D3D12_RESOURCE_BARRIER barrier = splitTransition.barrier;
+			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+			m_resourceBarriers.push_back(barrier);
+
+			m_splitTransitions[i] = m_splitTransitions.back();
+			m_splitTransitions.pop_back();
+		}
+		else
+		{
+			++i;
+		}
+	}
+}
+
+void ResourceStateTracker::endSplitTransitions(ID3D12Resource* resource)
+{
+	for (size_t i = 0; i < m_splitTransitions.size();)
+	{
+		const SplitTransition& splitTransition = m_splitTransitions[i];
+
+		if (resource == nullptr || splitTransition.barrier.Transition.pResource == resource)
+		{
+			D3D12_RESOURCE_BARRIER barrier = splitTransition.barrier;
+			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+			m_resourceBarriers.push_back(barrier);
+
+			m_splitTransitions[i] = m_splitTransitions.back();
+			m_splitTransitions.pop_back();
+		}
+		else
+		{
+			++i;
+		}
 	}
 }
 
@@ -84,7 +307,7 @@ void ResourceStateTracker::aliasBarrier(ID3D12Resource* beforeResource, ID3D12Re
 
 uint32_t ResourceStateTracker::flushPendingResourceBarriers(CommandList& commandList)
 {
-	assert(s_isLocked);
+	PROFILE_SCOPE("FlushPendingBarriers");
 
 	// Resolve the pending resource barriers by checking the global state of the
 	// (sub)resources. Add barriers if the pending state and the global state do not match.
@@ -93,81 +316,267 @@ uint32_t ResourceStateTracker::flushPendingResourceBarriers(CommandList& command
 	// Reserve enough space (worst-case, all pending barriers)
 	resourceBarriers.reserve(m_pendingResourceBarriers.size());
 
-	for (auto pendingBarrier : m_pendingResourceBarriers)
+	for (const PendingTransition& pendingTransition : m_pendingResourceBarriers)
+	{
+		ResourceSlot& slot = GetResourceSlot(pendingTransition.resource);
+		FinalResourceState& finalState = m_finalResourceStates[pendingTransition.resource];
+
+		// Read the global state and replace it with the final state in one step, so a command list
+		// that is flushed on another thread at the same time sees either the old or the new state.
+		slot.lock();
+		resolvePendingTransition(pendingTransition, slot, resourceBarriers);
+		slot.state = finalState.state;
+		slot.unlock();
+
+		finalState.committed = true;
+	}
+
+	m_pendingResourceBarriers.clear();
+
+	return submitResourceBarriers(commandList, resourceBarriers);
+}
+
+void ResourceStateTracker::resolvePendingTransition(const PendingTransition& pendingTransition, const ResourceSlot& slot, ResourceBarriers& resourceBarriers) const
+{
+	const D3D12_RESOURCE_TRANSITION_BARRIER& transition = pendingTransition.barrier.Transition;
+	const ResourceState& resourceState = slot.state;
+
+	// If all subresources are being transitioned, and there are multiple
+	// subresources of the resource that are in a different state...
+	if (transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
+		!resourceState.subresourceStates.empty())
+	{
+		// Transition all subresources
+		for (const SubresourceStates::Range& range : resourceState.subresourceStates)
+		{
+			if (transition.StateAfter != range.state)
+			{
+				D3D12_RESOURCE_BARRIER newBarrier = pendingTransition.barrier;
+				newBarrier.Transition.StateBefore = range.state;
+				for (UINT subresource = range.first; subresource < range.first + range.count; ++subresource)
+				{
+					newBarrier.Transition.Subresource = subresource;
+					resourceBarriers.push_back(newBarrier);
+				}
+			}
+		}
+	}
+	else
+	{
+		// No (sub)resources need to be transitioned. Just add a single transition barrier (if needed).
+		auto globalState = resourceState.getSubresourceState(transition.Subresource);
+		if (transition.StateAfter != globalState)
+		{
+			// Fix-up the before state based on current global state of the resource.
+			D3D12_RESOURCE_BARRIER newBarrier = pendingTransition.barrier;
+			newBarrier.Transition.StateBefore = globalState;
+			resourceBarriers.push_back(newBarrier);
+		}
+	}
+}
+
+void ResourceStateTracker::flushResourceBarriers(CommandList& commandList)
+{
+	PROFILE_SCOPE("FlushBarriers");
+
+	// End the split transitions which have been open for the whole window
+	for (size_t i = 0; i < m_splitTransitions.size();)
+	{
+		SplitTransition& splitTransition = m_splitTransitions[i];
+		if (splitTransition.age >= m_settings.splitBarrierWindow)
+		{
+			D3D12_RESOURCE_BARRIER barrier = splitTransition.barrier;
+			barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_END_ONLY;
+			m_resourceBarriers.push_back(barrier);
+
+			m_splitTransitions[i] = m_splitTransitions.back();
+			m_splitTransitions.pop_back();
+		}
+		else
+		{
+			splitTransition.age++;
+			++i;
+		}
+	}
+
+	submitResourceBarriers(commandList, m_resourceBarriers);
+	m_resourceBarriers.clear();
+}
+
+uint32_t ResourceStateTracker::submitResourceBarriers(CommandList& commandList, ResourceBarriers& resourceBarriers)
+{
+	if (m_settings.optimizeBarriers)
+	{
+		optimizeResourceBarriers(resourceBarriers);
+	}
+
+	UINT numBarriers = static_cast<UINT>(resourceBarriers.size());
+	if (numBarriers > 0)
+	{
+		commandList.resourceBarrier(numBarriers, resourceBarriers.data());
+	}
+
+	m_stats.numSubmitted += numBarriers;
+
+	// Publish the counts once per flush instead of once per barrier
+	s_numRequestedBarriers.fetch_add(m_stats.numRequested, std::memory_order_relaxed);
+	s_numSubmittedBarriers.fetch_add(m_stats.numSubmitted, std::memory_order_relaxed);
+	s_numElidedBarriers.fetch_add(m_stats.numElided, std::memory_order_relaxed);
+	s_numMergedBarriers.fetch_add(m_stats.numMerged, std::memory_order_relaxed);
+	s_numSplitBarriers.fetch_add(m_stats.numSplit, std::memory_order_relaxed);
+	m_stats = {};
+
+	return numBarriers;
+}
+
+void ResourceStateTracker::optimizeResourceBarriers(ResourceBarriers& resourceBarriers)
+{
+	// Fold back-to-back transitions of the same subresource (A -> B, B -> C becomes A -> C) and drop transitions
+	// which do nothing. UAV and aliasing barriers order the work on the GPU, nothing is folded across them.
+	size_t numBarriers = 0;
+	size_t firstFoldable = 0;
+
+	for (size_t i = 0; i < resourceBarriers.size(); ++i)
 	{
-		// Only transition barries should be pending
-		if (pendingBarrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+		const D3D12_RESOURCE_BARRIER barrier = resourceBarriers[i];
+
+		if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
 		{
+			resourceBarriers[numBarriers++] = barrier;
+			firstFoldable = numBarriers;
 			continue;
 		}
 
-		auto pendingTransition = pendingBarrier.Transition;
-		const auto& itr = s_globalResourceStates.find(pendingTransition.pResource);
-		if (itr != s_globalResourceStates.end())
+		const D3D12_RESOURCE_TRANSITION_BARRIER& transition = barrier.Transition;
+
+		if (barrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE)
 		{
-			// If all subresources are being transitioned, and there are multiple
-			// subresources of the resource that are in a different state...
-			auto& resourceState = itr->second;
-			if (pendingTransition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES &&
-				!resourceState.subresourceStates.empty())
+			if (transition.StateBefore == transition.StateAfter)
+			{
+				m_stats.numElided++;
+				continue;
+			}
+
+			// Find the previous transition of the subresource
+			size_t previous = SIZE_MAX;
+			for (size_t j = numBarriers; j > firstFoldable; --j)
 			{
-				// Transition all subresources
-				for (auto subresourceState : resourceState.subresourceStates)
+				const D3D12_RESOURCE_BARRIER& previousBarrier = resourceBarriers[j - 1];
+				if (previousBarrier.Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && OverlapSubresources(previousBarrier.Transition, transition))
 				{
-					if (pendingTransition.StateAfter != subresourceState.second)
+					if (previousBarrier.Flags == D3D12_RESOURCE_BARRIER_FLAG_NONE && previousBarrier.Transition.Subresource == transition.Subresource &&
+						previousBarrier.Transition.StateAfter == transition.StateBefore)
 					{
-						D3D12_RESOURCE_BARRIER newBarrier = pendingBarrier;
-						newBarrier.Transition.Subresource = subresourceState.first;
-						newBarrier.Transition.StateBefore = subresourceState.second;
-						resourceBarriers.push_back(newBarrier);
+						previous = j - 1;
 					}
+					break;
 				}
 			}
-			else
+
+			if (previous != SIZE_MAX)
 			{
-				// No (sub)resources need to be transitioned. Just add a single transition barrier (if needed).
-				auto globalState = (itr->second).getSubresourceState(pendingTransition.Subresource);
-				if (pendingTransition.StateAfter != globalState)
+				D3D12_RESOURCE_TRANSITION_BARRIER& previousTransition = resourceBarriers[previous].Transition;
+				previousTransition.StateAfter = transition.StateAfter;
+				m_stats.numElided++;
+
+				// A -> B, B -> A does nothing at all
+				if (previousTransition.StateBefore == previousTransition.StateAfter)
 				{
-					// Fix-up the before state based on current global state of the resource.
-					pendingBarrier.Transition.StateBefore = globalState;
-					resourceBarriers.push_back(pendingBarrier);
+					resourceBarriers.erase(resourceBarriers.begin() + previous);
+					numBarriers--;
+					i--;
+					m_stats.numElided++;
 				}
+				continue;
 			}
 		}
+
+		resourceBarriers[numBarriers++] = barrier;
 	}
 
-	UINT numBarriers = static_cast<UINT>(resourceBarriers.size());
-	if (numBarriers > 0)
+	resourceBarriers.resize(numBarriers);
+
+	// Merge per-subresource transitions into a single transition when all subresources of the resource are
+	// transitioned from and to the same state, and no other barrier in the same section uses the resource.
+	size_t sectionBegin = 0;
+	for (size_t i = 0; i < resourceBarriers.size(); ++i)
 	{
-		auto d3dCommandList = commandList.getCommandList();
-		d3dCommandList->ResourceBarrier(numBarriers, resourceBarriers.data());
-	}
+		const D3D12_RESOURCE_BARRIER& barrier = resourceBarriers[i];
+		if (barrier.Type != D3D12_RESOURCE_BARRIER_TYPE_TRANSITION)
+		{
+			sectionBegin = i + 1;
+			continue;
+		}
 
-	m_pendingResourceBarriers.clear();
+		const D3D12_RESOURCE_TRANSITION_BARRIER& transition = barrier.Transition;
+		if (barrier.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE || transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES)
+		{
+			continue;
+		}
 
-	return numBarriers;
-}
+		// Only the first transition of the resource in the section starts a merge
+		bool usedBefore = false;
+		for (size_t j = sectionBegin; j < i && !usedBefore; ++j)
+		{
+			usedBefore = resourceBarriers[j].Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION && resourceBarriers[j].Transition.pResource == transition.pResource;
+		}
+		if (usedBefore)
+		{
+			continue;
+		}
 
-void ResourceStateTracker::flushResourceBarriers(CommandList& commandList)
-{
-	UINT numBarriers = static_cast<UINT>(m_resourceBarriers.size());
-	if (numBarriers > 0)
-	{
-		auto d3dCommandList = commandList.getCommandList();
-		d3dCommandList->ResourceBarrier(numBarriers, m_resourceBarriers.data());
-		m_resourceBarriers.clear();
+		uint32_t numUniform = 1;
+		size_t sectionEnd = i + 1;
+		bool uniform = true;
+		for (; sectionEnd < resourceBarriers.size() && resourceBarriers[sectionEnd].Type == D3D12_RESOURCE_BARRIER_TYPE_TRANSITION; ++sectionEnd)
+		{
+			const D3D12_RESOURCE_BARRIER& other = resourceBarriers[sectionEnd];
+			if (other.Transition.pResource != transition.pResource)
+			{
+				continue;
+			}
+
+			if (other.Flags != D3D12_RESOURCE_BARRIER_FLAG_NONE || other.Transition.Subresource == D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES ||
+				other.Transition.StateBefore != transition.StateBefore || other.Transition.StateAfter != transition.StateAfter)
+			{
+				uniform = false;
+			}
+			numUniform++;
+		}
+
+		// Folding left at most one transition per subresource
+		if (!uniform || numUniform < 2 || numUniform != GetNumSubresources(transition.pResource))
+		{
+			continue;
+		}
+
+		resourceBarriers[i].Transition.Subresource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES;
+
+		ID3D12Resource* resource = transition.pResource;
+		auto last = std::remove_if(resourceBarriers.begin() + i + 1, resourceBarriers.begin() + sectionEnd, [resource](const D3D12_RESOURCE_BARRIER& other)
+		{
+			return other.Transition.pResource == resource;
+		});
+		resourceBarriers.erase(last, resourceBarriers.begin() + sectionEnd);
+
+		m_stats.numMerged += numUniform - 1;
 	}
 }
 
 void ResourceStateTracker::commitFinalResourceStates()
 {
-	assert(s_isLocked);
-
-	// Commit final resource states to the global resource state array (map).
-	for (const auto& resourceState : m_finalResourceStates)
+	// Commit final resource states to the global resource state array.
+	// The states of resources with a pending barrier were already committed when it was flushed.
+	for (const auto& finalState : m_finalResourceStates)
 	{
-		s_globalResourceStates[resourceState.first] = resourceState.second;
+		if (!finalState.second.committed)
+		{
+			ResourceSlot& slot = GetResourceSlot(finalState.first);
+
+			slot.lock();
+			slot.state = finalState.second.state;
+			slot.unlock();
+		}
 	}
 
 	m_finalResourceStates.clear();
@@ -179,34 +588,222 @@ void ResourceStateTracker::reset()
 	m_pendingResourceBarriers.clear();
 	m_resourceBarriers.clear();
 	m_finalResourceStates.clear();
+	m_splitTransitions.clear();
+}
+
+ResourceStateTracker::ResourceId ResourceStateTracker::AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+{
+	if (resource == nullptr)
+	{
+		return InvalidResourceId;
+	}
+
+	ResourceId id;
+	{
+		std::lock_guard<std::mutex> lock(s_resourceIdMutex);
+
+		if (!s_freeResourceIds.empty())
+		{
+			id = s_freeResourceIds.back();
+			s_freeResourceIds.pop_back();
+		}
+		else
+		{
+			if (s_numResourceIds == MaxResources)
+			{
+				throw std::bad_alloc();
+			}
+
+			id = s_numResourceIds++;
+
+			uint32_t chunkIndex = id / SlotsPerChunk;
+			if (s_resourceSlotChunkStorage[chunkIndex] == nullptr)
+			{
+				s_resourceSlotChunkStorage[chunkIndex] = std::make_unique<ResourceSlot[]>(SlotsPerChunk);
+				s_resourceSlotChunks[chunkIndex].store(s_resourceSlotChunkStorage[chunkIndex].get(), std::memory_order_release);
+			}
+		}
+	}
+
+	ResourceSlot& slot = GetResourceSlot(id);
+
+	slot.lock();
+	slot.resource = resource;
+	slot.state = ResourceState(state);
+	slot.unlock();
+
+	return id;
 }
 
-void ResourceStateTracker::Lock()
+void ResourceStateTracker::RemoveGlobalResourceState(ResourceId resource)
 {
-	s_globalMutex.lock();
-	s_isLocked = true;
+	if (resource == InvalidResourceId)
+	{
+		return;
+	}
+
+	ResourceSlot& slot = GetResourceSlot(resource);
+
+	slot.lock();
+	slot.resource = nullptr;
+	slot.state = ResourceState();
+	slot.unlock();
+
+	std::lock_guard<std::mutex> lock(s_resourceIdMutex);
+	s_freeResourceIds.push_back(resource);
 }
 
-void ResourceStateTracker::Unlock()
+void ResourceStateTracker::SubresourceStates::clear()
 {
-	s_isLocked = false;
-	s_globalMutex.unlock();
+	m_heapRanges.clear();
+	m_numRanges = 0;
+	m_onHeap = false;
 }
 
-void ResourceStateTracker::AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state)
+void ResourceStateTracker::SubresourceStates::set(UINT subresource, D3D12_RESOURCE_STATES state)
 {
-	if (resource != nullptr)
+	// Find the first range which does not end before the subresource
+	uint32_t index = 0;
+	const Range* ranges = data();
+	while (index < m_numRanges && ranges[index].first + ranges[index].count <= subresource)
 	{
-		std::lock_guard<std::mutex> lock(s_globalMutex);
-		s_globalResourceStates[resource].setSubresourceState(D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES, state);
+		++index;
+	}
+
+	if (index < m_numRanges && ranges[index].first <= subresource)
+	{
+		// The subresource is part of a range
+		Range range = ranges[index];
+		if (range.state == state)
+		{
+			return;
+		}
+
+		UINT rangeEnd = range.first + range.count;
+		if (range.count == 1)
+		{
+			data()[index].state = state;
+		}
+		else if (subresource == range.first)
+		{
+			data()[index] = { subresource + 1, range.count - 1, range.state };
+			insert(index, { subresource, 1, state });
+		}
+		else if (subresource == rangeEnd - 1)
+		{
+			data()[index].count--;
+			insert(++index, { subresource, 1, state });
+		}
+		else
+		{
+			// Split the range in three
+			data()[index].count = subresource - range.first;
+			insert(index + 1, { subresource, 1, state });
+			insert(index + 2, { subresource + 1, rangeEnd - subresource - 1, range.state });
+			++index;
+		}
+	}
+	else
+	{
+		insert(index, { subresource, 1, state });
+	}
+
+	mergeWithNext(index);
+	if (index > 0)
+	{
+		mergeWithNext(index - 1);
 	}
 }
 
-void ResourceStateTracker::RemoveGlobalResourceState(ID3D12Resource* resource)
+bool ResourceStateTracker::SubresourceStates::find(UINT subresource, D3D12_RESOURCE_STATES& state) const
 {
-	if (resource != nullptr)
+	for (const Range& range : *this)
 	{
-		std::lock_guard<std::mutex> lock(s_globalMutex);
-		s_globalResourceStates.erase(resource);
+		if (range.first > subresource)
+		{
+			break;
+		}
+
+		if (subresource < range.first + range.count)
+		{
+			state = range.state;
+			return true;
+		}
 	}
+
+	return false;
+}
+
+void ResourceStateTracker::SubresourceStates::insert(uint32_t index, const Range& range)
+{
+	if (!m_onHeap && m_numRanges == NumInlineRanges)
+	{
+		m_heapRanges.assign(m_inlineRanges, m_inlineRanges + m_numRanges);
+		m_onHeap = true;
+	}
+
+	if (m_onHeap)
+	{
+		m_heapRanges.insert(m_heapRanges.begin() + index, range);
+	}
+	else
+	{
+		for (uint32_t i = m_numRanges; i > index; --i)
+		{
+			m_inlineRanges[i] = m_inlineRanges[i - 1];
+		}
+		m_inlineRanges[index] = range;
+	}
+
+	m_numRanges++;
+}
+
+void ResourceStateTracker::SubresourceStates::erase(uint32_t index)
+{
+	if (m_onHeap)
+	{
+		m_heapRanges.erase(m_heapRanges.begin() + index);
+	}
+	else
+	{
+		for (uint32_t i = index + 1; i < m_numRanges; ++i)
+		{
+			m_inlineRanges[i - 1] = m_inlineRanges[i];
+		}
+	}
+
+	m_numRanges--;
+}
+
+void ResourceStateTracker::SubresourceStates::mergeWithNext(uint32_t index)
+{
+	Range* ranges = data();
+	if (index + 1 < m_numRanges && ranges[index].first + ranges[index].count == ranges[index + 1].first &&
+		ranges[index].state == ranges[index + 1].state)
+	{
+		ranges[index].count += ranges[index + 1].count;
+		erase(index + 1);
+	}
+}
+
+ResourceStateTracker::BarrierStats ResourceStateTracker::GetAndResetBarrierStats()
+{
+	BarrierStats stats;
+	stats.numRequested = s_numRequestedBarriers.exchange(0, std::memory_order_relaxed);
+	stats.numSubmitted = s_numSubmittedBarriers.exchange(0, std::memory_order_relaxed);
+	stats.numElided = s_numElidedBarriers.exchange(0, std::memory_order_relaxed);
+	stats.numMerged = s_numMergedBarriers.exchange(0, std::memory_order_relaxed);
+	stats.numSplit = s_numSplitBarriers.exchange(0, std::memory_order_relaxed);
+
+	return stats;
+}
+
+ResourceStateTracker::ResourceSlot& ResourceStateTracker::GetResourceSlot(ResourceId resource)
+{
+	assert(resource < MaxResources);
+
+	ResourceSlot* chunk = s_resourceSlotChunks[resource / SlotsPerChunk].load(std::memory_order_acquire);
+	assert(chunk != nullptr && "The resource was not added to the global resource state.");
+
+	return chunk[resource % SlotsPerChunk];
 }
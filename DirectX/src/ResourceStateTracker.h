@@ -2,21 +2,75 @@
 
 #include "d3dx12.h"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <mutex>
-#include <map>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
 class CommandList;
 
+/*
+*	Tracks the state of resources within a command list and resolves the state the resources
+*	are in at the start of the command list when it is executed.
+*
+*	Resources are registered in a global array of slots (AddGlobalResourceState) and referred to by
+*	their dense ResourceId. Every slot has its own lock, so command lists that are closed on different
+*	threads only wait for each other when they use the same resource, there is no global lock.
+*
+*	Before the barriers are submitted to the command list they are optimized: transitions which
+*	do nothing are dropped, back-to-back transitions of a subresource are folded into one and
+*	uniform per-subresource transitions are merged into a single ALL_SUBRESOURCES transition.
+*	Read states can be combined, so switching between two read states only costs a barrier once,
+*	and transitions can be split (beginTransitionResource) to give the GPU time to perform them.
+*/
 class ResourceStateTracker
 {
 public:
+	// Dense handle of a resource in the global resource state array
+	using ResourceId = uint32_t;
+
+	static const ResourceId InvalidResourceId = UINT32_MAX;
+	// The maximum number of resources which can be tracked at the same time
+	static const uint32_t MaxResources = 1 << 20;
+
+	struct OptimizerSettings
+	{
+		// Optimize the barriers before they are submitted to the command list
+		bool optimizeBarriers = true;
+		// Transition a resource in a read state to the combination of both read states when another read state is
+		// requested. Must be disabled for copy command lists, which only support the copy states.
+		bool combineReadStates = true;
+		// The number of barrier flushes after which a split transition is ended, if the resource was not used before.
+		// Split transitions are disabled when this is 0.
+		uint32_t splitBarrierWindow = 2;
+	};
+
+	// Barrier counts of all resource state trackers
+	struct BarrierStats
+	{
+		// The barriers that were requested (one for every transition, UAV or aliasing barrier call)
+		uint64_t numRequested;
+		// The barriers that were submitted to command lists
+		uint64_t numSubmitted;
+		// Transitions which were dropped because the resource was already in the state (or folded into another transition)
+		uint64_t numElided;
+		// Per-subresource transitions that were replaced by a single ALL_SUBRESOURCES transition
+		uint64_t numMerged;
+		// Transitions which were split in a BEGIN_ONLY and an END_ONLY barrier
+		uint64_t numSplit;
+	};
+
 	ResourceStateTracker();
 	~ResourceStateTracker();
 
+	void setOptimizerSettings(const OptimizerSettings& settings) { m_settings = settings; }
+
 	/*
-	* Push a resource barrier to the resource state tracker.
+	* Push a UAV or aliasing barrier to the resource state tracker.
+	* Transitions must be pushed with transitionResource.
 	* 
 	* @param barrier The resource barrier to push to the resource state tracker.
 	*/
@@ -25,12 +79,33 @@ public:
 	/*
 	* Push a transition resource barrier to the resource state tracker.
 	* 
-	* @param resource The resouce to transition.
+	* @param resource The resouce to transition, as returned by AddGlobalResourceState.
 	* @param stateAfter The state to transition the resource to.
 	* @param subResource The subresource to transition. By default this is D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES
 	* which indicates that all subresources should be transitioned to the same state.
 	*/
-	void transitionResource(ID3D12Resource* resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+	void transitionResource(ResourceId resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+	/*
+	* Start a transition that is only needed later on in the command list (split barrier).
+	* The transition ends when the resource is transitioned again (with transitionResource) or
+	* after the number of barrier flushes of the split barrier window.
+	* Falls back to a regular transition if the state of the resource in the command list is not known yet.
+	*/
+	void beginTransitionResource(ResourceId resource, D3D12_RESOURCE_STATES stateAfter, UINT subResource = D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES);
+
+	/*
+	* Use the current global state of a resource as its known state in the command list, so its transitions are
+	* recorded in place instead of being resolved when the command list is executed (e.g. after an aliasing barrier).
+	* Only valid for resources which are not used by command lists that are recorded at the same time, like
+	* the transient resources of a render graph.
+	*/
+	void acquireResourceState(ResourceId resource);
+
+	/*
+	* End all split transitions, must be done before the last flush of the command list.
+	*/
+	void endSplitTransitions();
 
 	/*
 	* Push a UAV resource barrier for the given resource.
@@ -53,6 +128,10 @@ public:
 
 	/*
 	* Flush any pending resource barriers to the command list.
+	* The barriers are resolved against the global state of the resources, which is replaced by the final
+	* state of the resources in this command list at the same time (per resource, under the lock of its slot).
+	* Command lists that use the same resources must be executed in the order in which their pending barriers
+	* were flushed, CommandQueue::executeCommandLists does this for the command lists of a queue.
 	* 
 	* @return The number of resource barriers that were flushed to the command list.
 	*/
@@ -64,9 +143,12 @@ public:
 	*/
 	void flushResourceBarriers(CommandList& commandList);
 
+	// There are (non-pending) resource barriers which have not been flushed yet
+	bool hasResourceBarriers() const { return !m_resourceBarriers.empty(); }
+
 	/*
-	* Commit final resource states to the global resource state map.
-	* This must be called when the command list is closed.
+	* Commit final resource states (which were not committed by flushPendingResourceBarriers)
+	* to the global resource state array. This must be called when the command list is closed.
 	*/
 	void commitFinalResourceStates();
 
@@ -78,42 +160,84 @@ public:
 public:
 
 	/*
-	* The global state must be locked before flushing pending resource barriers.
-	* and committing the final resource state to the global resource state.
-	* This ensures consistency of the global resource state between command list executions.
-	*/
-	static void Lock();
-
-	/*
-	* Unlocks the global resource state after the final states have been committed
-	* to the global resource state array.
+	* Add a resource with a give state to the global resource state array.
+	* This should be done when the resource is created for the first time.
+	* @return The id which refers to the resource in the resource state trackers.
 	*/
-	static void Unlock();
+	static ResourceId AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
 
 	/*
-	* Add a resource with a give state to the global resource state array (map).
-	* This should be done when the resource is created for the first time.
+	* Remove a resource from the global resource state array, its id can be reused afterwards.
+	* This should only be done when the resource is destroyed.
 	*/
-	static void AddGlobalResourceState(ID3D12Resource* resource, D3D12_RESOURCE_STATES state);
+	static void RemoveGlobalResourceState(ResourceId resource);
 
 	/*
-	* Remove a resource from the global resource state array (map).
-	* This should only be done when the resource is destroyed.
+	* Get the barrier counts since the previous call, call this once per frame.
 	*/
-	static void RemoveGlobalResourceState(ID3D12Resource* resource);
+	static BarrierStats GetAndResetBarrierStats();
 
 private:
 	// An array (vector) of resource barriers
 	using ResourceBarriers = std::vector<D3D12_RESOURCE_BARRIER>;
 
+	// The first transition of a resource in the command list, its state before is only known when the command list is executed
+	struct PendingTransition
+	{
+		ResourceId resource;
+		D3D12_RESOURCE_BARRIER barrier;
+	};
+
 	// Pending resource transitions are committed before a command list
 	// is executed on the command queue. This guarantees that resources will
 	// be in the expected state at the beginning of a command list.
-	ResourceBarriers m_pendingResourceBarriers;
+	std::vector<PendingTransition> m_pendingResourceBarriers;
 
 	// Resource barriers that need to be committed to the command list.
 	ResourceBarriers m_resourceBarriers;
 
+	/*
+	*	The states of the subresources which are not in the state of the whole resource.
+	*	Consecutive subresources in the same state are stored as a single range, sorted by subresource.
+	*	The first few ranges are stored inline, so transitioning a few mips or array slices does not allocate.
+	*/
+	class SubresourceStates
+	{
+	public:
+		struct Range
+		{
+			UINT first;
+			UINT count;
+			D3D12_RESOURCE_STATES state;
+		};
+
+		bool empty() const { return m_numRanges == 0; }
+		void clear();
+
+		void set(UINT subresource, D3D12_RESOURCE_STATES state);
+		// @return false if the state of the subresource is not stored
+		bool find(UINT subresource, D3D12_RESOURCE_STATES& state) const;
+
+		const Range* begin() const { return m_onHeap ? m_heapRanges.data() : m_inlineRanges; }
+		const Range* end() const { return begin() + m_numRanges; }
+
+	private:
+		Range* data() { return m_onHeap ? m_heapRanges.data() : m_inlineRanges; }
+
+		void insert(uint32_t index, const Range& range);
+		void erase(uint32_t index);
+		// Merge a range with the next range if they are consecutive and in the same state
+		void mergeWithNext(uint32_t index);
+
+		static const uint32_t NumInlineRanges = 4;
+
+		Range m_inlineRanges[NumInlineRanges];
+		// Holds all ranges once they do not fit inline anymore (until cleared)
+		std::vector<Range> m_heapRanges;
+		uint32_t m_numRanges = 0;
+		bool m_onHeap = false;
+	};
+
 	// Tracks the state of a particular resource and all of its subresources.
 	struct ResourceState
 	{
@@ -132,42 +256,105 @@ private:
 			}
 			else
 			{
-				subresourceStates[subresource] = state;
+				subresourceStates.set(subresource, newState);
 			}
 		}
 
 		// Get the state of a (sub)resource within the resource.
-		// If the specified subresource is not found in the subresourceStates array (map)
+		// If the specified subresource is not found in the subresourceStates ranges
 		// then the state of the resource (D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES) is returned.
 		D3D12_RESOURCE_STATES getSubresourceState(UINT subresource) const
 		{
 			D3D12_RESOURCE_STATES subresourceState = state;
-			const auto itr = subresourceStates.find(subresource);
-			if (itr != subresourceStates.end())
-			{
-				subresourceState = itr->second;
-			}
+			subresourceStates.find(subresource, subresourceState);
 			return subresourceState;
 		}
 
-		// If the subresourceStates array (map) is empty, the the state variable
+		// If the subresourceStates ranges are empty, the the state variable
 		// defines the state of all the subresources.
 		D3D12_RESOURCE_STATES state;
-		std::map<UINT, D3D12_RESOURCE_STATES> subresourceStates;
+		SubresourceStates subresourceStates;
+	};
+
+	// The known state of a resource at the end of the command list
+	struct FinalResourceState
+	{
+		ResourceState state;
+		// Set once the state has been written to the global resource state
+		bool committed = false;
 	};
 
-	using ResourceStateMap = std::unordered_map<ID3D12Resource*, ResourceState>;
+	using ResourceStateMap = std::unordered_map<ResourceId, FinalResourceState>;
 
 	// The final (last knows state) of the resourced within a command list.
 	// The final resource state is committed to the global resource state when the
 	// command list is closed but before it is executed on the command queue.
 	ResourceStateMap m_finalResourceStates;
 
-	// The global resource state array (map) stores the state of a resource
-	// between command list execution.
-	static ResourceStateMap s_globalResourceStates;
+	// A transition which has begun (BEGIN_ONLY), but not ended yet
+	struct SplitTransition
+	{
+		ResourceId resource;
+		D3D12_RESOURCE_BARRIER barrier;
+		// The number of flushes since the transition began
+		uint32_t age;
+	};
+
+	std::vector<SplitTransition> m_splitTransitions;
+
+	// End the split transitions of a (sub)resource
+	void endSplitTransitions(ResourceId resource, UINT subresource);
+	// End the split transitions of a resource before a UAV or aliasing barrier (all of them if the resource is NULL)
+	void endSplitTransitions(ID3D12Resource* resource);
+
+	// Drop, fold and merge barriers before they are submitted
+	void optimizeResourceBarriers(ResourceBarriers& resourceBarriers);
+
+	// Optimize and submit barriers to the command list
+	uint32_t submitResourceBarriers(CommandList& commandList, ResourceBarriers& resourceBarriers);
+
+	OptimizerSettings m_settings;
+	// The barrier counts of this tracker which have not been added to the global counts yet
+	BarrierStats m_stats;
+
+	// The global state of a single resource
+	struct ResourceSlot
+	{
+		// Protects the state, only held while a single resource is resolved or committed
+		void lock()
+		{
+			while (busy.test_and_set(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+		}
+		void unlock() { busy.clear(std::memory_order_release); }
+
+		std::atomic_flag busy = ATOMIC_FLAG_INIT;
+		ID3D12Resource* resource = nullptr;
+		ResourceState state;
+	};
+
+	// The slots are allocated in chunks which are never moved or freed, so they can be found without locking
+	static const uint32_t SlotsPerChunk = 1024;
+	static const uint32_t MaxChunks = MaxResources / SlotsPerChunk;
+
+	static ResourceSlot& GetResourceSlot(ResourceId resource);
+
+	// Resolve the pending transition of a resource against its global state and commit the final state, the slot must be locked
+	void resolvePendingTransition(const PendingTransition& pendingTransition, const ResourceSlot& slot, ResourceBarriers& resourceBarriers) const;
+
+	static std::atomic<ResourceSlot*> s_resourceSlotChunks[MaxChunks];
+	static std::unique_ptr<ResourceSlot[]> s_resourceSlotChunkStorage[MaxChunks];
+
+	// Protects the allocation of resource ids (and slot chunks)
+	static std::mutex s_resourceIdMutex;
+	static std::vector<ResourceId> s_freeResourceIds;
+	static uint32_t s_numResourceIds;
 
-	// The mutex protects shared acces to the globalResourceState map.
-	static std::mutex s_globalMutex;
-	static bool s_isLocked;
+	static std::atomic<uint64_t> s_numRequestedBarriers;
+	static std::atomic<uint64_t> s_numSubmittedBarriers;
+	static std::atomic<uint64_t> s_numElidedBarriers;
+	static std::atomic<uint64_t> s_numMergedBarriers;
+	static std::atomic<uint64_t> s_numSplitBarriers;
 };
\ No newline at end of file
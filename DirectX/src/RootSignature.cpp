@@ -7,6 +7,7 @@ RootSignature::RootSignature()
     , m_numDescriptorsPerTable{ 0 }
     , m_samplerTableBitMask(0)
     , m_descriptorTableBitMask(0)
+    , m_rootSignatureSize(0)
 {}
 
 RootSignature::RootSignature(
@@ -15,6 +16,7 @@ RootSignature::RootSignature(
     , m_numDescriptorsPerTable{ 0 }
     , m_samplerTableBitMask(0)
     , m_descriptorTableBitMask(0)
+    , m_rootSignatureSize(0)
 {
     setRootSignatureDesc(rootSignatureDesc, rootSignatureVersion);
 }
@@ -45,6 +47,7 @@ void RootSignature::destroy()
 
     m_descriptorTableBitMask = 0;
     m_samplerTableBitMask = 0;
+    m_rootSignatureSize = 0;
 
     memset(m_numDescriptorsPerTable, 0, sizeof(m_numDescriptorsPerTable));
 }
@@ -65,6 +68,8 @@ void RootSignature::setRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootS
         const D3D12_ROOT_PARAMETER1& rootParameter = rootSignatureDesc.pParameters[i];
         pParameters[i] = rootParameter;
 
+        m_rootSignatureSize += GetRootParameterSize(rootParameter);
+
         if (rootParameter.ParameterType == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
         {
             UINT numDescriptorRanges = rootParameter.DescriptorTable.NumDescriptorRanges;
@@ -100,6 +105,8 @@ void RootSignature::setRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootS
         }
     }
 
+    assert(m_rootSignatureSize <= MaxRootSignatureSize && "The root signature is larger than 64 DWORDs.");
+
     m_rootSignatureDesc.NumParameters = numParameters;
     m_rootSignatureDesc.pParameters = pParameters;
 
@@ -121,15 +128,8 @@ void RootSignature::setRootSignatureDesc(const D3D12_ROOT_SIGNATURE_DESC1& rootS
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC versionRootSignatureDesc;
     versionRootSignatureDesc.Init_1_1(numParameters, pParameters, numStaticSamplers, pStaticSamplers, flags);
 
-    // Serialize the root signature.
-    Microsoft::WRL::ComPtr<ID3DBlob> rootSignatureBlob;
-    Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
-    ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&versionRootSignatureDesc,
-        rootSignatureVersion, &rootSignatureBlob, &errorBlob));
-
-    // Create the root signature.
-    ThrowIfFailed(device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(),
-        rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&m_rootSignature)));
+    // Create (and serialize) the root signature.
+    m_rootSignature = device->createRootSignature(versionRootSignatureDesc, rootSignatureVersion);
 }
 
 uint32_t RootSignature::getDescriptorTableBitMask(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const
@@ -152,4 +152,67 @@ uint32_t RootSignature::getNumDescriptors(uint32_t rootIndex) const
 {
     assert(rootIndex < 32);
     return m_numDescriptorsPerTable[rootIndex];
+}
+
+D3D12_ROOT_PARAMETER_TYPE RootSignature::getRootParameterType(uint32_t rootIndex) const
+{
+    assert(rootIndex < m_rootSignatureDesc.NumParameters);
+    return m_rootSignatureDesc.pParameters[rootIndex].ParameterType;
+}
+
+uint32_t RootSignature::getNum32BitValues(uint32_t rootIndex) const
+{
+    assert(getRootParameterType(rootIndex) == D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS);
+    return m_rootSignatureDesc.pParameters[rootIndex].Constants.Num32BitValues;
+}
+
+void RootSignature::InitAsConstantBuffer(CD3DX12_ROOT_PARAMETER1& rootParameter, uint32_t sizeInBytes, uint32_t shaderRegister, uint32_t registerSpace,
+    D3D12_SHADER_VISIBILITY visibility, uint32_t& rootSignatureSize, CD3DX12_DESCRIPTOR_RANGE1& tableRange)
+{
+    uint32_t num32BitValues = (sizeInBytes + 3) / 4;
+
+    if (sizeInBytes <= MaxRootConstantsSize && rootSignatureSize + num32BitValues <= MaxRootSignatureSize)
+    {
+        rootParameter.InitAsConstants(num32BitValues, shaderRegister, registerSpace, visibility);
+    }
+    else if (rootSignatureSize + 2 <= MaxRootSignatureSize)
+    {
+        rootParameter.InitAsConstantBufferView(shaderRegister, registerSpace, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, visibility);
+    }
+    else
+    {
+        tableRange.Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, shaderRegister, registerSpace);
+        rootParameter.InitAsDescriptorTable(1, &tableRange, visibility);
+    }
+
+    rootSignatureSize += GetRootParameterSize(rootParameter);
+}
+
+uint32_t RootSignature::GetRootParameterSize(const D3D12_ROOT_PARAMETER1& rootParameter)
+{
+    switch (rootParameter.ParameterType)
+    {
+    case D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS:
+        return rootParameter.Constants.Num32BitValues;
+    case D3D12_ROOT_PARAMETER_TYPE_CBV:
+    case D3D12_ROOT_PARAMETER_TYPE_SRV:
+    case D3D12_ROOT_PARAMETER_TYPE_UAV:
+        // A GPU virtual address
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+bool RootSignature::isDescriptorHeapDirectlyIndexed(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const
+{
+    switch (descriptorHeapType)
+    {
+    case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
+        return (m_rootSignatureDesc.Flags & D3D12_ROOT_SIGNATURE_FLAG_CBV_SRV_UAV_HEAP_DIRECTLY_INDEXED) != 0;
+    case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
+        return (m_rootSignatureDesc.Flags & D3D12_ROOT_SIGNATURE_FLAG_SAMPLER_HEAP_DIRECTLY_INDEXED) != 0;
+    default:
+        return false;
+    }
 }
\ No newline at end of file
@@ -6,9 +6,35 @@
 
 #include <vector>
 
+/*
+*   Copy of a root signature description together with what the descriptor heaps and
+*   the ConstantBufferBinder need to know about its parameters.
+*
+*   A root signature can hold 64 DWORDs. Root constants cost one DWORD per 32-bit value, root
+*   descriptors two DWORDs and descriptor tables one DWORD. Data in the root signature is read by
+*   the shaders without an indirection and does not need a descriptor, so small per-draw constant
+*   buffers should be passed as root constants (or as root CBVs) instead of through a descriptor table.
+*/
 class RootSignature
 {
 public:
+    // The maximum size of a root signature in DWORDs
+    static const uint32_t MaxRootSignatureSize = 64;
+    // Constant buffers up to this size (in bytes) are passed as root constants by InitAsConstantBuffer
+    static const uint32_t MaxRootConstantsSize = 64;
+
+    /*
+    * Initialize the root parameter of a constant buffer with the cheapest binding that still fits in the root signature:
+    * root constants for buffers up to MaxRootConstantsSize, a root CBV for larger buffers and a descriptor table
+    * (using tableRange, which must stay valid until the root signature is created) when the root signature is full.
+    * @param rootSignatureSize The size (in DWORDs) of the parameters before this one, the size of the parameter is added.
+    */
+    static void InitAsConstantBuffer(CD3DX12_ROOT_PARAMETER1& rootParameter, uint32_t sizeInBytes, uint32_t shaderRegister, uint32_t registerSpace,
+        D3D12_SHADER_VISIBILITY visibility, uint32_t& rootSignatureSize, CD3DX12_DESCRIPTOR_RANGE1& tableRange);
+
+    // The size (in DWORDs) a root parameter takes in the root signature
+    static uint32_t GetRootParameterSize(const D3D12_ROOT_PARAMETER1& rootParameter);
+
     RootSignature();
     RootSignature(const D3D12_ROOT_SIGNATURE_DESC1& rootSignatureDesc, D3D_ROOT_SIGNATURE_VERSION rootSignatureVersion);
 
@@ -25,6 +51,15 @@ public:
     uint32_t getDescriptorTableBitMask(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const;
     uint32_t getNumDescriptors(uint32_t rootIndex) const;
 
+    D3D12_ROOT_PARAMETER_TYPE getRootParameterType(uint32_t rootIndex) const;
+    // The number of 32-bit values of a root constants parameter
+    uint32_t getNum32BitValues(uint32_t rootIndex) const;
+    // The size (in DWORDs) of all root parameters
+    uint32_t getRootSignatureSize() const { return m_rootSignatureSize; }
+
+    // Check if shaders index the descriptor heap of this type directly (bindless, see BindlessDescriptorHeap)
+    bool isDescriptorHeapDirectlyIndexed(D3D12_DESCRIPTOR_HEAP_TYPE descriptorHeapType) const;
+
 private:
     D3D12_ROOT_SIGNATURE_DESC1 m_rootSignatureDesc;
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_rootSignature;
@@ -40,4 +75,6 @@ private:
     // A bit mask that represents the root parameter indices that are 
     // CBV, UAV, and SRV descriptor tables.
     uint32_t m_descriptorTableBitMask;
+
+    uint32_t m_rootSignatureSize;
 };
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "dxpch.h"
+#include "SamplerCache.h"
+#include "Application.h"
+
+#include <cstring>
+
+SamplerCache::SamplerCache(uint32_t numDescriptorsPerHeap)
+	// Samplers are only created once, so the per-thread caches of the allocator are not needed
+	:	m_descriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, numDescriptorsPerHeap, false),
+		m_numCacheHits(0)
+{
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE SamplerCache::getSampler(const D3D12_SAMPLER_DESC& desc)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto itr = m_samplers.find(desc);
+	if (itr != m_samplers.end())
+	{
+		m_numCacheHits++;
+		return itr->second.getDescriptorHandle();
+	}
+
+	DescriptorAllocation allocation = m_descriptorAllocator.allocate(1);
+	Application::Get()->getDevice()->createSampler(desc, allocation.getDescriptorHandle());
+
+	m_samplers.emplace(desc, allocation);
+
+	return allocation.getDescriptorHandle();
+}
+
+uint32_t SamplerCache::getNumSamplers() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return static_cast<uint32_t>(m_samplers.size());
+}
+
+uint64_t SamplerCache::getNumCacheHits() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_numCacheHits;
+}
+
+size_t SamplerCache::SamplerDescHash::operator()(const D3D12_SAMPLER_DESC& desc) const
+{
+	// FNV-1a over the bytes of the description (it only consists of 32-bit members, so there is no padding)
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&desc);
+
+	uint64_t hash = 14695981039346656037ull;
+	for (size_t i = 0; i < sizeof(D3D12_SAMPLER_DESC); ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return static_cast<size_t>(hash);
+}
+
+bool SamplerCache::SamplerDescEqual::operator()(const D3D12_SAMPLER_DESC& lhs, const D3D12_SAMPLER_DESC& rhs) const
+{
+	return memcmp(&lhs, &rhs, sizeof(D3D12_SAMPLER_DESC)) == 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "d3dx12.h"
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+#include "DescriptorAllocation.h"
+#include "DescriptorAllocator.h"
+
+/*
+*	De-duplicates samplers: every distinct D3D12_SAMPLER_DESC gets a single CPU visible descriptor,
+*	which is shared by everyone that requests the same description.
+*
+*	The shader visible sampler heap is limited to 2048 descriptors, so materials should not create
+*	samplers of their own. The descriptors are never freed or overwritten while the cache exists,
+*	which lets the DynamicDescriptorHeap reuse the sampler tables it committed earlier
+*	(see DynamicDescriptorHeap::setRetainCommittedTables).
+*/
+class SamplerCache
+{
+public:
+	SamplerCache(uint32_t numDescriptorsPerHeap = 256);
+	virtual ~SamplerCache() = default;
+
+	/*
+	* Get the descriptor of a sampler, the sampler is created the first time the description is requested.
+	* Descriptions are compared bitwise, so they should be fully initialized (e.g. with CD3DX12 helpers or {}).
+	*/
+	D3D12_CPU_DESCRIPTOR_HANDLE getSampler(const D3D12_SAMPLER_DESC& desc);
+
+	// The number of distinct samplers that were created
+	uint32_t getNumSamplers() const;
+	// The number of getSampler calls that returned an existing sampler
+	uint64_t getNumCacheHits() const;
+
+private:
+	struct SamplerDescHash
+	{
+		size_t operator()(const D3D12_SAMPLER_DESC& desc) const;
+	};
+
+	struct SamplerDescEqual
+	{
+		bool operator()(const D3D12_SAMPLER_DESC& lhs, const D3D12_SAMPLER_DESC& rhs) const;
+	};
+
+	DescriptorAllocator m_descriptorAllocator;
+
+	std::unordered_map<D3D12_SAMPLER_DESC, DescriptorAllocation, SamplerDescHash, SamplerDescEqual> m_samplers;
+	uint64_t m_numCacheHits;
+
+	mutable std::mutex m_mutex;
+};
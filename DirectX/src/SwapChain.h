@@ -6,20 +6,39 @@
 // DirectX 12 specific headers.
 #include <d3d12.h>
 
+#include "ResourceStateTracker.h"
+
 // STL Headers
 #include <algorithm>
+#include <chrono>
+#include <memory>
 #include <vector>
 
+class Device;
+
+/*
+*	Swap chain with a render target view per back buffer.
+*	Presenting is implemented by a backend (D3D12SwapChain or NullSwapChain),
+*	created through Device::createSwapChain.
+*/
 class SwapChain
 {
 public:
-	SwapChain(Microsoft::WRL::ComPtr<ID3D12Device2> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue, 
-		uint32_t width, uint32_t height, uint32_t bufferCount, HWND windowHandle, bool tearingSupported);
-	~SwapChain() = default;
+	SwapChain(std::shared_ptr<Device> device, uint32_t bufferCount);
+	virtual ~SwapChain();
+
+	// Returns the index of the new current back buffer
+	virtual uint32_t present() = 0;
 
-	uint32_t present();
+	virtual void resize(uint32_t width, uint32_t height) = 0;
 
-	void resize(uint32_t width, uint32_t height);
+	// Limit the number of frames which are queued for presentation
+	virtual void setMaximumFrameLatency(uint32_t maxLatency) = 0;
+	/*
+	* Block until the swap chain can take another frame without exceeding the maximum frame latency,
+	* a frame should be started after this to keep the latency low. Returns false on a timeout.
+	*/
+	virtual bool waitForNextFrame(std::chrono::milliseconds timeout = std::chrono::milliseconds::max()) = 0;
 
 	bool isVSync() { return m_vSync; }
 	void setVSync(bool vSync) { m_vSync = vSync; }
@@ -28,22 +47,22 @@ public:
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> getCurrentBackBuffer() const { return m_backBuffers[m_currentBackBufferIndex]; }
 	uint32_t getCurrentBackBufferIndex() const { return m_currentBackBufferIndex; }
-	
-private:
-	void updateRenterTargetViews();
+	// Refers to the current back buffer in the resource state trackers
+	ResourceStateTracker::ResourceId getCurrentBackBufferResourceId() const { return m_backBufferResourceIds[m_currentBackBufferIndex]; }
 
-	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> createDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptors);
+protected:
+	// Create the render target views for the back buffers in m_backBuffers (and add them to the global resource states)
+	void updateRenterTargetViews();
 
-private:
-	Microsoft::WRL::ComPtr<ID3D12Device2>				m_device;
+protected:
+	std::shared_ptr<Device>								m_device;
 
-	Microsoft::WRL::ComPtr<IDXGISwapChain4>				m_swapChain;
 	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>		m_RTVDescriptorHeap;
 	UINT												m_RTVDescriptorSize;
 	uint32_t											m_bufferCount;
 	std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_backBuffers;
+	std::vector<ResourceStateTracker::ResourceId>		m_backBufferResourceIds;
 	UINT												m_currentBackBufferIndex;
 
 	bool												m_vSync = true;
-	bool												m_isTearingSupported;
 };
\ No newline at end of file
@@ -6,84 +6,119 @@
 #include "d3dx12.h"
 #include "stb_image.h"
 
-void Texture::loadTextureFromFile(std::shared_ptr<CommandQueue>& copyCommandQueue, const std::string& fileName)
+Texture::Texture()
+	:	m_resourceId(ResourceStateTracker::InvalidResourceId)
+{
+}
+
+Texture::~Texture()
+{
+	ResourceStateTracker::RemoveGlobalResourceState(m_resourceId);
+}
+
+FenceTicket Texture::loadTextureFromFile(std::shared_ptr<CommandQueue>& copyCommandQueue, const std::string& fileName)
 {
 	unsigned char* imgData = nullptr;
 	int width;
 	int height;
 	int channels;
 
-	imgData = stbi_load(fileName.c_str(), &width, &height, &channels, 0);
+	// stb loads 8 bits per channel, and there is no 8 bit format with 3 channels, so the images are loaded with 4
+	const int numChannels = 4;
+	imgData = stbi_load(fileName.c_str(), &width, &height, &channels, numChannels);
 
 	assert(imgData != nullptr && "Could not load image");
 
-	DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
-	switch (channels)
-	{
-	case 3: format = DXGI_FORMAT_R32G32B32_FLOAT; break;
-	case 4: format - DXGI_FORMAT_R32G32B32A32_FLOAT; break;
-	}
-
 	D3D12_RESOURCE_DESC textureDesc = CD3DX12_RESOURCE_DESC::Tex2D(
-		format,
+		DXGI_FORMAT_R8G8B8A8_UNORM,
 		static_cast<UINT64>(width),
 		static_cast<UINT64>(height));
 
 	auto device = Application::Get()->getDevice();
 
 	// Allocate GPU memory for the texture
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+	m_textureResource = device->createCommittedResource(
+		CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
 		D3D12_HEAP_FLAG_NONE,
-		&textureDesc,
-		D3D12_RESOURCE_STATE_COMMON,
-		nullptr,
-		IID_PPV_ARGS(&m_textureResource)
-	));
+		textureDesc,
+		D3D12_RESOURCE_STATE_COMMON
+	);
 
-	ResourceStateTracker::AddGlobalResourceState(m_textureResource.Get(), D3D12_RESOURCE_STATE_COMMON);
+	ResourceStateTracker::RemoveGlobalResourceState(m_resourceId);
+	m_resourceId = ResourceStateTracker::AddGlobalResourceState(m_textureResource.Get(), D3D12_RESOURCE_STATE_COMMON);
 
 	// Load texture data
 	D3D12_SUBRESOURCE_DATA subresource;
 	subresource.pData = imgData;
-	subresource.RowPitch = sizeof(imgData);
-	subresource.SlicePitch = subresource.RowPitch;
+	subresource.RowPitch = static_cast<LONG_PTR>(width) * numChannels;
+	subresource.SlicePitch = subresource.RowPitch * height;
 
 	auto commandList = copyCommandQueue->getCommandList();
 
 	ComPtr<ID3D12Resource> intermediateResource;
-	copyTextureSubResource(commandList.Get(), 0, 1, &subresource, intermediateResource);
+	copyTextureSubResource(*commandList, 0, 1, &subresource, intermediateResource);
 
 	//GenerateMips();
 
-	// Upload the image data to the GPU
-	copyCommandQueue->executeCommandList(commandList);
+	// Upload the image data to the GPU, the image data has been copied to the intermediate resource
+	// already, which is released by the copy queue once the copy is done
 	auto fenceValue = copyCommandQueue->executeCommandList(commandList);
-	copyCommandQueue->waitForFenceValue(fenceValue);
+	copyCommandQueue->releaseOnCompletion(fenceValue, std::make_shared<ComPtr<ID3D12Resource>>(intermediateResource));
 
 	stbi_image_free(imgData);
+
+	return copyCommandQueue->getTicket(fenceValue);
 }
 
-void Texture::copyTextureSubResource(ID3D12GraphicsCommandList1* commandList, uint32_t firstSubresource, uint32_t numSubresources, D3D12_SUBRESOURCE_DATA* subresourceData, Microsoft::WRL::ComPtr<ID3D12Resource> intermediateResource)
+void Texture::copyTextureSubResource(CommandList& commandList, uint32_t firstSubresource, uint32_t numSubresources, D3D12_SUBRESOURCE_DATA* subresourceData, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource)
 {
 	auto device = Application::Get()->getDevice();
 	
 	CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
 		m_textureResource.Get(),
 		D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST);
-	commandList->ResourceBarrier(1, &barrier);
+	commandList.resourceBarrier(1, &barrier);
 
-	UINT requiredSize = GetRequiredIntermediateSize(m_textureResource.Get(), firstSubresource, numSubresources);
+	D3D12_RESOURCE_DESC textureDesc = m_textureResource->GetDesc();
+
+	std::vector<D3D12_PLACED_SUBRESOURCE_FOOTPRINT> layouts(numSubresources);
+	std::vector<UINT> numRows(numSubresources);
+	std::vector<UINT64> rowSizesInBytes(numSubresources);
+	UINT64 requiredSize = 0;
+	device->getCopyableFootprints(textureDesc, firstSubresource, numSubresources, 0,
+		layouts.data(), numRows.data(), rowSizesInBytes.data(), &requiredSize);
 
 	// Create a temporary (intermediate) resource for uploading the subresources
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+	intermediateResource = device->createCommittedResource(
+		CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
 		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(requiredSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&intermediateResource)
-	));
+		CD3DX12_RESOURCE_DESC::Buffer(requiredSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ
+	);
+
+	uint8_t* mappedData = nullptr;
+	ThrowIfFailed(intermediateResource->Map(0, nullptr, reinterpret_cast<void**>(&mappedData)));
+
+	for (uint32_t i = 0; i < numSubresources; ++i)
+	{
+		// Copy the subresource row by row, the rows in the intermediate resource are aligned to the row pitch.
+		// Nothing is read past a row of the source data, even if its pitch is smaller than a row of the texture
+		const D3D12_PLACED_SUBRESOURCE_FOOTPRINT& layout = layouts[i];
+		size_t rowSize = static_cast<size_t>(std::min(static_cast<UINT64>(subresourceData[i].RowPitch), rowSizesInBytes[i]));
+		for (UINT z = 0; z < layout.Footprint.Depth; ++z)
+		{
+			for (UINT y = 0; y < numRows[i]; ++y)
+			{
+				memcpy(mappedData + layout.Offset + (z * numRows[i] + y) * static_cast<UINT64>(layout.Footprint.RowPitch),
+					static_cast<const uint8_t*>(subresourceData[i].pData) + z * subresourceData[i].SlicePitch + y * subresourceData[i].RowPitch,
+					rowSize);
+			}
+		}
+
+		CD3DX12_TEXTURE_COPY_LOCATION dst(m_textureResource.Get(), firstSubresource + i);
+		CD3DX12_TEXTURE_COPY_LOCATION src(intermediateResource.Get(), layout);
+		commandList.copyTextureRegion(dst, 0, 0, 0, src);
+	}
 
-	UpdateSubresources(commandList, m_textureResource.Get(), intermediateResource.Get(), 0, firstSubresource, numSubresources, subresourceData);
+	intermediateResource->Unmap(0, nullptr);
 }
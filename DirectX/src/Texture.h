@@ -1,6 +1,8 @@
 #pragma once
 
+#include "CommandList.h"
 #include "CommandQueue.h"
+#include "ResourceStateTracker.h"
 
 #include "d3dx12.h"
 #include <wrl.h>
@@ -13,11 +15,17 @@ public:
 	Texture();
 	virtual ~Texture();
 
-	void loadTextureFromFile(std::shared_ptr<CommandQueue>& copyCommandQueue, const std::string& fileName);
+	/*
+	* Load the image and upload it on the copy queue, without waiting for it.
+	* Returns the ticket a queue has to wait for (waitForTicket) before the texture is used.
+	*/
+	FenceTicket loadTextureFromFile(std::shared_ptr<CommandQueue>& copyCommandQueue, const std::string& fileName);
 
 private:
-	void copyTextureSubResource(ID3D12GraphicsCommandList1* commandList, uint32_t firstSubresource, uint32_t numSubresources, 
-		D3D12_SUBRESOURCE_DATA* subresourceData, Microsoft::WRL::ComPtr<ID3D12Resource> intermediateResource);
+	void copyTextureSubResource(CommandList& commandList, uint32_t firstSubresource, uint32_t numSubresources, 
+		D3D12_SUBRESOURCE_DATA* subresourceData, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource);
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> m_textureResource;
+	// Refers to the texture in the resource state trackers
+	ResourceStateTracker::ResourceId m_resourceId;
 };
\ No newline at end of file
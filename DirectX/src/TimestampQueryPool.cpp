@@ -0,0 +1,225 @@
+#include "dxpch.h"
+#include "TimestampQueryPool.h"
+#include "Application.h"
+#include "CommandList.h"
+#include "CommandQueue.h"
+#include "Profiler.h"
+
+#include <mutex>
+#include <unordered_set>
+
+namespace
+{
+	// The profiler keeps the names of the zones, so the names of the GPU zones (e.g. pass names,
+	// which are rebuilt every frame) are kept until the program exits
+	const char* InternName(const std::string& name)
+	{
+		static std::mutex mutex;
+		static std::unordered_set<std::string> names;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		return names.insert(name).first->c_str();
+	}
+
+	const char* GetQueueName(D3D12_COMMAND_LIST_TYPE type)
+	{
+		switch (type)
+		{
+		case D3D12_COMMAND_LIST_TYPE_COMPUTE:
+			return "GPU Compute";
+		case D3D12_COMMAND_LIST_TYPE_COPY:
+			return "GPU Copy";
+		default:
+			return "GPU Direct";
+		}
+	}
+}
+
+TimestampQueryPool::TimestampQueryPool(std::shared_ptr<CommandQueue> commandQueue, uint32_t numFrameSlots, uint32_t maxZonesPerFrame)
+	:	m_commandQueue(commandQueue),
+		m_numFrameSlots(std::max(1u, numFrameSlots)),
+		m_maxZonesPerFrame(std::max(1u, maxZonesPerFrame)),
+		m_frameSlot(InvalidFrameSlot),
+		m_nextFrameSlot(0),
+		m_depth(0),
+		m_resolved(false),
+		m_numSkippedFrames(0),
+		m_numDroppedZones(0)
+{
+	assert(m_commandQueue != nullptr && m_commandQueue->getTimestampFrequency() > 0 && "The queue has no timestamps.");
+
+	auto device = Application::Get()->getDevice();
+
+	m_readback = std::make_shared<Readback>();
+	m_readback->queueName = GetQueueName(m_commandQueue->getType());
+	m_readback->timestampFrequency = m_commandQueue->getTimestampFrequency();
+	m_readback->numQueriesPerFrame = 2 * m_maxZonesPerFrame;
+	m_readback->frameSlots = std::make_unique<FrameSlot[]>(m_numFrameSlots);
+
+	// Copy queues have their own kind of timestamp heap
+	D3D12_QUERY_HEAP_DESC queryHeapDesc = {};
+	queryHeapDesc.Type = m_commandQueue->getType() == D3D12_COMMAND_LIST_TYPE_COPY ? D3D12_QUERY_HEAP_TYPE_COPY_QUEUE_TIMESTAMP : D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+	queryHeapDesc.Count = m_numFrameSlots * m_readback->numQueriesPerFrame;
+	m_readback->queryHeap = device->createQueryHeap(queryHeapDesc);
+
+	m_readback->buffer = device->createCommittedResource(CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_READBACK), D3D12_HEAP_FLAG_NONE,
+		CD3DX12_RESOURCE_DESC::Buffer(queryHeapDesc.Count * sizeof(uint64_t)), D3D12_RESOURCE_STATE_COPY_DEST);
+}
+
+void TimestampQueryPool::beginFrame()
+{
+	assert(m_frameSlot == InvalidFrameSlot && "The previous frame has not ended.");
+
+	uint32_t frameSlot = m_nextFrameSlot;
+	m_nextFrameSlot = (m_nextFrameSlot + 1) % m_numFrameSlots;
+
+	// The retire thread is still reading the timestamps this slot had a few frames ago
+	FrameSlot& slot = m_readback->frameSlots[frameSlot];
+	if (slot.pending.load(std::memory_order_acquire))
+	{
+		m_numSkippedFrames++;
+		return;
+	}
+
+	slot.zones.clear();
+	m_frameSlot = frameSlot;
+	m_depth = 0;
+	m_resolved = false;
+}
+
+bool TimestampQueryPool::hasZones() const
+{
+	return isMeasuring() && !m_readback->frameSlots[m_frameSlot].zones.empty();
+}
+
+TimestampQueryPool::ZoneId TimestampQueryPool::beginZone(CommandList& commandList, const std::string& name)
+{
+	if (!isMeasuring())
+	{
+		return InvalidZoneId;
+	}
+
+	assert(!m_resolved && "The frame has been resolved.");
+
+	FrameSlot& slot = m_readback->frameSlots[m_frameSlot];
+	if (slot.zones.size() >= m_maxZonesPerFrame)
+	{
+		m_numDroppedZones++;
+		return InvalidZoneId;
+	}
+
+	ZoneId zone = static_cast<ZoneId>(slot.zones.size());
+	slot.zones.push_back({ InternName(name), m_depth++, false });
+
+	commandList.endQuery(m_readback->queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, getQueryIndex(zone, false));
+
+	return zone;
+}
+
+void TimestampQueryPool::endZone(CommandList& commandList, ZoneId zone)
+{
+	if (zone == InvalidZoneId || !isMeasuring())
+	{
+		return;
+	}
+
+	Zone& slotZone = m_readback->frameSlots[m_frameSlot].zones[zone];
+	assert(!slotZone.ended && "The zone has already ended.");
+
+	slotZone.ended = true;
+	m_depth--;
+
+	commandList.endQuery(m_readback->queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, getQueryIndex(zone, true));
+}
+
+void TimestampQueryPool::resolve(CommandList& commandList)
+{
+	if (!hasZones())
+	{
+		return;
+	}
+
+	assert(!m_resolved && "The frame has already been resolved.");
+
+	FrameSlot& slot = m_readback->frameSlots[m_frameSlot];
+
+	// Queries which were never written must not be resolved
+	for (ZoneId zone = 0; zone < slot.zones.size(); ++zone)
+	{
+		if (!slot.zones[zone].ended)
+		{
+			endZone(commandList, zone);
+		}
+	}
+
+	uint32_t firstQuery = getQueryIndex(0, false);
+	commandList.resolveQueryData(m_readback->queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, firstQuery, static_cast<uint32_t>(2 * slot.zones.size()),
+		m_readback->buffer.Get(), firstQuery * sizeof(uint64_t));
+
+	m_commandQueue->getClockCalibration(slot.gpuTimestamp, slot.cpuTime);
+	m_resolved = true;
+}
+
+void TimestampQueryPool::endFrame(uint64_t fenceValue)
+{
+	if (!isMeasuring())
+	{
+		return;
+	}
+
+	uint32_t frameSlot = m_frameSlot;
+	m_frameSlot = InvalidFrameSlot;
+
+	if (!m_resolved || fenceValue == 0)
+	{
+		return;
+	}
+
+	m_readback->frameSlots[frameSlot].pending.store(true, std::memory_order_relaxed);
+
+	std::shared_ptr<Readback> readback = m_readback;
+	m_commandQueue->addCompletionCallback(fenceValue, [readback, frameSlot]()
+	{
+		ReadBack(*readback, frameSlot);
+	});
+}
+
+void TimestampQueryPool::ReadBack(Readback& readback, uint32_t frameSlot)
+{
+	FrameSlot& slot = readback.frameSlots[frameSlot];
+
+	size_t firstQuery = static_cast<size_t>(frameSlot) * readback.numQueriesPerFrame;
+	size_t numQueries = 2 * slot.zones.size();
+
+	D3D12_RANGE readRange = { firstQuery * sizeof(uint64_t), (firstQuery + numQueries) * sizeof(uint64_t) };
+	uint64_t* timestamps;
+	ThrowIfFailed(readback.buffer->Map(0, &readRange, reinterpret_cast<void**>(&timestamps)));
+	timestamps += firstQuery;
+
+	// The timestamps relative to the calibration, in nanoseconds of the profiler clock
+	double nanosecondsPerTick = 1e9 / readback.timestampFrequency;
+	auto getCpuTime = [&slot, nanosecondsPerTick](uint64_t timestamp)
+	{
+		int64_t ticks = static_cast<int64_t>(timestamp - slot.gpuTimestamp);
+		return slot.cpuTime + static_cast<int64_t>(ticks * nanosecondsPerTick);
+	};
+
+	uint64_t frameBeginTime = UINT64_MAX;
+	uint64_t frameEndTime = 0;
+	for (size_t i = 0; i < slot.zones.size(); ++i)
+	{
+		uint64_t beginTime = getCpuTime(timestamps[2 * i]);
+		uint64_t endTime = std::max(beginTime, getCpuTime(timestamps[2 * i + 1]));
+
+		Profiler::RecordGpuZone(readback.queueName, slot.zones[i].name, beginTime, endTime, slot.zones[i].depth + 1);
+
+		frameBeginTime = std::min(frameBeginTime, beginTime);
+		frameEndTime = std::max(frameEndTime, endTime);
+	}
+	Profiler::RecordGpuZone(readback.queueName, readback.queueName, frameBeginTime, frameEndTime, 0);
+
+	D3D12_RANGE writtenRange = { 0, 0 };
+	readback.buffer->Unmap(0, &writtenRange);
+
+	slot.pending.store(false, std::memory_order_release);
+}
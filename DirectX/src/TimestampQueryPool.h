@@ -0,0 +1,119 @@
+#pragma once
+
+#include "d3dx12.h"
+
+#include <wrl.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class CommandList;
+class CommandQueue;
+
+/*
+*	Measures the GPU time of zones of the work on a command queue (e.g. the passes of the render graph) with
+*	timestamp queries. A zone writes a timestamp before and after its commands. Every frame uses a slot of a
+*	ring of query ranges and readback memory: at the end of the frame the timestamps are resolved into the
+*	readback memory of the slot, and once the queue has finished the frame its retire thread converts them
+*	to CPU time and records the zones in the Profiler. The zones of a queue are nested in a zone named after
+*	the queue (e.g. "GPU Direct"), so they are in the report and the trace next to the CPU zones. The GPU zones
+*	are counted in the frame the profiler collects them in, which is a few frames after the one they measure.
+*
+*	Nothing waits for the GPU: a frame whose slot is still being read back is not measured.
+*
+*	The pool is used by the thread which records the frames of the queue. A zone must begin and end on command
+*	lists which are executed on the queue in the same frame, before the command list of resolve.
+*/
+class TimestampQueryPool
+{
+public:
+	using ZoneId = uint32_t;
+
+	static const ZoneId InvalidZoneId = UINT32_MAX;
+
+	/*
+	* @param commandQueue A queue with timestamps (getTimestampFrequency is not 0).
+	* @param numFrameSlots The number of frames which can be read back at the same time, more than the frames in flight.
+	* @param maxZonesPerFrame The zones of a frame after this many are not measured.
+	*/
+	TimestampQueryPool(std::shared_ptr<CommandQueue> commandQueue, uint32_t numFrameSlots = 4, uint32_t maxZonesPerFrame = 256);
+	virtual ~TimestampQueryPool() = default;
+
+	void beginFrame();
+	// Whether the zones of the current frame are measured, false when its slot is still being read back
+	bool isMeasuring() const { return m_frameSlot != InvalidFrameSlot; }
+	bool hasZones() const;
+
+	// Write the begin timestamp of a zone, zones which begin before the zone ends are nested in it
+	ZoneId beginZone(CommandList& commandList, const std::string& name);
+	void endZone(CommandList& commandList, ZoneId zone);
+
+	// Copy the timestamps of the frame to the readback memory, zones which have not ended yet end here
+	void resolve(CommandList& commandList);
+	/*
+	* Read the timestamps back once the queue has finished the frame.
+	*
+	* @param fenceValue The fence value of the command list of resolve.
+	*/
+	void endFrame(uint64_t fenceValue);
+
+	uint64_t getNumSkippedFrames() const { return m_numSkippedFrames; }
+	uint64_t getNumDroppedZones() const { return m_numDroppedZones; }
+
+private:
+	static const uint32_t InvalidFrameSlot = UINT32_MAX;
+
+	struct Zone
+	{
+		const char* name;
+		uint32_t depth;
+		bool ended;
+	};
+
+	// Zone i of a frame uses the queries 2 * i (begin) and 2 * i + 1 (end) of the range of its slot
+	struct FrameSlot
+	{
+		std::vector<Zone> zones;
+		// Sampled at resolve, to convert the timestamps to CPU time
+		uint64_t gpuTimestamp = 0;
+		uint64_t cpuTime = 0;
+		// Set while the slot is being read back, cleared by the retire thread
+		std::atomic<bool> pending{ false };
+	};
+
+	// Shared with the completion callbacks, so they do not depend on the lifetime of the pool
+	struct Readback
+	{
+		const char* queueName;
+		uint64_t timestampFrequency;
+		uint32_t numQueriesPerFrame;
+
+		Microsoft::WRL::ComPtr<ID3D12QueryHeap> queryHeap;
+		Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+		std::unique_ptr<FrameSlot[]> frameSlots;
+	};
+
+	// Record the zones of a slot in the profiler, called on the retire thread
+	static void ReadBack(Readback& readback, uint32_t frameSlot);
+
+	uint32_t getQueryIndex(ZoneId zone, bool end) const { return m_frameSlot * m_readback->numQueriesPerFrame + 2 * zone + (end ? 1 : 0); }
+
+	std::shared_ptr<CommandQueue> m_commandQueue;
+	std::shared_ptr<Readback> m_readback;
+
+	uint32_t m_numFrameSlots;
+	uint32_t m_maxZonesPerFrame;
+
+	// The slot of the current frame (InvalidFrameSlot when it is not measured), and of the next frame
+	uint32_t m_frameSlot;
+	uint32_t m_nextFrameSlot;
+	// The number of zones the next zone is nested in
+	uint32_t m_depth;
+	bool m_resolved;
+
+	uint64_t m_numSkippedFrames;
+	uint64_t m_numDroppedZones;
+};
@@ -0,0 +1,309 @@
+#include "dxpch.h"
+#include "TransientResourceAllocator.h"
+#include "Application.h"
+
+#include <numeric>
+
+namespace
+{
+	bool LifetimesOverlap(const TransientResourceAllocator::ResourceRequest& a, const TransientResourceAllocator::ResourceRequest& b)
+	{
+		if (a.queue != b.queue || a.queue == TransientResourceAllocator::MultipleQueues)
+		{
+			return true;
+		}
+
+		return a.firstUse <= b.lastUse && b.firstUse <= a.lastUse;
+	}
+
+	// The descriptions have padding, so they are compared member by member
+	bool IsSameDesc(const D3D12_RESOURCE_DESC& a, const D3D12_RESOURCE_DESC& b)
+	{
+		return a.Dimension == b.Dimension && a.Alignment == b.Alignment && a.Width == b.Width && a.Height == b.Height &&
+			a.DepthOrArraySize == b.DepthOrArraySize && a.MipLevels == b.MipLevels && a.Format == b.Format &&
+			a.SampleDesc.Count == b.SampleDesc.Count && a.SampleDesc.Quality == b.SampleDesc.Quality && a.Layout == b.Layout && a.Flags == b.Flags;
+	}
+}
+
+TransientResourceAllocator::TransientResourceAllocator()
+	:	m_heapMemorySize(0),
+		m_resourceMemorySize(0),
+		m_peakMemorySaved(0)
+{
+}
+
+TransientResourceAllocator::~TransientResourceAllocator()
+{
+	for (CachedResource& cachedResource : m_cachedResources)
+	{
+		ResourceStateTracker::RemoveGlobalResourceState(cachedResource.resourceId);
+	}
+}
+
+bool TransientResourceAllocator::allocate(const ResourceRequest* requests, uint32_t numRequests, PlacedResource* placedResources)
+{
+	auto device = Application::Get()->getDevice();
+
+	struct Placement
+	{
+		HeapCategory category;
+		uint64_t offset;
+		uint64_t size;
+		uint64_t alignment;
+	};
+
+	std::vector<Placement> placements(numRequests);
+
+	m_resourceMemorySize = 0;
+	for (uint32_t i = 0; i < numRequests; ++i)
+	{
+		D3D12_RESOURCE_ALLOCATION_INFO allocationInfo = device->getResourceAllocationInfo(requests[i].desc);
+		placements[i] = { GetHeapCategory(requests[i].desc), 0, allocationInfo.SizeInBytes, allocationInfo.Alignment };
+
+		m_resourceMemorySize += allocationInfo.SizeInBytes;
+	}
+
+	// Place the largest resources first, they are the hardest to fit in between the others
+	std::vector<uint32_t> order(numRequests);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&placements](uint32_t a, uint32_t b)
+	{
+		return placements[a].size > placements[b].size;
+	});
+
+	uint64_t requiredHeapSizes[NumHeapCategories] = {};
+
+	std::vector<uint32_t> placed;
+	std::vector<uint32_t> alive;
+	for (uint32_t i : order)
+	{
+		Placement& placement = placements[i];
+
+		// The placed resources that are alive at the same time, sorted by their offset
+		alive.clear();
+		for (uint32_t j : placed)
+		{
+			if (placements[j].category == placement.category && LifetimesOverlap(requests[i], requests[j]))
+			{
+				alive.push_back(j);
+			}
+		}
+		std::sort(alive.begin(), alive.end(), [&placements](uint32_t a, uint32_t b)
+		{
+			return placements[a].offset < placements[b].offset;
+		});
+
+		// Take the first gap that is large enough
+		uint64_t offset = 0;
+		for (uint32_t j : alive)
+		{
+			if (offset + placement.size <= placements[j].offset)
+			{
+				break;
+			}
+			offset = std::max(offset, Math::AlignUp(placements[j].offset + placements[j].size, placement.alignment));
+		}
+
+		placement.offset = offset;
+		requiredHeapSizes[placement.category] = std::max(requiredHeapSizes[placement.category], offset + placement.size);
+
+		placed.push_back(i);
+	}
+
+	// Grow the heaps which are too small, the resources in the old heaps cannot be reused
+	bool newHeaps[NumHeapCategories] = {};
+
+	m_heapMemorySize = 0;
+	for (uint32_t category = 0; category < NumHeapCategories; ++category)
+	{
+		Heap& heap = m_heaps[category];
+		m_heapMemorySize += requiredHeapSizes[category];
+
+		if (requiredHeapSizes[category] <= heap.size)
+		{
+			continue;
+		}
+
+		for (CachedResource& cachedResource : m_cachedResources)
+		{
+			if (cachedResource.category == category)
+			{
+				retireResource(cachedResource);
+			}
+		}
+
+		if (heap.heap != nullptr)
+		{
+			m_staleObjects.push({ heap.heap, Application::Get()->getFrameCount() });
+		}
+
+		D3D12_HEAP_DESC heapDesc{};
+		heapDesc.SizeInBytes = Math::AlignUp(requiredHeapSizes[category], static_cast<uint64_t>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT));
+		heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+
+		switch (category)
+		{
+		case BufferHeap:
+			heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+			break;
+		case TextureHeap:
+			heapDesc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+			heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+			break;
+		default:
+			// Multi-sampled render targets need a larger alignment
+			heapDesc.Alignment = D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT;
+			heapDesc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+			break;
+		}
+
+		heap.heap = device->createHeap(heapDesc);
+		heap.size = heapDesc.SizeInBytes;
+		newHeaps[category] = true;
+	}
+
+	// The alignment of the offsets can make the heaps larger than the resources
+	if (m_resourceMemorySize > m_heapMemorySize)
+	{
+		m_peakMemorySaved = std::max(m_peakMemorySaved, m_resourceMemorySize - m_heapMemorySize);
+	}
+
+	m_cachedResources.erase(std::remove_if(m_cachedResources.begin(), m_cachedResources.end(), [](const CachedResource& cachedResource)
+	{
+		return cachedResource.resource == nullptr;
+	}), m_cachedResources.end());
+
+	for (CachedResource& cachedResource : m_cachedResources)
+	{
+		cachedResource.used = false;
+	}
+
+	// Reuse the resources of the previous frame which are placed at the same offset
+	bool memoryReused = false;
+	for (uint32_t i = 0; i < numRequests; ++i)
+	{
+		const ResourceRequest& request = requests[i];
+		const Placement& placement = placements[i];
+
+		size_t index = 0;
+		while (index < m_cachedResources.size())
+		{
+			const CachedResource& cachedResource = m_cachedResources[index];
+			if (!cachedResource.used && cachedResource.category == placement.category && cachedResource.heapOffset == placement.offset &&
+				IsSameResource(cachedResource, request))
+			{
+				break;
+			}
+			++index;
+		}
+
+		if (index == m_cachedResources.size())
+		{
+			CachedResource cachedResource;
+			cachedResource.desc = request.desc;
+			cachedResource.clearValue = request.clearValue;
+			cachedResource.hasClearValue = request.hasClearValue;
+			cachedResource.category = placement.category;
+			cachedResource.heapOffset = placement.offset;
+			cachedResource.resource = device->createPlacedResource(m_heaps[placement.category].heap.Get(), placement.offset, request.desc,
+				D3D12_RESOURCE_STATE_COMMON, request.hasClearValue ? &request.clearValue : nullptr);
+			cachedResource.resourceId = ResourceStateTracker::AddGlobalResourceState(cachedResource.resource.Get(), D3D12_RESOURCE_STATE_COMMON);
+
+			m_cachedResources.push_back(cachedResource);
+
+			memoryReused = memoryReused || !newHeaps[placement.category];
+		}
+
+		CachedResource& cachedResource = m_cachedResources[index];
+		cachedResource.used = true;
+
+		placedResources[i].resource = cachedResource.resource.Get();
+		placedResources[i].resourceId = cachedResource.resourceId;
+		placedResources[i].aliased = false;
+	}
+
+	// The resources of the previous frame that are not reused
+	for (CachedResource& cachedResource : m_cachedResources)
+	{
+		if (!cachedResource.used)
+		{
+			retireResource(cachedResource);
+		}
+	}
+
+	m_cachedResources.erase(std::remove_if(m_cachedResources.begin(), m_cachedResources.end(), [](const CachedResource& cachedResource)
+	{
+		return cachedResource.resource == nullptr;
+	}), m_cachedResources.end());
+
+	for (uint32_t i = 0; i < numRequests; ++i)
+	{
+		for (uint32_t j = i + 1; j < numRequests; ++j)
+		{
+			const Placement& a = placements[i];
+			const Placement& b = placements[j];
+			if (a.category == b.category && a.offset < b.offset + b.size && b.offset < a.offset + a.size)
+			{
+				placedResources[i].aliased = true;
+				placedResources[j].aliased = true;
+			}
+		}
+	}
+
+	return memoryReused;
+}
+
+void TransientResourceAllocator::releaseStaleResources(uint64_t frameNumber)
+{
+	while (!m_staleObjects.empty() && m_staleObjects.front().frameNumber <= frameNumber)
+	{
+		m_staleObjects.pop();
+	}
+}
+
+void TransientResourceAllocator::retireResource(CachedResource& cachedResource)
+{
+	ResourceStateTracker::RemoveGlobalResourceState(cachedResource.resourceId);
+	cachedResource.resourceId = ResourceStateTracker::InvalidResourceId;
+
+	m_staleObjects.push({ cachedResource.resource, Application::Get()->getFrameCount() });
+	cachedResource.resource.Reset();
+}
+
+TransientResourceAllocator::HeapCategory TransientResourceAllocator::GetHeapCategory(const D3D12_RESOURCE_DESC& desc)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		return BufferHeap;
+	}
+
+	if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+	{
+		return RenderTargetHeap;
+	}
+
+	return TextureHeap;
+}
+
+bool TransientResourceAllocator::IsSameResource(const CachedResource& cachedResource, const ResourceRequest& request)
+{
+	if (!IsSameDesc(cachedResource.desc, request.desc) || cachedResource.hasClearValue != request.hasClearValue)
+	{
+		return false;
+	}
+
+	if (!request.hasClearValue)
+	{
+		return true;
+	}
+
+	const D3D12_CLEAR_VALUE& a = cachedResource.clearValue;
+	const D3D12_CLEAR_VALUE& b = request.clearValue;
+	if (request.desc.Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+	{
+		return a.Format == b.Format && a.DepthStencil.Depth == b.DepthStencil.Depth && a.DepthStencil.Stencil == b.DepthStencil.Stencil;
+	}
+
+	return a.Format == b.Format && memcmp(a.Color, b.Color, sizeof(a.Color)) == 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "ResourceStateTracker.h"
+
+#include "d3dx12.h"
+
+#include <wrl.h>
+
+#include <cstdint>
+#include <queue>
+#include <vector>
+
+/*
+*	Places the resources which are only used during part of a frame (transient resources) in shared heaps.
+*	Resources whose lifetimes do not overlap are placed in the same memory. The placed resources are kept,
+*	so the next frame reuses them when it requests the same resources at the same place.
+*
+*	Resource heap tier 1 does not allow buffers, render target or depth stencil textures and other textures
+*	in the same heap, so they are placed in separate heaps. The heaps only grow.
+*
+*	The contents of a resource are undefined at its first use. When it shares memory with other resources
+*	an aliasing barrier must be recorded before it is used, and render target and depth stencil textures
+*	must be cleared (or discarded) first.
+*/
+class TransientResourceAllocator
+{
+public:
+	// The resources used on different queues never share memory, as the queues run at the same time
+	static const uint32_t MultipleQueues = UINT32_MAX;
+
+	struct ResourceRequest
+	{
+		D3D12_RESOURCE_DESC desc;
+		// Only used for render target and depth stencil textures
+		D3D12_CLEAR_VALUE clearValue;
+		bool hasClearValue;
+
+		// The queue the resource is used on (in any numbering) or MultipleQueues
+		uint32_t queue;
+		// The first and last use of the resource, in the order in which the work is executed on the queue
+		uint32_t firstUse;
+		uint32_t lastUse;
+	};
+
+	struct PlacedResource
+	{
+		ID3D12Resource* resource;
+		ResourceStateTracker::ResourceId resourceId;
+		// Shares memory with other resources, an aliasing barrier is needed before its first use
+		bool aliased;
+	};
+
+	TransientResourceAllocator();
+	virtual ~TransientResourceAllocator();
+
+	/*
+	* Place the transient resources of a frame, replacing the resources of the previous frame.
+	* The resources which are not reused become stale.
+	*
+	* @param placedResources Receives the placed resource of every request, valid until the next allocate.
+	* @return True if memory of the previous frame is now used by other resources. The GPU must then have
+	* finished the previous frame on all queues before the resources are used.
+	*/
+	bool allocate(const ResourceRequest* requests, uint32_t numRequests, PlacedResource* placedResources);
+
+	/*
+	* Release the resources (and heaps) that became stale in this frame (or before), once the frame has completed.
+	*/
+	void releaseStaleResources(uint64_t frameNumber);
+
+	// The memory of the heaps used by the last allocate
+	uint64_t getHeapMemorySize() const { return m_heapMemorySize; }
+	// The memory the resources of the last allocate would need if they did not share memory
+	uint64_t getResourceMemorySize() const { return m_resourceMemorySize; }
+	// The memory sharing memory saved in the last allocate
+	uint64_t getMemorySaved() const { return m_resourceMemorySize > m_heapMemorySize ? m_resourceMemorySize - m_heapMemorySize : 0; }
+	// The most memory sharing memory has saved in a frame so far
+	uint64_t getPeakMemorySaved() const { return m_peakMemorySaved; }
+
+private:
+	enum HeapCategory
+	{
+		BufferHeap,
+		TextureHeap,
+		RenderTargetHeap,
+		NumHeapCategories
+	};
+
+	struct Heap
+	{
+		Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+		uint64_t size = 0;
+	};
+
+	// A resource placed in one of the heaps, kept between frames
+	struct CachedResource
+	{
+		D3D12_RESOURCE_DESC desc;
+		D3D12_CLEAR_VALUE clearValue;
+		bool hasClearValue;
+
+		HeapCategory category;
+		uint64_t heapOffset;
+
+		Microsoft::WRL::ComPtr<ID3D12Resource> resource;
+		ResourceStateTracker::ResourceId resourceId;
+		// Used by the current frame
+		bool used;
+	};
+
+	struct StaleObject
+	{
+		Microsoft::WRL::ComPtr<ID3D12Pageable> object;
+		uint64_t frameNumber;
+	};
+
+	static HeapCategory GetHeapCategory(const D3D12_RESOURCE_DESC& desc);
+	static bool IsSameResource(const CachedResource& cachedResource, const ResourceRequest& request);
+
+	// Keep a resource alive until the current frame has completed
+	void retireResource(CachedResource& cachedResource);
+
+	Heap m_heaps[NumHeapCategories];
+	std::vector<CachedResource> m_cachedResources;
+
+	std::queue<StaleObject> m_staleObjects;
+
+	uint64_t m_heapMemorySize;
+	uint64_t m_resourceMemorySize;
+	uint64_t m_peakMemorySaved;
+};
@@ -1,19 +1,50 @@
 #include "dxpch.h"
 #include "UploadBuffer.h"
 #include "Application.h"
+#include "CommandQueue.h"
 
 #include <new>
 
 UploadBuffer::UploadBuffer(size_t pageSize)
-	:	m_pageSize(pageSize)
+	:	m_pageSize(pageSize),
+		m_numLargePages(0),
+		m_pageHighWaterMark(0),
+		m_numResetsSinceTrim(0),
+		m_numBytesAllocated(0),
+		m_numBytesWasted(0),
+		m_ringHead(0),
+		m_ringTail(0),
+		m_ringSubmitted(0)
 {
 }
 
+UploadBuffer::UploadBuffer(std::shared_ptr<CommandQueue> commandQueue, size_t ringSize)
+	:	m_pageSize(Math::AlignUp(ringSize, static_cast<size_t>(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))),
+		m_numLargePages(0),
+		m_pageHighWaterMark(0),
+		m_numResetsSinceTrim(0),
+		m_numBytesAllocated(0),
+		m_numBytesWasted(0),
+		m_commandQueue(commandQueue),
+		m_ringHead(0),
+		m_ringTail(0),
+		m_ringSubmitted(0)
+{
+	assert(m_commandQueue != nullptr);
+
+	m_ring = std::make_shared<Page>(m_pageSize);
+}
+
 UploadBuffer::Allocation UploadBuffer::allocate(size_t sizeInBytes, size_t alignment)
 {
-	if (sizeInBytes > m_pageSize)
+	if (isRing())
 	{
-		throw std::bad_alloc();
+		return allocateFromRing(sizeInBytes, alignment);
+	}
+
+	if (Math::AlignUp(sizeInBytes, alignment) > m_pageSize)
+	{
+		return allocateLargePage(sizeInBytes, alignment);
 	}
 
 	// If there is no current page, or the requested allocation exceeds
@@ -23,7 +54,30 @@ UploadBuffer::Allocation UploadBuffer::allocate(size_t sizeInBytes, size_t align
 		m_currentPage = requestPage();
 	}
 
-	return m_currentPage->allocate(sizeInBytes, alignment);
+	size_t offset = m_currentPage->getOffset();
+	Allocation allocation = m_currentPage->allocate(sizeInBytes, alignment);
+
+	m_numBytesAllocated += sizeInBytes;
+	m_numBytesWasted += m_currentPage->getOffset() - offset - sizeInBytes;
+
+	return allocation;
+}
+
+UploadBuffer::Allocation UploadBuffer::allocateLargePage(size_t sizeInBytes, size_t alignment)
+{
+	// Pages start at a placement aligned address
+	assert(alignment <= D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	size_t alignedSize = Math::AlignUp(sizeInBytes, alignment);
+
+	std::shared_ptr<Page> page = std::make_shared<Page>(alignedSize);
+	m_largePages.push_back(page);
+	m_numLargePages++;
+
+	m_numBytesAllocated += sizeInBytes;
+	m_numBytesWasted += alignedSize - sizeInBytes;
+
+	return page->allocate(sizeInBytes, alignment);
 }
 
 std::shared_ptr<UploadBuffer::Page> UploadBuffer::requestPage()
@@ -44,8 +98,111 @@ std::shared_ptr<UploadBuffer::Page> UploadBuffer::requestPage()
 	return page;
 }
 
+UploadBuffer::Allocation UploadBuffer::allocateFromRing(size_t sizeInBytes, size_t alignment)
+{
+	// The ring starts at a placement aligned address, so aligned offsets are aligned addresses
+	assert(m_pageSize % alignment == 0);
+
+	uint64_t alignedSize = Math::AlignUp(static_cast<uint64_t>(sizeInBytes), alignment);
+	if (alignedSize > m_pageSize)
+	{
+		return allocateLargePage(sizeInBytes, alignment);
+	}
+
+	for (;;)
+	{
+		uint64_t offset = Math::AlignUp(m_ringHead, alignment);
+
+		// An allocation can not wrap around, skip the end of the ring
+		if (offset % m_pageSize + alignedSize > m_pageSize)
+		{
+			offset = (offset / m_pageSize + 1) * m_pageSize;
+		}
+
+		if (offset + alignedSize - m_ringTail <= m_pageSize)
+		{
+			m_numBytesAllocated += sizeInBytes;
+			m_numBytesWasted += offset + alignedSize - m_ringHead - sizeInBytes;
+
+			m_ringHead = offset + alignedSize;
+			return m_ring->getAllocation(static_cast<size_t>(offset % m_pageSize));
+		}
+
+		// The ring is full, the allocations which are not submitted yet can not be waited for
+		if (!reclaimRing(true))
+		{
+			throw std::bad_alloc();
+		}
+	}
+}
+
+void UploadBuffer::submit(uint64_t fenceValue)
+{
+	assert(isRing() && "Only allocations in ring mode are tracked by fence value.");
+
+	if (m_ringHead == m_ringSubmitted && m_largePages.empty())
+	{
+		return;
+	}
+
+	if (m_ringRanges.empty() || m_ringRanges.back().fenceValue != fenceValue)
+	{
+		m_ringRanges.push({ fenceValue, m_ringHead, {} });
+	}
+
+	RingRange& range = m_ringRanges.back();
+	range.end = m_ringHead;
+	range.largePages.insert(range.largePages.end(), m_largePages.begin(), m_largePages.end());
+	m_largePages.clear();
+
+	m_ringSubmitted = m_ringHead;
+}
+
+bool UploadBuffer::reclaimRing(bool wait)
+{
+	if (m_ringRanges.empty())
+	{
+		return false;
+	}
+
+	if (wait)
+	{
+		m_commandQueue->waitForFenceValue(m_ringRanges.front().fenceValue);
+	}
+
+	while (!m_ringRanges.empty() && m_commandQueue->isFenceComplete(m_ringRanges.front().fenceValue))
+	{
+		m_ringTail = m_ringRanges.front().end;
+		m_numLargePages -= static_cast<uint32_t>(m_ringRanges.front().largePages.size());
+		m_ringRanges.pop();
+	}
+
+	return true;
+}
+
+size_t UploadBuffer::getUsedSize() const
+{
+	if (isRing())
+	{
+		return static_cast<size_t>(m_ringHead - m_ringTail);
+	}
+
+	return m_pagePool.size() * m_pageSize;
+}
+
 void UploadBuffer::reset()
 {
+	if (isRing())
+	{
+		reclaimRing(false);
+		return;
+	}
+
+	m_largePages.clear();
+	m_numLargePages = 0;
+
+	trimPages();
+
 	m_currentPage = nullptr;
 	// Reset all available pages
 	m_availablePages = m_pagePool;
@@ -57,6 +214,37 @@ void UploadBuffer::reset()
 	}
 }
 
+void UploadBuffer::trimPages()
+{
+	uint32_t numPagesUsed = static_cast<uint32_t>(m_pagePool.size() - m_availablePages.size());
+	m_pageHighWaterMark = std::max(m_pageHighWaterMark, numPagesUsed);
+
+	if (m_trimPolicy.numResets == 0 || ++m_numResetsSinceTrim < m_trimPolicy.numResets)
+	{
+		return;
+	}
+
+	size_t numPagesToKeep = std::max(m_pageHighWaterMark, m_trimPolicy.numPagesToKeep);
+	if (m_pagePool.size() > numPagesToKeep)
+	{
+		m_pagePool.resize(numPagesToKeep);
+	}
+
+	m_pageHighWaterMark = 0;
+	m_numResetsSinceTrim = 0;
+}
+
+UploadBuffer::Stats UploadBuffer::getStats() const
+{
+	Stats stats;
+	stats.numBytesAllocated = m_numBytesAllocated;
+	stats.numBytesWasted = m_numBytesWasted;
+	stats.numLargePagesLive = m_numLargePages;
+	stats.numPagesLive = static_cast<uint32_t>(isRing() ? 1 : m_pagePool.size()) + m_numLargePages;
+
+	return stats;
+}
+
 UploadBuffer::Page::Page(size_t sizeInBytes)
 	:	m_pageSize(sizeInBytes),
 		m_offset(0),
@@ -65,14 +253,12 @@ UploadBuffer::Page::Page(size_t sizeInBytes)
 {
 	auto device = Application::Get()->getDevice();
 
-	ThrowIfFailed(device->CreateCommittedResource(
-		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+	m_resource = device->createCommittedResource(
+		CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
 		D3D12_HEAP_FLAG_NONE,
-		&CD3DX12_RESOURCE_DESC::Buffer(m_pageSize),
-		D3D12_RESOURCE_STATE_GENERIC_READ,
-		nullptr,
-		IID_PPV_ARGS(&m_resource)
-	));
+		CD3DX12_RESOURCE_DESC::Buffer(m_pageSize),
+		D3D12_RESOURCE_STATE_GENERIC_READ
+	);
 
 	m_gpuPtr = m_resource->GetGPUVirtualAddress();
 	m_resource->Map(0, nullptr, &m_cpuPtr);
@@ -104,9 +290,7 @@ UploadBuffer::Allocation UploadBuffer::Page::allocate(size_t sizeInBytes, size_t
 	size_t alignedSize = Math::AlignUp(sizeInBytes, alignment);
 	m_offset = Math::AlignUp(m_offset, alignment);
 
-	Allocation allocation;
-	allocation.cpu = static_cast<uint8_t*>(m_cpuPtr) + m_offset;
-	allocation.gpu = m_gpuPtr + m_offset;
+	Allocation allocation = getAllocation(m_offset);
 
 	m_offset += alignedSize;
 
@@ -117,3 +301,12 @@ void UploadBuffer::Page::reset()
 {
 	m_offset = 0;
 }
+
+UploadBuffer::Allocation UploadBuffer::Page::getAllocation(size_t offset) const
+{
+	Allocation allocation;
+	allocation.cpu = static_cast<uint8_t*>(m_cpuPtr) + offset;
+	allocation.gpu = m_gpuPtr + offset;
+
+	return allocation;
+}
@@ -7,11 +7,26 @@
 
 #include <memory>
 #include <deque>
+#include <queue>
+#include <vector>
+
+class CommandQueue;
 
 /*
 *	An UploadBuffer provides a convenient method to upload resources to the GPU.
 *	Creates a temporary CPU resource and copies it over to the GPU resource.
 *	A single instance of an UploadBuffer can only be associated to a single command list/allocator!
+*	Threads which record command lists in parallel each use the UploadBuffer of their own FrameContext.
+*
+*	In page mode allocations are made from pages, which are all freed by reset.
+*	In ring mode allocations are made from a single persistently mapped ring buffer. The allocations are
+*	tagged with the fence value of the command list which uses them (see submit), and their memory is
+*	reclaimed as soon as the command queue has reached that fence value. A single ring can be used by
+*	all frames in flight.
+*
+*	Allocations larger than a page (or the ring) get a dedicated large page, which is released
+*	with the allocations it was made with. In page mode, the pages that are not needed anymore after
+*	a spike are destroyed by reset, following the trim policy.
 */
 class UploadBuffer
 {
@@ -23,26 +38,74 @@ public:
 		D3D12_GPU_VIRTUAL_ADDRESS gpu;
 	};
 
+	struct Stats
+	{
+		// The bytes requested by all allocations
+		uint64_t numBytesAllocated;
+		// The bytes lost to the alignment of the allocations (and to skipping the end of the ring)
+		uint64_t numBytesWasted;
+		// The number of pages which exist, including the ring and the large pages
+		uint32_t numPagesLive;
+		// The number of dedicated pages of allocations larger than a page
+		uint32_t numLargePagesLive;
+	};
+
+	// When the pages of page mode are destroyed
+	struct TrimPolicy
+	{
+		// The pages above the highest number of pages used during this number of resets are destroyed,
+		// 0 never destroys pages
+		uint32_t numResets = 120;
+		// The number of pages which are kept anyway
+		uint32_t numPagesToKeep = 1;
+	};
+
 	/*
 	* @param pageSize The size to use to allocate new pages in GPU memory
 	*/
 	explicit UploadBuffer(size_t pageSize = _2MB);
 
+	/*
+	* Create an UploadBuffer in ring mode.
+	*
+	* @param commandQueue The queue the command lists using the allocations are executed on.
+	* @param ringSize The size of the ring, an allocation must not exceed it.
+	*/
+	UploadBuffer(std::shared_ptr<CommandQueue> commandQueue, size_t ringSize);
+
+	bool isRing() const { return m_commandQueue != nullptr; }
+
 	size_t getPageSize() const { return m_pageSize; }
 
+	void setTrimPolicy(const TrimPolicy& policy) { m_trimPolicy = policy; }
+
 	/*
-	* Allocate memory in an Upload heap. An allocation must not exceed the size of a page.
+	* Allocate memory in an Upload heap. An allocation larger than a page gets a page of its own.
 	* Use a memcpy or similar method to copy the buffer data to CPU pointer 
 	* in the Allocation structure returned from this function.
 	*/
 	Allocation allocate(size_t sizeInBytes, size_t alignment);
 
+	/*
+	* Ring mode only. Tag the allocations made since the last submit with the fence value
+	* of the command list which uses them, after it has been executed.
+	*/
+	void submit(uint64_t fenceValue);
+
 	/*
 	* Release all allocated pages. This should only be done when the command list
 	* is finished executing on the CommandQueue.
+	* In ring mode only the allocations whose fence value has been reached are released.
+	* In page mode the large pages are destroyed, and the idle pages when the trim policy says so.
 	*/
 	void reset();
 
+	Stats getStats() const;
+
+	// The memory used by allocations which may still be in use by the GPU (ring mode)
+	// or by all pages (page mode)
+	size_t getUsedSize() const;
+
 private:
 	// A single page for the allocator
 	struct Page
@@ -61,6 +124,11 @@ private:
 		// Reset the page for reuse
 		void reset();
 
+		// The addresses at an offset in the page
+		Allocation getAllocation(size_t offset) const;
+
+		size_t getOffset() const { return m_offset; }
+
 	private:
 		Microsoft::WRL::ComPtr<ID3D12Resource> m_resource;
 
@@ -77,10 +145,29 @@ private:
 	// A pool of memory pages
 	using PagePool = std::deque<std::shared_ptr<Page>>;
 
+	// The allocations made before a submit, which are in use until the fence value is reached
+	struct RingRange
+	{
+		uint64_t fenceValue;
+		// The end of the allocations in the ring
+		uint64_t end;
+		std::vector<std::shared_ptr<Page>> largePages;
+	};
+
 	// Request a page from the pool of available pages
 	// or create a new page if there are no available pages.
 	std::shared_ptr<Page> requestPage();
 
+	Allocation allocateFromRing(size_t sizeInBytes, size_t alignment);
+	// Allocate from a dedicated page, which is released with the other allocations
+	Allocation allocateLargePage(size_t sizeInBytes, size_t alignment);
+
+	// Destroy the pages above the high-water mark of the last resets
+	void trimPages();
+	// Release the ranges whose fence value has been reached. Waits for the oldest range first when wait is set.
+	// Returns false if there are no submitted ranges.
+	bool reclaimRing(bool wait);
+
 	PagePool m_pagePool;
 	PagePool m_availablePages;
 
@@ -88,4 +175,25 @@ private:
 
 	// The size of each page of memory
 	size_t m_pageSize;
+
+	// The large pages of the allocations since the last reset (page mode) or submit (ring mode)
+	std::vector<std::shared_ptr<Page>> m_largePages;
+	uint32_t m_numLargePages;
+
+	TrimPolicy m_trimPolicy;
+	// The highest number of pages used since the last trim, and the number of resets since then
+	uint32_t m_pageHighWaterMark;
+	uint32_t m_numResetsSinceTrim;
+
+	uint64_t m_numBytesAllocated;
+	uint64_t m_numBytesWasted;
+
+	// Ring mode, the ring is a single page
+	std::shared_ptr<CommandQueue> m_commandQueue;
+	std::shared_ptr<Page> m_ring;
+	// The offsets only increase, the position in the ring is the offset modulo the page size
+	uint64_t m_ringHead;
+	uint64_t m_ringTail;
+	uint64_t m_ringSubmitted;
+	std::queue<RingRange> m_ringRanges;
 };
\ No newline at end of file
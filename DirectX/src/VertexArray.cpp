@@ -6,40 +6,44 @@
 //                        Buffer
 // --------------------------------------------------------
 
-D3D12_VERTEX_BUFFER_VIEW& VertexBuffer::updateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> copyCommandList, ID3D12Resource** intermediateResource)
+Microsoft::WRL::ComPtr<ID3D12Resource> CreateBufferResource(CommandList& copyCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource,
+    size_t bufferSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags)
 {
     auto device = Application::Get()->getDevice();
 
-    size_t bufferSize = m_numElements * m_elementSize;
-
     // Create a committed resource for the GPU resource in a default heap.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+    ComPtr<ID3D12Resource> buffer = device->createCommittedResource(
+        CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
         D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(bufferSize, m_flags),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(&m_buffer)));
+        CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags),
+        D3D12_RESOURCE_STATE_COPY_DEST);
 
     // Create an committed resource for the upload.
-    if (m_data != nullptr)
+    if (bufferData != nullptr)
     {
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+        intermediateResource = device->createCommittedResource(
+            CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
             D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(intermediateResource)));
+            CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
+            D3D12_RESOURCE_STATE_GENERIC_READ);
 
-        D3D12_SUBRESOURCE_DATA subresourceData = {};
-        subresourceData.pData = m_data;
-        subresourceData.RowPitch = bufferSize;
-        subresourceData.SlicePitch = subresourceData.RowPitch;
+        void* mappedData = nullptr;
+        ThrowIfFailed(intermediateResource->Map(0, nullptr, &mappedData));
+        memcpy(mappedData, bufferData, bufferSize);
+        intermediateResource->Unmap(0, nullptr);
 
-        UpdateSubresources(copyCommandList.Get(), m_buffer.Get(), *intermediateResource, 0, 0, 1, &subresourceData);
+        copyCommandList.copyBufferRegion(buffer.Get(), 0, intermediateResource.Get(), 0, bufferSize);
     }
 
+    return buffer;
+}
+
+D3D12_VERTEX_BUFFER_VIEW& VertexBuffer::updateBufferResource(CommandList& copyCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource)
+{
+    size_t bufferSize = m_numElements * m_elementSize;
+
+    m_buffer = CreateBufferResource(copyCommandList, intermediateResource, bufferSize, m_data, m_flags);
+
     // Create the buffer view (tells the input assembler where the vertices are stored in GPU memory)
     m_bufferView.BufferLocation = m_buffer->GetGPUVirtualAddress();
     m_bufferView.SizeInBytes = bufferSize;
@@ -48,39 +52,11 @@ D3D12_VERTEX_BUFFER_VIEW& VertexBuffer::updateBufferResource(Microsoft::WRL::Com
     return m_bufferView;
 }
 
-D3D12_INDEX_BUFFER_VIEW& IndexBuffer::updateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> copyCommandList, ID3D12Resource** intermediateResource)
+D3D12_INDEX_BUFFER_VIEW& IndexBuffer::updateBufferResource(CommandList& copyCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource)
 {
-    auto device = Application::Get()->getDevice();
-
     size_t bufferSize = m_numElements * m_elementSize;
 
-    // Create a committed resource for the GPU resource in a default heap.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(bufferSize, m_flags),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(&m_buffer)));
-
-    // Create an committed resource for the upload.
-    if (m_data != nullptr)
-    {
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(intermediateResource)));
-
-        D3D12_SUBRESOURCE_DATA subresourceData = {};
-        subresourceData.pData = m_data;
-        subresourceData.RowPitch = bufferSize;
-        subresourceData.SlicePitch = subresourceData.RowPitch;
-
-        UpdateSubresources(copyCommandList.Get(), m_buffer.Get(), *intermediateResource, 0, 0, 1, &subresourceData);
-    }
+    m_buffer = CreateBufferResource(copyCommandList, intermediateResource, bufferSize, m_data, m_flags);
 
     // Create the buffer view (tells the input assembler where the vertices are stored in GPU memory)
     m_bufferView.BufferLocation = m_buffer->GetGPUVirtualAddress();
@@ -103,13 +79,14 @@ VertexArray::~VertexArray()
     }
 }
 
-void VertexArray::bind(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>& commandList)
+void VertexArray::bind(CommandList& commandList)
 {
-    commandList->IASetVertexBuffers(0, m_vertexBufferViewCount, m_vertexBufferViews);
+    commandList.setVertexBuffers(0, m_vertexBufferViewCount, m_vertexBufferViews);
     
     if (m_indexBuffer != nullptr)
     {
-        commandList->IASetIndexBuffer(&m_indexBuffer->getBufferView());
+        D3D12_INDEX_BUFFER_VIEW indexBufferView = m_indexBuffer->getBufferView();
+        commandList.setIndexBuffer(&indexBufferView);
     }
 }
 
@@ -147,27 +124,30 @@ std::vector<D3D12_INPUT_ELEMENT_DESC> VertexArray::setVertexBuffers(std::initial
     return inputLayout;
 }
 
-void VertexArray::uploadDataToGPU(std::shared_ptr<CommandQueue>& copyCommandQueue)
+FenceTicket VertexArray::uploadDataToGPU(std::shared_ptr<CommandQueue>& copyCommandQueue)
 {
     auto commandList = copyCommandQueue->getCommandList();
 
-    std::vector<ComPtr<ID3D12Resource>> intermediateBuffers;
+    auto intermediateBuffers = std::make_shared<std::vector<ComPtr<ID3D12Resource>>>();
 
     for (int i = 0; i < m_vertexBuffers.size(); i++)
     {
         ComPtr<ID3D12Resource> tempBuffer;
-        m_vertexBufferViews[i] = m_vertexBuffers[i]->updateBufferResource(commandList, &tempBuffer);
-        intermediateBuffers.push_back(tempBuffer);
+        m_vertexBufferViews[i] = m_vertexBuffers[i]->updateBufferResource(*commandList, tempBuffer);
+        intermediateBuffers->push_back(tempBuffer);
     }
 
     if (m_indexBuffer != nullptr)
     {
         ComPtr<ID3D12Resource> tempBuffer;
-        m_indexBuffer->updateBufferResource(commandList, &tempBuffer);
-        intermediateBuffers.push_back(tempBuffer);
+        m_indexBuffer->updateBufferResource(*commandList, tempBuffer);
+        intermediateBuffers->push_back(tempBuffer);
     }
 
-    // Upload the vertex and index buffers to the GPU resources
+    // Upload the vertex and index buffers to the GPU resources, the intermediate buffers
+    // are released by the copy queue once the copies are done
     auto fenceValue = copyCommandQueue->executeCommandList(commandList);
-    copyCommandQueue->waitForFenceValue(fenceValue);
+    copyCommandQueue->releaseOnCompletion(fenceValue, intermediateBuffers);
+
+    return copyCommandQueue->getTicket(fenceValue);
 }
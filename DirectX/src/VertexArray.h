@@ -11,8 +11,16 @@
 #include <vector>
 
 // Own Headers
+#include "CommandList.h"
 #include "CommandQueue.h"
 
+/*
+* Create a GPU buffer in a default heap and, when data is given, record a copy
+* from a (mapped) intermediate upload buffer into it.
+*/
+Microsoft::WRL::ComPtr<ID3D12Resource> CreateBufferResource(CommandList& copyCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource,
+	size_t bufferSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
+
 class VertexBuffer
 {
 public:
@@ -20,7 +28,7 @@ public:
 		:	m_data(bufferData), m_numElements(numElements), m_elementSize(elementSize), m_flags(flags) {}
 	~VertexBuffer() = default;
 
-	D3D12_VERTEX_BUFFER_VIEW& updateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> copyCommandList, ID3D12Resource** intermediateResource);
+	D3D12_VERTEX_BUFFER_VIEW& updateBufferResource(CommandList& copyCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource);
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> getBuffer() const { return m_buffer; }
 	D3D12_VERTEX_BUFFER_VIEW getBufferView() const { return m_bufferView; }
@@ -44,7 +52,7 @@ public:
 		: m_data(bufferData), m_numElements(numElements), m_elementSize(elementSize), m_flags(flags) {}
 	~IndexBuffer() = default;
 
-	D3D12_INDEX_BUFFER_VIEW& updateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> copyCommandList, ID3D12Resource** intermediateResource);
+	D3D12_INDEX_BUFFER_VIEW& updateBufferResource(CommandList& copyCommandList, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource);
 
 	Microsoft::WRL::ComPtr<ID3D12Resource> getBuffer() const { return m_buffer; }
 	D3D12_INDEX_BUFFER_VIEW getBufferView() const { return m_bufferView; }
@@ -81,12 +89,16 @@ public:
 	VertexArray() = default;
 	~VertexArray();
 
-	void bind(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>& commandList);
+	void bind(CommandList& commandList);
 
 	std::vector<D3D12_INPUT_ELEMENT_DESC> setVertexBuffers(std::initializer_list<VertexBufferDescription> elementDescriptions);
 	void setIndexBuffer(std::shared_ptr<IndexBuffer>& indexBuffer) { m_indexBuffer = indexBuffer; }
 
-	void uploadDataToGPU(std::shared_ptr<CommandQueue>& copyCommandQueue);
+	/*
+	* Record and execute the upload of the buffers on the copy queue, without waiting for it.
+	* Returns the ticket a queue has to wait for (waitForTicket) before the buffers are used.
+	*/
+	FenceTicket uploadDataToGPU(std::shared_ptr<CommandQueue>& copyCommandQueue);
 
 private:
 	std::vector<std::shared_ptr<VertexBuffer>>	m_vertexBuffers;
@@ -2,12 +2,23 @@
 #include "Window.h"
 #include "Application.h"
 
+#if defined(_WIN32)
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
+#endif
 
 Window::Window(const WindowSettings& settings, EventListener* listener)
-    :   m_tearingSupported(settings.tearingSupported),
+    :   m_headless(settings.headless),
+        m_tearingSupported(settings.tearingSupported),
+        m_width(settings.width),
+        m_height(settings.height),
         m_listener(listener)
 {
+#if defined(_WIN32)
+    if (m_headless)
+    {
+        return;
+    }
+
     const wchar_t* windowClassName = L"DX12WindowClass";
 
     registerWindowClass(settings.hInstance, windowClassName);
@@ -17,11 +28,17 @@ Window::Window(const WindowSettings& settings, EventListener* listener)
     ::GetWindowRect(m_windowHandle, &m_windowRect);
     m_width = m_windowRect.right - m_windowRect.left;
     m_height = m_windowRect.bottom - m_windowRect.top;
+#endif
 }
 
 void Window::show()
 {
-    ::ShowWindow(m_windowHandle, SW_SHOW);
+#if defined(_WIN32)
+    if (!m_headless)
+    {
+        ::ShowWindow(m_windowHandle, SW_SHOW);
+    }
+#endif
 }
 
 void Window::onResize(uint32_t width, uint32_t height)
@@ -42,7 +59,8 @@ void Window::onResize(uint32_t width, uint32_t height)
 
 void Window::setFullscreen(bool fullscreen)
 {
-    if (m_fullscreen == fullscreen)
+#if defined(_WIN32)
+    if (m_headless || m_fullscreen == fullscreen)
     {
         return;
     }
@@ -91,8 +109,11 @@ void Window::setFullscreen(bool fullscreen)
 
         ::ShowWindow(m_windowHandle, SW_NORMAL);
     }
+#endif
 }
 
+#if defined(_WIN32)
+
 void Window::registerWindowClass(HINSTANCE hInstance, const wchar_t* windowClassName)
 {
     // Register a window class for creating our render window with.
@@ -208,3 +229,4 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 
     return 0;
 }
+#endif
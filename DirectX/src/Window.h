@@ -1,7 +1,9 @@
 #pragma once
 
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
+#endif
 
 // Windows Runtime Library. Needed for Microsoft::WRL::ComPtr<> template class.
 #include <wrl.h>
@@ -22,7 +24,11 @@ struct WindowSettings
 	uint32_t width;
 	uint32_t height;
 	bool tearingSupported;
+	// Don't create a window and render with the null device
+	bool headless;
+#if defined(_WIN32)
 	HINSTANCE hInstance;
+#endif
 };
 
 class Window
@@ -38,12 +44,15 @@ public:
 	uint32_t getWidth() { return m_width; }
 	uint32_t getHeight() { return m_height; }
 
+	bool isHeadless() const { return m_headless; }
+
 	bool isFullscreen() const { return m_fullscreen; }
 	void setFullscreen(bool fullscreen);
 
 	void setSwapChain(const std::shared_ptr<SwapChain>& swapChain) { m_swapChain = swapChain; }
 	const std::shared_ptr<SwapChain> getSwapChain() const { return m_swapChain; }
 
+#if defined(_WIN32)
 	HWND getWindowHandle() const { return m_windowHandle; }
 
 private:
@@ -51,13 +60,17 @@ private:
 
 	void registerWindowClass(HINSTANCE hInstance, const wchar_t* windowClassName);
 	void createWindow(const wchar_t* windowClassName, HINSTANCE hInstance, const wchar_t* appName, uint32_t width, uint32_t height);
+#endif
 
 private:
 	std::shared_ptr<SwapChain>		m_swapChain;
 
+#if defined(_WIN32)
 	HWND							m_windowHandle = nullptr;
 	RECT							m_windowRect;
+#endif
 
+	bool							m_headless = false;
 	bool							m_tearingSupported = false;
 	bool							m_fullscreen = false;
 
@@ -0,0 +1,121 @@
+#include "dxpch.h"
+#include "WorkerPool.h"
+
+WorkerPool::WorkerPool(uint32_t numWorkers)
+	:	m_task(nullptr),
+		m_numTasks(0),
+		m_generation(0),
+		m_stop(false),
+		m_nextTask(0),
+		m_numTasksDone(0),
+		m_numActiveWorkers(0)
+{
+	for (uint32_t i = 0; i < numWorkers; ++i)
+	{
+		m_workers.emplace_back(&WorkerPool::workerMain, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wakeCondition.notify_all();
+
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+}
+
+uint32_t WorkerPool::DefaultNumWorkers()
+{
+	uint32_t numCores = std::thread::hardware_concurrency();
+	return numCores > 1 ? numCores - 1 : 0;
+}
+
+void WorkerPool::parallelFor(uint32_t numTasks, const TaskFunction& task)
+{
+	if (numTasks == 0)
+	{
+		return;
+	}
+
+	if (numTasks == 1 || m_workers.empty())
+	{
+		for (uint32_t i = 0; i < numTasks; ++i)
+		{
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		// A worker of the previous parallelFor may still be about to find out there are no tasks left
+		m_doneCondition.wait(lock, [this]() { return m_numActiveWorkers == 0; });
+
+		m_task = &task;
+		m_numTasks = numTasks;
+		m_nextTask = 0;
+		m_numTasksDone = 0;
+		m_generation++;
+	}
+	m_wakeCondition.notify_all();
+
+	executeTasks(task, numTasks);
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_doneCondition.wait(lock, [this, numTasks]() { return m_numTasksDone == numTasks; });
+}
+
+void WorkerPool::workerMain()
+{
+	uint64_t generation = 0;
+
+	for (;;)
+	{
+		const TaskFunction* task;
+		uint32_t numTasks;
+
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wakeCondition.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+
+			if (m_stop)
+			{
+				return;
+			}
+
+			generation = m_generation;
+			task = m_task;
+			numTasks = m_numTasks;
+			m_numActiveWorkers++;
+		}
+
+		executeTasks(*task, numTasks);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_numActiveWorkers--;
+		}
+		m_doneCondition.notify_all();
+	}
+}
+
+void WorkerPool::executeTasks(const TaskFunction& task, uint32_t numTasks)
+{
+	for (uint32_t i = m_nextTask++; i < numTasks; i = m_nextTask++)
+	{
+		task(i);
+
+		if (++m_numTasksDone == numTasks)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_doneCondition.notify_all();
+		}
+	}
+}
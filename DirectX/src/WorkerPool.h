@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+*	A fixed set of worker threads which execute the tasks of a parallelFor, e.g. the recording of
+*	command lists. The calling thread executes tasks as well, so a pool without workers simply
+*	executes all tasks on the calling thread.
+*
+*	parallelFor must only be called from a single thread at a time.
+*/
+class WorkerPool
+{
+public:
+	using TaskFunction = std::function<void(uint32_t task)>;
+
+	/*
+	* @param numWorkers The number of threads besides the calling thread, by default one less than the number of cores.
+	*/
+	explicit WorkerPool(uint32_t numWorkers = DefaultNumWorkers());
+	virtual ~WorkerPool();
+
+	// The number of threads which execute tasks, including the calling thread
+	uint32_t getNumThreads() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+	/*
+	* Execute the tasks 0 to numTasks - 1 on the workers and the calling thread.
+	* Returns when all tasks have been executed.
+	*/
+	void parallelFor(uint32_t numTasks, const TaskFunction& task);
+
+	static uint32_t DefaultNumWorkers();
+
+private:
+	void workerMain();
+	// Execute tasks until there are none left
+	void executeTasks(const TaskFunction& task, uint32_t numTasks);
+
+	std::vector<std::thread> m_workers;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_doneCondition;
+
+	// The current parallelFor, workers copy it when they join
+	const TaskFunction* m_task;
+	uint32_t m_numTasks;
+	uint64_t m_generation;
+	bool m_stop;
+
+	std::atomic<uint32_t> m_nextTask;
+	std::atomic<uint32_t> m_numTasksDone;
+	// The workers which have joined the current parallelFor, and may still take a task from it
+	uint32_t m_numActiveWorkers;
+};
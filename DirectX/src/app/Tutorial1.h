@@ -4,6 +4,7 @@
 
 #include <chrono>
 #include "Application.h"
+#include "CommandList.h"
 #include "CommandQueue.h"
 #include "SwapChain.h"
 
@@ -28,10 +29,10 @@ public:
 
         window = std::make_shared<Window>(settings, Application::Get());
 
-        commandQueue = std::make_shared<CommandQueue>(device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+        commandQueue = device->createCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
-        swapChain = std::make_shared<SwapChain>(device, commandQueue->getCommandQueue(), settings.width, settings.height,
-            SWAPCHAIN_BUFFER_COUNT, window->getWindowHandle(), settings.tearingSupported);
+        swapChain = device->createSwapChain(commandQueue, *window, settings.width, settings.height,
+            SWAPCHAIN_BUFFER_COUNT, settings.tearingSupported);
         window->setSwapChain(swapChain);
 
         return window;
@@ -57,12 +58,12 @@ public:
             CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
                 backBuffer.Get(),
                 D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
-            commandList->ResourceBarrier(1, &barrier);
+            commandList->resourceBarrier(1, &barrier);
 
             FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
             CD3DX12_CPU_DESCRIPTOR_HANDLE rtv(swapChain->getCurrentRenderTargetView());
 
-            commandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+            commandList->clearRenderTargetView(rtv, clearColor);
         }
 
         // Present
@@ -70,7 +71,7 @@ public:
             CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
                 backBuffer.Get(),
                 D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
-            commandList->ResourceBarrier(1, &barrier);
+            commandList->resourceBarrier(1, &barrier);
 
             commandQueue->executeCommandList(commandList);
 
@@ -1,7 +1,11 @@
 #include "dxpch.h"
+#if defined(_WIN32)
 #include <d3dcompiler.h>
+#endif
 #include "Tutorial2.h"
 
+#include <fstream>
+
 using namespace Microsoft::WRL;
 using namespace DirectX;
 
@@ -52,6 +56,22 @@ static XMFLOAT3 g_VerticesColor[8] = {
      XMFLOAT3(1.0f, 0.0f, 1.0f)
 };
 
+// Read a compiled shader (.cso) from disk.
+static std::vector<char> ReadShaderFile(const char* fileName)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Could not open shader file");
+    }
+
+    std::vector<char> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), data.size());
+
+    return data;
+}
+
 static WORD g_Indicies[36] =
 {
     0, 1, 2, 0, 2, 3,
@@ -73,13 +93,25 @@ std::shared_ptr<Window> Tutorial2::Initialize(const WindowSettings& settings)
 
     window = std::make_shared<Window>(settings, Application::Get());
 
-    commandQueueCopy = std::make_shared<CommandQueue>(device, D3D12_COMMAND_LIST_TYPE_COPY);
-    commandQueueDirect = std::make_shared<CommandQueue>(device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+    commandQueueCopy = device->createCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
+    commandQueueDirect = device->createCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
-    swapChain = std::make_shared<SwapChain>(device, commandQueueDirect->getCommandQueue(), settings.width, settings.height,
-        SWAPCHAIN_BUFFER_COUNT, window->getWindowHandle(), settings.tearingSupported);
+    swapChain = device->createSwapChain(commandQueueDirect, *window, settings.width, settings.height,
+        SWAPCHAIN_BUFFER_COUNT, settings.tearingSupported);
     window->setSwapChain(swapChain);
 
+    // The CPU runs at most two frames ahead of the GPU
+    frameScheduler = std::make_shared<FrameScheduler>(commandQueueDirect, swapChain, SWAPCHAIN_BUFFER_COUNT - 1);
+
+    renderGraph = std::make_shared<RenderGraph>(commandQueueDirect, nullptr, commandQueueCopy);
+
+    // Records the cubes on multiple command lists in parallel
+    workerPool = std::make_shared<WorkerPool>();
+    renderGraph->setWorkerPool(workerPool);
+
+    // The GPU time of every pass is in the profiler report, next to the CPU zones
+    renderGraph->setGpuTimings(true);
+
 
     // Upload vertex buffer data
     vao = std::make_shared<VertexArray>();
@@ -94,10 +126,12 @@ std::shared_ptr<Window> Tutorial2::Initialize(const WindowSettings& settings)
     auto ibo = std::make_shared<IndexBuffer>(_countof(g_Indicies), sizeof(WORD), g_Indicies);
     vao->setIndexBuffer(ibo);
 
-    vao->uploadDataToGPU(commandQueueCopy);
+    // The direct queue waits for the upload on the GPU, before the cubes are drawn
+    FenceTicket uploadTicket = vao->uploadDataToGPU(commandQueueCopy);
+    commandQueueDirect->waitForTicket(uploadTicket);
 
 
-#if defined(_DEBUG)
+#if defined(_WIN32) && defined(_DEBUG)
     // Enable better shader debugging with the graphics debugging tools.
     UINT compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
 #else
@@ -105,12 +139,10 @@ std::shared_ptr<Window> Tutorial2::Initialize(const WindowSettings& settings)
 #endif
 
     // Load the vertex shader
-    ComPtr<ID3DBlob> vertexShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"VertexShader.cso", &vertexShaderBlob));
+    std::vector<char> vertexShader = ReadShaderFile("VertexShader.cso");
     //ThrowIfFailed(D3DCompileFromFile(L"Shader.hlsl", nullptr, nullptr, "VSMain", "vs_5_1", compileFlags, 0, &vertexShaderBlob, nullptr));
     // Load the pixel shader
-    ComPtr<ID3DBlob> pixelShaderBlob;
-    ThrowIfFailed(D3DReadFileToBlob(L"PixelShader.cso", &pixelShaderBlob));
+    std::vector<char> pixelShader = ReadShaderFile("PixelShader.cso");
     //ThrowIfFailed(D3DCompileFromFile(L"Shader.hlsl", nullptr, nullptr, "PSMain", "ps_5_1", compileFlags, 0, &vertexShaderBlob, nullptr));
 
     // Create the descriptor heap for the depth-stencil view
@@ -119,12 +151,7 @@ std::shared_ptr<Window> Tutorial2::Initialize(const WindowSettings& settings)
 
 
     // Create a root signature
-    D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData{};
-    featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
-    if (FAILED(device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
-    {
-        featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
-    }
+    D3D_ROOT_SIGNATURE_VERSION highestVersion = device->getHighestRootSignatureVersion();
 
     // Allow input layout and deny unnecessary access to certain pipeline stages.
     D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags =
@@ -135,26 +162,18 @@ std::shared_ptr<Window> Tutorial2::Initialize(const WindowSettings& settings)
         D3D12_ROOT_SIGNATURE_FLAG_DENY_PIXEL_SHADER_ROOT_ACCESS;
 
 
+    // The MVP matrix fits in root constants, so no descriptor is needed per draw
+    uint32_t rootSignatureSize = 0;
     CD3DX12_DESCRIPTOR_RANGE1 ranges[1];
     CD3DX12_ROOT_PARAMETER1 rootParameters[1];
-    ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, 1, 0, 0, D3D12_DESCRIPTOR_RANGE_FLAG_NONE);
-    //rootParameters[0].InitAsConstants(sizeof(XMMATRIX) / 4, 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
-    rootParameters[0].InitAsDescriptorTable(1, &ranges[0], D3D12_SHADER_VISIBILITY_VERTEX);
-    //rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_VERTEX);
+    RootSignature::InitAsConstantBuffer(rootParameters[0], sizeof(XMMATRIX), 0, 0, D3D12_SHADER_VISIBILITY_VERTEX, rootSignatureSize, ranges[0]);
 
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
     rootSignatureDesc.Init_1_1(_countof(rootParameters), rootParameters, 0, nullptr, rootSignatureFlags);
 
     rootSignature = std::make_shared<RootSignature>();
-    rootSignature->setRootSignatureDesc(rootSignatureDesc.Desc_1_1, featureData.HighestVersion);
+    rootSignature->setRootSignatureDesc(rootSignatureDesc.Desc_1_1, highestVersion);
 
-    uploadBuffer = std::make_shared<UploadBuffer>();
-
-    for (int i = 0; i < SWAPCHAIN_BUFFER_COUNT; i++)
-    {
-        cbvGPUDescriptorHeap[i] = std::make_shared<DynamicDescriptorHeap>(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 9);
-    }
-    
     cbvCPUDescAllocator = std::make_shared<DescriptorAllocator>(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1);
 
     struct PipelineStateStream
@@ -177,8 +196,8 @@ std::shared_ptr<Window> Tutorial2::Initialize(const WindowSettings& settings)
     pipelineStateStream.pRootSignature = rootSignature->getRootSignature().Get();
     pipelineStateStream.InputLayout = { &inputLayout[0], inputLayout.size() };
     pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
-    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
-    pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
+    pipelineStateStream.VS = CD3DX12_SHADER_BYTECODE(vertexShader.data(), vertexShader.size());
+    pipelineStateStream.PS = CD3DX12_SHADER_BYTECODE(pixelShader.data(), pixelShader.size());
     pipelineStateStream.DSVFormat = DXGI_FORMAT_D32_FLOAT;
     pipelineStateStream.RTVFormats = rtvFormats;
 
@@ -186,7 +205,7 @@ std::shared_ptr<Window> Tutorial2::Initialize(const WindowSettings& settings)
     D3D12_PIPELINE_STATE_STREAM_DESC pipelineStateStreamDesc = {
         sizeof(PipelineStateStream), &pipelineStateStream
     };
-    ThrowIfFailed(device->CreatePipelineState(&pipelineStateStreamDesc, IID_PPV_ARGS(&pipelineState)));
+    pipelineState = device->createPipelineState(pipelineStateStreamDesc);
 
     contentLoaded = true;
 
@@ -200,6 +219,8 @@ void Tutorial2::Destory()
 {
     commandQueueCopy->flush();
     commandQueueDirect->flush();
+
+    dsvTable.free();
 }
 
 void Tutorial2::onUpdate(float delta)
@@ -234,85 +255,116 @@ void Tutorial2::onRender()
         return;
     }
 
-    auto commandList = commandQueueDirect->getCommandList();
-    CommandList cl(commandList);
+    frameScheduler->beginFrame();
 
-    UINT currentBackBufferIndex = swapChain->getCurrentBackBufferIndex();
-    auto backBuffer = swapChain->getCurrentBackBuffer();
     auto rtv = swapChain->getCurrentRenderTargetView();
     auto dsv = dsvTable.getDescriptorHandle();
 
-    cbvGPUDescriptorHeap[currentBackBufferIndex]->reset();
-    uploadBuffer->reset();
-    cbvCPUDescAllocator->releaseStaleDescriptors(Application::Get()->getFrameCount());
-    dsvDescAllocator->releaseStaleDescriptors(Application::Get()->getFrameCount());
+    // Release what the frames the GPU has finished freed. The allocators count the frames of the application,
+    // which are ahead of the frames of the scheduler by the frames before the content was loaded
+    uint64_t completedFrame = frameScheduler->getCompletedFrameNumber();
+    if (completedFrame != FrameScheduler::InvalidFrameNumber)
+    {
+        completedFrame += Application::Get()->getFrameCount() - frameScheduler->getFrameNumber();
+        cbvCPUDescAllocator->releaseStaleDescriptors(completedFrame);
+        dsvDescAllocator->releaseStaleDescriptors(completedFrame);
+        renderGraph->getTransientResourceAllocator().releaseStaleResources(completedFrame);
+        cbvCPUDescAllocator->trim(completedFrame);
+    }
 
-    cbvGPUDescriptorHeap[currentBackBufferIndex]->parseRootSignature(*rootSignature);
+    // The graph transitions the back buffer to the render target state and back to the present state
+    renderGraph->reset();
 
-    // Clear the render targets
-    {
-        transitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    RenderGraph::ResourceHandle backBuffer = renderGraph->importResource("BackBuffer", swapChain->getCurrentBackBuffer().Get(),
+        swapChain->getCurrentBackBufferResourceId(), D3D12_RESOURCE_STATE_PRESENT);
 
-        FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
-        commandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+    // The depth buffer is only used within the frame, so the graph allocates it
+    D3D12_CLEAR_VALUE optimizedClearValue{};
+    optimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
+    optimizedClearValue.DepthStencil = { 1.0f, 0 };
 
-        commandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
-    }
+    RenderGraph::ResourceHandle depthBufferHandle = renderGraph->createResource("DepthBuffer",
+        CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, depthBufferWidth, depthBufferHeight, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+        &optimizedClearValue);
 
-    commandList->SetPipelineState(pipelineState.Get());
-    commandList->SetGraphicsRootSignature(rootSignature->getRootSignature().Get());
+    // The cubes are split over the worker threads once there are enough of them, every thread
+    // records its own command list with the upload buffer and descriptor heap of its context
+    const uint32_t numCubes = 9;
 
-    commandList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    renderGraph->addParallelPass("Cubes", D3D12_COMMAND_LIST_TYPE_DIRECT,
+        [&](RenderGraph::PassBuilder& builder)
+        {
+            builder.write(backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET);
+            builder.write(depthBufferHandle, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+        },
+        numCubes,
+        [&](FrameContext& context, uint32_t firstCube, uint32_t numCubes)
+        {
+            CommandList& commandList = context.getCommandList();
+            DynamicDescriptorHeap& descriptorHeap = context.getDescriptorHeap();
 
-    vao->bind(commandList);
+            // Clear the render targets, the first range is executed first
+            if (firstCube == 0)
+            {
+                FLOAT clearColor[] = { 0.4f, 0.6f, 0.9f, 1.0f };
+                commandList.clearRenderTargetView(rtv, clearColor);
 
-    commandList->RSSetViewports(1, &viewport);
-    commandList->RSSetScissorRects(1, &scissorRect);
+                commandList.clearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0);
+            }
 
-    commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
+            descriptorHeap.parseRootSignature(*rootSignature);
 
-    // Only create 1 CPU visible descriptor table (in a heap) for all the objects because each object can overwrite 
-    // the previous one because the data in the table will be copied over to a GPU visible descriptor 
-    // before the next object is submitted to the commandlist.
-    DescriptorAllocation cbvCPUTable = cbvCPUDescAllocator->allocate();
+            // Binds the MVP matrix the way the root signature chose (root constants)
+            ConstantBufferBinder constantBufferBinder(context.getUploadBuffer(), *cbvCPUDescAllocator);
+            constantBufferBinder.setRootSignature(*rootSignature);
 
-    // Render each object
-    for (int i = -20; i <= 20; i += 5)
-    {
-        auto m = modelMatrix * XMMatrixTranslation(i, 0, 30);
-        auto mvpMatrix = m * viewMatrix;
-        mvpMatrix = mvpMatrix * projectionMatrix;
+            commandList.setPipelineState(pipelineState.Get());
+            commandList.setGraphicsRootSignature(rootSignature->getRootSignature().Get());
 
-        //commandList->SetGraphicsRoot32BitConstants(0, sizeof(XMMATRIX) / 4, &mvpMatrix, 0)
+            commandList.setPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        // CB size need to be 256-byte aligned!
-        UploadBuffer::Allocation resourceAllocation = uploadBuffer->allocate(sizeof(XMMATRIX), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
-        memcpy(resourceAllocation.cpu, &mvpMatrix, sizeof(XMMATRIX));
+            vao->bind(commandList);
 
-        // Inline CBV (not in a table)
-        //commandList->SetGraphicsRootConstantBufferView(0, resourceAllocation.gpu);
+            commandList.setViewports(1, &viewport);
+            commandList.setScissorRects(1, &scissorRect);
 
-        D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc{};
-        cbvDesc.BufferLocation = resourceAllocation.gpu;
-        cbvDesc.SizeInBytes = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
-        Application::Get()->getDevice()->CreateConstantBufferView(&cbvDesc, cbvCPUTable.getDescriptorHandle());
-        cbvGPUDescriptorHeap[currentBackBufferIndex]->stageDescriptors(0, 0, 1, cbvCPUTable.getDescriptorHandle());
-        cbvGPUDescriptorHeap[currentBackBufferIndex]->commitStagedDescriptorsForDraw(cl);
+            commandList.setRenderTargets(1, &rtv, &dsv);
 
-        commandList->DrawIndexedInstanced(_countof(g_Indicies), 1, 0, 0, 0);
-    }
+            // Render each object
+            for (uint32_t cube = firstCube; cube < firstCube + numCubes; ++cube)
+            {
+                auto m = modelMatrix * XMMatrixTranslation(-20.0f + 5.0f * cube, 0, 30);
+                auto mvpMatrix = m * viewMatrix;
+                mvpMatrix = mvpMatrix * projectionMatrix;
 
-    // Present
-    {
-        transitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+                // Only stages (and copies) a descriptor when the root signature had to use a descriptor table
+                constantBufferBinder.setGraphicsConstantBuffer(commandList, descriptorHeap, 0, &mvpMatrix, sizeof(XMMATRIX));
+                descriptorHeap.commitStagedDescriptorsForDraw(commandList);
 
-        frameFenceValues[currentBackBufferIndex] = commandQueueDirect->executeCommandList(commandList);
+                commandList.drawIndexedInstanced(_countof(g_Indicies), 1, 0, 0, 0);
+            }
+        });
 
-        currentBackBufferIndex = swapChain->present();
+    renderGraph->compile();
 
-        // Wait until the new backbuffer is ready to be used
-        commandQueueDirect->waitForFenceValue(frameFenceValues[currentBackBufferIndex]);
+    // Update the depth-stencil view when the graph placed a new depth buffer
+    if (renderGraph->getResource(depthBufferHandle) != depthBuffer)
+    {
+        depthBuffer = renderGraph->getResource(depthBufferHandle);
+
+        D3D12_DEPTH_STENCIL_VIEW_DESC dsvDesc{};
+        dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+        dsvDesc.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
+        dsvDesc.Texture2D.MipSlice = 0;
+        dsvDesc.Flags = D3D12_DSV_FLAG_NONE;
+
+        Application::Get()->getDevice()->createDepthStencilView(depthBuffer, &dsvDesc, dsv);
     }
+
+    renderGraph->execute();
+
+    // Present, the next frame waits until it can be started
+    frameScheduler->endFrame(renderGraph->getFenceValue(D3D12_COMMAND_LIST_TYPE_DIRECT));
 }
 
 void Tutorial2::onKeyPressed(KeyEvent& event)
@@ -325,98 +377,78 @@ void Tutorial2::onResize(ResizeEvent& event)
     commandQueueCopy->flush();
     commandQueueDirect->flush();
 
-    uint32_t currentBackBufferIndex = swapChain->getCurrentBackBufferIndex();
-    for (int i = 0; i < SWAPCHAIN_BUFFER_COUNT; i++)
-    {
-        frameFenceValues[i] = frameFenceValues[currentBackBufferIndex];
-    }
+    // Nothing is recorded while resizing, so the sparse descriptor pages can be emptied (and trimmed later).
+    // The constant buffer views are only used within a frame, no allocation has to be forwarded.
+    cbvCPUDescAllocator->compact(DescriptorAllocator::CompactionPolicy(),
+        [](const DescriptorAllocation&, const DescriptorAllocation&) {});
 
     viewport = CD3DX12_VIEWPORT(0.0f, 0.0f, static_cast<float>(event.width), static_cast<float>(event.height));
 
     resizeDepthBuffer(event.width, event.height);
 }
 
-void Tutorial2::transitionResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList, Microsoft::WRL::ComPtr<ID3D12Resource> resource, D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState)
+std::string Tutorial2::getReport() const
 {
-    CD3DX12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-        resource.Get(),
-        beforeState, afterState);
+    if (!contentLoaded)
+    {
+        return std::string();
+    }
 
-    commandList->ResourceBarrier(1, &barrier);
-}
+    // How often the descriptor allocations were served from the caches of the threads
+    DescriptorAllocator::Stats stats = cbvCPUDescAllocator->getStats();
 
-void Tutorial2::updateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList, ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource, size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags)
-{
-    auto device = Application::Get()->getDevice();
+    char buffer[500];
+    snprintf(buffer, 500, "CBV/SRV/UAV descriptors: %llu allocations, %llu cache hits, %llu refills, %llu locks (%llu contended), %llu stale\n",
+        static_cast<unsigned long long>(stats.numAllocations), static_cast<unsigned long long>(stats.numCacheHits),
+        static_cast<unsigned long long>(stats.numCacheRefills), static_cast<unsigned long long>(stats.numLocks),
+        static_cast<unsigned long long>(stats.numContendedLocks), static_cast<unsigned long long>(stats.numStaleDescriptors));
+    std::string report = buffer;
 
-    size_t bufferSize = numElements * elementSize;
+    // How well the pages are used, compacting on resize empties the sparse ones
+    DescriptorAllocator::OccupancyStats occupancyStats = cbvCPUDescAllocator->getOccupancyStats();
 
-    // Create a committed resource for the GPU resource in a default heap.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(pDestinationResource)));
+    snprintf(buffer, 500, "CBV/SRV/UAV descriptor pages: %u pages, %llu of %llu descriptors allocated (%.1f%%), %llu free blocks, fragmentation %.2f\n",
+        occupancyStats.numPages, static_cast<unsigned long long>(occupancyStats.numAllocatedDescriptors),
+        static_cast<unsigned long long>(occupancyStats.numDescriptors), occupancyStats.occupancy * 100.0f,
+        static_cast<unsigned long long>(occupancyStats.numFreeBlocks), occupancyStats.fragmentation);
+    report += buffer;
 
+    FrameScheduler::FrameTimes frameTimes = frameScheduler->getLastFrameTimes();
 
-    // Create an committed resource for the upload.
-    if (bufferData != nullptr)
+    snprintf(buffer, 500, "Last completed frame %llu: CPU wait %.3f ms, GPU idle %.3f ms\n",
+        static_cast<unsigned long long>(frameTimes.frameNumber), frameTimes.cpuWaitTime, frameTimes.gpuIdleTime);
+    report += buffer;
+
+    return report;
+}
+
+std::string Tutorial2::getFrameSummary() const
+{
+    if (!contentLoaded)
     {
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(pIntermediateResource)));
-
-        D3D12_SUBRESOURCE_DATA subresourceData = {};
-        subresourceData.pData = bufferData;
-        subresourceData.RowPitch = bufferSize;
-        subresourceData.SlicePitch = subresourceData.RowPitch;
-
-        UpdateSubresources(commandList.Get(),
-            *pDestinationResource, *pIntermediateResource,
-            0, 0, 1, &subresourceData);
+        return std::string();
     }
+
+    // The average times the CPU waited and the GPU was idle since the last summary
+    FrameScheduler::FrameTimes frameTimes = frameScheduler->collectAverageFrameTimes();
+
+    // The memory the transient resources (the depth buffer) of the last frame saved by sharing heaps
+    char buffer[200];
+    snprintf(buffer, 200, "CPU wait %.3f ms, GPU idle %.3f ms, transient memory saved %.2f MB (peak %.2f MB)",
+        frameTimes.cpuWaitTime, frameTimes.gpuIdleTime,
+        renderGraph->getTransientMemorySaved() / (1024.0 * 1024.0),
+        renderGraph->getTransientResourceAllocator().getPeakMemorySaved() / (1024.0 * 1024.0));
+    return buffer;
+}
+
+void Tutorial2::updateBufferResource(CommandList& commandList, Microsoft::WRL::ComPtr<ID3D12Resource>& destinationResource, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource, size_t numElements, size_t elementSize, const void* bufferData, D3D12_RESOURCE_FLAGS flags)
+{
+    destinationResource = CreateBufferResource(commandList, intermediateResource, numElements * elementSize, bufferData, flags);
 }
 
 void Tutorial2::resizeDepthBuffer(int width, int height)
 {
-    if (contentLoaded)
-    {
-        commandQueueCopy->flush();
-        commandQueueDirect->flush();
-
-        width = std::max(1, width);
-        height = std::max(1, height);
-
-        auto device = Application::Get()->getDevice();
-
-        // Resize screen dependent resources
-        // Create a depth buffer
-        D3D12_CLEAR_VALUE optimizedClearValue{};
-        optimizedClearValue.Format = DXGI_FORMAT_D32_FLOAT;
-        optimizedClearValue.DepthStencil = { 1.0f, 0 };
-
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
-            D3D12_RESOURCE_STATE_DEPTH_WRITE,
-            &optimizedClearValue,
-            IID_PPV_ARGS(&depthBuffer)
-        ));
-
-        // Update the depth-stencil view
-        D3D12_DEPTH_STENCIL_VIEW_DESC dsv{};
-        dsv.Format = DXGI_FORMAT_D32_FLOAT;
-        dsv.ViewDimension = D3D12_DSV_DIMENSION_TEXTURE2D;
-        dsv.Texture2D.MipSlice = 0;
-        dsv.Flags = D3D12_DSV_FLAG_NONE;
-
-        device->CreateDepthStencilView(depthBuffer.Get(), &dsv, dsvTable.getDescriptorHandle());
-    }
+    // The render graph allocates the depth buffer with this size in the next frame
+    depthBufferWidth = std::max(1, width);
+    depthBufferHeight = std::max(1, height);
 }
@@ -11,7 +11,11 @@
 #include "DescriptorAllocator.h"
 #include "DynamicDescriptorHeap.h"
 #include "UploadBuffer.h"
+#include "ConstantBufferBinder.h"
 #include "CommandList.h"
+#include "RenderGraph.h"
+#include "WorkerPool.h"
+#include "FrameScheduler.h"
 
 #define SWAPCHAIN_BUFFER_COUNT 3
 
@@ -30,29 +34,31 @@ public:
     void onKeyPressed(KeyEvent& event) override;
     void onResize(ResizeEvent& event) override;
 
-private:
-    // Transition a resource
-    void transitionResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
-        Microsoft::WRL::ComPtr<ID3D12Resource> resource,
-        D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState);
+    std::string getReport() const override;
+    std::string getFrameSummary() const override;
 
+private:
     // Create a GPU buffer.
-    void updateBufferResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
-        ID3D12Resource** pDestinationResource, ID3D12Resource** pIntermediateResource,
+    void updateBufferResource(CommandList& commandList,
+        Microsoft::WRL::ComPtr<ID3D12Resource>& destinationResource, Microsoft::WRL::ComPtr<ID3D12Resource>& intermediateResource,
         size_t numElements, size_t elementSize, const void* bufferData,
         D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
 
-    // Resize the depth buffer to match the size of the client area.
+    // Set the size of the depth buffer to the size of the client area.
     void resizeDepthBuffer(int width, int height);
 
 private:
-    uint64_t frameFenceValues[SWAPCHAIN_BUFFER_COUNT] = {};
-
     std::shared_ptr<Window> window;
     std::shared_ptr<SwapChain> swapChain;
+    // Waits for the swap chain and the GPU before a frame, and presents it
+    std::shared_ptr<FrameScheduler> frameScheduler;
     std::shared_ptr<CommandQueue> commandQueueCopy;
     std::shared_ptr<CommandQueue> commandQueueDirect;
 
+    // Records the frame, transitions the back buffer and allocates the depth buffer
+    std::shared_ptr<RenderGraph> renderGraph;
+    std::shared_ptr<WorkerPool> workerPool;
+
     // Descriptor heap depth buffer
     std::shared_ptr<DescriptorAllocator> dsvDescAllocator;
     DescriptorAllocation dsvTable;
@@ -62,12 +68,8 @@ private:
     // Vertex buffer cube
     std::shared_ptr<VertexArray> vao;
 
-    // Uploads data to GPU resource
-    std::shared_ptr<UploadBuffer> uploadBuffer;
     // Allocates CPU descriptors + heaps
     std::shared_ptr<DescriptorAllocator> cbvCPUDescAllocator;
-    // Handles CPU to GPU descriptor copying + GPU heaps
-    std::shared_ptr<DynamicDescriptorHeap> cbvGPUDescriptorHeap[SWAPCHAIN_BUFFER_COUNT];
 
     //Microsoft::WRL::ComPtr<ID3D12Resource> vertexPosBuffer;
     //D3D12_VERTEX_BUFFER_VIEW vertexPosBufferView;
@@ -77,8 +79,10 @@ private:
     //Microsoft::WRL::ComPtr<ID3D12Resource> indexBuffer;
     //D3D12_INDEX_BUFFER_VIEW indexBufferView;
 
-    // Depth buffer
-    Microsoft::WRL::ComPtr<ID3D12Resource> depthBuffer;
+    // Depth buffer, a transient resource of the render graph
+    ID3D12Resource* depthBuffer = nullptr;
+    int depthBufferWidth = 1;
+    int depthBufferHeight = 1;
     // Descriptor heap depth buffer
     //Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> dsvHeap;
 
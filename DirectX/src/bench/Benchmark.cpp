@@ -0,0 +1,98 @@
+#include "dxpch.h"
+#include "Benchmark.h"
+
+#include "Application.h"
+
+#include <cstdarg>
+#include <vector>
+
+namespace
+{
+	struct BenchmarkEntry
+	{
+		const char* name;
+		BenchmarkFunction function;
+	};
+
+	// Game without a window, the benchmarks drive the classes they measure themselves
+	class BenchmarkGame : public Game
+	{
+	public:
+		std::shared_ptr<Window> Initialize(const WindowSettings& settings) override { return nullptr; }
+		void Destory() override {}
+
+		void onUpdate(float delta) override {}
+		void onRender() override {}
+
+		void onKeyPressed(KeyEvent& event) override {}
+		void onResize(ResizeEvent& event) override {}
+	};
+
+	// Function local so it is constructed before the first (static) registration
+	std::vector<BenchmarkEntry>& GetBenchmarks()
+	{
+		static std::vector<BenchmarkEntry> benchmarks;
+		return benchmarks;
+	}
+}
+
+BenchmarkRegistration::BenchmarkRegistration(const char* name, BenchmarkFunction function)
+{
+	GetBenchmarks().push_back({ name, function });
+}
+
+bool RunBenchmark(const std::string& name)
+{
+	bool found = false;
+
+	for (const BenchmarkEntry& benchmark : GetBenchmarks())
+	{
+		if (name == "all" || name == benchmark.name)
+		{
+			BenchmarkLog("--- %s ---\n", benchmark.name);
+			benchmark.function();
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		BenchmarkLog("Unknown benchmark '%s', available benchmarks:\n", name.c_str());
+		for (const BenchmarkEntry& benchmark : GetBenchmarks())
+		{
+			BenchmarkLog("  %s\n", benchmark.name);
+		}
+	}
+
+	return found;
+}
+
+void BenchmarkLog(const char* format, ...)
+{
+	char buffer[1024];
+
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+#if defined(_WIN32)
+	::OutputDebugStringA(buffer);
+#endif
+	fputs(buffer, stdout);
+}
+
+BenchmarkApplication::BenchmarkApplication()
+{
+	WindowSettings settings{};
+	settings.headless = true;
+
+	m_game = new BenchmarkGame();
+	m_application = new Application(settings, m_game);
+}
+
+BenchmarkApplication::~BenchmarkApplication()
+{
+	delete m_application;
+	delete m_game;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+/*
+*	Micro benchmarks of the renderer internals. They do not need a device (or a window)
+*	and are run from the command line with: -benchmark <name> (or -benchmark all).
+*	Benchmarks register themselves with a static BenchmarkRegistration.
+*/
+using BenchmarkFunction = void(*)();
+
+struct BenchmarkRegistration
+{
+	BenchmarkRegistration(const char* name, BenchmarkFunction function);
+};
+
+// Run the benchmark with the given name, returns false when there is no such benchmark
+bool RunBenchmark(const std::string& name);
+
+// Print a line of benchmark output (to the debug output and stdout)
+void BenchmarkLog(const char* format, ...);
+
+class Application;
+class Game;
+
+/*
+* A headless application (with the null device and without a game) for benchmarks of
+* classes which get the device through Application::Get(). Only one can exist at a time.
+*/
+class BenchmarkApplication
+{
+public:
+	BenchmarkApplication();
+	~BenchmarkApplication();
+
+private:
+	Application* m_application;
+	Game* m_game;
+};
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "dxpch.h"
+#include "Benchmark.h"
+#include "MapDescriptorFreeList.h"
+
+#include "DescriptorFreeList.h"
+
+#include <random>
+#include <vector>
+
+namespace
+{
+	struct Range
+	{
+		uint32_t offset;
+		uint32_t size;
+	};
+
+	/*
+	* Simulates the descriptor traffic of a frame: allocate a batch of (mostly small)
+	* descriptor ranges and free them again in a random order, so blocks are split
+	* and merged all the time. Returns the number of operations that were done.
+	*/
+	template<typename FreeList>
+	uint64_t RunWorkload(FreeList& freeList, const std::vector<uint32_t>& sizes, const std::vector<uint32_t>& freeOrder, uint32_t numFrames)
+	{
+		uint64_t numOperations = 0;
+		std::vector<Range> ranges;
+		ranges.reserve(sizes.size());
+
+		for (uint32_t frame = 0; frame < numFrames; ++frame)
+		{
+			ranges.clear();
+
+			for (uint32_t size : sizes)
+			{
+				uint32_t offset = freeList.allocate(size);
+				if (offset != FreeList::InvalidOffset)
+				{
+					ranges.push_back({ offset, size });
+				}
+				numOperations++;
+			}
+
+			for (uint32_t index : freeOrder)
+			{
+				if (index < ranges.size())
+				{
+					freeList.free(ranges[index].offset, ranges[index].size);
+					numOperations++;
+				}
+			}
+		}
+
+		return numOperations;
+	}
+
+	template<typename FreeList>
+	double Measure(uint32_t numDescriptors, const std::vector<uint32_t>& sizes, const std::vector<uint32_t>& freeOrder, uint32_t numFrames)
+	{
+		FreeList freeList(numDescriptors);
+
+		// Warm up
+		RunWorkload(freeList, sizes, freeOrder, 1);
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		uint64_t numOperations = RunWorkload(freeList, sizes, freeOrder, numFrames);
+		std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - t0;
+
+		assert(freeList.getNumFreeDescriptors() == numDescriptors && "Descriptors leaked in the benchmark");
+
+		return duration.count() / numOperations;
+	}
+
+	void RunDescriptorAllocatorBenchmark()
+	{
+		const uint32_t numFrames = 200;
+		const uint32_t numDescriptorsPerHeap[] = { 256, 4096, 65536 };
+
+		std::mt19937 random(1337);
+
+		for (uint32_t numDescriptors : numDescriptorsPerHeap)
+		{
+			// Fill about 3/4 of the heap with SRV/UAV like tables (1 to 8 descriptors, mostly 1)
+			std::vector<uint32_t> sizes;
+			uint32_t numAllocated = 0;
+			while (numAllocated < numDescriptors * 3 / 4)
+			{
+				uint32_t size = random() % 4 == 0 ? 1 + random() % 8 : 1;
+				sizes.push_back(size);
+				numAllocated += size;
+			}
+
+			std::vector<uint32_t> freeOrder(sizes.size());
+			for (uint32_t i = 0; i < freeOrder.size(); ++i)
+			{
+				freeOrder[i] = i;
+			}
+			std::shuffle(freeOrder.begin(), freeOrder.end(), random);
+
+			double mapTime = Measure<MapDescriptorFreeList>(numDescriptors, sizes, freeOrder, numFrames);
+			double tlsfTime = Measure<DescriptorFreeList>(numDescriptors, sizes, freeOrder, numFrames);
+
+			BenchmarkLog("%6u descriptors, %6zu allocations/frame: map %7.2f ns/op, tlsf %7.2f ns/op (%.2fx)\n",
+				numDescriptors, sizes.size(), mapTime, tlsfTime, mapTime / tlsfTime);
+		}
+	}
+
+	BenchmarkRegistration s_registration("descriptors", &RunDescriptorAllocatorBenchmark);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "dxpch.h"
+#include "Benchmark.h"
+#include "PerTableDescriptorHeap.h"
+
+#include "Application.h"
+#include "CommandList.h"
+#include "CommandQueue.h"
+#include "DescriptorAllocator.h"
+#include "DynamicDescriptorHeap.h"
+#include "RootSignature.h"
+
+namespace
+{
+	// The descriptor tables of the root signature: a CBV, two SRV tables and a UAV
+	const uint32_t TableSizes[] = { 1, 4, 2, 1 };
+	const uint32_t NumTables = _countof(TableSizes);
+
+	const uint32_t NumSourceDescriptors = 512;
+
+	/*
+	* Stages and commits the descriptor tables of every draw in a number of frames.
+	* Every draw uses other CPU descriptors, so the tables are never reused from an earlier draw.
+	* @param numStagedTables The number of tables that change per draw (the others stay bound).
+	*/
+	template<typename DescriptorHeap>
+	void RunWorkload(DescriptorHeap& descriptorHeap, CommandList& commandList, const RootSignature& rootSignature,
+		const DescriptorAllocation& sourceDescriptors, uint32_t numStagedTables, uint32_t numFrames, uint32_t numDrawsPerFrame)
+	{
+		uint32_t sourceOffset = 0;
+
+		for (uint32_t frame = 0; frame < numFrames; ++frame)
+		{
+			commandList.reset();
+			descriptorHeap.reset();
+			descriptorHeap.parseRootSignature(rootSignature);
+
+			for (uint32_t draw = 0; draw < numDrawsPerFrame; ++draw)
+			{
+				// The first draw of a frame binds all tables
+				uint32_t numTables = draw == 0 ? NumTables : numStagedTables;
+				for (uint32_t table = 0; table < numTables; ++table)
+				{
+					if (sourceOffset + TableSizes[table] > NumSourceDescriptors)
+					{
+						sourceOffset = 0;
+					}
+
+					descriptorHeap.stageDescriptors(table, 0, TableSizes[table], sourceDescriptors.getDescriptorHandle(sourceOffset));
+					sourceOffset += TableSizes[table];
+				}
+
+				descriptorHeap.commitStagedDescriptorsForDraw(commandList);
+			}
+		}
+	}
+
+	template<typename DescriptorHeap>
+	double Measure(CommandList& commandList, const RootSignature& rootSignature, const DescriptorAllocation& sourceDescriptors,
+		uint32_t numStagedTables, uint32_t numFrames, uint32_t numDrawsPerFrame)
+	{
+		DescriptorHeap descriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 1024);
+
+		// Warm up, so all descriptor heaps have been created
+		RunWorkload(descriptorHeap, commandList, rootSignature, sourceDescriptors, numStagedTables, 1, numDrawsPerFrame);
+
+		auto t0 = std::chrono::high_resolution_clock::now();
+		RunWorkload(descriptorHeap, commandList, rootSignature, sourceDescriptors, numStagedTables, numFrames, numDrawsPerFrame);
+		std::chrono::duration<double, std::nano> duration = std::chrono::high_resolution_clock::now() - t0;
+
+		return duration.count() / (static_cast<double>(numFrames) * numDrawsPerFrame);
+	}
+
+	void RunDescriptorCommitBenchmark()
+	{
+		const uint32_t numFrames = 200;
+		const uint32_t numDrawsPerFrame = 1000;
+
+		BenchmarkApplication application;
+		auto device = Application::Get()->getDevice();
+
+		auto commandQueue = device->createCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+		auto commandList = commandQueue->getCommandList();
+
+		CD3DX12_DESCRIPTOR_RANGE1 ranges[NumTables];
+		CD3DX12_ROOT_PARAMETER1 rootParameters[NumTables];
+		ranges[0].Init(D3D12_DESCRIPTOR_RANGE_TYPE_CBV, TableSizes[0], 0);
+		ranges[1].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, TableSizes[1], 0);
+		ranges[2].Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, TableSizes[2], TableSizes[1]);
+		ranges[3].Init(D3D12_DESCRIPTOR_RANGE_TYPE_UAV, TableSizes[3], 0);
+		for (uint32_t i = 0; i < NumTables; ++i)
+		{
+			rootParameters[i].InitAsDescriptorTable(1, &ranges[i]);
+		}
+
+		CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDesc;
+		rootSignatureDesc.Init_1_1(NumTables, rootParameters);
+
+		RootSignature rootSignature(rootSignatureDesc.Desc_1_1, device->getHighestRootSignatureVersion());
+
+		DescriptorAllocator descriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, NumSourceDescriptors);
+		DescriptorAllocation sourceDescriptors = descriptorAllocator.allocate(NumSourceDescriptors);
+
+		for (uint32_t numStagedTables : { NumTables, 1u })
+		{
+			double perTableTime = Measure<PerTableDescriptorHeap>(*commandList, rootSignature, sourceDescriptors, numStagedTables, numFrames, numDrawsPerFrame);
+			double batchedTime = Measure<DynamicDescriptorHeap>(*commandList, rootSignature, sourceDescriptors, numStagedTables, numFrames, numDrawsPerFrame);
+
+			BenchmarkLog("%u of %u tables per draw: per table copy %7.2f ns/draw, batched copy %7.2f ns/draw (%.2fx)\n",
+				numStagedTables, NumTables, perTableTime, batchedTime, perTableTime / batchedTime);
+		}
+
+		descriptorAllocator.free(sourceDescriptors);
+	}
+
+	BenchmarkRegistration s_registration("descriptor-commit", &RunDescriptorCommitBenchmark);
+}
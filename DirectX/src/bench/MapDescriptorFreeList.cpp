@@ -0,0 +1,95 @@
+#include "dxpch.h"
+#include "MapDescriptorFreeList.h"
+
+MapDescriptorFreeList::MapDescriptorFreeList(uint32_t numDescriptors)
+	:	m_numFreeDescriptors(numDescriptors)
+{
+	addNewBlock(0, numDescriptors);
+}
+
+bool MapDescriptorFreeList::hasSpace(uint32_t numDescriptors) const
+{
+	return m_freeListBySize.lower_bound(numDescriptors) != m_freeListBySize.end();
+}
+
+uint32_t MapDescriptorFreeList::allocate(uint32_t numDescriptors)
+{
+	if (numDescriptors > m_numFreeDescriptors)
+	{
+		return InvalidOffset;
+	}
+
+	// Get the first block that is large enough to satify the request.
+	auto smallestBlockItr = m_freeListBySize.lower_bound(numDescriptors);
+	if (smallestBlockItr == m_freeListBySize.end())
+	{
+		return InvalidOffset;
+	}
+
+	auto blockSize = smallestBlockItr->first;
+	auto offsetItr = smallestBlockItr->second;
+	auto offset = offsetItr->first;
+
+	// Remove the existing free block from the free list.
+	m_freeListBySize.erase(smallestBlockItr);
+	m_freeListByOffset.erase(offsetItr);
+
+	// Return the left-over to the free list.
+	auto newSize = blockSize - numDescriptors;
+	if (newSize > 0)
+	{
+		addNewBlock(offset + numDescriptors, newSize);
+	}
+
+	m_numFreeDescriptors -= numDescriptors;
+
+	return offset;
+}
+
+void MapDescriptorFreeList::free(uint32_t offset, uint32_t numDescriptors)
+{
+	// Find the blocks that appear after and before the block that is being freed.
+	auto nextBlockItr = m_freeListByOffset.upper_bound(offset);
+	auto prevBlockItr = nextBlockItr;
+
+	if (prevBlockItr != m_freeListByOffset.begin())
+	{
+		--prevBlockItr;
+	}
+	else
+	{
+		prevBlockItr = m_freeListByOffset.end();
+	}
+
+	m_numFreeDescriptors += numDescriptors;
+
+	if (prevBlockItr != m_freeListByOffset.end() &&
+		offset == prevBlockItr->first + prevBlockItr->second.size)
+	{
+		// Merge with the previous block.
+		offset = prevBlockItr->first;
+		numDescriptors += prevBlockItr->second.size;
+
+		m_freeListBySize.erase(prevBlockItr->second.freeListBySizeItr);
+		m_freeListByOffset.erase(prevBlockItr);
+	}
+
+	if (nextBlockItr != m_freeListByOffset.end() &&
+		offset + numDescriptors == nextBlockItr->first)
+	{
+		// Merge with the next block.
+		numDescriptors += nextBlockItr->second.size;
+
+		m_freeListBySize.erase(nextBlockItr->second.freeListBySizeItr);
+		m_freeListByOffset.erase(nextBlockItr);
+	}
+
+	addNewBlock(offset, numDescriptors);
+}
+
+void MapDescriptorFreeList::addNewBlock(uint32_t offset, uint32_t numDescriptors)
+{
+	auto offsetItr = m_freeListByOffset.emplace(offset, FreeBlockInfo(numDescriptors));
+	auto sizeItr = m_freeListBySize.emplace(numDescriptors, offsetItr.first);
+	offsetItr.first->second.freeListBySizeItr = sizeItr;
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+/*
+*	The previous free list of the DescriptorAllocatorPage, which keeps the free blocks in
+*	a std::map (by offset) and a std::multimap (by size). Only kept as a reference for
+*	the descriptor allocator benchmark, it has the same interface as DescriptorFreeList.
+*/
+class MapDescriptorFreeList
+{
+public:
+	static const uint32_t InvalidOffset = UINT32_MAX;
+
+	explicit MapDescriptorFreeList(uint32_t numDescriptors);
+
+	bool hasSpace(uint32_t numDescriptors) const;
+	uint32_t allocate(uint32_t numDescriptors);
+	void free(uint32_t offset, uint32_t numDescriptors);
+
+	uint32_t getNumFreeDescriptors() const { return m_numFreeDescriptors; }
+
+private:
+	// Adds a new block to the free list
+	void addNewBlock(uint32_t offset, uint32_t numDescriptors);
+
+private:
+	struct FreeBlockInfo;
+	// A map that lists the free block by the offset within the descriptor heap
+	using FreeListByOffset = std::map<uint32_t, FreeBlockInfo>;
+
+	// A map that lists the free blocks by size. Needs to be multimap since
+	// multiple blocks can have the same size.
+	using FreeListBySize = std::multimap<uint32_t, FreeListByOffset::iterator>;
+
+	struct FreeBlockInfo
+	{
+		FreeBlockInfo(uint32_t size): size(size) {}
+
+		uint32_t size;
+		FreeListBySize::iterator freeListBySizeItr;
+	};
+
+	FreeListByOffset m_freeListByOffset;
+	FreeListBySize m_freeListBySize;
+
+	uint32_t m_numFreeDescriptors;
+};
\ No newline at end of file
@@ -0,0 +1,310 @@
+#include "dxpch.h"
+#include "PerTableDescriptorHeap.h"
+
+#include "Application.h"
+#include "RootSignature.h"
+#include "CommandList.h"
+
+PerTableDescriptorHeap::PerTableDescriptorHeap(D3D12_DESCRIPTOR_HEAP_TYPE type, uint32_t numDescriptorsPerHeap)
+	:	m_descriptorHeapType(type),
+		m_numDescriptorsPerHeap(numDescriptorsPerHeap),
+		m_descriptorTableBitMask(0),
+		m_staleDescriptorTableBitMask(0),
+		m_currentCPUDescriptorHandle(D3D12_DEFAULT),
+		m_currentGPUDescriptorHandle(D3D12_DEFAULT),
+		m_numFreeHandles(0),
+		m_numReusedTables(0)
+{
+	m_descriptorHandleIncrementSize = Application::Get()->getDevice()->getDescriptorHandleIncrementSize(m_descriptorHeapType);
+
+	// Allocate space for staging CPU visible descriptors
+	m_descriptorHandleCache = std::make_unique<D3D12_CPU_DESCRIPTOR_HANDLE[]>(m_numDescriptorsPerHeap);
+}
+
+void PerTableDescriptorHeap::stageDescriptors(uint32_t rootParameterIndex, uint32_t offset, uint32_t numDescriptors, const D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptor)
+{
+	// Cannot stage more than the maximum number of descriptors per heap
+	// Cannot stage more than the MaxDescriptorTables root parameters
+	if (numDescriptors > m_numDescriptorsPerHeap || rootParameterIndex >= MaxDescriptorTables)
+	{
+		throw std::bad_alloc();
+	}
+
+	DescriptorTableCache& descriptorTableCache = m_descriptorTableCache[rootParameterIndex];
+
+	// Check that the number of descriptors to copy does not exceed the number
+	// of descriptors expected in the descriptor table.
+	if ((offset + numDescriptors) > descriptorTableCache.numDescriptors)
+	{
+		throw std::length_error("Number of descriptors exceeds the number of descriptors in the descriptor table.");
+	}
+
+	D3D12_CPU_DESCRIPTOR_HANDLE* dstDescriptor = (descriptorTableCache.baseDescriptor + offset);
+	for (uint32_t i = 0; i < numDescriptors; ++i)
+	{
+		dstDescriptor[i] = CD3DX12_CPU_DESCRIPTOR_HANDLE(srcDescriptor, i, m_descriptorHandleIncrementSize);
+	}
+
+	// Set the root parameter index bit to make sure the descriptor table
+	// at that index is bound to the command list.
+	m_staleDescriptorTableBitMask |= (1 << rootParameterIndex);
+}
+
+void PerTableDescriptorHeap::commitStagedDescriptors(CommandList& commandlist, std::function<void(CommandList&, UINT, D3D12_GPU_DESCRIPTOR_HANDLE)> setFunc)
+{
+	// Compute the number of descriptors that need to be copied
+	uint32_t numDescriptorsToCommit = computeStaleDescriptorCount();
+
+	if (numDescriptorsToCommit == 0)
+	{
+		return;
+	}
+
+	auto device = Application::Get()->getDevice();
+
+	if (m_currentDescriptorHeap == nullptr || m_numFreeHandles < numDescriptorsToCommit)
+	{
+		m_currentDescriptorHeap = requestDescriptorHeap();
+		m_currentCPUDescriptorHandle = m_currentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+		m_currentGPUDescriptorHandle = m_currentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+		m_numFreeHandles = m_numDescriptorsPerHeap;
+
+		commandlist.setDescriptorHeap(m_descriptorHeapType, m_currentDescriptorHeap.Get());
+
+		// When updating the descriptor heap on the command list, all descriptor
+		// tables must be (re)copied to the new descriptor heap (not just
+		// the stale descriptor tables).
+		m_staleDescriptorTableBitMask = m_descriptorTableBitMask;
+
+		// The committed tables are in the previous heap, which is not bound anymore
+		invalidateCommittedTables();
+	}
+
+	DWORD rootIndex;
+	// Scan from LSB to MSB for a set bit in staleDescriptorsBitMask
+	while (_BitScanForward(&rootIndex, m_staleDescriptorTableBitMask))
+	{
+		UINT numSrcDescriptors = m_descriptorTableCache[rootIndex].numDescriptors;
+		D3D12_CPU_DESCRIPTOR_HANDLE* pSrcDescriptorHandles = m_descriptorTableCache[rootIndex].baseDescriptor;
+
+		uint64_t hash = hashDescriptorTable(pSrcDescriptorHandles, numSrcDescriptors);
+
+		// An identical table is already in the heap, bind that one instead of copying the descriptors again
+		D3D12_GPU_DESCRIPTOR_HANDLE gpuDescriptor;
+		if (findCommittedTable(hash, pSrcDescriptorHandles, numSrcDescriptors, gpuDescriptor))
+		{
+			setFunc(commandlist, rootIndex, gpuDescriptor);
+			m_numReusedTables++;
+
+			m_staleDescriptorTableBitMask ^= (1 << rootIndex);
+			continue;
+		}
+
+		D3D12_CPU_DESCRIPTOR_HANDLE pDestDescriptorRangeStarts[] =
+		{
+			m_currentCPUDescriptorHandle
+		};
+		UINT pDestDescriptorRangeSizes[] =
+		{
+			numSrcDescriptors
+		};
+
+		// Copy the staged CPU visible descriptors to the GPU visible descriptor heap
+		device->copyDescriptors(1, pDestDescriptorRangeStarts, pDestDescriptorRangeSizes,
+			numSrcDescriptors, pSrcDescriptorHandles, nullptr, m_descriptorHeapType);
+
+		// Set the descriptors on the command list using the passed-in setter function
+		setFunc(commandlist, rootIndex, m_currentGPUDescriptorHandle);
+
+		// Remember the table, a table with the same hash is replaced
+		m_committedTables[hash] = { m_currentGPUDescriptorHandle, static_cast<uint32_t>(m_committedDescriptors.size()), numSrcDescriptors };
+		m_committedDescriptors.insert(m_committedDescriptors.end(), pSrcDescriptorHandles, pSrcDescriptorHandles + numSrcDescriptors);
+
+		// Offset current CPU and GPU descriptor handles
+		m_currentCPUDescriptorHandle.Offset(numSrcDescriptors, m_descriptorHandleIncrementSize);
+		m_currentGPUDescriptorHandle.Offset(numSrcDescriptors, m_descriptorHandleIncrementSize);
+		m_numFreeHandles -= numSrcDescriptors;
+
+		// Flip the stale bit so the descriptor table is not recopied again unless it is updated with a new descriptor
+		m_staleDescriptorTableBitMask ^= (1 << rootIndex);
+	}
+}
+
+void PerTableDescriptorHeap::commitStagedDescriptorsForDraw(CommandList& commandlist)
+{
+	commitStagedDescriptors(commandlist, &CommandList::setGraphicsRootDescriptorTable);
+}
+
+void PerTableDescriptorHeap::commitStagedDescriptorsForDispatch(CommandList& commandlist)
+{
+	commitStagedDescriptors(commandlist, &CommandList::setComputeRootDescriptorTable);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE PerTableDescriptorHeap::copyDescriptor(CommandList& commandlist, D3D12_CPU_DESCRIPTOR_HANDLE cpuDescriptor)
+{
+	if (m_currentDescriptorHeap == nullptr || m_numFreeHandles < 1)
+	{
+		m_currentDescriptorHeap = requestDescriptorHeap();
+		m_currentCPUDescriptorHandle = m_currentDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
+		m_currentGPUDescriptorHandle = m_currentDescriptorHeap->GetGPUDescriptorHandleForHeapStart();
+		m_numFreeHandles = m_numDescriptorsPerHeap;
+
+		commandlist.setDescriptorHeap(m_descriptorHeapType, m_currentDescriptorHeap.Get());
+
+		// When updating the descriptor heap on the command list, all descriptor
+		// tables must be (re)copied to the new descriptor heap (not just
+		// the stale descriptor tables).
+		m_staleDescriptorTableBitMask = m_descriptorTableBitMask;
+
+		// The committed tables are in the previous heap, which is not bound anymore
+		invalidateCommittedTables();
+	}
+
+	auto device = Application::Get()->getDevice();
+
+	D3D12_GPU_DESCRIPTOR_HANDLE hGPU = m_currentGPUDescriptorHandle;
+	device->copyDescriptorsSimple(1, m_currentCPUDescriptorHandle, cpuDescriptor, m_descriptorHeapType);
+
+	m_currentCPUDescriptorHandle.Offset(1, m_descriptorHandleIncrementSize);
+	m_currentGPUDescriptorHandle.Offset(1, m_descriptorHandleIncrementSize);
+	m_numFreeHandles -= 1;
+
+	return hGPU;
+}
+
+void PerTableDescriptorHeap::parseRootSignature(const RootSignature& rootSignature)
+{
+	// If the root signature changes, all the descriptors muse be (re)bound to the command list
+	m_staleDescriptorTableBitMask = 0;
+
+	const auto& rootSignatureDesc = rootSignature.getRootSignatureDesc();
+
+	// Get a bit mask that represents the root parameter that match the descriptor heap tpe for this dynamic descriptor heap
+	m_descriptorTableBitMask = rootSignature.getDescriptorTableBitMask(m_descriptorHeapType);
+	uint32_t descriptorTableBitMask = m_descriptorTableBitMask;
+
+	uint32_t currentOffset = 0;
+	DWORD rootIndex;
+	while (_BitScanForward(&rootIndex, descriptorTableBitMask) && rootIndex < rootSignatureDesc.NumParameters)
+	{
+		uint32_t numDescriptors = rootSignature.getNumDescriptors(rootIndex);
+
+		DescriptorTableCache& descriptorTableCache = m_descriptorTableCache[rootIndex];
+		descriptorTableCache.numDescriptors = numDescriptors;
+		descriptorTableCache.baseDescriptor = m_descriptorHandleCache.get() + currentOffset;
+
+		currentOffset += numDescriptors;
+
+		// Flip the descriptor table bit so it's not scanned agina for the current index
+		descriptorTableBitMask ^= (1 << rootIndex);
+
+		// Make sure the maximum number of descriptors per descriptor heap has not been exceeded
+		assert(currentOffset <= m_numDescriptorsPerHeap && 
+			"The root signature requires more than the maximum number of descriptors per descriptor heap. Consider increasing the maximum number of descriptors per descriptor heap.");
+	}
+}
+
+void PerTableDescriptorHeap::reset()
+{
+	m_availableDescriptorHeaps = m_descriptorHeapPool;
+	m_currentDescriptorHeap.Reset();
+	m_currentCPUDescriptorHandle = CD3DX12_CPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
+	m_currentGPUDescriptorHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(D3D12_DEFAULT);
+	m_numFreeHandles = 0;
+	m_descriptorTableBitMask = 0;
+	m_staleDescriptorTableBitMask = 0;
+
+	// Reset the table cache
+	for (int i = 0; i < MaxDescriptorTables; ++i)
+	{
+		m_descriptorTableCache[i].reset();
+	}
+
+	invalidateCommittedTables();
+	m_numReusedTables = 0;
+}
+
+void PerTableDescriptorHeap::invalidateCommittedTables()
+{
+	m_committedTables.clear();
+	m_committedDescriptors.clear();
+}
+
+Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> PerTableDescriptorHeap::requestDescriptorHeap()
+{
+	ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+	if (!m_availableDescriptorHeaps.empty())
+	{
+		descriptorHeap = m_availableDescriptorHeaps.front();
+		m_availableDescriptorHeaps.pop();
+	}
+	else
+	{
+		descriptorHeap = createDescriptorHeap();
+		m_descriptorHeapPool.push(descriptorHeap);
+	}
+
+	return descriptorHeap;
+}
+
+Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> PerTableDescriptorHeap::createDescriptorHeap()
+{
+	auto device = Application::Get()->getDevice();
+
+	D3D12_DESCRIPTOR_HEAP_DESC descriptorHeapDesc{};
+	descriptorHeapDesc.Type = m_descriptorHeapType;
+	descriptorHeapDesc.NumDescriptors = m_numDescriptorsPerHeap;
+	descriptorHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+
+	return device->createDescriptorHeap(descriptorHeapDesc);
+}
+
+uint32_t PerTableDescriptorHeap::computeStaleDescriptorCount() const
+{
+	uint32_t numStaleDescriptors = 0;
+	DWORD i;
+	DWORD staleDescriptorsBitMask = m_staleDescriptorTableBitMask;
+
+	while (_BitScanForward(&i, staleDescriptorsBitMask))
+	{
+		numStaleDescriptors += m_descriptorTableCache[i].numDescriptors;
+		staleDescriptorsBitMask ^= (1 << i);
+	}
+
+	return numStaleDescriptors;
+}
+
+uint64_t PerTableDescriptorHeap::hashDescriptorTable(const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors)
+{
+	// FNV-1a over the descriptor addresses
+	uint64_t hash = 14695981039346656037ull;
+	for (uint32_t i = 0; i < numDescriptors; ++i)
+	{
+		hash ^= static_cast<uint64_t>(descriptors[i].ptr);
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+bool PerTableDescriptorHeap::findCommittedTable(uint64_t hash, const D3D12_CPU_DESCRIPTOR_HANDLE* descriptors, uint32_t numDescriptors, D3D12_GPU_DESCRIPTOR_HANDLE& gpuDescriptor) const
+{
+	auto itr = m_committedTables.find(hash);
+	if (itr == m_committedTables.end() || itr->second.numDescriptors != numDescriptors)
+	{
+		return false;
+	}
+
+	// Different tables can have the same hash
+	const D3D12_CPU_DESCRIPTOR_HANDLE* committedDescriptors = m_committedDescriptors.data() + itr->second.firstDescriptor;
+	for (uint32_t i = 0; i < numDescriptors; ++i)
+	{
+		if (committedDescriptors[i].ptr != descriptors[i].ptr)
+		{
+			return false;
+		}
+	}
+
+	gpuDescriptor = itr->second.gpuDescriptor;
+	return true;
+}
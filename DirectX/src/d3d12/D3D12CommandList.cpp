@@ -0,0 +1,150 @@
+#include "dxpch.h"
+#include "D3D12CommandList.h"
+
+D3D12CommandList::D3D12CommandList(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
+	:	CommandList(type)
+{
+	ThrowIfFailed(device->CreateCommandAllocator(type, IID_PPV_ARGS(&m_commandAllocator)));
+	ThrowIfFailed(device->CreateCommandList(0, type, m_commandAllocator.Get(), nullptr, IID_PPV_ARGS(&m_commandList)));
+}
+
+void D3D12CommandList::reset()
+{
+	ThrowIfFailed(m_commandAllocator->Reset());
+	ThrowIfFailed(m_commandList->Reset(m_commandAllocator.Get(), nullptr));
+
+	CommandList::reset();
+}
+
+void D3D12CommandList::close()
+{
+	ThrowIfFailed(m_commandList->Close());
+}
+
+void D3D12CommandList::resourceBarrier(uint32_t numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+	m_commandList->ResourceBarrier(numBarriers, barriers);
+}
+
+void D3D12CommandList::copyBufferRegion(ID3D12Resource* dstBuffer, uint64_t dstOffset, ID3D12Resource* srcBuffer, uint64_t srcOffset, uint64_t numBytes)
+{
+	m_commandList->CopyBufferRegion(dstBuffer, dstOffset, srcBuffer, srcOffset, numBytes);
+}
+
+void D3D12CommandList::copyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION& dst, uint32_t dstX, uint32_t dstY, uint32_t dstZ,
+	const D3D12_TEXTURE_COPY_LOCATION& src, const D3D12_BOX* srcBox)
+{
+	m_commandList->CopyTextureRegion(&dst, dstX, dstY, dstZ, &src, srcBox);
+}
+
+void D3D12CommandList::clearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const float clearColor[4])
+{
+	m_commandList->ClearRenderTargetView(rtv, clearColor, 0, nullptr);
+}
+
+void D3D12CommandList::clearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags, float depth, uint8_t stencil)
+{
+	m_commandList->ClearDepthStencilView(dsv, clearFlags, depth, stencil, 0, nullptr);
+}
+
+void D3D12CommandList::setPipelineState(ID3D12PipelineState* pipelineState)
+{
+	m_commandList->SetPipelineState(pipelineState);
+}
+
+void D3D12CommandList::setGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+	m_commandList->SetGraphicsRootSignature(rootSignature);
+}
+
+void D3D12CommandList::setComputeRootSignature(ID3D12RootSignature* rootSignature)
+{
+	m_commandList->SetComputeRootSignature(rootSignature);
+}
+
+void D3D12CommandList::setGraphicsRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	m_commandList->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+}
+
+void D3D12CommandList::setComputeRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	m_commandList->SetComputeRootDescriptorTable(rootParameterIndex, baseDescriptor);
+}
+
+void D3D12CommandList::setGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues)
+{
+	m_commandList->SetGraphicsRoot32BitConstants(rootParameterIndex, num32BitValues, data, destOffsetIn32BitValues);
+}
+
+void D3D12CommandList::setComputeRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues)
+{
+	m_commandList->SetComputeRoot32BitConstants(rootParameterIndex, num32BitValues, data, destOffsetIn32BitValues);
+}
+
+void D3D12CommandList::setGraphicsRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	m_commandList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+}
+
+void D3D12CommandList::setComputeRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	m_commandList->SetComputeRootConstantBufferView(rootParameterIndex, bufferLocation);
+}
+
+void D3D12CommandList::setPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology)
+{
+	m_commandList->IASetPrimitiveTopology(primitiveTopology);
+}
+
+void D3D12CommandList::setVertexBuffers(uint32_t startSlot, uint32_t numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+	m_commandList->IASetVertexBuffers(startSlot, numViews, views);
+}
+
+void D3D12CommandList::setIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+	m_commandList->IASetIndexBuffer(view);
+}
+
+void D3D12CommandList::setViewports(uint32_t numViewports, const D3D12_VIEWPORT* viewports)
+{
+	m_commandList->RSSetViewports(numViewports, viewports);
+}
+
+void D3D12CommandList::setScissorRects(uint32_t numRects, const D3D12_RECT* rects)
+{
+	m_commandList->RSSetScissorRects(numRects, rects);
+}
+
+void D3D12CommandList::setRenderTargets(uint32_t numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+{
+	m_commandList->OMSetRenderTargets(numRenderTargets, rtvs, FALSE, dsv);
+}
+
+void D3D12CommandList::drawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation,
+	int32_t baseVertexLocation, uint32_t startInstanceLocation)
+{
+	m_commandList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+void D3D12CommandList::dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ)
+{
+	m_commandList->Dispatch(threadGroupCountX, threadGroupCountY, threadGroupCountZ);
+}
+
+void D3D12CommandList::endQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t index)
+{
+	m_commandList->EndQuery(queryHeap, type, index);
+}
+
+void D3D12CommandList::resolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t startIndex, uint32_t numQueries,
+	ID3D12Resource* destinationBuffer, uint64_t alignedDestinationBufferOffset)
+{
+	m_commandList->ResolveQueryData(queryHeap, type, startIndex, numQueries, destinationBuffer, alignedDestinationBufferOffset);
+}
+
+void D3D12CommandList::setDescriptorHeaps(uint32_t numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps)
+{
+	m_commandList->SetDescriptorHeaps(numDescriptorHeaps, descriptorHeaps);
+}
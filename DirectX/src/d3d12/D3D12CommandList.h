@@ -0,0 +1,65 @@
+#pragma once
+
+#include "CommandList.h"
+
+/*
+*	Command list backend which records into an ID3D12GraphicsCommandList2.
+*	Every command list owns its own command allocator, both are recycled together
+*	by the CommandQueue once the command list has finished executing.
+*/
+class D3D12CommandList : public CommandList
+{
+public:
+	D3D12CommandList(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
+	virtual ~D3D12CommandList() = default;
+
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> getD3D12CommandList() const { return m_commandList; }
+
+	void reset() override;
+	void close() override;
+
+	void resourceBarrier(uint32_t numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override;
+
+	void copyBufferRegion(ID3D12Resource* dstBuffer, uint64_t dstOffset, ID3D12Resource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) override;
+	void copyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION& dst, uint32_t dstX, uint32_t dstY, uint32_t dstZ,
+		const D3D12_TEXTURE_COPY_LOCATION& src, const D3D12_BOX* srcBox = nullptr) override;
+
+	void clearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const float clearColor[4]) override;
+	void clearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags, float depth, uint8_t stencil) override;
+
+	void setPipelineState(ID3D12PipelineState* pipelineState) override;
+	void setGraphicsRootSignature(ID3D12RootSignature* rootSignature) override;
+	void setComputeRootSignature(ID3D12RootSignature* rootSignature) override;
+
+	void setGraphicsRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override;
+	void setComputeRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override;
+
+	void setGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues = 0) override;
+	void setComputeRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues = 0) override;
+
+	void setGraphicsRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) override;
+	void setComputeRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) override;
+
+	void setPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology) override;
+	void setVertexBuffers(uint32_t startSlot, uint32_t numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override;
+	void setIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override;
+
+	void setViewports(uint32_t numViewports, const D3D12_VIEWPORT* viewports) override;
+	void setScissorRects(uint32_t numRects, const D3D12_RECT* rects) override;
+	void setRenderTargets(uint32_t numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) override;
+
+	void drawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation,
+		int32_t baseVertexLocation, uint32_t startInstanceLocation) override;
+	void dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) override;
+
+	void endQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t index) override;
+	void resolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t startIndex, uint32_t numQueries,
+		ID3D12Resource* destinationBuffer, uint64_t alignedDestinationBufferOffset) override;
+
+protected:
+	void setDescriptorHeaps(uint32_t numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps) override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12CommandAllocator>		m_commandAllocator;
+	Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>	m_commandList;
+};
\ No newline at end of file
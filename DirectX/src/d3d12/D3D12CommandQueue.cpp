@@ -0,0 +1,100 @@
+#include "dxpch.h"
+#include "D3D12CommandQueue.h"
+#include "D3D12CommandList.h"
+
+D3D12CommandQueue::D3D12CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type)
+    :   CommandQueue(type),
+        m_device(device),
+        m_timestampFrequency(0)
+{
+    D3D12_COMMAND_QUEUE_DESC desc = {};
+    desc.Type = type;
+    desc.Priority = D3D12_COMMAND_QUEUE_PRIORITY_NORMAL;
+    desc.Flags = D3D12_COMMAND_QUEUE_FLAG_NONE;
+    desc.NodeMask = 0;
+
+    ThrowIfFailed(m_device->CreateCommandQueue(&desc, IID_PPV_ARGS(&m_commandQueue)));
+    ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_fence)));
+
+    m_fenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    // Timestamps on copy queues are optional
+    bool timestampsSupported = true;
+    if (type == D3D12_COMMAND_LIST_TYPE_COPY)
+    {
+        D3D12_FEATURE_DATA_D3D12_OPTIONS3 options = {};
+        timestampsSupported = SUCCEEDED(m_device->CheckFeatureSupport(D3D12_FEATURE_D3D12_OPTIONS3, &options, sizeof(options))) &&
+            options.CopyQueueTimestampQueriesSupported;
+    }
+
+    if (timestampsSupported && FAILED(m_commandQueue->GetTimestampFrequency(&m_timestampFrequency)))
+    {
+        m_timestampFrequency = 0;
+    }
+}
+
+D3D12CommandQueue::~D3D12CommandQueue()
+{
+    stopRetireThread();
+
+    ::CloseHandle(m_fenceEvent);
+}
+
+std::shared_ptr<CommandList> D3D12CommandQueue::createCommandList()
+{
+    return std::make_shared<D3D12CommandList>(m_device, getType());
+}
+
+void D3D12CommandQueue::submitCommandLists(uint32_t numCommandLists, CommandList* const* commandLists)
+{
+    m_d3d12CommandLists.resize(numCommandLists);
+    for (uint32_t i = 0; i < numCommandLists; ++i)
+    {
+        m_d3d12CommandLists[i] = static_cast<D3D12CommandList*>(commandLists[i])->getD3D12CommandList().Get();
+    }
+
+    m_commandQueue->ExecuteCommandLists(numCommandLists, m_d3d12CommandLists.data());
+}
+
+void D3D12CommandQueue::signalFence(uint64_t fenceValue)
+{
+    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), fenceValue));
+}
+
+uint64_t D3D12CommandQueue::getCompletedFenceValue()
+{
+    return m_fence->GetCompletedValue();
+}
+
+void D3D12CommandQueue::getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuTime)
+{
+    UINT64 cpuTimestamp;
+    ThrowIfFailed(m_commandQueue->GetClockCalibration(&gpuTimestamp, &cpuTimestamp));
+
+    // The CPU timestamp is a performance counter value, which steady_clock (and so the profiler) is based on
+    LARGE_INTEGER frequency;
+    ::QueryPerformanceFrequency(&frequency);
+
+    uint64_t ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+    cpuTime = cpuTimestamp / ticksPerSecond * 1000000000 + cpuTimestamp % ticksPerSecond * 1000000000 / ticksPerSecond;
+}
+
+void D3D12CommandQueue::waitForQueueFence(CommandQueue& commandQueue, uint64_t fenceValue)
+{
+    D3D12CommandQueue& d3d12CommandQueue = static_cast<D3D12CommandQueue&>(commandQueue);
+    ThrowIfFailed(m_commandQueue->Wait(d3d12CommandQueue.m_fence.Get(), fenceValue));
+}
+
+void D3D12CommandQueue::waitForFence(uint64_t fenceValue, std::chrono::milliseconds duration)
+{
+    // Without an event the call blocks until the fence is reached, so the retire thread and
+    // the thread which waits with a timeout do not share the event.
+    if (duration == std::chrono::milliseconds::max())
+    {
+        ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, nullptr));
+        return;
+    }
+
+    ThrowIfFailed(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent));
+    ::WaitForSingleObject(m_fenceEvent, static_cast<DWORD>(duration.count()));
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "CommandQueue.h"
+
+/*
+*	Command queue backend which submits to an ID3D12CommandQueue and
+*	uses an ID3D12Fence (with a Win32 event) for synchronization.
+*/
+class D3D12CommandQueue : public CommandQueue
+{
+public:
+	D3D12CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device, D3D12_COMMAND_LIST_TYPE type);
+	virtual ~D3D12CommandQueue();
+
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue> getD3D12CommandQueue() const { return m_commandQueue; }
+	Microsoft::WRL::ComPtr<ID3D12Fence> getD3D12Fence() const { return m_fence; }
+
+	uint64_t getTimestampFrequency() const override { return m_timestampFrequency; }
+	void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuTime) override;
+
+protected:
+	std::shared_ptr<CommandList> createCommandList() override;
+	void submitCommandLists(uint32_t numCommandLists, CommandList* const* commandLists) override;
+	void signalFence(uint64_t fenceValue) override;
+	uint64_t getCompletedFenceValue() override;
+	void waitForQueueFence(CommandQueue& commandQueue, uint64_t fenceValue) override;
+	void waitForFence(uint64_t fenceValue, std::chrono::milliseconds duration) override;
+
+private:
+	Microsoft::WRL::ComPtr<ID3D12Device2>       m_device;
+	Microsoft::WRL::ComPtr<ID3D12CommandQueue>  m_commandQueue;
+	Microsoft::WRL::ComPtr<ID3D12Fence>         m_fence;
+	HANDLE                                      m_fenceEvent;
+	uint64_t                                    m_timestampFrequency;
+
+	// The command lists of a submission, kept to avoid an allocation per submission
+	std::vector<ID3D12CommandList*>             m_d3d12CommandLists;
+};
\ No newline at end of file
@@ -0,0 +1,259 @@
+#include "dxpch.h"
+#include "D3D12Device.h"
+#include "D3D12CommandQueue.h"
+#include "D3D12SwapChain.h"
+#include "Window.h"
+
+std::shared_ptr<Device> Device::CreateD3D12Device(bool useWarp)
+{
+	return std::make_shared<D3D12Device>(useWarp);
+}
+
+D3D12Device::D3D12Device(bool useWarp)
+{
+	ComPtr<IDXGIAdapter4> adapter = getAdapter(useWarp);
+	m_device = createDevice(adapter);
+}
+
+std::shared_ptr<CommandQueue> D3D12Device::createCommandQueue(D3D12_COMMAND_LIST_TYPE type)
+{
+	return std::make_shared<D3D12CommandQueue>(m_device, type);
+}
+
+std::shared_ptr<SwapChain> D3D12Device::createSwapChain(std::shared_ptr<CommandQueue> commandQueue, const Window& window,
+	uint32_t width, uint32_t height, uint32_t bufferCount, bool tearingSupported)
+{
+	auto d3d12CommandQueue = std::static_pointer_cast<D3D12CommandQueue>(commandQueue);
+
+	return std::make_shared<D3D12SwapChain>(shared_from_this(), d3d12CommandQueue->getD3D12CommandQueue(),
+		width, height, bufferCount, window.getWindowHandle(), tearingSupported);
+}
+
+Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> D3D12Device::createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC& desc)
+{
+	ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+	ThrowIfFailed(m_device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&descriptorHeap)));
+
+	return descriptorHeap;
+}
+
+uint32_t D3D12Device::getDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const
+{
+	return m_device->GetDescriptorHandleIncrementSize(type);
+}
+
+void D3D12Device::copyDescriptors(uint32_t numDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* destDescriptorRangeStarts, const UINT* destDescriptorRangeSizes,
+	uint32_t numSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptorRangeStarts, const UINT* srcDescriptorRangeSizes,
+	D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+	m_device->CopyDescriptors(numDestDescriptorRanges, destDescriptorRangeStarts, destDescriptorRangeSizes,
+		numSrcDescriptorRanges, srcDescriptorRangeStarts, srcDescriptorRangeSizes, type);
+}
+
+void D3D12Device::copyDescriptorsSimple(uint32_t numDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptorRangeStart,
+	D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptorRangeStart, D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+	m_device->CopyDescriptorsSimple(numDescriptors, destDescriptorRangeStart, srcDescriptorRangeStart, type);
+}
+
+void D3D12Device::createConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	m_device->CreateConstantBufferView(&desc, destDescriptor);
+}
+
+void D3D12Device::createRenderTargetView(ID3D12Resource* resource, const D3D12_RENDER_TARGET_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	m_device->CreateRenderTargetView(resource, desc, destDescriptor);
+}
+
+void D3D12Device::createDepthStencilView(ID3D12Resource* resource, const D3D12_DEPTH_STENCIL_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	m_device->CreateDepthStencilView(resource, desc, destDescriptor);
+}
+
+void D3D12Device::createSampler(const D3D12_SAMPLER_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	m_device->CreateSampler(&desc, destDescriptor);
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> D3D12Device::createCommittedResource(const D3D12_HEAP_PROPERTIES& heapProperties, D3D12_HEAP_FLAGS heapFlags,
+	const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue)
+{
+	ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(m_device->CreateCommittedResource(
+		&heapProperties,
+		heapFlags,
+		&desc,
+		initialState,
+		optimizedClearValue,
+		IID_PPV_ARGS(&resource)
+	));
+
+	return resource;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Heap> D3D12Device::createHeap(const D3D12_HEAP_DESC& desc)
+{
+	ComPtr<ID3D12Heap> heap;
+	ThrowIfFailed(m_device->CreateHeap(&desc, IID_PPV_ARGS(&heap)));
+
+	return heap;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> D3D12Device::createPlacedResource(ID3D12Heap* heap, uint64_t heapOffset, const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue)
+{
+	ComPtr<ID3D12Resource> resource;
+	ThrowIfFailed(m_device->CreatePlacedResource(
+		heap,
+		heapOffset,
+		&desc,
+		initialState,
+		optimizedClearValue,
+		IID_PPV_ARGS(&resource)
+	));
+
+	return resource;
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO D3D12Device::getResourceAllocationInfo(const D3D12_RESOURCE_DESC& desc)
+{
+	return m_device->GetResourceAllocationInfo(0, 1, &desc);
+}
+
+void D3D12Device::getCopyableFootprints(const D3D12_RESOURCE_DESC& desc, uint32_t firstSubresource, uint32_t numSubresources, uint64_t baseOffset,
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizesInBytes, UINT64* totalBytes)
+{
+	m_device->GetCopyableFootprints(&desc, firstSubresource, numSubresources, baseOffset, layouts, numRows, rowSizesInBytes, totalBytes);
+}
+
+Microsoft::WRL::ComPtr<ID3D12QueryHeap> D3D12Device::createQueryHeap(const D3D12_QUERY_HEAP_DESC& desc)
+{
+	ComPtr<ID3D12QueryHeap> queryHeap;
+	ThrowIfFailed(m_device->CreateQueryHeap(&desc, IID_PPV_ARGS(&queryHeap)));
+
+	return queryHeap;
+}
+
+D3D_ROOT_SIGNATURE_VERSION D3D12Device::getHighestRootSignatureVersion()
+{
+	D3D12_FEATURE_DATA_ROOT_SIGNATURE featureData{};
+	featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_1;
+	if (FAILED(m_device->CheckFeatureSupport(D3D12_FEATURE_ROOT_SIGNATURE, &featureData, sizeof(featureData))))
+	{
+		featureData.HighestVersion = D3D_ROOT_SIGNATURE_VERSION_1_0;
+	}
+
+	return featureData.HighestVersion;
+}
+
+Microsoft::WRL::ComPtr<ID3D12RootSignature> D3D12Device::createRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, D3D_ROOT_SIGNATURE_VERSION version)
+{
+	// Serialize the root signature.
+	ComPtr<ID3DBlob> rootSignatureBlob;
+	ComPtr<ID3DBlob> errorBlob;
+	ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&desc, version, &rootSignatureBlob, &errorBlob));
+
+	// Create the root signature.
+	ComPtr<ID3D12RootSignature> rootSignature;
+	ThrowIfFailed(m_device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(),
+		rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&rootSignature)));
+
+	return rootSignature;
+}
+
+Microsoft::WRL::ComPtr<ID3D12PipelineState> D3D12Device::createPipelineState(const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+{
+	ComPtr<ID3D12PipelineState> pipelineState;
+	ThrowIfFailed(m_device->CreatePipelineState(&desc, IID_PPV_ARGS(&pipelineState)));
+
+	return pipelineState;
+}
+
+Microsoft::WRL::ComPtr<IDXGIAdapter4> D3D12Device::getAdapter(bool useWarp)
+{
+	ComPtr<IDXGIFactory4> dxgiFactory;
+	UINT createFactoryFlags = 0;
+#if defined(_DEBUG)
+	createFactoryFlags = DXGI_CREATE_FACTORY_DEBUG;
+#endif
+
+	ThrowIfFailed(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory)));
+
+	ComPtr<IDXGIAdapter1> dxgiAdapter1;
+	ComPtr<IDXGIAdapter4> dxgiAdapter4;
+
+	if (useWarp)
+	{
+		ThrowIfFailed(dxgiFactory->EnumWarpAdapter(IID_PPV_ARGS(&dxgiAdapter1)));
+		ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
+	}
+	else
+	{
+		SIZE_T maxDedicatedVideoMemory = 0;
+		for (UINT i = 0; dxgiFactory->EnumAdapters1(i, &dxgiAdapter1) != DXGI_ERROR_NOT_FOUND; ++i)
+		{
+			DXGI_ADAPTER_DESC1 dxgiAdapterDesc1;
+			dxgiAdapter1->GetDesc1(&dxgiAdapterDesc1);
+
+			// Check to see if the adapter can create a D3D12 device without actually
+			// creating it. The adapter with the largest dedicated video memory
+			// is favored.
+			if ((dxgiAdapterDesc1.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) == 0 &&
+				SUCCEEDED(D3D12CreateDevice(dxgiAdapter1.Get(),
+					D3D_FEATURE_LEVEL_11_0, __uuidof(ID3D12Device), nullptr)) &&
+				dxgiAdapterDesc1.DedicatedVideoMemory > maxDedicatedVideoMemory)
+			{
+				maxDedicatedVideoMemory = dxgiAdapterDesc1.DedicatedVideoMemory;
+				ThrowIfFailed(dxgiAdapter1.As(&dxgiAdapter4));
+			}
+		}
+	}
+
+	return dxgiAdapter4;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Device2> D3D12Device::createDevice(Microsoft::WRL::ComPtr<IDXGIAdapter4> adapter)
+{
+	ComPtr<ID3D12Device2> d3d12Device2;
+	ThrowIfFailed(D3D12CreateDevice(adapter.Get(), D3D_FEATURE_LEVEL_11_0, IID_PPV_ARGS(&d3d12Device2)));
+
+	// Enable debug messages in debug mode.
+#if defined(_DEBUG)
+	ComPtr<ID3D12InfoQueue> pInfoQueue;
+	if (SUCCEEDED(d3d12Device2.As(&pInfoQueue)))
+	{
+		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_CORRUPTION, TRUE);
+		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_ERROR, TRUE);
+		pInfoQueue->SetBreakOnSeverity(D3D12_MESSAGE_SEVERITY_WARNING, TRUE);
+
+		// Suppress whole categories of messages
+		//D3D12_MESSAGE_CATEGORY Categories[] = {};
+
+		// Suppress messages based on their severity level
+		D3D12_MESSAGE_SEVERITY Severities[] =
+		{
+			D3D12_MESSAGE_SEVERITY_INFO
+		};
+
+		// Suppress individual messages by their ID
+		D3D12_MESSAGE_ID DenyIds[] = {
+			D3D12_MESSAGE_ID_CLEARRENDERTARGETVIEW_MISMATCHINGCLEARVALUE,   // I'm really not sure how to avoid this message.
+			D3D12_MESSAGE_ID_MAP_INVALID_NULLRANGE,                         // This warning occurs when using capture frame while graphics debugging.
+			D3D12_MESSAGE_ID_UNMAP_INVALID_NULLRANGE,                       // This warning occurs when using capture frame while graphics debugging.
+		};
+
+		D3D12_INFO_QUEUE_FILTER NewFilter = {};
+		//NewFilter.DenyList.NumCategories = _countof(Categories);
+		//NewFilter.DenyList.pCategoryList = Categories;
+		NewFilter.DenyList.NumSeverities = _countof(Severities);
+		NewFilter.DenyList.pSeverityList = Severities;
+		NewFilter.DenyList.NumIDs = _countof(DenyIds);
+		NewFilter.DenyList.pIDList = DenyIds;
+
+		ThrowIfFailed(pInfoQueue->PushStorageFilter(&NewFilter));
+	}
+#endif
+
+	return d3d12Device2;
+}
@@ -0,0 +1,114 @@
+#include "dxpch.h"
+#include "D3D12SwapChain.h"
+
+D3D12SwapChain::D3D12SwapChain(std::shared_ptr<Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+    uint32_t width, uint32_t height, uint32_t bufferCount, HWND windowHandle, bool tearingSupported)
+    :   SwapChain(device, bufferCount),
+        m_isTearingSupported(tearingSupported)
+{
+    ComPtr<IDXGIFactory4> dxgiFactory4;
+    UINT createFactoryFlags = 0;
+#if defined(_DEBUG)
+    createFactoryFlags = DXGI_CREATE_FACTORY_DEBUG;
+#endif
+
+    ThrowIfFailed(CreateDXGIFactory2(createFactoryFlags, IID_PPV_ARGS(&dxgiFactory4)));
+
+    DXGI_SWAP_CHAIN_DESC1 swapChainDesc = {};
+    swapChainDesc.Width = width;
+    swapChainDesc.Height = height;
+    swapChainDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    swapChainDesc.Stereo = FALSE;
+    swapChainDesc.SampleDesc = { 1, 0 };
+    swapChainDesc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+    swapChainDesc.BufferCount = m_bufferCount;
+    swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
+    swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
+    swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_UNSPECIFIED;
+    // It is recommended to always allow tearing if tearing support is available.
+    swapChainDesc.Flags = m_isTearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+    // The frame latency is controlled with a waitable object instead of blocking in Present
+    swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+
+    ComPtr<IDXGISwapChain1> swapChain1;
+    ThrowIfFailed(dxgiFactory4->CreateSwapChainForHwnd(
+        commandQueue.Get(),
+        windowHandle,
+        &swapChainDesc,
+        nullptr,
+        nullptr,
+        &swapChain1));
+
+    // Disable the Alt+Enter fullscreen toggle feature. Switching to fullscreen
+    // will be handled manually.
+    ThrowIfFailed(dxgiFactory4->MakeWindowAssociation(windowHandle, DXGI_MWA_NO_ALT_ENTER));
+
+    ThrowIfFailed(swapChain1.As(&m_swapChain));
+
+    m_currentBackBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+    ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(1));
+    m_frameLatencyWaitableObject = m_swapChain->GetFrameLatencyWaitableObject();
+
+    updateBackBuffers();
+}
+
+D3D12SwapChain::~D3D12SwapChain()
+{
+    ::CloseHandle(m_frameLatencyWaitableObject);
+}
+
+uint32_t D3D12SwapChain::present()
+{
+    UINT syncInterval = m_vSync ? 1 : 0;
+    UINT presentFlags = m_isTearingSupported && !m_vSync ? DXGI_PRESENT_ALLOW_TEARING : 0;
+    ThrowIfFailed(m_swapChain->Present(syncInterval, presentFlags));
+    m_currentBackBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+    return m_currentBackBufferIndex;
+}
+
+void D3D12SwapChain::resize(uint32_t width, uint32_t height)
+{
+    for (uint32_t i = 0; i < m_bufferCount; ++i)
+    {
+        // Any references to the back buffers must be released
+        // before the swap chain can be resized.
+        m_backBuffers[i].Reset();
+    }
+
+    DXGI_SWAP_CHAIN_DESC swapChainDesc = {};
+    ThrowIfFailed(m_swapChain->GetDesc(&swapChainDesc));
+    ThrowIfFailed(m_swapChain->ResizeBuffers(m_bufferCount, width, height,
+        swapChainDesc.BufferDesc.Format, swapChainDesc.Flags));
+
+    m_currentBackBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
+
+    updateBackBuffers();
+}
+
+void D3D12SwapChain::setMaximumFrameLatency(uint32_t maxLatency)
+{
+    ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(maxLatency));
+}
+
+bool D3D12SwapChain::waitForNextFrame(std::chrono::milliseconds timeout)
+{
+    DWORD milliseconds = timeout == std::chrono::milliseconds::max() ? INFINITE : static_cast<DWORD>(timeout.count());
+    return ::WaitForSingleObjectEx(m_frameLatencyWaitableObject, milliseconds, TRUE) == WAIT_OBJECT_0;
+}
+
+void D3D12SwapChain::updateBackBuffers()
+{
+    m_backBuffers.clear();
+
+    for (uint32_t i = 0; i < m_bufferCount; ++i)
+    {
+        ComPtr<ID3D12Resource> backBuffer;
+        ThrowIfFailed(m_swapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffer)));
+
+        m_backBuffers.push_back(backBuffer);
+    }
+
+    updateRenterTargetViews();
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "SwapChain.h"
+
+#include <dxgi1_6.h>
+
+/*
+*	Swap chain backend which presents to a window using DXGI.
+*/
+class D3D12SwapChain : public SwapChain
+{
+public:
+	D3D12SwapChain(std::shared_ptr<Device> device, Microsoft::WRL::ComPtr<ID3D12CommandQueue> commandQueue,
+		uint32_t width, uint32_t height, uint32_t bufferCount, HWND windowHandle, bool tearingSupported);
+	virtual ~D3D12SwapChain();
+
+	uint32_t present() override;
+
+	void resize(uint32_t width, uint32_t height) override;
+
+	void setMaximumFrameLatency(uint32_t maxLatency) override;
+	bool waitForNextFrame(std::chrono::milliseconds timeout) override;
+
+private:
+	// Get the back buffers from the DXGI swap chain and create their render target views
+	void updateBackBuffers();
+
+private:
+	Microsoft::WRL::ComPtr<IDXGISwapChain4>				m_swapChain;
+	// Signaled when the swap chain can take another frame
+	HANDLE												m_frameLatencyWaitableObject;
+
+	bool												m_isTearingSupported;
+};
\ No newline at end of file
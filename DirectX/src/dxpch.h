@@ -1,8 +1,15 @@
 #pragma once
 
+#if defined(_WIN32)
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <shellapi.h> // For CommandLineToArgvW
+#else
+// Outside of Windows the DirectX-Headers (https://github.com/microsoft/DirectX-Headers)
+// provide the Win32 types and COM helpers. Only the null device can be used there.
+#include <wsl/winadapter.h>
+#include <wsl/wrladapter.h>
+#endif
 
 // The min/max macros conflict with like-named member functions.
 // Only use std::min and std::max defined in <algorithm>.
@@ -21,13 +28,17 @@
 #endif
 
 // Windows Runtime Library. Needed for Microsoft::WRL::ComPtr<> template class.
+#if defined(_WIN32)
 #include <wrl.h>
+#endif
 using namespace Microsoft::WRL;
 
 // DirectX 12 specific headers.
 #include <d3d12.h>
+#if defined(_WIN32)
 #include <dxgi1_6.h>
 #include <d3dcompiler.h>
+#endif
 #include <DirectXMath.h>
 
 // D3D12 extension library.
@@ -37,8 +48,43 @@ using namespace Microsoft::WRL;
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cstdio>
+#include <limits>
 #include <map>
 #include <memory>
 
+#if !defined(_WIN32)
+#include <cstring>
+
+// MSVC intrinsics and macros which are used by the renderer.
+template<typename Index>
+inline unsigned char _BitScanForward(Index* index, uint32_t mask)
+{
+	if (mask == 0)
+	{
+		return 0;
+	}
+
+	*index = static_cast<Index>(__builtin_ctz(mask));
+	return 1;
+}
+
+template<typename Index>
+inline unsigned char _BitScanReverse(Index* index, uint32_t mask)
+{
+	if (mask == 0)
+	{
+		return 0;
+	}
+
+	*index = static_cast<Index>(31 - __builtin_clz(mask));
+	return 1;
+}
+
+#if !defined(_countof)
+#define _countof(array) (sizeof(array) / sizeof(array[0]))
+#endif
+#endif
+
 // Helper functions
 #include "Helpers.h"
@@ -0,0 +1,351 @@
+#include "dxpch.h"
+#include "NullCommandList.h"
+#include "NullObjects.h"
+
+namespace
+{
+	struct NullCopyBufferRegion
+	{
+		ID3D12Resource* dstBuffer;
+		uint64_t dstOffset;
+		ID3D12Resource* srcBuffer;
+		uint64_t srcOffset;
+		uint64_t numBytes;
+	};
+
+	struct NullCopyTextureRegion
+	{
+		D3D12_TEXTURE_COPY_LOCATION dst;
+		uint32_t dstX, dstY, dstZ;
+		D3D12_TEXTURE_COPY_LOCATION src;
+		D3D12_BOX srcBox;
+		bool hasSrcBox;
+	};
+
+	struct NullClearRenderTargetView
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+		float clearColor[4];
+	};
+
+	struct NullClearDepthStencilView
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+		D3D12_CLEAR_FLAGS clearFlags;
+		float depth;
+		uint8_t stencil;
+	};
+
+	struct NullSetRootDescriptorTable
+	{
+		uint32_t rootParameterIndex;
+		D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor;
+	};
+
+	struct NullSetRoot32BitConstants
+	{
+		uint32_t rootParameterIndex;
+		uint32_t destOffsetIn32BitValues;
+	};
+
+	struct NullSetRootConstantBufferView
+	{
+		uint32_t rootParameterIndex;
+		D3D12_GPU_VIRTUAL_ADDRESS bufferLocation;
+	};
+
+	struct NullSetRenderTargets
+	{
+		D3D12_CPU_DESCRIPTOR_HANDLE dsv;
+		bool hasDsv;
+	};
+
+	struct NullDrawIndexedInstanced
+	{
+		uint32_t indexCountPerInstance;
+		uint32_t instanceCount;
+		uint32_t startIndexLocation;
+		int32_t baseVertexLocation;
+		uint32_t startInstanceLocation;
+	};
+
+	struct NullDispatch
+	{
+		uint32_t threadGroupCountX;
+		uint32_t threadGroupCountY;
+		uint32_t threadGroupCountZ;
+	};
+
+	struct NullEndQuery
+	{
+		ID3D12QueryHeap* queryHeap;
+		D3D12_QUERY_TYPE type;
+		uint32_t index;
+	};
+
+	struct NullResolveQueryData
+	{
+		ID3D12QueryHeap* queryHeap;
+		D3D12_QUERY_TYPE type;
+		uint32_t startIndex;
+		uint32_t numQueries;
+		ID3D12Resource* destinationBuffer;
+		uint64_t alignedDestinationBufferOffset;
+	};
+}
+
+NullCommandList::NullCommandList(D3D12_COMMAND_LIST_TYPE type)
+	:	CommandList(type),
+		m_numCommands(0),
+		m_numQueries(0),
+		m_isClosed(false)
+{
+}
+
+void NullCommandList::reset()
+{
+	// Keep the capacity of the stream, just like a command allocator keeps its memory
+	m_commandStream.clear();
+	m_numCommands = 0;
+	m_numQueries = 0;
+	m_isClosed = false;
+
+	CommandList::reset();
+}
+
+void NullCommandList::close()
+{
+	assert(!m_isClosed && "Command list is already closed");
+	m_isClosed = true;
+}
+
+template<typename Arguments, typename Element>
+void NullCommandList::record(NullCommandType type, const Arguments& arguments, uint32_t numElements, const Element* elements)
+{
+	assert(!m_isClosed && "Recording into a closed command list");
+
+	size_t elementsSize = static_cast<size_t>(numElements) * sizeof(Element);
+
+	NullCommandHeader header;
+	header.type = type;
+	header.size = static_cast<uint32_t>(sizeof(NullCommandHeader) + sizeof(Arguments) + elementsSize);
+
+	size_t offset = m_commandStream.size();
+	m_commandStream.resize(offset + header.size);
+
+	uint8_t* data = m_commandStream.data() + offset;
+	memcpy(data, &header, sizeof(NullCommandHeader));
+	memcpy(data + sizeof(NullCommandHeader), &arguments, sizeof(Arguments));
+	if (elementsSize > 0)
+	{
+		memcpy(data + sizeof(NullCommandHeader) + sizeof(Arguments), elements, elementsSize);
+	}
+
+	m_numCommands++;
+}
+
+void NullCommandList::resourceBarrier(uint32_t numBarriers, const D3D12_RESOURCE_BARRIER* barriers)
+{
+	record(NullCommandType::ResourceBarrier, numBarriers, numBarriers, barriers);
+}
+
+void NullCommandList::copyBufferRegion(ID3D12Resource* dstBuffer, uint64_t dstOffset, ID3D12Resource* srcBuffer, uint64_t srcOffset, uint64_t numBytes)
+{
+	record(NullCommandType::CopyBufferRegion, NullCopyBufferRegion{ dstBuffer, dstOffset, srcBuffer, srcOffset, numBytes });
+}
+
+void NullCommandList::copyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION& dst, uint32_t dstX, uint32_t dstY, uint32_t dstZ,
+	const D3D12_TEXTURE_COPY_LOCATION& src, const D3D12_BOX* srcBox)
+{
+	NullCopyTextureRegion arguments = {};
+	arguments.dst = dst;
+	arguments.dstX = dstX;
+	arguments.dstY = dstY;
+	arguments.dstZ = dstZ;
+	arguments.src = src;
+	arguments.hasSrcBox = srcBox != nullptr;
+	if (srcBox != nullptr)
+	{
+		arguments.srcBox = *srcBox;
+	}
+
+	record(NullCommandType::CopyTextureRegion, arguments);
+}
+
+void NullCommandList::clearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const float clearColor[4])
+{
+	NullClearRenderTargetView arguments;
+	arguments.rtv = rtv;
+	memcpy(arguments.clearColor, clearColor, sizeof(arguments.clearColor));
+
+	record(NullCommandType::ClearRenderTargetView, arguments);
+}
+
+void NullCommandList::clearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags, float depth, uint8_t stencil)
+{
+	record(NullCommandType::ClearDepthStencilView, NullClearDepthStencilView{ dsv, clearFlags, depth, stencil });
+}
+
+void NullCommandList::setPipelineState(ID3D12PipelineState* pipelineState)
+{
+	record(NullCommandType::SetPipelineState, pipelineState);
+}
+
+void NullCommandList::setGraphicsRootSignature(ID3D12RootSignature* rootSignature)
+{
+	record(NullCommandType::SetGraphicsRootSignature, rootSignature);
+}
+
+void NullCommandList::setComputeRootSignature(ID3D12RootSignature* rootSignature)
+{
+	record(NullCommandType::SetComputeRootSignature, rootSignature);
+}
+
+void NullCommandList::setGraphicsRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	record(NullCommandType::SetGraphicsRootDescriptorTable, NullSetRootDescriptorTable{ rootParameterIndex, baseDescriptor });
+}
+
+void NullCommandList::setComputeRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor)
+{
+	record(NullCommandType::SetComputeRootDescriptorTable, NullSetRootDescriptorTable{ rootParameterIndex, baseDescriptor });
+}
+
+void NullCommandList::setGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues)
+{
+	record(NullCommandType::SetGraphicsRoot32BitConstants, NullSetRoot32BitConstants{ rootParameterIndex, destOffsetIn32BitValues },
+		num32BitValues, static_cast<const uint32_t*>(data));
+}
+
+void NullCommandList::setComputeRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues)
+{
+	record(NullCommandType::SetComputeRoot32BitConstants, NullSetRoot32BitConstants{ rootParameterIndex, destOffsetIn32BitValues },
+		num32BitValues, static_cast<const uint32_t*>(data));
+}
+
+void NullCommandList::setGraphicsRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	record(NullCommandType::SetGraphicsRootConstantBufferView, NullSetRootConstantBufferView{ rootParameterIndex, bufferLocation });
+}
+
+void NullCommandList::setComputeRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation)
+{
+	record(NullCommandType::SetComputeRootConstantBufferView, NullSetRootConstantBufferView{ rootParameterIndex, bufferLocation });
+}
+
+void NullCommandList::setPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology)
+{
+	record(NullCommandType::SetPrimitiveTopology, primitiveTopology);
+}
+
+void NullCommandList::setVertexBuffers(uint32_t startSlot, uint32_t numViews, const D3D12_VERTEX_BUFFER_VIEW* views)
+{
+	record(NullCommandType::SetVertexBuffers, startSlot, numViews, views);
+}
+
+void NullCommandList::setIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view)
+{
+	D3D12_INDEX_BUFFER_VIEW arguments = {};
+	if (view != nullptr)
+	{
+		arguments = *view;
+	}
+
+	record(NullCommandType::SetIndexBuffer, arguments);
+}
+
+void NullCommandList::setViewports(uint32_t numViewports, const D3D12_VIEWPORT* viewports)
+{
+	record(NullCommandType::SetViewports, numViewports, numViewports, viewports);
+}
+
+void NullCommandList::setScissorRects(uint32_t numRects, const D3D12_RECT* rects)
+{
+	record(NullCommandType::SetScissorRects, numRects, numRects, rects);
+}
+
+void NullCommandList::setRenderTargets(uint32_t numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv)
+{
+	NullSetRenderTargets arguments = {};
+	arguments.hasDsv = dsv != nullptr;
+	if (dsv != nullptr)
+	{
+		arguments.dsv = *dsv;
+	}
+
+	record(NullCommandType::SetRenderTargets, arguments, numRenderTargets, rtvs);
+}
+
+void NullCommandList::drawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation,
+	int32_t baseVertexLocation, uint32_t startInstanceLocation)
+{
+	record(NullCommandType::DrawIndexedInstanced,
+		NullDrawIndexedInstanced{ indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation });
+}
+
+void NullCommandList::dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ)
+{
+	record(NullCommandType::Dispatch, NullDispatch{ threadGroupCountX, threadGroupCountY, threadGroupCountZ });
+}
+
+void NullCommandList::endQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t index)
+{
+	record(NullCommandType::EndQuery, NullEndQuery{ queryHeap, type, index });
+	m_numQueries++;
+}
+
+void NullCommandList::resolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t startIndex, uint32_t numQueries,
+	ID3D12Resource* destinationBuffer, uint64_t alignedDestinationBufferOffset)
+{
+	record(NullCommandType::ResolveQueryData, NullResolveQueryData{ queryHeap, type, startIndex, numQueries, destinationBuffer, alignedDestinationBufferOffset });
+	m_numQueries++;
+}
+
+uint64_t NullCommandList::executeQueries(uint64_t timestamp) const
+{
+	if (m_numQueries == 0)
+	{
+		return timestamp + m_numCommands * TimestampTicksPerCommand;
+	}
+
+	for (size_t offset = 0; offset < m_commandStream.size();)
+	{
+		NullCommandHeader header;
+		memcpy(&header, m_commandStream.data() + offset, sizeof(NullCommandHeader));
+		const uint8_t* arguments = m_commandStream.data() + offset + sizeof(NullCommandHeader);
+
+		if (header.type == NullCommandType::EndQuery)
+		{
+			NullEndQuery endQuery;
+			memcpy(&endQuery, arguments, sizeof(NullEndQuery));
+
+			// Nothing is drawn, so occlusion queries pass no samples
+			NullQueryHeap* queryHeap = static_cast<NullQueryHeap*>(endQuery.queryHeap);
+			queryHeap->getResults()[endQuery.index] = endQuery.type == D3D12_QUERY_TYPE_TIMESTAMP ? timestamp : 0;
+		}
+		else if (header.type == NullCommandType::ResolveQueryData)
+		{
+			NullResolveQueryData resolve;
+			memcpy(&resolve, arguments, sizeof(NullResolveQueryData));
+
+			NullQueryHeap* queryHeap = static_cast<NullQueryHeap*>(resolve.queryHeap);
+			uint8_t* data;
+			ThrowIfFailed(resolve.destinationBuffer->Map(0, nullptr, reinterpret_cast<void**>(&data)));
+			memcpy(data + resolve.alignedDestinationBufferOffset, queryHeap->getResults() + resolve.startIndex, resolve.numQueries * sizeof(uint64_t));
+			resolve.destinationBuffer->Unmap(0, nullptr);
+		}
+		else
+		{
+			timestamp += TimestampTicksPerCommand;
+		}
+
+		offset += header.size;
+	}
+
+	return timestamp;
+}
+
+void NullCommandList::setDescriptorHeaps(uint32_t numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps)
+{
+	record(NullCommandType::SetDescriptorHeaps, numDescriptorHeaps, numDescriptorHeaps, descriptorHeaps);
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "CommandList.h"
+
+#include <vector>
+
+enum class NullCommandType : uint32_t
+{
+	ResourceBarrier,
+	CopyBufferRegion,
+	CopyTextureRegion,
+	ClearRenderTargetView,
+	ClearDepthStencilView,
+	SetPipelineState,
+	SetGraphicsRootSignature,
+	SetComputeRootSignature,
+	SetGraphicsRootDescriptorTable,
+	SetComputeRootDescriptorTable,
+	SetGraphicsRoot32BitConstants,
+	SetComputeRoot32BitConstants,
+	SetGraphicsRootConstantBufferView,
+	SetComputeRootConstantBufferView,
+	SetPrimitiveTopology,
+	SetVertexBuffers,
+	SetIndexBuffer,
+	SetViewports,
+	SetScissorRects,
+	SetRenderTargets,
+	SetDescriptorHeaps,
+	DrawIndexedInstanced,
+	Dispatch,
+	EndQuery,
+	ResolveQueryData
+};
+
+// Every command in the command stream starts with this header, followed by its arguments.
+struct NullCommandHeader
+{
+	NullCommandType type;
+	uint32_t size;	// The size of the whole command (header included) in bytes
+};
+
+/*
+*	Command list backend which serializes every command (and its arguments) into an
+*	in-memory command stream. Nothing is ever executed, but the recording costs the
+*	same kind of CPU work as filling a real command list.
+*/
+class NullCommandList : public CommandList
+{
+public:
+	explicit NullCommandList(D3D12_COMMAND_LIST_TYPE type);
+	virtual ~NullCommandList() = default;
+
+	// The synthetic GPU time of a command, in timestamp ticks (see NullCommandQueue::TimestampFrequency)
+	static const uint64_t TimestampTicksPerCommand = 100;
+
+	const std::vector<uint8_t>& getCommandStream() const { return m_commandStream; }
+	uint32_t getNumCommands() const { return m_numCommands; }
+
+	/*
+	* "Execute" the queries of the command list, called by NullCommandQueue on submission. Timestamps get the
+	* synthetic GPU time, which advances with every command, and resolved queries are copied to the CPU memory
+	* of their buffer. Returns the GPU time after the command list.
+	*/
+	uint64_t executeQueries(uint64_t timestamp) const;
+
+	void reset() override;
+	void close() override;
+
+	void resourceBarrier(uint32_t numBarriers, const D3D12_RESOURCE_BARRIER* barriers) override;
+
+	void copyBufferRegion(ID3D12Resource* dstBuffer, uint64_t dstOffset, ID3D12Resource* srcBuffer, uint64_t srcOffset, uint64_t numBytes) override;
+	void copyTextureRegion(const D3D12_TEXTURE_COPY_LOCATION& dst, uint32_t dstX, uint32_t dstY, uint32_t dstZ,
+		const D3D12_TEXTURE_COPY_LOCATION& src, const D3D12_BOX* srcBox = nullptr) override;
+
+	void clearRenderTargetView(D3D12_CPU_DESCRIPTOR_HANDLE rtv, const float clearColor[4]) override;
+	void clearDepthStencilView(D3D12_CPU_DESCRIPTOR_HANDLE dsv, D3D12_CLEAR_FLAGS clearFlags, float depth, uint8_t stencil) override;
+
+	void setPipelineState(ID3D12PipelineState* pipelineState) override;
+	void setGraphicsRootSignature(ID3D12RootSignature* rootSignature) override;
+	void setComputeRootSignature(ID3D12RootSignature* rootSignature) override;
+
+	void setGraphicsRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override;
+	void setComputeRootDescriptorTable(uint32_t rootParameterIndex, D3D12_GPU_DESCRIPTOR_HANDLE baseDescriptor) override;
+
+	void setGraphicsRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues = 0) override;
+	void setComputeRoot32BitConstants(uint32_t rootParameterIndex, uint32_t num32BitValues, const void* data, uint32_t destOffsetIn32BitValues = 0) override;
+
+	void setGraphicsRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) override;
+	void setComputeRootConstantBufferView(uint32_t rootParameterIndex, D3D12_GPU_VIRTUAL_ADDRESS bufferLocation) override;
+
+	void setPrimitiveTopology(D3D12_PRIMITIVE_TOPOLOGY primitiveTopology) override;
+	void setVertexBuffers(uint32_t startSlot, uint32_t numViews, const D3D12_VERTEX_BUFFER_VIEW* views) override;
+	void setIndexBuffer(const D3D12_INDEX_BUFFER_VIEW* view) override;
+
+	void setViewports(uint32_t numViewports, const D3D12_VIEWPORT* viewports) override;
+	void setScissorRects(uint32_t numRects, const D3D12_RECT* rects) override;
+	void setRenderTargets(uint32_t numRenderTargets, const D3D12_CPU_DESCRIPTOR_HANDLE* rtvs, const D3D12_CPU_DESCRIPTOR_HANDLE* dsv) override;
+
+	void drawIndexedInstanced(uint32_t indexCountPerInstance, uint32_t instanceCount, uint32_t startIndexLocation,
+		int32_t baseVertexLocation, uint32_t startInstanceLocation) override;
+	void dispatch(uint32_t threadGroupCountX, uint32_t threadGroupCountY, uint32_t threadGroupCountZ) override;
+
+	void endQuery(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t index) override;
+	void resolveQueryData(ID3D12QueryHeap* queryHeap, D3D12_QUERY_TYPE type, uint32_t startIndex, uint32_t numQueries,
+		ID3D12Resource* destinationBuffer, uint64_t alignedDestinationBufferOffset) override;
+
+protected:
+	void setDescriptorHeaps(uint32_t numDescriptorHeaps, ID3D12DescriptorHeap* const* descriptorHeaps) override;
+
+private:
+	// Write a command with its fixed size arguments and an optional array of trailing elements.
+	template<typename Arguments, typename Element = uint8_t>
+	void record(NullCommandType type, const Arguments& arguments, uint32_t numElements = 0, const Element* elements = nullptr);
+
+private:
+	std::vector<uint8_t>	m_commandStream;
+	uint32_t				m_numCommands;
+	// The queries and resolves, when there are none executeQueries does not have to parse the stream
+	uint32_t				m_numQueries;
+	bool					m_isClosed;
+};
\ No newline at end of file
@@ -0,0 +1,68 @@
+#include "dxpch.h"
+#include "NullCommandQueue.h"
+#include "NullCommandList.h"
+#include "Profiler.h"
+
+NullCommandQueue::NullCommandQueue(D3D12_COMMAND_LIST_TYPE type)
+    :   CommandQueue(type),
+        m_completedFenceValue(0),
+        m_gpuTimestamp(0),
+        m_numExecutedCommandLists(0),
+        m_numExecutedCommands(0),
+        m_numExecutedBytes(0)
+{
+}
+
+NullCommandQueue::~NullCommandQueue()
+{
+    stopRetireThread();
+}
+
+std::shared_ptr<CommandList> NullCommandQueue::createCommandList()
+{
+    return std::make_shared<NullCommandList>(getType());
+}
+
+void NullCommandQueue::getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuTime)
+{
+    cpuTime = Profiler::GetTime();
+    gpuTimestamp = cpuTime;
+}
+
+void NullCommandQueue::submitCommandLists(uint32_t numCommandLists, CommandList* const* commandLists)
+{
+    uint64_t timestamp = std::max(m_gpuTimestamp.load(), Profiler::GetTime());
+
+    for (uint32_t i = 0; i < numCommandLists; ++i)
+    {
+        NullCommandList* commandList = static_cast<NullCommandList*>(commandLists[i]);
+
+        m_numExecutedCommands += commandList->getNumCommands();
+        m_numExecutedBytes += commandList->getCommandStream().size();
+
+        timestamp = commandList->executeQueries(timestamp);
+    }
+
+    m_numExecutedCommandLists += numCommandLists;
+    m_gpuTimestamp = timestamp;
+}
+
+void NullCommandQueue::signalFence(uint64_t fenceValue)
+{
+    // There is no GPU to wait for, so the work is "done" as soon as it is signaled.
+    m_completedFenceValue = fenceValue;
+}
+
+uint64_t NullCommandQueue::getCompletedFenceValue()
+{
+    return m_completedFenceValue;
+}
+
+void NullCommandQueue::waitForQueueFence(CommandQueue& commandQueue, uint64_t fenceValue)
+{
+    // The fences of the other queues are complete as well
+}
+
+void NullCommandQueue::waitForFence(uint64_t fenceValue, std::chrono::milliseconds duration)
+{
+}
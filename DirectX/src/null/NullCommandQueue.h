@@ -0,0 +1,46 @@
+#pragma once
+
+#include "CommandQueue.h"
+
+#include <atomic>
+
+/*
+*	Command queue backend without a GPU. Submitted command lists are only counted
+*	and every fence is signaled immediately, so the CPU never waits on this queue.
+*
+*	Timestamps are synthetic: the "GPU" starts a submission when it is submitted (or when it has finished the
+*	previous one) and spends NullCommandList::TimestampTicksPerCommand on every command. The timestamps count
+*	nanoseconds of the profiler clock, so the GPU zones line up with the CPU zones in a trace.
+*/
+class NullCommandQueue : public CommandQueue
+{
+public:
+	static const uint64_t TimestampFrequency = 1000000000;
+
+	explicit NullCommandQueue(D3D12_COMMAND_LIST_TYPE type);
+	virtual ~NullCommandQueue();
+
+	uint64_t getTimestampFrequency() const override { return TimestampFrequency; }
+	void getClockCalibration(uint64_t& gpuTimestamp, uint64_t& cpuTime) override;
+
+	uint64_t getNumExecutedCommandLists() const { return m_numExecutedCommandLists; }
+	uint64_t getNumExecutedCommands() const { return m_numExecutedCommands; }
+	uint64_t getNumExecutedBytes() const { return m_numExecutedBytes; }
+
+protected:
+	std::shared_ptr<CommandList> createCommandList() override;
+	void submitCommandLists(uint32_t numCommandLists, CommandList* const* commandLists) override;
+	void signalFence(uint64_t fenceValue) override;
+	uint64_t getCompletedFenceValue() override;
+	void waitForQueueFence(CommandQueue& commandQueue, uint64_t fenceValue) override;
+	void waitForFence(uint64_t fenceValue, std::chrono::milliseconds duration) override;
+
+private:
+	std::atomic<uint64_t>	m_completedFenceValue;
+	// The synthetic GPU time at which the submitted work is finished
+	std::atomic<uint64_t>	m_gpuTimestamp;
+
+	uint64_t				m_numExecutedCommandLists;
+	uint64_t				m_numExecutedCommands;
+	uint64_t				m_numExecutedBytes;
+};
\ No newline at end of file
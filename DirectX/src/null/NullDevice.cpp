@@ -0,0 +1,322 @@
+#include "dxpch.h"
+#include "NullDevice.h"
+#include "NullCommandQueue.h"
+#include "NullObjects.h"
+#include "NullSwapChain.h"
+
+namespace
+{
+	// The layout of a descriptor in a null descriptor heap.
+	struct NullDescriptor
+	{
+		uint32_t viewType;
+		uint32_t reserved;
+		uint64_t resource;
+		uint64_t info;
+		uint64_t padding;
+	};
+
+	static_assert(sizeof(NullDescriptor) == NullDevice::DescriptorSize, "A null descriptor should fill a whole descriptor slot");
+
+	enum NullViewType : uint32_t
+	{
+		NullViewConstantBuffer = 1,
+		NullViewRenderTarget,
+		NullViewDepthStencil,
+		NullViewSampler
+	};
+
+	// The first (fake) GPU virtual address that is handed out.
+	const uint64_t NullGpuVirtualAddressStart = 0x100000000ull;
+
+	uint32_t GetFormatSize(DXGI_FORMAT format)
+	{
+		switch (format)
+		{
+		case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		case DXGI_FORMAT_R32G32B32A32_UINT:
+			return 16;
+		case DXGI_FORMAT_R32G32B32_FLOAT:
+		case DXGI_FORMAT_R32G32B32_UINT:
+			return 12;
+		case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		case DXGI_FORMAT_R16G16B16A16_UNORM:
+		case DXGI_FORMAT_R32G32_FLOAT:
+		case DXGI_FORMAT_R32G32_UINT:
+			return 8;
+		case DXGI_FORMAT_R16_FLOAT:
+		case DXGI_FORMAT_R16_UNORM:
+		case DXGI_FORMAT_R16_UINT:
+		case DXGI_FORMAT_R8G8_UNORM:
+		case DXGI_FORMAT_D16_UNORM:
+			return 2;
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_R8_UINT:
+		case DXGI_FORMAT_A8_UNORM:
+			return 1;
+		default:
+			// Most formats that are used by the renderer are 32 bits per pixel
+			return 4;
+		}
+	}
+}
+
+std::shared_ptr<Device> Device::CreateNullDevice()
+{
+	return std::make_shared<NullDevice>();
+}
+
+NullDevice::NullDevice()
+	:	m_nextGpuVirtualAddress(NullGpuVirtualAddressStart)
+{
+}
+
+std::shared_ptr<CommandQueue> NullDevice::createCommandQueue(D3D12_COMMAND_LIST_TYPE type)
+{
+	return std::make_shared<NullCommandQueue>(type);
+}
+
+std::shared_ptr<SwapChain> NullDevice::createSwapChain(std::shared_ptr<CommandQueue> commandQueue, const Window& window,
+	uint32_t width, uint32_t height, uint32_t bufferCount, bool tearingSupported)
+{
+	return std::make_shared<NullSwapChain>(shared_from_this(), width, height, bufferCount);
+}
+
+Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> NullDevice::createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC& desc)
+{
+	D3D12_GPU_VIRTUAL_ADDRESS gpuVirtualAddress = 0;
+	if (desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)
+	{
+		gpuVirtualAddress = allocateGpuVirtualAddress(static_cast<uint64_t>(desc.NumDescriptors) * DescriptorSize);
+	}
+
+	ComPtr<ID3D12DescriptorHeap> descriptorHeap;
+	descriptorHeap.Attach(new NullDescriptorHeap(desc, DescriptorSize, gpuVirtualAddress));
+
+	return descriptorHeap;
+}
+
+uint32_t NullDevice::getDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const
+{
+	return DescriptorSize;
+}
+
+void NullDevice::copyDescriptors(uint32_t numDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* destDescriptorRangeStarts, const UINT* destDescriptorRangeSizes,
+	uint32_t numSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptorRangeStarts, const UINT* srcDescriptorRangeSizes,
+	D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+	// Walk the source and destination ranges at the same time and copy
+	// the largest contiguous run that fits in both ranges at once.
+	uint32_t destRange = 0;
+	uint32_t destOffset = 0;
+
+	for (uint32_t srcRange = 0; srcRange < numSrcDescriptorRanges; ++srcRange)
+	{
+		uint32_t srcSize = srcDescriptorRangeSizes != nullptr ? srcDescriptorRangeSizes[srcRange] : 1;
+		uint32_t srcOffset = 0;
+
+		while (srcOffset < srcSize)
+		{
+			assert(destRange < numDestDescriptorRanges && "More source than destination descriptors");
+
+			uint32_t destSize = destDescriptorRangeSizes != nullptr ? destDescriptorRangeSizes[destRange] : 1;
+			uint32_t numDescriptors = std::min(srcSize - srcOffset, destSize - destOffset);
+
+			memcpy(reinterpret_cast<void*>(destDescriptorRangeStarts[destRange].ptr + static_cast<SIZE_T>(destOffset) * DescriptorSize),
+				reinterpret_cast<const void*>(srcDescriptorRangeStarts[srcRange].ptr + static_cast<SIZE_T>(srcOffset) * DescriptorSize),
+				static_cast<size_t>(numDescriptors) * DescriptorSize);
+
+			srcOffset += numDescriptors;
+			destOffset += numDescriptors;
+
+			if (destOffset == destSize)
+			{
+				++destRange;
+				destOffset = 0;
+			}
+		}
+	}
+}
+
+void NullDevice::copyDescriptorsSimple(uint32_t numDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptorRangeStart,
+	D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptorRangeStart, D3D12_DESCRIPTOR_HEAP_TYPE type)
+{
+	memcpy(reinterpret_cast<void*>(destDescriptorRangeStart.ptr), reinterpret_cast<const void*>(srcDescriptorRangeStart.ptr),
+		static_cast<size_t>(numDescriptors) * DescriptorSize);
+}
+
+void NullDevice::createConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	writeDescriptor(destDescriptor, NullViewConstantBuffer, desc.BufferLocation, desc.SizeInBytes);
+}
+
+void NullDevice::createRenderTargetView(ID3D12Resource* resource, const D3D12_RENDER_TARGET_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	writeDescriptor(destDescriptor, NullViewRenderTarget, reinterpret_cast<uint64_t>(resource), desc != nullptr ? desc->Format : 0);
+}
+
+void NullDevice::createDepthStencilView(ID3D12Resource* resource, const D3D12_DEPTH_STENCIL_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	writeDescriptor(destDescriptor, NullViewDepthStencil, reinterpret_cast<uint64_t>(resource), desc != nullptr ? desc->Format : 0);
+}
+
+void NullDevice::createSampler(const D3D12_SAMPLER_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor)
+{
+	writeDescriptor(destDescriptor, NullViewSampler, desc.Filter, desc.AddressU | (desc.AddressV << 8) | (desc.AddressW << 16));
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> NullDevice::createCommittedResource(const D3D12_HEAP_PROPERTIES& heapProperties, D3D12_HEAP_FLAGS heapFlags,
+	const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue)
+{
+	uint64_t sizeInBytes = getResourceSize(desc);
+
+	ComPtr<ID3D12Resource> resource;
+	resource.Attach(new NullResource(desc, heapProperties, heapFlags, allocateGpuVirtualAddress(sizeInBytes), sizeInBytes));
+
+	return resource;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Heap> NullDevice::createHeap(const D3D12_HEAP_DESC& desc)
+{
+	ComPtr<ID3D12Heap> heap;
+	heap.Attach(new NullHeap(desc, allocateGpuVirtualAddress(desc.SizeInBytes)));
+
+	return heap;
+}
+
+Microsoft::WRL::ComPtr<ID3D12Resource> NullDevice::createPlacedResource(ID3D12Heap* heap, uint64_t heapOffset, const D3D12_RESOURCE_DESC& desc,
+	D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue)
+{
+	NullHeap* nullHeap = static_cast<NullHeap*>(heap);
+	D3D12_HEAP_DESC heapDesc = nullHeap->GetDesc();
+
+	uint64_t sizeInBytes = getResourceSize(desc);
+	assert(heapOffset + sizeInBytes <= heapDesc.SizeInBytes && "The resource does not fit in the heap.");
+
+	// Placed resources in the same memory get the same GPU virtual addresses (CPU memory of mappable heaps is not shared)
+	ComPtr<ID3D12Resource> resource;
+	resource.Attach(new NullResource(desc, heapDesc.Properties, heapDesc.Flags, nullHeap->getGpuVirtualAddress() + heapOffset, sizeInBytes));
+
+	return resource;
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO NullDevice::getResourceAllocationInfo(const D3D12_RESOURCE_DESC& desc)
+{
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo;
+	allocationInfo.Alignment = desc.SampleDesc.Count > 1 ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+	allocationInfo.SizeInBytes = Math::AlignUp(std::max<uint64_t>(1, getResourceSize(desc)), allocationInfo.Alignment);
+
+	return allocationInfo;
+}
+
+void NullDevice::getCopyableFootprints(const D3D12_RESOURCE_DESC& desc, uint32_t firstSubresource, uint32_t numSubresources, uint64_t baseOffset,
+	D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizesInBytes, UINT64* totalBytes)
+{
+	bool isBuffer = desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER;
+	uint32_t mipLevels = std::max<uint32_t>(1, desc.MipLevels);
+
+	uint64_t offset = baseOffset;
+	for (uint32_t i = 0; i < numSubresources; ++i)
+	{
+		uint32_t mipSlice = (firstSubresource + i) % mipLevels;
+
+		uint32_t width = isBuffer ? static_cast<uint32_t>(desc.Width) : std::max<uint32_t>(1, static_cast<uint32_t>(desc.Width >> mipSlice));
+		uint32_t height = isBuffer ? 1 : std::max<uint32_t>(1, desc.Height >> mipSlice);
+		uint32_t depth = desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? std::max<uint32_t>(1, desc.DepthOrArraySize >> mipSlice) : 1;
+
+		uint64_t rowSize = isBuffer ? desc.Width : static_cast<uint64_t>(width) * GetFormatSize(desc.Format);
+		uint64_t rowPitch = isBuffer ? rowSize : Math::AlignUp(rowSize, D3D12_TEXTURE_DATA_PITCH_ALIGNMENT);
+
+		if (!isBuffer)
+		{
+			offset = Math::AlignUp(offset, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+		}
+
+		if (layouts != nullptr)
+		{
+			layouts[i].Offset = offset;
+			layouts[i].Footprint.Format = desc.Format;
+			layouts[i].Footprint.Width = width;
+			layouts[i].Footprint.Height = height;
+			layouts[i].Footprint.Depth = depth;
+			layouts[i].Footprint.RowPitch = static_cast<UINT>(rowPitch);
+		}
+		if (numRows != nullptr)
+		{
+			numRows[i] = height;
+		}
+		if (rowSizesInBytes != nullptr)
+		{
+			rowSizesInBytes[i] = rowSize;
+		}
+
+		offset += rowPitch * height * depth;
+	}
+
+	if (totalBytes != nullptr)
+	{
+		*totalBytes = offset - baseOffset;
+	}
+}
+
+Microsoft::WRL::ComPtr<ID3D12QueryHeap> NullDevice::createQueryHeap(const D3D12_QUERY_HEAP_DESC& desc)
+{
+	ComPtr<ID3D12QueryHeap> queryHeap;
+	queryHeap.Attach(new NullQueryHeap(desc));
+
+	return queryHeap;
+}
+
+D3D_ROOT_SIGNATURE_VERSION NullDevice::getHighestRootSignatureVersion()
+{
+	return D3D_ROOT_SIGNATURE_VERSION_1_1;
+}
+
+Microsoft::WRL::ComPtr<ID3D12RootSignature> NullDevice::createRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, D3D_ROOT_SIGNATURE_VERSION version)
+{
+	ComPtr<ID3D12RootSignature> rootSignature;
+	rootSignature.Attach(new NullRootSignature());
+
+	return rootSignature;
+}
+
+Microsoft::WRL::ComPtr<ID3D12PipelineState> NullDevice::createPipelineState(const D3D12_PIPELINE_STATE_STREAM_DESC& desc)
+{
+	ComPtr<ID3D12PipelineState> pipelineState;
+	pipelineState.Attach(new NullPipelineState());
+
+	return pipelineState;
+}
+
+D3D12_GPU_VIRTUAL_ADDRESS NullDevice::allocateGpuVirtualAddress(uint64_t sizeInBytes)
+{
+	uint64_t alignedSize = Math::AlignUp(std::max<uint64_t>(1, sizeInBytes), D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+	return m_nextGpuVirtualAddress.fetch_add(alignedSize);
+}
+
+uint64_t NullDevice::getResourceSize(const D3D12_RESOURCE_DESC& desc)
+{
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+	{
+		return desc.Width;
+	}
+
+	uint32_t numSubresources = std::max<uint32_t>(1, desc.MipLevels) *
+		(desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D ? 1 : desc.DepthOrArraySize);
+
+	UINT64 totalBytes = 0;
+	getCopyableFootprints(desc, 0, numSubresources, 0, nullptr, nullptr, nullptr, &totalBytes);
+
+	return totalBytes;
+}
+
+void NullDevice::writeDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor, uint32_t viewType, uint64_t resource, uint64_t info)
+{
+	NullDescriptor* descriptor = reinterpret_cast<NullDescriptor*>(destDescriptor.ptr);
+	descriptor->viewType = viewType;
+	descriptor->reserved = 0;
+	descriptor->resource = resource;
+	descriptor->info = info;
+	descriptor->padding = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Device.h"
+
+#include <atomic>
+
+/*
+*	Device backend without a GPU. Resources get fake GPU virtual addresses,
+*	descriptors are plain CPU memory, command lists are recorded into an in-memory
+*	stream and fences are signaled as soon as they are submitted.
+*	This allows running (and profiling) the CPU side of the renderer anywhere.
+*/
+class NullDevice : public Device
+{
+public:
+	// The size (in bytes) of a single descriptor in a null descriptor heap.
+	static const uint32_t DescriptorSize = 32;
+
+	NullDevice();
+	virtual ~NullDevice() = default;
+
+	bool isNullDevice() const override { return true; }
+
+	std::shared_ptr<CommandQueue> createCommandQueue(D3D12_COMMAND_LIST_TYPE type) override;
+	std::shared_ptr<SwapChain> createSwapChain(std::shared_ptr<CommandQueue> commandQueue, const Window& window,
+		uint32_t width, uint32_t height, uint32_t bufferCount, bool tearingSupported) override;
+
+	Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> createDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC& desc) override;
+	uint32_t getDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const override;
+
+	void copyDescriptors(uint32_t numDestDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* destDescriptorRangeStarts, const UINT* destDescriptorRangeSizes,
+		uint32_t numSrcDescriptorRanges, const D3D12_CPU_DESCRIPTOR_HANDLE* srcDescriptorRangeStarts, const UINT* srcDescriptorRangeSizes,
+		D3D12_DESCRIPTOR_HEAP_TYPE type) override;
+	void copyDescriptorsSimple(uint32_t numDescriptors, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptorRangeStart,
+		D3D12_CPU_DESCRIPTOR_HANDLE srcDescriptorRangeStart, D3D12_DESCRIPTOR_HEAP_TYPE type) override;
+
+	void createConstantBufferView(const D3D12_CONSTANT_BUFFER_VIEW_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override;
+	void createRenderTargetView(ID3D12Resource* resource, const D3D12_RENDER_TARGET_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override;
+	void createDepthStencilView(ID3D12Resource* resource, const D3D12_DEPTH_STENCIL_VIEW_DESC* desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override;
+	void createSampler(const D3D12_SAMPLER_DESC& desc, D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor) override;
+
+	Microsoft::WRL::ComPtr<ID3D12Resource> createCommittedResource(const D3D12_HEAP_PROPERTIES& heapProperties, D3D12_HEAP_FLAGS heapFlags,
+		const D3D12_RESOURCE_DESC& desc, D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue = nullptr) override;
+
+	Microsoft::WRL::ComPtr<ID3D12Heap> createHeap(const D3D12_HEAP_DESC& desc) override;
+	Microsoft::WRL::ComPtr<ID3D12Resource> createPlacedResource(ID3D12Heap* heap, uint64_t heapOffset, const D3D12_RESOURCE_DESC& desc,
+		D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE* optimizedClearValue = nullptr) override;
+	D3D12_RESOURCE_ALLOCATION_INFO getResourceAllocationInfo(const D3D12_RESOURCE_DESC& desc) override;
+
+	void getCopyableFootprints(const D3D12_RESOURCE_DESC& desc, uint32_t firstSubresource, uint32_t numSubresources, uint64_t baseOffset,
+		D3D12_PLACED_SUBRESOURCE_FOOTPRINT* layouts, UINT* numRows, UINT64* rowSizesInBytes, UINT64* totalBytes) override;
+
+	Microsoft::WRL::ComPtr<ID3D12QueryHeap> createQueryHeap(const D3D12_QUERY_HEAP_DESC& desc) override;
+
+	D3D_ROOT_SIGNATURE_VERSION getHighestRootSignatureVersion() override;
+	Microsoft::WRL::ComPtr<ID3D12RootSignature> createRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC& desc, D3D_ROOT_SIGNATURE_VERSION version) override;
+	Microsoft::WRL::ComPtr<ID3D12PipelineState> createPipelineState(const D3D12_PIPELINE_STATE_STREAM_DESC& desc) override;
+
+private:
+	// Reserve a range of (fake) GPU virtual addresses.
+	D3D12_GPU_VIRTUAL_ADDRESS allocateGpuVirtualAddress(uint64_t sizeInBytes);
+
+	// Compute the size of the resource in memory.
+	uint64_t getResourceSize(const D3D12_RESOURCE_DESC& desc);
+
+	// Write a view description in a descriptor of a null descriptor heap.
+	void writeDescriptor(D3D12_CPU_DESCRIPTOR_HANDLE destDescriptor, uint32_t viewType, uint64_t resource, uint64_t info);
+
+private:
+	std::atomic<uint64_t>	m_nextGpuVirtualAddress;
+};
\ No newline at end of file
@@ -0,0 +1,227 @@
+#pragma once
+
+#include "d3dx12.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+/*
+*	Minimal COM implementations of the D3D12 objects that the null device hands out.
+*	They only carry the data the renderer queries (descriptions, fake GPU virtual
+*	addresses and CPU memory for mappable heaps), so the rest of the renderer can keep
+*	using ComPtr<ID3D12Resource> and friends regardless of the backend.
+*/
+template<typename Interface>
+class NullObject : public Interface
+{
+public:
+	NullObject()
+		:	m_refCount(1)
+	{}
+	virtual ~NullObject() = default;
+
+	// IUnknown
+	HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override
+	{
+		if (ppvObject == nullptr)
+		{
+			return E_POINTER;
+		}
+
+		if (riid == __uuidof(IUnknown) || riid == __uuidof(Interface))
+		{
+			AddRef();
+			*ppvObject = static_cast<Interface*>(this);
+			return S_OK;
+		}
+
+		*ppvObject = nullptr;
+		return E_NOINTERFACE;
+	}
+
+	ULONG STDMETHODCALLTYPE AddRef() override
+	{
+		return ++m_refCount;
+	}
+
+	ULONG STDMETHODCALLTYPE Release() override
+	{
+		ULONG refCount = --m_refCount;
+		if (refCount == 0)
+		{
+			delete this;
+		}
+
+		return refCount;
+	}
+
+	// ID3D12Object
+	HRESULT STDMETHODCALLTYPE GetPrivateData(REFGUID guid, UINT* pDataSize, void* pData) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateData(REFGUID guid, UINT DataSize, const void* pData) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetPrivateDataInterface(REFGUID guid, const IUnknown* pData) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE SetName(LPCWSTR Name) override { return S_OK; }
+
+	// ID3D12DeviceChild
+	HRESULT STDMETHODCALLTYPE GetDevice(REFIID riid, void** ppvDevice) override
+	{
+		// The null device is not a COM object
+		if (ppvDevice != nullptr)
+		{
+			*ppvDevice = nullptr;
+		}
+		return E_NOINTERFACE;
+	}
+
+private:
+	std::atomic<ULONG> m_refCount;
+};
+
+class NullResource : public NullObject<ID3D12Resource>
+{
+public:
+	NullResource(const D3D12_RESOURCE_DESC& desc, const D3D12_HEAP_PROPERTIES& heapProperties, D3D12_HEAP_FLAGS heapFlags,
+		D3D12_GPU_VIRTUAL_ADDRESS gpuVirtualAddress, uint64_t sizeInBytes)
+		:	m_desc(desc),
+			m_heapProperties(heapProperties),
+			m_heapFlags(heapFlags),
+			m_gpuVirtualAddress(gpuVirtualAddress),
+			m_sizeInBytes(sizeInBytes)
+	{
+		// Only CPU accessible heaps get backing memory, all other data only lives on the "GPU".
+		if (m_heapProperties.Type == D3D12_HEAP_TYPE_UPLOAD || m_heapProperties.Type == D3D12_HEAP_TYPE_READBACK)
+		{
+			m_cpuMemory = std::make_unique<uint8_t[]>(static_cast<size_t>(m_sizeInBytes));
+		}
+	}
+
+	HRESULT STDMETHODCALLTYPE Map(UINT Subresource, const D3D12_RANGE* pReadRange, void** ppData) override
+	{
+		if (m_cpuMemory == nullptr)
+		{
+			return E_INVALIDARG;
+		}
+
+		if (ppData != nullptr)
+		{
+			*ppData = m_cpuMemory.get();
+		}
+		return S_OK;
+	}
+
+	void STDMETHODCALLTYPE Unmap(UINT Subresource, const D3D12_RANGE* pWrittenRange) override {}
+
+	D3D12_RESOURCE_DESC STDMETHODCALLTYPE GetDesc() override { return m_desc; }
+
+	D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE GetGPUVirtualAddress() override
+	{
+		// Like D3D12, only buffers have a GPU virtual address
+		return m_desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ? m_gpuVirtualAddress : 0;
+	}
+
+	HRESULT STDMETHODCALLTYPE WriteToSubresource(UINT DstSubresource, const D3D12_BOX* pDstBox, const void* pSrcData, UINT SrcRowPitch, UINT SrcDepthPitch) override { return E_NOTIMPL; }
+	HRESULT STDMETHODCALLTYPE ReadFromSubresource(void* pDstData, UINT DstRowPitch, UINT DstDepthPitch, UINT SrcSubresource, const D3D12_BOX* pSrcBox) override { return E_NOTIMPL; }
+
+	HRESULT STDMETHODCALLTYPE GetHeapProperties(D3D12_HEAP_PROPERTIES* pHeapProperties, D3D12_HEAP_FLAGS* pHeapFlags) override
+	{
+		if (pHeapProperties != nullptr)
+		{
+			*pHeapProperties = m_heapProperties;
+		}
+		if (pHeapFlags != nullptr)
+		{
+			*pHeapFlags = m_heapFlags;
+		}
+		return S_OK;
+	}
+
+	uint64_t getSizeInBytes() const { return m_sizeInBytes; }
+
+private:
+	D3D12_RESOURCE_DESC			m_desc;
+	D3D12_HEAP_PROPERTIES		m_heapProperties;
+	D3D12_HEAP_FLAGS			m_heapFlags;
+	D3D12_GPU_VIRTUAL_ADDRESS	m_gpuVirtualAddress;
+	uint64_t					m_sizeInBytes;
+
+	std::unique_ptr<uint8_t[]>	m_cpuMemory;
+};
+
+class NullHeap : public NullObject<ID3D12Heap>
+{
+public:
+	NullHeap(const D3D12_HEAP_DESC& desc, D3D12_GPU_VIRTUAL_ADDRESS gpuVirtualAddress)
+		:	m_desc(desc),
+			m_gpuVirtualAddress(gpuVirtualAddress)
+	{}
+
+	D3D12_HEAP_DESC STDMETHODCALLTYPE GetDesc() override { return m_desc; }
+
+	// The GPU virtual address of the start of the heap, placed resources are offset from it
+	D3D12_GPU_VIRTUAL_ADDRESS getGpuVirtualAddress() const { return m_gpuVirtualAddress; }
+
+private:
+	D3D12_HEAP_DESC				m_desc;
+	D3D12_GPU_VIRTUAL_ADDRESS	m_gpuVirtualAddress;
+};
+
+class NullQueryHeap : public NullObject<ID3D12QueryHeap>
+{
+public:
+	explicit NullQueryHeap(const D3D12_QUERY_HEAP_DESC& desc)
+		:	m_desc(desc)
+	{
+		m_results = std::make_unique<uint64_t[]>(desc.Count);
+	}
+
+	const D3D12_QUERY_HEAP_DESC& getDesc() const { return m_desc; }
+
+	// A 64 bit result per query, written when a NullCommandQueue executes the queries
+	uint64_t* getResults() { return m_results.get(); }
+
+private:
+	D3D12_QUERY_HEAP_DESC		m_desc;
+
+	std::unique_ptr<uint64_t[]>	m_results;
+};
+
+class NullDescriptorHeap : public NullObject<ID3D12DescriptorHeap>
+{
+public:
+	NullDescriptorHeap(const D3D12_DESCRIPTOR_HEAP_DESC& desc, uint32_t descriptorSize, D3D12_GPU_VIRTUAL_ADDRESS gpuVirtualAddress)
+		:	m_desc(desc),
+			m_gpuVirtualAddress(gpuVirtualAddress)
+	{
+		// The descriptors are plain CPU memory, so descriptor copies cost the same memory traffic as on a real device.
+		m_descriptors = std::make_unique<uint8_t[]>(static_cast<size_t>(desc.NumDescriptors) * descriptorSize);
+	}
+
+	D3D12_DESCRIPTOR_HEAP_DESC STDMETHODCALLTYPE GetDesc() override { return m_desc; }
+
+	D3D12_CPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetCPUDescriptorHandleForHeapStart() override
+	{
+		return { reinterpret_cast<SIZE_T>(m_descriptors.get()) };
+	}
+
+	D3D12_GPU_DESCRIPTOR_HANDLE STDMETHODCALLTYPE GetGPUDescriptorHandleForHeapStart() override
+	{
+		// Like D3D12, only shader visible heaps have a GPU handle
+		return { (m_desc.Flags & D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE) ? m_gpuVirtualAddress : 0 };
+	}
+
+private:
+	D3D12_DESCRIPTOR_HEAP_DESC	m_desc;
+	D3D12_GPU_VIRTUAL_ADDRESS	m_gpuVirtualAddress;
+
+	std::unique_ptr<uint8_t[]>	m_descriptors;
+};
+
+class NullRootSignature : public NullObject<ID3D12RootSignature>
+{
+};
+
+class NullPipelineState : public NullObject<ID3D12PipelineState>
+{
+public:
+	HRESULT STDMETHODCALLTYPE GetCachedBlob(ID3DBlob** ppBlob) override { return E_NOTIMPL; }
+};
\ No newline at end of file
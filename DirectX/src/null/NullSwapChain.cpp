@@ -0,0 +1,49 @@
+#include "dxpch.h"
+#include "NullSwapChain.h"
+#include "Device.h"
+
+NullSwapChain::NullSwapChain(std::shared_ptr<Device> device, uint32_t width, uint32_t height, uint32_t bufferCount)
+    :   SwapChain(device, bufferCount)
+{
+    updateBackBuffers(width, height);
+}
+
+uint32_t NullSwapChain::present()
+{
+    m_currentBackBufferIndex = (m_currentBackBufferIndex + 1) % m_bufferCount;
+
+    return m_currentBackBufferIndex;
+}
+
+void NullSwapChain::resize(uint32_t width, uint32_t height)
+{
+    m_currentBackBufferIndex = 0;
+
+    updateBackBuffers(width, height);
+}
+
+void NullSwapChain::setMaximumFrameLatency(uint32_t maxLatency)
+{
+}
+
+bool NullSwapChain::waitForNextFrame(std::chrono::milliseconds timeout)
+{
+    // Nothing is ever queued for presentation
+    return true;
+}
+
+void NullSwapChain::updateBackBuffers(uint32_t width, uint32_t height)
+{
+    m_backBuffers.clear();
+
+    CD3DX12_HEAP_PROPERTIES heapProperties(D3D12_HEAP_TYPE_DEFAULT);
+    CD3DX12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_R8G8B8A8_UNORM, width, height,
+        1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
+
+    for (uint32_t i = 0; i < m_bufferCount; ++i)
+    {
+        m_backBuffers.push_back(m_device->createCommittedResource(heapProperties, D3D12_HEAP_FLAG_NONE, desc, D3D12_RESOURCE_STATE_PRESENT));
+    }
+
+    updateRenterTargetViews();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "SwapChain.h"
+
+/*
+*	Swap chain backend without a window. The back buffers are regular render target
+*	textures created by the device and presenting only moves to the next back buffer.
+*/
+class NullSwapChain : public SwapChain
+{
+public:
+	NullSwapChain(std::shared_ptr<Device> device, uint32_t width, uint32_t height, uint32_t bufferCount);
+	virtual ~NullSwapChain() = default;
+
+	uint32_t present() override;
+
+	void resize(uint32_t width, uint32_t height) override;
+
+	void setMaximumFrameLatency(uint32_t maxLatency) override;
+	bool waitForNextFrame(std::chrono::milliseconds timeout) override;
+
+private:
+	// Create the back buffer textures and their render target views
+	void updateBackBuffers(uint32_t width, uint32_t height);
+};
\ No newline at end of file